@@ -0,0 +1,157 @@
+//
+// Measures the cost per message of logging paths that are meant to be cheap enough for hot code, so that changes
+// to them can be compared objectively:
+//   - deferred: LOG_DEFERRED_TRACE with three integer arguments, and the cost of formatting it later in Flush
+//   - deferred-disabled: LOG_DEFERRED_TRACE on a channel that is masked out
+//   - formatted: LOG_TRACE with the same arguments, for comparison
+//   - log-file: short lines through LogWrite with the log file open, from one or more threads
+//
+// Usage: hoffgui_log_benchmark [--log-file path] [--threads N]
+//
+// Log output goes to the null device; results are printed to stderr.
+//
+
+#include "Core/DeferredLog.h"
+#include "Core/Log.h"
+#include "Core/StringHelpers.h"
+#include "Core/hp_assert.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+static const char* kNullDevice = "NUL";
+#else
+static const char* kNullDevice = "/dev/null";
+#endif
+
+// Small enough for a batch of records to fit in the ring, so that none are dropped
+static const unsigned int kDeferredBatchCount = 8192;
+static const unsigned int kDeferredBatchRepeat = 64;
+static const unsigned int kFormattedCount = 200000;
+static const unsigned int kLogFileLineCount = 2000000;
+
+static double secondsSince(std::chrono::steady_clock::time_point startTime)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+static void printUsage()
+{
+	fprintf(stderr, "Usage: hoffgui_log_benchmark [--log-file path] [--threads N]\n");
+}
+
+static void benchmarkDeferred()
+{
+	// Best batch, to exclude interruptions
+	double bestRecordSeconds = 1.0;
+	double totalFlushSeconds = 0.0;
+	unsigned int flushedCount = 0;
+	for (unsigned int repeat = 0; repeat < kDeferredBatchRepeat; repeat++)
+	{
+		const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < kDeferredBatchCount; i++)
+			LOG_DEFERRED_TRACE(General, "Row %u: note %u volume %u\n", i, i * 3, i & 63);
+		bestRecordSeconds = Min(bestRecordSeconds, secondsSince(startTime) / kDeferredBatchCount);
+
+		const std::chrono::steady_clock::time_point flushStartTime = std::chrono::steady_clock::now();
+		flushedCount += DeferredLog::Flush();
+		totalFlushSeconds += secondsSince(flushStartTime);
+	}
+	fprintf(stderr, "%-18s %8.2f ns/record, %8.2f ns/record to flush\n", "deferred", bestRecordSeconds * 1e9, totalFlushSeconds * 1e9 / Max(flushedCount, 1u));
+	if (flushedCount != kDeferredBatchCount * kDeferredBatchRepeat)
+		fprintf(stderr, "WARNING: %u records dropped\n", kDeferredBatchCount * kDeferredBatchRepeat - flushedCount);
+
+	SetLogChannelMask(kLogChannelMaskAll & ~LOG_CHANNEL_BIT(LogChannel::General));
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < kFormattedCount; i++)
+		LOG_DEFERRED_TRACE(General, "Row %u: note %u volume %u\n", i, i * 3, i & 63);
+	fprintf(stderr, "%-18s %8.2f ns/record\n", "deferred-disabled", secondsSince(startTime) * 1e9 / kFormattedCount);
+	SetLogChannelMask(kLogChannelMaskAll);
+}
+
+static void benchmarkFormatted()
+{
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < kFormattedCount; i++)
+		LOG_TRACE("Row %u: note %u volume %u\n", i, i * 3, i & 63);
+	fprintf(stderr, "%-18s %8.2f ns/message\n", "formatted", secondsSince(startTime) * 1e9 / kFormattedCount);
+}
+
+static bool benchmarkLogFile(const char* path, unsigned int threadCount)
+{
+	FILE* pNullStream = fopen(kNullDevice, "w");
+	if (!pNullStream || !OpenLogFile(path))
+	{
+		fprintf(stderr, "Failed to open log file: %s\n", path);
+		return false;
+	}
+
+	const unsigned int linesPerThread = kLogFileLineCount / threadCount;
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (unsigned int threadIndex = 0; threadIndex < threadCount; threadIndex++)
+	{
+		threads.emplace_back([pNullStream, threadIndex, linesPerThread]
+		{
+			char line[64];
+			for (unsigned int i = 0; i < linesPerThread; i++)
+			{
+				const int length = snprintf(line, sizeof(line), "Thread %u line %u\n", threadIndex, i);
+				LogWrite(pNullStream, line, (size_t)length);
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+	const double seconds = secondsSince(startTime);
+	CloseLogFile();
+	fclose(pNullStream);
+
+	fprintf(stderr, "%-18s %8.2f M lines/s from %u thread(s), see %s for dropped lines\n", "log-file", linesPerThread * threadCount / seconds * 1e-6, threadCount, path);
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* logFilePath = "hoffgui_log_benchmark.log";
+	unsigned int threadCount = 1;
+
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		const bool hasValue = argIndex + 1 < argc;
+		if (strcmp(argv[argIndex], "--log-file") == 0 && hasValue)
+			logFilePath = argv[++argIndex];
+		else if (strcmp(argv[argIndex], "--threads") == 0 && hasValue)
+			threadCount = Max(1u, (unsigned int)strtoul(argv[++argIndex], nullptr, 10));
+		else
+		{
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!freopen(kNullDevice, "w", stdout))
+	{
+		fprintf(stderr, "Failed to redirect stdout\n");
+		return EXIT_FAILURE;
+	}
+	SetLogLevel(LOG_LEVEL_TRACE);
+
+#if LOG_COMPILE_LEVEL < LOG_LEVEL_TRACE
+	fprintf(stderr, "Trace logging is compiled out of this build; build with -DLOG_COMPILE_LEVEL=2 to measure it\n");
+#endif
+
+	benchmarkDeferred();
+	benchmarkFormatted();
+	const bool succeeded = benchmarkLogFile(logFilePath, threadCount);
+
+	DeferredLog::Shutdown();
+	return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
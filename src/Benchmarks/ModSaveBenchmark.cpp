@@ -0,0 +1,115 @@
+//
+// Measures saving a module after small edits, so that changes to ModDocument::Save can be compared objectively:
+//   - in-place: one-byte edits saved by overwriting the dirty range
+//   - rewrite: the same edits saved by rewriting the whole file atomically, as after a resize
+//
+// Usage: hoffgui_mod_save_benchmark [--path file] [--size-kb N]
+//
+// The file is created, overwritten and deleted. Results are printed to stderr.
+//
+
+#include "Mod/ModDocument.h"
+
+#include "Core/Log.h"
+#include "Core/hp_assert.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <vector>
+
+static const unsigned int kSaveCount = 200;
+
+static double secondsSince(std::chrono::steady_clock::time_point startTime)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+static void printUsage()
+{
+	fprintf(stderr, "Usage: hoffgui_mod_save_benchmark [--path file] [--size-kb N]\n");
+}
+
+// Returns the mean and worst save times in milliseconds
+static bool benchmarkSaves(ModDocument& document, bool rewrite, double& meanMs, double& worstMs)
+{
+	double totalSeconds = 0.0;
+	double worstSeconds = 0.0;
+	for (unsigned int saveIndex = 0; saveIndex < kSaveCount; saveIndex++)
+	{
+		// Spread over the module, as edits to different patterns would be
+		const uint64_t offset = (saveIndex * 7919ull) % document.GetDataSizeBytes();
+		const uint8_t byte = (uint8_t)saveIndex;
+		if (!document.Write(offset, &byte, 1))
+			return false;
+		if (rewrite)
+		{
+			// Growing and shrinking back marks the whole file for rewriting
+			document.Resize(document.GetDataSizeBytes() + 1);
+			document.Resize(document.GetDataSizeBytes() - 1);
+		}
+
+		const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		if (!document.Save())
+			return false;
+		const double seconds = secondsSince(startTime);
+		totalSeconds += seconds;
+		worstSeconds = Max(worstSeconds, seconds);
+	}
+	meanMs = totalSeconds * 1e3 / kSaveCount;
+	worstMs = worstSeconds * 1e3;
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	const char* path = "hoffgui_mod_save_benchmark.mod";
+	unsigned int sizeKB = 2048;
+
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		const bool hasValue = argIndex + 1 < argc;
+		if (strcmp(argv[argIndex], "--path") == 0 && hasValue)
+			path = argv[++argIndex];
+		else if (strcmp(argv[argIndex], "--size-kb") == 0 && hasValue)
+			sizeKB = Max(1u, (unsigned int)strtoul(argv[++argIndex], nullptr, 10));
+		else
+		{
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::vector<uint8_t> data((size_t)sizeKB * 1024);
+	for (size_t i = 0; i < data.size(); i++)
+		data[i] = (uint8_t)(i * 31);
+
+	ModDocument document;
+	document.New();
+	document.Resize(data.size());
+	document.Write(0, data.data(), data.size());
+	if (!document.SaveAs(path))
+	{
+		fprintf(stderr, "Failed to create %s\n", path);
+		return EXIT_FAILURE;
+	}
+
+	double inPlaceMeanMs = 0.0, inPlaceWorstMs = 0.0;
+	double rewriteMeanMs = 0.0, rewriteWorstMs = 0.0;
+	const bool succeeded = benchmarkSaves(document, /*rewrite*/false, inPlaceMeanMs, inPlaceWorstMs)
+		&& benchmarkSaves(document, /*rewrite*/true, rewriteMeanMs, rewriteWorstMs);
+	remove(path);
+	if (!succeeded)
+	{
+		fprintf(stderr, "Save failed\n");
+		return EXIT_FAILURE;
+	}
+
+	fprintf(stderr, "%u KB module, %u one-byte edits each saved separately\n", sizeKB, kSaveCount);
+	fprintf(stderr, "%-10s %8.3f ms/save mean, %8.3f ms worst\n", "in-place", inPlaceMeanMs, inPlaceWorstMs);
+	fprintf(stderr, "%-10s %8.3f ms/save mean, %8.3f ms worst\n", "rewrite", rewriteMeanMs, rewriteWorstMs);
+	return EXIT_SUCCESS;
+}
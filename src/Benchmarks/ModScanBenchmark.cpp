@@ -0,0 +1,128 @@
+//
+// Measures scanning for embedded modules (see ModScanner), so that changes to the scanner can be compared
+// objectively. Scans pseudo-random data with synthetic modules planted in it, on one thread and then on several,
+// and checks that exactly the planted modules are found.
+//
+// Usage: hoffgui_mod_scan_benchmark [--size-mb N] [--threads N]
+//
+// --threads 0, the default, is one per core. Results are printed to stderr.
+//
+
+#include "Mod/ModScanner.h"
+
+#include "Core/Log.h"
+#include "Core/hp_assert.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static const unsigned int kRunCount = 5; // the fastest is reported
+static const unsigned int kPlantedModuleCount = 16;
+
+static double secondsSince(std::chrono::steady_clock::time_point startTime)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+static void printUsage()
+{
+	fprintf(stderr, "Usage: hoffgui_mod_scan_benchmark [--size-mb N] [--threads N]\n");
+}
+
+// A 4 channel module of 4 empty patterns and one sample
+static void plantModule(uint8_t* pModule, unsigned int moduleIndex)
+{
+	static const unsigned int kPatternCount = 4;
+	static const unsigned int kSampleLengthWords = 1000;
+
+	memset(pModule, 0, 1084 + kPatternCount * 1024);
+	snprintf((char*)pModule, 20, "planted %u", moduleIndex);
+	uint8_t* pSample = pModule + 20;
+	pSample[22] = (uint8_t)(kSampleLengthWords >> 8);
+	pSample[23] = (uint8_t)kSampleLengthWords;
+	pSample[25] = 64; // volume
+	pSample[29] = 1; // no loop
+	pModule[950] = kPatternCount; // song length
+	for (unsigned int orderIndex = 0; orderIndex < kPatternCount; orderIndex++)
+		pModule[952 + orderIndex] = (uint8_t)orderIndex;
+	memcpy(pModule + 1080, "M.K.", 4);
+}
+
+// Returns the fastest time in seconds
+static double benchmarkScans(const std::vector<uint8_t>& data, unsigned int threadCount, std::vector<ModScanner::Hit>& hits)
+{
+	double fastestSeconds = 0.0;
+	for (unsigned int runIndex = 0; runIndex < kRunCount; runIndex++)
+	{
+		const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+		ModScanner::Scan(data.data(), data.size(), threadCount, hits);
+		const double seconds = secondsSince(startTime);
+		if (runIndex == 0 || seconds < fastestSeconds)
+			fastestSeconds = seconds;
+	}
+	return fastestSeconds;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned int sizeMB = 1024;
+	unsigned int threadCount = 0;
+
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		const bool hasValue = argIndex + 1 < argc;
+		if (strcmp(argv[argIndex], "--size-mb") == 0 && hasValue)
+			sizeMB = Max(1u, (unsigned int)strtoul(argv[++argIndex], nullptr, 10));
+		else if (strcmp(argv[argIndex], "--threads") == 0 && hasValue)
+			threadCount = (unsigned int)strtoul(argv[++argIndex], nullptr, 10);
+		else
+		{
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+	if (threadCount == 0)
+		threadCount = Max(std::thread::hardware_concurrency(), 1u);
+
+	// xorshift64, so that runs are repeatable
+	std::vector<uint8_t> data((size_t)sizeMB * 1024 * 1024);
+	uint64_t state = 0x9E3779B97F4A7C15ull;
+	for (size_t offset = 0; offset + sizeof(state) <= data.size(); offset += sizeof(state))
+	{
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		memcpy(&data[offset], &state, sizeof(state));
+	}
+
+	const size_t spacingBytes = data.size() / kPlantedModuleCount;
+	if (spacingBytes < 16 * 1024)
+	{
+		fprintf(stderr, "Too small to plant %u modules\n", kPlantedModuleCount);
+		return EXIT_FAILURE;
+	}
+	for (unsigned int moduleIndex = 0; moduleIndex < kPlantedModuleCount; moduleIndex++)
+		plantModule(&data[moduleIndex * spacingBytes + moduleIndex * 7], moduleIndex); // 7 so that alignment varies
+
+	std::vector<ModScanner::Hit> hits;
+	const double singleThreadSeconds = benchmarkScans(data, 1, hits);
+	const size_t singleThreadHitCount = hits.size();
+	const double multiThreadSeconds = benchmarkScans(data, threadCount, hits);
+	if (singleThreadHitCount != kPlantedModuleCount || hits.size() != kPlantedModuleCount)
+	{
+		fprintf(stderr, "Found %u and %u modules, but planted %u\n", (unsigned int)singleThreadHitCount, (unsigned int)hits.size(), kPlantedModuleCount);
+		return EXIT_FAILURE;
+	}
+
+	const double sizeGB = (double)data.size() / (1024.0 * 1024.0 * 1024.0);
+	fprintf(stderr, "%u MB scanned, %u planted modules found, fastest of %u runs\n", sizeMB, kPlantedModuleCount, kRunCount);
+	fprintf(stderr, "%2u thread(s) %8.3f s %8.2f GB/s\n", 1u, singleThreadSeconds, sizeGB / singleThreadSeconds);
+	fprintf(stderr, "%2u thread(s) %8.3f s %8.2f GB/s\n", threadCount, multiThreadSeconds, sizeGB / multiThreadSeconds);
+	return EXIT_SUCCESS;
+}
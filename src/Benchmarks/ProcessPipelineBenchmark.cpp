@@ -0,0 +1,322 @@
+//
+// Measures how fast child process output moves through Process::Launch, the log and into the Output window
+// buffer, so that changes to that path can be compared objectively.
+//
+// Each scenario launches hoffgui_fake_tool, which stamps lines with the time they were written. Latency is
+// measured when the chunk has been committed to OutputBuffer, via the same log sink callbacks as hoffgui.
+//
+// Usage: hoffgui_process_benchmark [--tool path] [--scenario name] [--repeat N] [--csv path] [--show-log]
+//
+// Reports per scenario:
+//   - throughput: child output bytes / wall time from launch to exit
+//   - latency: child write to visible in OutputBuffer, p50/p99/max. "-", or empty in the CSV, for scenarios
+//     without timestamps.
+//   - parent CPU: hoffgui-side user+system CPU time, total and per MB
+//
+
+#include "HoffGui/OutputBuffer.h"
+
+#include "Core/ProcessStats.h"
+#include "Core/ProcessWrap.h"
+#include "Core/StringHelpers.h"
+#include "Core/Log.h"
+#include "Core/hp_assert.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+static const char* kFakeToolFilename = "hoffgui_fake_tool.exe";
+static const char* kNullDevice = "NUL";
+#else
+static const char* kFakeToolFilename = "hoffgui_fake_tool";
+static const char* kNullDevice = "/dev/null";
+#endif
+
+static const unsigned int kMaxToolArgs = 16;
+
+struct Scenario
+{
+	const char* name;
+	const char* toolArgs[kMaxToolArgs]; // null terminated
+};
+
+// Every 64th line is stamped for latency measurement, except in short-lines, where a timestamp wouldn't fit
+static const Scenario kScenarios[] =
+{
+	{ "bulk-stdout",  { "--bytes", "67108864", "--line-length", "80", nullptr } },
+	{ "both-streams", { "--bytes", "16777216", "--stream", "both", nullptr } },
+	{ "progress",     { "--bytes", "8388608", "--progress-every", "1", nullptr } },
+	{ "long-lines",   { "--bytes", "33554432", "--line-length", "4096", nullptr } },
+	{ "short-lines",  { "--bytes", "8388608", "--line-length", "8", "--timestamp-every", "0", nullptr } },
+	{ "small-writes", { "--bytes", "4194304", "--chunk-bytes", "80", nullptr } },
+	{ "paced-4MBps",  { "--bytes", "8388608", "--rate-kbps", "4096", nullptr } },
+	{ "percent",      { "--bytes", "16777216", "--pattern", "percent", nullptr } },
+	{ "ansi-colour",  { "--bytes", "67108864", "--pattern", "ansi", nullptr } },
+};
+
+struct RunResult
+{
+	unsigned int exitCode = 0;
+	uint64_t childBytes = 0;
+	uint64_t outputBufferBytes = 0;
+	double wallSeconds = 0.0;
+	double parentCpuSeconds = 0.0;
+	std::vector<double> latenciesMicroseconds;
+};
+
+static RunResult* s_pCurrentRunResult;
+static std::vector<uint64_t> s_pendingWriteTimes;
+
+//------------------------------------------------------------------------------------------------
+
+static uint64_t nowNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// n.b. A timestamp split across two chunks is skipped, which is rare enough not to bias the result
+static void findWriteTimes(const char* text, size_t len, std::vector<uint64_t>& writeTimes)
+{
+	static const unsigned int kTimestampDigits = 20;
+	const char* pEnd = text + len;
+	for (const char* p = text; p + 2 + kTimestampDigits <= pEnd; p++)
+	{
+		p = (const char*)memchr(p, '@', (size_t)(pEnd - p));
+		if (!p || p + 2 + kTimestampDigits > pEnd)
+			break;
+		if (p[1] != 'T')
+			continue;
+		const uint64_t writeTime = strtoull(p + 2, nullptr, 10);
+		if (writeTime > 0)
+			writeTimes.push_back(writeTime);
+	}
+}
+
+// Same as hoffgui's log callbacks: everything logged is appended to the Output window buffer
+static void logCallback(int logLevel, const char* format, va_list argList)
+{
+	OutputBuffer::SetAttributes(OutputBuffer::MakeAttributes(logLevel, OutputBuffer::Source::App));
+	OutputBuffer::Vfprintf(format, argList);
+}
+
+static char* logReserveCallback(size_t& sizeBytes)
+{
+	return OutputBuffer::Reserve(sizeBytes);
+}
+
+static void logCommitCallback(FILE* pStream, char* text, size_t len)
+{
+	const OutputBuffer::Source source = pStream == stderr ? OutputBuffer::Source::ChildStderr : OutputBuffer::Source::ChildStdout;
+	OutputBuffer::SetAttributes(OutputBuffer::MakeAttributes(LOG_LEVEL_INFO, source));
+
+	// Find timestamps before committing, which may modify the text in place
+	s_pendingWriteTimes.clear();
+	if (s_pCurrentRunResult)
+		findWriteTimes(text, len, s_pendingWriteTimes);
+
+	OutputBuffer::Commit(text, len);
+
+	// Now visible
+	const uint64_t now = nowNanoseconds();
+	for (uint64_t writeTime : s_pendingWriteTimes)
+	{
+		if (writeTime <= now)
+			s_pCurrentRunResult->latenciesMicroseconds.push_back((double)(now - writeTime) * 1e-3);
+	}
+}
+
+static void outputCallback(const char* text, size_t len, void* pUserData)
+{
+	HP_UNUSED(text);
+	RunResult& result = *(RunResult*)pUserData;
+	result.childBytes += len;
+}
+
+static bool runScenario(const char* toolPath, const Scenario& scenario, RunResult& result)
+{
+	const char* argv[kMaxToolArgs + 4];
+	unsigned int argCount = 0;
+	argv[argCount++] = toolPath;
+	argv[argCount++] = "--timestamp-every";
+	argv[argCount++] = "64";
+	for (unsigned int argIndex = 0; scenario.toolArgs[argIndex]; argIndex++)
+		argv[argCount++] = scenario.toolArgs[argIndex];
+	argv[argCount] = nullptr;
+	HP_ASSERT(argCount < COUNTOF_ARRAY(argv));
+
+	OutputBuffer::Clear();
+	const uint64_t outputBufferBytesBefore = OutputBuffer::GetTotalBytesAppended();
+	const double parentCpuSecondsBefore = ProcessStats::GetParentCpuSeconds();
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	s_pCurrentRunResult = &result;
+	result.exitCode = Process::Launch(argv, outputCallback, &result);
+	s_pCurrentRunResult = nullptr;
+
+	result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	result.parentCpuSeconds = ProcessStats::GetParentCpuSeconds() - parentCpuSecondsBefore;
+	result.outputBufferBytes = OutputBuffer::GetTotalBytesAppended() - outputBufferBytesBefore;
+
+	return result.exitCode == EXIT_SUCCESS;
+}
+
+static double percentile(std::vector<double>& values, double fraction)
+{
+	if (values.empty())
+		return 0.0;
+	const size_t index = Min((size_t)(fraction * (double)values.size()), values.size() - 1);
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+static void printUsage()
+{
+	printf("Usage: hoffgui_process_benchmark [--tool path] [--scenario name] [--repeat N] [--csv path] [--show-log]\n");
+	printf("Scenarios:\n");
+	for (const Scenario& scenario : kScenarios)
+		printf("  %s\n", scenario.name);
+}
+
+int main(int argc, char* argv[])
+{
+	std::string toolPath;
+	const char* scenarioName = nullptr;
+	const char* csvPath = nullptr;
+	unsigned int repeatCount = 3;
+	bool showLog = false;
+
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		const bool hasValue = argIndex + 1 < argc;
+		if (strcmp(argv[argIndex], "--tool") == 0 && hasValue)
+			toolPath = argv[++argIndex];
+		else if (strcmp(argv[argIndex], "--scenario") == 0 && hasValue)
+			scenarioName = argv[++argIndex];
+		else if (strcmp(argv[argIndex], "--repeat") == 0 && hasValue)
+			repeatCount = Max(1u, (unsigned int)strtoul(argv[++argIndex], nullptr, 10));
+		else if (strcmp(argv[argIndex], "--csv") == 0 && hasValue)
+			csvPath = argv[++argIndex];
+		else if (strcmp(argv[argIndex], "--show-log") == 0)
+			showLog = true;
+		else
+		{
+			printUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Default to the fake tool next to this executable
+	if (toolPath.empty())
+	{
+		toolPath = argv[0];
+		const size_t slashPos = toolPath.find_last_of("/\\");
+		toolPath.resize(slashPos == std::string::npos ? 0 : slashPos + 1);
+		if (toolPath.empty())
+			toolPath = "./";
+		toolPath += kFakeToolFilename;
+	}
+
+	// Child output is logged to stderr. Writing it to a terminal would dominate the measurement.
+	if (!showLog)
+	{
+		SetLogLevel(LOG_LEVEL_WARN);
+		if (!freopen(kNullDevice, "w", stderr))
+		{
+			fprintf(stdout, "Failed to redirect stderr\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	SetLogCallback(logCallback);
+	SetLogSinkCallbacks(logReserveCallback, logCommitCallback);
+
+	FILE* pCsvFile = nullptr;
+	if (csvPath)
+	{
+		pCsvFile = fopen(csvPath, "w");
+		if (!pCsvFile)
+		{
+			printf("Failed to open %s for write\n", csvPath);
+			return EXIT_FAILURE;
+		}
+		fprintf(pCsvFile, "scenario,run,child_bytes,wall_s,mb_per_s,latency_p50_us,latency_p99_us,latency_max_us,parent_cpu_s,parent_cpu_ms_per_mb\n");
+	}
+
+	printf("Tool: %s\n", toolPath.c_str());
+	printf("%-14s %10s %9s %10s %10s %10s %10s %12s\n", "scenario", "MB", "MB/s", "p50 us", "p99 us", "max us", "cpu s", "cpu ms/MB");
+
+	bool ok = true;
+	unsigned int scenarioCount = 0;
+	for (const Scenario& scenario : kScenarios)
+	{
+		if (scenarioName && strcmp(scenarioName, scenario.name) != 0)
+			continue;
+		scenarioCount++;
+
+		for (unsigned int runIndex = 0; runIndex < repeatCount; runIndex++)
+		{
+			RunResult result;
+			if (!runScenario(toolPath.c_str(), scenario, result))
+			{
+				printf("%-14s failed with exit code %u\n", scenario.name, result.exitCode);
+				ok = false;
+				break;
+			}
+
+			// Every byte must have reached the Output window buffer
+			if (result.outputBufferBytes < result.childBytes)
+				printf("%-14s WARNING: %llu bytes read from child but %llu bytes appended to OutputBuffer\n", scenario.name,
+					(unsigned long long)result.childBytes, (unsigned long long)result.outputBufferBytes);
+
+			const double megabytes = (double)result.childBytes / (1024.0 * 1024.0);
+			const double megabytesPerSecond = megabytes / result.wallSeconds;
+			const double cpuMsPerMB = megabytes > 0.0 ? result.parentCpuSeconds * 1000.0 / megabytes : 0.0;
+
+			// Not 0 when no timestamps were collected, which would read as no latency
+			char latencyText[64];
+			char latencyCsv[64];
+			if (result.latenciesMicroseconds.empty())
+			{
+				SafeSnprintf(latencyText, sizeof(latencyText), "%10s %10s %10s", "-", "-", "-");
+				SafeSnprintf(latencyCsv, sizeof(latencyCsv), ",,");
+			}
+			else
+			{
+				const double p50 = percentile(result.latenciesMicroseconds, 0.5);
+				const double p99 = percentile(result.latenciesMicroseconds, 0.99);
+				const double max = percentile(result.latenciesMicroseconds, 1.0);
+				SafeSnprintf(latencyText, sizeof(latencyText), "%10.0f %10.0f %10.0f", p50, p99, max);
+				SafeSnprintf(latencyCsv, sizeof(latencyCsv), "%.1f,%.1f,%.1f", p50, p99, max);
+			}
+
+			printf("%-14s %10.1f %9.1f %s %10.3f %12.2f\n", scenario.name, megabytes, megabytesPerSecond, latencyText,
+				result.parentCpuSeconds, cpuMsPerMB);
+
+			if (pCsvFile)
+				fprintf(pCsvFile, "%s,%u,%llu,%.6f,%.3f,%s,%.6f,%.4f\n", scenario.name, runIndex,
+					(unsigned long long)result.childBytes, result.wallSeconds, megabytesPerSecond, latencyCsv,
+					result.parentCpuSeconds, cpuMsPerMB);
+		}
+	}
+
+	if (pCsvFile)
+		fclose(pCsvFile);
+
+	if (scenarioCount == 0)
+	{
+		printf("Unknown scenario: %s\n", scenarioName);
+		printUsage();
+		return EXIT_FAILURE;
+	}
+
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -2,6 +2,7 @@
 
 #include "Utils/Parse.h"
 #include "Core/Window.h"
+#include "Core/Helpers.h" // ENUM_COUNT
 #include "Core/Log.h"
 
 #include <stdio.h>
@@ -22,7 +23,10 @@ void PrintUsage()
 	puts(  "Usage: hoffgui [OPTIONS]");
 	puts(  "Options:\n"
 		   "  --help                                Shows this message\n"
-		   "  --log-level <value>                   Specify log level: 2 (trace), 1 (debug), 0 (info), -1 (warn), -2 (error) -3 (none)  Default: 0"
+		   "  --log-level <value>                   Specify log level: 2 (trace), 1 (debug), 0 (info), -1 (warn), -2 (error) -3 (none)  Default: 0\n"
+		   "  --log-channels <names>                Debug and trace only these comma separated channels: General, Process, ModFile, Fonts, Ini, UI  Default: all\n"
+		   "  --log-file <path>                     Also log to this file, rotating any existing file to <path>.1 etc.\n"
+		   "  --log-file-max-size <MB>              Rotate the log file when it reaches this size. Default: 64"
 	);
 	puts(  "  -d --display-index                    Window display (monitor) index Default = 0 (primary)\n");
 	puts(  "  -x --window-x                         Window pos x. Default: centred\n");
@@ -34,6 +38,34 @@ void PrintUsage()
 	puts(  "  -ignore-ini-file                      Don't load hoffgui.ini\n");
 }
 
+// e.g. "Process,Ini"
+static bool parseLogChannels(const char* names, uint32_t& channelMask)
+{
+	channelMask = 0;
+	const char* pName = names;
+	while (true)
+	{
+		const char* pComma = strchr(pName, ',');
+		const size_t nameLength = pComma ? (size_t)(pComma - pName) : strlen(pName);
+
+		unsigned int channelIndex = 0;
+		while (channelIndex < ENUM_COUNT(LogChannel))
+		{
+			const char* channelName = GetLogChannelName((LogChannel)channelIndex);
+			if (strlen(channelName) == nameLength && strncmp(channelName, pName, nameLength) == 0)
+				break;
+			channelIndex++;
+		}
+		if (channelIndex == ENUM_COUNT(LogChannel))
+			return false;
+		channelMask |= LOG_CHANNEL_BIT(channelIndex);
+
+		if (!pComma)
+			return true;
+		pName = pComma + 1;
+	}
+}
+
 void ParseCommandLine(int argc, char** argv)
 {
 	for (int i = 1; i < argc; i++)
@@ -63,6 +95,50 @@ void ParseCommandLine(int argc, char** argv)
 			}
 			SetLogLevel(logLevel);
 		}
+		else if (strcmp(arg, "--log-channels") == 0)
+		{
+			if (i + 1 == argc)
+			{
+				PrintUsage();
+				exit(EXIT_FAILURE);
+			}
+
+			arg = argv[++i];
+			uint32_t channelMask = 0;
+			if (!parseLogChannels(arg, channelMask))
+			{
+				fprintf(stderr, "ERROR: Invalid log-channels value\n");
+				PrintUsage();
+				exit(EXIT_FAILURE);
+			}
+			SetLogChannelMask(channelMask);
+		}
+		else if (strcmp(arg, "--log-file") == 0)
+		{
+			if (i + 1 == argc)
+			{
+				PrintUsage();
+				exit(EXIT_FAILURE);
+			}
+
+			s_commandLineArgs.logFilePath = argv[++i];
+		}
+		else if (strcmp(arg, "--log-file-max-size") == 0)
+		{
+			if (i + 1 == argc)
+			{
+				PrintUsage();
+				exit(EXIT_FAILURE);
+			}
+
+			arg = argv[++i];
+			if (!ParseInt(arg, s_commandLineArgs.logFileMaxSizeMB) || s_commandLineArgs.logFileMaxSizeMB <= 0)
+			{
+				fprintf(stderr, "ERROR: Invalid log-file-max-size value\n");
+				PrintUsage();
+				exit(EXIT_FAILURE);
+			}
+		}
 		else if (strcmp(arg, "--ignore-ini-file") == 0)
 		{
 			s_commandLineArgs.ignoreIniFile = true;
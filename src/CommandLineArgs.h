@@ -4,6 +4,9 @@ struct CommandLineArgs
 {
 	bool ignoreIniFile = false;
 
+	const char* logFilePath = nullptr;
+	int logFileMaxSizeMB = 0; // 0 for the default
+
 	int displayIndex = -1;
 
 	bool hasWindowX = false;
@@ -0,0 +1,385 @@
+#include "DeferredLog.h"
+
+#include "Core/hp_assert.h"
+
+#include <stdio.h> // snprintf
+
+#include <algorithm> // std::stable_sort, std::find
+#include <mutex>
+#include <string>
+#include <vector>
+
+static std::mutex s_ringsMutex; // protects the list, not the rings' contents
+static std::vector<DeferredLog::Ring*> s_rings;
+
+// Records gathered from every ring by Flush, before sorting by time
+struct PendingRecord
+{
+	uint64_t ticks;
+	const void* pHeader;
+};
+static std::vector<PendingRecord> s_pendingRecords;
+static std::string s_text;
+
+// Ticks are converted to seconds using the rate measured since the first ring was created
+static uint64_t s_startTicks;
+static std::chrono::steady_clock::time_point s_startTime;
+static double s_ticksPerSecond = 0.0; // fixed once measured over at least kCalibrationSeconds
+static const double kCalibrationSeconds = 1.0;
+
+// Marks the ring as free to delete once drained, when its thread exits
+struct RingOwner
+{
+	DeferredLog::Ring* pRing = nullptr;
+
+	~RingOwner()
+	{
+		if (pRing)
+			pRing->threadExited.store(true, std::memory_order_release);
+	}
+};
+static thread_local RingOwner t_ringOwner;
+
+DeferredLog::Ring* DeferredLog::createThreadRing()
+{
+	HP_ASSERT(t_pRing == nullptr);
+
+	Ring* pRing = new Ring;
+	pRing->pData = new char[kRingSizeBytes];
+	t_pRing = pRing;
+	t_ringOwner.pRing = pRing;
+
+	std::lock_guard<std::mutex> lock(s_ringsMutex);
+	if (s_rings.empty() && s_startTicks == 0)
+	{
+		s_startTicks = GetTicks();
+		s_startTime = std::chrono::steady_clock::now();
+	}
+	s_rings.push_back(pRing);
+	return pRing;
+}
+
+static double getTicksPerSecond()
+{
+	if (s_ticksPerSecond > 0.0)
+		return s_ticksPerSecond;
+
+	const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - s_startTime).count();
+	const uint64_t elapsedTicks = DeferredLog::GetTicks() - s_startTicks;
+	if (elapsedSeconds <= 0.0 || elapsedTicks == 0)
+		return 0.0;
+
+	const double ticksPerSecond = (double)elapsedTicks / elapsedSeconds;
+	if (elapsedSeconds >= kCalibrationSeconds)
+		s_ticksPerSecond = ticksPerSecond;
+	return ticksPerSecond;
+}
+
+//------------------------------------------------------------------------------------------------
+// Formatting
+
+struct ArgReader
+{
+	const DeferredLog::ArgType* pTypes;
+	unsigned int count;
+	unsigned int index = 0;
+	const char* p;
+};
+
+// Returns false if there are no more arguments
+static bool readArg(ArgReader& reader, DeferredLog::ArgType& type, uint64_t& bits, const char*& pString)
+{
+	if (reader.index >= reader.count)
+		return false;
+
+	type = reader.pTypes[reader.index++];
+	memcpy(&bits, reader.p, 8);
+	reader.p += 8;
+	pString = nullptr;
+	if (type == DeferredLog::ArgType::String)
+	{
+		pString = reader.p;
+		reader.p += (bits + 7) & ~(uint64_t)7;
+	}
+	return true;
+}
+
+static int64_t argToInt(DeferredLog::ArgType type, uint64_t bits)
+{
+	if (type == DeferredLog::ArgType::Double)
+	{
+		double value;
+		memcpy(&value, &bits, 8);
+		return (int64_t)value;
+	}
+	return (int64_t)bits;
+}
+
+static double argToDouble(DeferredLog::ArgType type, uint64_t bits)
+{
+	if (type == DeferredLog::ArgType::Double)
+	{
+		double value;
+		memcpy(&value, &bits, 8);
+		return value;
+	}
+	return type == DeferredLog::ArgType::Int ? (double)(int64_t)bits : (double)bits;
+}
+
+template<typename T>
+static void appendFormatted(std::string& text, const char* spec, T value)
+{
+	char buffer[128];
+	const int length = snprintf(buffer, sizeof(buffer), spec, value);
+	if (length <= 0)
+		return;
+	if ((size_t)length < sizeof(buffer))
+	{
+		text.append(buffer, (size_t)length);
+		return;
+	}
+	const size_t size = text.size();
+	text.resize(size + (size_t)length + 1);
+	snprintf(&text[size], (size_t)length + 1, spec, value);
+	text.resize(size + (size_t)length);
+}
+
+// Formats one printf conversion at format (just after the '%') with the next argument(s). Returns the end of
+// the conversion.
+static const char* appendConversion(std::string& text, const char* format, ArgReader& reader)
+{
+	DeferredLog::ArgType type;
+	uint64_t bits;
+	const char* pString;
+
+	// Rebuilt with the length modifier that matches the recorded argument type
+	char spec[48];
+	size_t specLength = 0;
+	spec[specLength++] = '%';
+
+	const char* p = format;
+	while (*p && strchr("-+ #0", *p) && specLength < 8)
+		spec[specLength++] = *p++;
+
+	// Width and precision, either of which may be '*'
+	for (int part = 0; part < 2; part++)
+	{
+		if (part == 1)
+		{
+			if (*p != '.')
+				break;
+			spec[specLength++] = *p++;
+		}
+		if (*p == '*')
+		{
+			p++;
+			int value = 0;
+			if (readArg(reader, type, bits, pString))
+				value = (int)argToInt(type, bits);
+			specLength += (size_t)snprintf(spec + specLength, 12, "%d", value);
+		}
+		else
+		{
+			while (*p >= '0' && *p <= '9' && specLength < 40)
+				spec[specLength++] = *p++;
+		}
+	}
+
+	while (*p && strchr("hljztLq", *p))
+		p++;
+
+	const char conversion = *p;
+	if (conversion == '\0')
+		return p;
+	p++;
+
+	if (!readArg(reader, type, bits, pString))
+	{
+		text += "<missing>";
+		return p;
+	}
+
+	switch (conversion)
+	{
+		case 'd':
+		case 'i':
+			spec[specLength++] = 'l';
+			spec[specLength++] = 'l';
+			spec[specLength++] = 'd';
+			spec[specLength] = '\0';
+			appendFormatted(text, spec, (long long)argToInt(type, bits));
+			break;
+
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			spec[specLength++] = 'l';
+			spec[specLength++] = 'l';
+			spec[specLength++] = conversion;
+			spec[specLength] = '\0';
+			appendFormatted(text, spec, (unsigned long long)argToInt(type, bits));
+			break;
+
+		case 'c':
+			spec[specLength++] = 'c';
+			spec[specLength] = '\0';
+			appendFormatted(text, spec, (int)argToInt(type, bits));
+			break;
+
+		case 'e':
+		case 'E':
+		case 'f':
+		case 'F':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			spec[specLength++] = conversion;
+			spec[specLength] = '\0';
+			appendFormatted(text, spec, argToDouble(type, bits));
+			break;
+
+		case 's':
+			if (type == DeferredLog::ArgType::String)
+			{
+				// Not null-terminated in the ring
+				spec[specLength++] = 's';
+				spec[specLength] = '\0';
+				char buffer[DeferredLog::kMaxStringLength + 1];
+				memcpy(buffer, pString, (size_t)bits);
+				buffer[bits] = '\0';
+				appendFormatted(text, spec, (const char*)buffer);
+			}
+			else
+				text += "<not a string>";
+			break;
+
+		case 'p':
+			appendFormatted(text, "%p", (const void*)(uintptr_t)bits);
+			break;
+
+		default:
+			text += "<unsupported>"; // including %n
+			break;
+	}
+	return p;
+}
+
+static void formatRecord(std::string& text, const char* format, const DeferredLog::ArgType* pArgTypes, unsigned int argCount, const char* pArgs)
+{
+	ArgReader reader = { pArgTypes, argCount, 0, pArgs };
+	const char* p = format;
+	while (*p)
+	{
+		const char* pPercent = strchr(p, '%');
+		if (!pPercent)
+		{
+			text.append(p);
+			break;
+		}
+		text.append(p, (size_t)(pPercent - p));
+		if (pPercent[1] == '%')
+		{
+			text += '%';
+			p = pPercent + 2;
+		}
+		else
+			p = appendConversion(text, pPercent + 1, reader);
+	}
+}
+
+//------------------------------------------------------------------------------------------------
+
+unsigned int DeferredLog::Flush()
+{
+	std::lock_guard<std::mutex> lock(s_ringsMutex);
+
+	// Gather what's been recorded so far. Records stay in the rings until the read positions are advanced below.
+	std::vector<uint64_t> endReadPositions(s_rings.size());
+	s_pendingRecords.clear();
+	for (size_t ringIndex = 0; ringIndex < s_rings.size(); ringIndex++)
+	{
+		const Ring& ring = *s_rings[ringIndex];
+		uint64_t readPosition = ring.readPosition.load(std::memory_order_relaxed);
+		const uint64_t writePosition = ring.writePosition.load(std::memory_order_acquire);
+		while (readPosition < writePosition)
+		{
+			const size_t offset = (size_t)(readPosition & (kRingSizeBytes - 1));
+			const RecordHeader* pHeader = (const RecordHeader*)(ring.pData + offset);
+			if (!pHeader->format)
+			{
+				readPosition += kRingSizeBytes - offset; // padding
+				continue;
+			}
+			s_pendingRecords.push_back({ pHeader->ticks, pHeader });
+			readPosition += pHeader->sizeBytes;
+		}
+		endReadPositions[ringIndex] = readPosition;
+	}
+
+	// Oldest first across threads. Stable, so each thread's records stay in order if ticks are equal.
+	std::stable_sort(s_pendingRecords.begin(), s_pendingRecords.end(),
+		[](const PendingRecord& lhs, const PendingRecord& rhs) { return lhs.ticks < rhs.ticks; });
+
+	const double ticksPerSecond = getTicksPerSecond();
+	for (const PendingRecord& pendingRecord : s_pendingRecords)
+	{
+		const RecordHeader& header = *(const RecordHeader*)pendingRecord.pHeader;
+		const double seconds = ticksPerSecond > 0.0 ? (double)(int64_t)(header.ticks - s_startTicks) / ticksPerSecond : 0.0;
+
+		s_text.clear();
+		appendFormatted(s_text, "%s: ", GetLogChannelName((LogChannel)header.channel));
+		appendFormatted(s_text, "[%.6f] ", seconds);
+		formatRecord(s_text, header.format, header.pArgTypes, header.argCount, (const char*)(&header + 1));
+		LogLevel(header.logLevel, "%s", s_text.c_str());
+	}
+	const unsigned int recordCount = (unsigned int)s_pendingRecords.size();
+	s_pendingRecords.clear();
+
+	for (size_t ringIndex = 0; ringIndex < s_rings.size(); ringIndex++)
+	{
+		Ring& ring = *s_rings[ringIndex];
+		ring.readPosition.store(endReadPositions[ringIndex], std::memory_order_release);
+
+		const uint64_t droppedCount = ring.droppedCount.exchange(0, std::memory_order_relaxed);
+		if (droppedCount > 0)
+			LOG_WARN("%llu deferred log records dropped\n", (unsigned long long)droppedCount);
+	}
+
+	// Free the rings of threads that have exited, now they're drained
+	for (size_t ringIndex = 0; ringIndex < s_rings.size();)
+	{
+		Ring* pRing = s_rings[ringIndex];
+		if (pRing->threadExited.load(std::memory_order_acquire) &&
+			pRing->readPosition.load(std::memory_order_relaxed) == pRing->writePosition.load(std::memory_order_acquire))
+		{
+			delete[] pRing->pData;
+			delete pRing;
+			s_rings.erase(s_rings.begin() + (ptrdiff_t)ringIndex);
+		}
+		else
+			ringIndex++;
+	}
+
+	return recordCount;
+}
+
+void DeferredLog::Shutdown()
+{
+	Flush();
+
+	// Other threads' rings are left until they exit
+	std::lock_guard<std::mutex> lock(s_ringsMutex);
+	if (t_pRing)
+	{
+		s_rings.erase(std::find(s_rings.begin(), s_rings.end(), t_pRing));
+		delete[] t_pRing->pData;
+		delete t_pRing;
+		t_pRing = nullptr;
+		t_ringOwner.pRing = nullptr;
+	}
+	s_text.clear();
+	s_text.shrink_to_fit();
+	s_pendingRecords.shrink_to_fit();
+}
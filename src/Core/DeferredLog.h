@@ -0,0 +1,246 @@
+#pragma once
+
+#include "Core/Helpers.h"
+#include "Core/Log.h"
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+#include <string.h> // memcpy, strlen
+
+#include <atomic>
+#include <chrono>
+#include <type_traits>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h> // __rdtsc
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // __rdtsc
+#endif
+
+//
+// Binary log records for hot trace points (e.g. per pattern row diagnostics) where even formatting a message is
+// too expensive. LOG_DEFERRED_* copy the format string pointer, a tick count and the raw argument values into a
+// ring owned by the calling thread; nothing is formatted until Flush, which formats everything recorded since the
+// last Flush, oldest first across threads, and logs it as usual (stdout, Output window, log file).
+//
+// The format string must be a string literal, as only the pointer is kept. Arguments may be integers, enums,
+// floating point numbers, pointers and C strings (copied, up to kMaxStringLength). printf conversions are supported
+// apart from %n; length modifiers are ignored, as each argument's type is recorded.
+//
+// Records are dropped (and counted) if a thread's ring is full, rather than blocking. Rings of threads that have
+// exited are freed once drained.
+//
+class DeferredLog
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(DeferredLog);
+
+	static const size_t kRingSizeBytes = 1024 * 1024; // per thread
+	static const size_t kMaxStringLength = 1024;
+
+	// Formats and logs everything recorded so far. Call regularly from one thread; HoffGui::Update calls it once
+	// per frame. Returns the number of records logged.
+	static unsigned int Flush();
+
+	// Flushes, then frees the rings of exited threads and the calling thread
+	static void Shutdown();
+
+	enum class ArgType : uint8_t
+	{
+		Int,
+		UInt,
+		Double,
+		Pointer,
+		String, // 8 byte length, then the characters padded to a multiple of 8 bytes
+	};
+
+	// Use LOG_DEFERRED_* rather than calling this directly
+	template<typename... Args>
+	static void Record(int logLevel, LogChannel channel, const char* format, const Args&... args);
+
+	// Cheap, monotonic tick count for record times e.g. the CPU's time stamp counter. Not necessarily in any
+	// particular unit; Flush converts ticks to seconds by measuring them against std::chrono::steady_clock.
+	static uint64_t GetTicks();
+
+	// Ring layout, used by Record and Flush
+	struct RecordHeader
+	{
+		const char* format; // nullptr marks padding to the end of the ring
+		const ArgType* pArgTypes;
+		uint64_t ticks;
+		uint32_t sizeBytes; // including this header; a multiple of 8
+		uint8_t argCount;
+		int8_t logLevel;
+		uint8_t channel;
+		uint8_t pad;
+	};
+	static_assert(sizeof(RecordHeader) % 8 == 0);
+
+	// Single producer (the owning thread), single consumer (Flush)
+	struct Ring
+	{
+		char* pData = nullptr;
+		std::atomic<uint64_t> writePosition = 0;
+		std::atomic<uint64_t> readPosition = 0;
+		std::atomic<uint64_t> droppedCount = 0;
+		std::atomic<bool> threadExited = false;
+	};
+
+private:
+	static inline thread_local Ring* t_pRing = nullptr;
+
+	static Ring* createThreadRing();
+
+	template<typename T>
+	static constexpr ArgType getArgType();
+
+	template<typename T>
+	static size_t getArgSizeBytes(const T& arg);
+
+	template<typename T>
+	static char* writeArg(char* p, const T& arg);
+};
+
+//------------------------------------------------------------------------------------------------
+
+inline uint64_t DeferredLog::GetTicks()
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#elif defined(__aarch64__)
+	uint64_t ticks;
+	asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+	return ticks;
+#else
+	return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+template<typename T>
+constexpr DeferredLog::ArgType DeferredLog::getArgType()
+{
+	using Type = std::decay_t<T>;
+	if constexpr (std::is_same_v<Type, const char*> || std::is_same_v<Type, char*>)
+		return ArgType::String;
+	else if constexpr (std::is_floating_point_v<Type>)
+		return ArgType::Double;
+	else if constexpr (std::is_pointer_v<Type> || std::is_null_pointer_v<Type>)
+		return ArgType::Pointer;
+	else if constexpr (std::is_enum_v<Type>)
+		return std::is_signed_v<std::underlying_type_t<Type>> ? ArgType::Int : ArgType::UInt;
+	else
+	{
+		static_assert(std::is_integral_v<Type>, "Unsupported DeferredLog argument type");
+		return std::is_signed_v<Type> ? ArgType::Int : ArgType::UInt;
+	}
+}
+
+template<typename T>
+size_t DeferredLog::getArgSizeBytes(const T& arg)
+{
+	if constexpr (getArgType<T>() == ArgType::String)
+	{
+		const char* pString = arg; // may be an array
+		const size_t length = pString ? Min(strlen(pString), kMaxStringLength) : 0;
+		return 8 + ((length + 7) & ~(size_t)7);
+	}
+	else
+	{
+		HP_UNUSED(arg);
+		return 8;
+	}
+}
+
+template<typename T>
+char* DeferredLog::writeArg(char* p, const T& arg)
+{
+	constexpr ArgType kArgType = getArgType<T>();
+	if constexpr (kArgType == ArgType::String)
+	{
+		const char* pString = arg;
+		const uint64_t length = pString ? Min(strlen(pString), kMaxStringLength) : 0;
+		memcpy(p, &length, 8);
+		memcpy(p + 8, pString, (size_t)length);
+		return p + 8 + ((length + 7) & ~(uint64_t)7);
+	}
+	else if constexpr (kArgType == ArgType::Double)
+	{
+		const double value = (double)arg;
+		memcpy(p, &value, 8);
+	}
+	else if constexpr (kArgType == ArgType::Pointer)
+	{
+		const uint64_t value = (uint64_t)(uintptr_t)arg;
+		memcpy(p, &value, 8);
+	}
+	else if constexpr (kArgType == ArgType::Int)
+	{
+		const int64_t value = (int64_t)arg;
+		memcpy(p, &value, 8);
+	}
+	else
+	{
+		const uint64_t value = (uint64_t)arg;
+		memcpy(p, &value, 8);
+	}
+	return p + 8;
+}
+
+template<typename... Args>
+void DeferredLog::Record(int logLevel, LogChannel channel, const char* format, const Args&... args)
+{
+	static_assert(sizeof...(Args) <= 255);
+	static constexpr ArgType kArgTypes[sizeof...(Args) + 1] = { getArgType<Args>()..., ArgType::Int };
+
+	Ring* pRing = t_pRing;
+	if (!pRing)
+		pRing = createThreadRing();
+
+	const uint32_t sizeBytes = (uint32_t)(sizeof(RecordHeader) + (0 + ... + getArgSizeBytes(args)));
+	uint64_t writePosition = pRing->writePosition.load(std::memory_order_relaxed);
+	size_t offset = (size_t)(writePosition & (kRingSizeBytes - 1));
+	const size_t contiguousSizeBytes = kRingSizeBytes - offset;
+	const uint64_t paddingSizeBytes = sizeBytes > contiguousSizeBytes ? contiguousSizeBytes : 0; // records don't wrap
+	if (writePosition + paddingSizeBytes + sizeBytes - pRing->readPosition.load(std::memory_order_acquire) > kRingSizeBytes)
+	{
+		pRing->droppedCount.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	if (paddingSizeBytes > 0)
+	{
+		const char* kPadding = nullptr;
+		memcpy(pRing->pData + offset, &kPadding, sizeof(kPadding));
+		writePosition += paddingSizeBytes;
+		offset = 0;
+	}
+
+	RecordHeader* pHeader = (RecordHeader*)(pRing->pData + offset);
+	pHeader->format = format;
+	pHeader->pArgTypes = kArgTypes;
+	pHeader->ticks = GetTicks();
+	pHeader->sizeBytes = sizeBytes;
+	pHeader->argCount = (uint8_t)sizeof...(Args);
+	pHeader->logLevel = (int8_t)logLevel;
+	pHeader->channel = (uint8_t)channel;
+	pHeader->pad = 0;
+	char* p = (char*)(pHeader + 1);
+	((p = writeArg(p, args)), ...);
+	HP_UNUSED(p);
+
+	pRing->writePosition.store(writePosition + sizeBytes, std::memory_order_release);
+}
+
+// e.g. LOG_DEFERRED_TRACE(ModFile, "Row %u: note %u\n", rowIndex, note) logs "ModFile: [12.345678] Row 3: note 25"
+// Arguments are only evaluated if the record will be logged. The time is seconds since logging started.
+#define LOG_DEFERRED_AT_LEVEL(logLevel, channel, ...) \
+	do \
+	{ \
+		if constexpr ((logLevel) <= LOG_COMPILE_LEVEL) \
+		{ \
+			if (IsLogEnabled((logLevel), LogChannel::channel)) \
+				DeferredLog::Record((logLevel), LogChannel::channel, __VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LOG_DEFERRED_DEBUG(channel, ...) LOG_DEFERRED_AT_LEVEL(LOG_LEVEL_DEBUG, channel, __VA_ARGS__)
+#define LOG_DEFERRED_TRACE(channel, ...) LOG_DEFERRED_AT_LEVEL(LOG_LEVEL_TRACE, channel, __VA_ARGS__)
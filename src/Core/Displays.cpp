@@ -37,11 +37,11 @@ void Displays::Enumerate()
 {
 	s_displays.resize(0);
 	int display_count = SDL_GetNumVideoDisplays();
-	LOG_TRACE("Num displays: %d\n", display_count);
+	LOG_CHANNEL_TRACE(UI, "Num displays: %d\n", display_count);
 	for (int displayIndex = 0; displayIndex < display_count; displayIndex++)
 	{
 		const char* displayName = SDL_GetDisplayName(displayIndex);
-		LOG_TRACE("Display %u \"%s\"\n", displayIndex, displayName);
+		LOG_CHANNEL_TRACE(UI, "Display %u \"%s\"\n", displayIndex, displayName);
 
 		// Warning: the validity of monitor DPI information on Windows depends on the application DPI awareness settings, which generally needs to be set in the manifest or at runtime.
 		Display display;
@@ -49,16 +49,16 @@ void Displays::Enumerate()
 		SDL_GetDisplayBounds(displayIndex, &rect);
 		display.pos = ImVec2((float)rect.x, (float)rect.y);
 		display.size = ImVec2((float)rect.w, (float)rect.h);
-		LOG_TRACE("  Display Bounds: (%d, %d) (%d, %d)\n", rect.x, rect.y, rect.w, rect.h);
+		LOG_CHANNEL_TRACE(UI, "  Display Bounds: (%d, %d) (%d, %d)\n", rect.x, rect.y, rect.w, rect.h);
 #if SDL_HAS_USABLE_DISPLAY_BOUNDS
 		SDL_GetDisplayUsableBounds(displayIndex, &rect);
 		display.usablePos = ImVec2((float)rect.x, (float)rect.y);
 		display.usableSize = ImVec2((float)rect.w, (float)rect.h);
-		LOG_TRACE("  Display Usable Bounds: (%d, %d) (%d, %d)\n", rect.x, rect.y, rect.w, rect.h);
+		LOG_CHANNEL_TRACE(UI, "  Display Usable Bounds: (%d, %d) (%d, %d)\n", rect.x, rect.y, rect.w, rect.h);
 #else
 		display.usablePos = display.pos;
 		display.usableSize = display.size;
-		LOG_TRACE("  Display Usable Bounds not available\n");
+		LOG_CHANNEL_TRACE(UI, "  Display Usable Bounds not available\n");
 #endif
 
 #if SDL_HAS_PER_MONITOR_DPI
@@ -67,15 +67,15 @@ void Displays::Enumerate()
 		float dpi = 0.0f;
 		if (SDL_GetDisplayDPI(displayIndex, &dpi, nullptr, nullptr) == 0)
 		{
-			LOG_TRACE("  DPI: %.1f\n", dpi);
+			LOG_CHANNEL_TRACE(UI, "  DPI: %.1f\n", dpi);
 
 			display.dpiScale = dpi / 96.0f;
-			LOG_TRACE("  DPI Scale: %.2f (%.0f%%)\n", display.dpiScale, 100.0f * display.dpiScale);
+			LOG_CHANNEL_TRACE(UI, "  DPI Scale: %.2f (%.0f%%)\n", display.dpiScale, 100.0f * display.dpiScale);
 		}
 		else
 			LOG_ERROR("  SDL_GetDisplayDPI failed: %s\n", SDL_GetError());
 #else
-		LOG_TRACE("  SDL_GetDisplayDPI not available\n");
+		LOG_CHANNEL_TRACE(UI, "  SDL_GetDisplayDPI not available\n");
 #endif
 		s_displays.push_back(display);
 	}
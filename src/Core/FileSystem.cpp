@@ -95,20 +95,26 @@ bool FileSystem::Exists(const char* path)
 	return exists;
 }
 
-unsigned int FileSystem::GetFileSize(const char* path)
+uint64_t FileSystem::GetFileSize(const char* path)
 {
 	HP_ASSERT(path && path[0]);
-	FILE* pFile = fopen(path, "rb");
-	if (!pFile)
+
+	std::error_code ec;
+
+#ifdef _MSC_VER
+	WCHAR wpath[kMaxPath];
+	::MultiByteToWideChar(CP_UTF8, 0, path, -1, wpath, kMaxPath);
+	const std::uintmax_t fileSizeBytes = std::filesystem::file_size(wpath, ec);
+#else
+	const std::uintmax_t fileSizeBytes = std::filesystem::file_size(path, ec);
+#endif
+	if (ec)
 	{
-		LOG_ERROR("Failed to open file for read: %s\n", path);
+		LOG_ERROR("std::filesystem::file_size(%s) failed : %s\n", path, ec.message().c_str());
 		return 0;
 	}
 
-	fseek(pFile, 0, SEEK_END);
-	const unsigned int fileSizeBytes = ftell(pFile);
-	fclose(pFile);
-	return fileSizeBytes;
+	return (uint64_t)fileSizeBytes;
 }
 
 void FileSystem::FilenameWithExtensionFromPath(const char* path, char* fileNameBuffer, size_t bufferSize)
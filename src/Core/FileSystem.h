@@ -2,6 +2,8 @@
 
 #include "Core/Helpers.h"
 
+#include <stdint.h>
+
 static const unsigned int kMaxPath = 256;
 
 class FileSystem
@@ -15,7 +17,7 @@ public:
 	static void Shutdown();
 
 	static bool Exists(const char* path);
-	static unsigned int GetFileSize(const char* path);
+	static uint64_t GetFileSize(const char* path); // 0 on failure, which is logged
 	static void FilenameWithExtensionFromPath(const char* path, char* fileNameBuffer, size_t bufferSize);
 	static void FilenameWithoutExtensionFromPath(const char* path, char* fileNameBuffer, size_t bufferSize);
 	static void ExtensionFromPath(const char* path, char* extensionBuffer, size_t bufferSize);
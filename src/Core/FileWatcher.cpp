@@ -0,0 +1,214 @@
+#include "FileWatcher.h"
+
+#include "Core/FileSystem.h" // kMaxPath
+#include "Core/StringHelpers.h"
+#include "Core/hp_assert.h"
+#include "Core/Log.h"
+
+#include <filesystem>
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <string.h> // memcpy, strcmp, strrchr
+#include <sys/inotify.h>
+#include <unistd.h> // read, close
+
+#include <vector>
+
+struct WatchEntry
+{
+	unsigned int watchId;
+	int directoryWatch; // inotify watch descriptor, shared by all files in the directory
+	char filename[kMaxPath];
+	FileWatcher::ChangeCallback pCallback;
+	void* pUserData;
+};
+
+static std::vector<WatchEntry> s_watches;
+static unsigned int s_nextWatchId = 1;
+
+// Splits path into its directory, "." if none, and filename
+static bool splitPath(const char* path, char* directory, size_t directorySize, char* filename, size_t filenameSize)
+{
+	const char* pSeparator = strrchr(path, '/');
+	if (!pSeparator)
+	{
+		SafeStrcpy(directory, directorySize, ".");
+		SafeStrcpy(filename, filenameSize, path);
+	}
+	else
+	{
+		const size_t directoryLength = pSeparator == path ? 1 : (size_t)(pSeparator - path); // keep the root
+		if (directoryLength >= directorySize)
+			return false;
+		memcpy(directory, path, directoryLength);
+		directory[directoryLength] = '\0';
+		SafeStrcpy(filename, filenameSize, pSeparator + 1);
+	}
+	return filename[0] != '\0';
+}
+
+static int s_inotifyFd = -1;
+
+bool FileWatcher::Init()
+{
+	HP_ASSERT(s_inotifyFd < 0);
+	s_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (s_inotifyFd < 0)
+	{
+		LOG_WARN("File watching unavailable: inotify_init1 failed (errno %d)\n", errno);
+		return false;
+	}
+	return true;
+}
+
+void FileWatcher::Shutdown()
+{
+	s_watches.clear();
+	s_watches.shrink_to_fit();
+	if (s_inotifyFd >= 0)
+	{
+		close(s_inotifyFd); // removes the watches
+		s_inotifyFd = -1;
+	}
+}
+
+unsigned int FileWatcher::Watch(const char* path, ChangeCallback pCallback, void* pUserData)
+{
+	HP_ASSERT(path && path[0]);
+	HP_ASSERT(pCallback);
+	if (s_inotifyFd < 0)
+		return 0;
+
+	char directory[kMaxPath];
+	WatchEntry entry = {};
+	if (!splitPath(path, directory, sizeof(directory), entry.filename, sizeof(entry.filename)))
+		return 0;
+
+	// Returns the existing descriptor if the directory is already watched
+	entry.directoryWatch = inotify_add_watch(s_inotifyFd, directory, IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE);
+	if (entry.directoryWatch < 0)
+	{
+		LOG_WARN("Failed to watch directory %s (errno %d)\n", directory, errno);
+		return 0;
+	}
+
+	entry.watchId = s_nextWatchId++;
+	entry.pCallback = pCallback;
+	entry.pUserData = pUserData;
+	s_watches.push_back(entry);
+	LOG_TRACE("Watching %s\n", path);
+	return entry.watchId;
+}
+
+void FileWatcher::Unwatch(unsigned int watchId)
+{
+	for (size_t watchIndex = 0; watchIndex < s_watches.size(); watchIndex++)
+	{
+		if (s_watches[watchIndex].watchId != watchId)
+			continue;
+
+		const int directoryWatch = s_watches[watchIndex].directoryWatch;
+		s_watches.erase(s_watches.begin() + (ptrdiff_t)watchIndex);
+		for (const WatchEntry& entry : s_watches)
+		{
+			if (entry.directoryWatch == directoryWatch)
+				return; // still needed
+		}
+		inotify_rm_watch(s_inotifyFd, directoryWatch);
+		return;
+	}
+}
+
+void FileWatcher::Update()
+{
+	if (s_inotifyFd < 0 || s_watches.empty())
+		return;
+
+	// Gather first, as callbacks may watch and unwatch
+	std::vector<unsigned int> changedWatchIds;
+	alignas(struct inotify_event) char buffer[16 * 1024];
+	for (;;)
+	{
+		const ssize_t bytesRead = read(s_inotifyFd, buffer, sizeof(buffer));
+		if (bytesRead <= 0)
+			break; // EAGAIN when there are no more events
+
+		for (const char* pEvent = buffer; pEvent < buffer + bytesRead;)
+		{
+			const struct inotify_event& event = *(const struct inotify_event*)pEvent;
+			pEvent += sizeof(struct inotify_event) + event.len;
+
+			// Events were lost, so anything may have changed
+			const bool overflow = (event.mask & IN_Q_OVERFLOW) != 0;
+			if (!overflow && event.len == 0)
+				continue;
+			for (const WatchEntry& entry : s_watches)
+			{
+				if (overflow || (entry.directoryWatch == event.wd && strcmp(entry.filename, event.name) == 0))
+					changedWatchIds.push_back(entry.watchId);
+			}
+		}
+	}
+
+	for (unsigned int watchId : changedWatchIds)
+	{
+		for (const WatchEntry& entry : s_watches)
+		{
+			if (entry.watchId == watchId)
+			{
+				entry.pCallback(watchId, entry.pUserData);
+				break;
+			}
+		}
+	}
+}
+
+#else
+
+bool FileWatcher::Init()
+{
+	LOG_INFO("File watching is not supported on this platform\n");
+	return false;
+}
+
+void FileWatcher::Shutdown()
+{
+}
+
+unsigned int FileWatcher::Watch(const char* path, ChangeCallback pCallback, void* pUserData)
+{
+	HP_UNUSED(path);
+	HP_UNUSED(pCallback);
+	HP_UNUSED(pUserData);
+	return 0;
+}
+
+void FileWatcher::Unwatch(unsigned int watchId)
+{
+	HP_UNUSED(watchId);
+}
+
+void FileWatcher::Update()
+{
+}
+
+#endif
+
+bool FileWatcher::GetStamp(const char* path, Stamp& stamp)
+{
+	HP_ASSERT(path && path[0]);
+
+	std::error_code ec;
+	const uint64_t sizeBytes = std::filesystem::file_size(path, ec);
+	if (ec)
+		return false;
+	const std::filesystem::file_time_type modifiedTime = std::filesystem::last_write_time(path, ec);
+	if (ec)
+		return false;
+
+	stamp.sizeBytes = sizeBytes;
+	stamp.modifiedTime = (int64_t)modifiedTime.time_since_epoch().count();
+	return true;
+}
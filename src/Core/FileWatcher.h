@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Core/Helpers.h"
+
+#include <stdint.h>
+
+//
+// Notifies when watched files are written, created or replaced. Each file's directory is watched rather than the
+// file itself, so that files replaced by renaming a new file over them, as atomic saves do, stay watched.
+//
+// Notifications are not filtered or debounced: a single save can produce several, and saves by this process are
+// included. Compare stamps to tell whether a file has really changed.
+//
+// #TODO: Windows (ReadDirectoryChangesW) and macOS (FSEvents) implementations. Init currently fails on both, and
+// Watch returns 0.
+//
+class FileWatcher
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(FileWatcher);
+
+	// Size and modification time
+	struct Stamp
+	{
+		uint64_t sizeBytes = 0;
+		int64_t modifiedTime = 0; // in an unspecified unit and epoch
+
+		bool operator==(const Stamp& other) const { return sizeBytes == other.sizeBytes && modifiedTime == other.modifiedTime; }
+		bool operator!=(const Stamp& other) const { return !(*this == other); }
+	};
+
+	// Called from Update
+	typedef void (*ChangeCallback)(unsigned int watchId, void* pUserData);
+
+	static bool Init();
+	static void Shutdown();
+
+	// Returns the watch id, or 0 on failure
+	static unsigned int Watch(const char* path, ChangeCallback pCallback, void* pUserData = nullptr);
+	static void Unwatch(unsigned int watchId);
+
+	// Non-blocking. Calls the callbacks of files changed since the last call.
+	static void Update();
+
+	// Returns false if the file doesn't exist
+	static bool GetStamp(const char* path, Stamp& stamp);
+};
@@ -0,0 +1,166 @@
+#include "FileWriter.h"
+
+#include "Core/FileSystem.h" // kMaxPath
+#include "Core/StringHelpers.h" // SafeSnprintf
+#include "Core/hp_assert.h"
+#include "Core/Log.h"
+
+#ifdef _MSC_VER
+#include <Windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h> // open
+#include <libgen.h> // dirname
+#include <stdio.h> // rename
+#include <sys/stat.h> // fstat
+#include <unistd.h> // pwrite, fsync, close, unlink, getpid
+#endif
+
+#ifdef _MSC_VER
+
+static bool writeAt(HANDLE hFile, uint64_t offset, const char* pBytes, size_t sizeBytes)
+{
+	while (sizeBytes > 0)
+	{
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = (DWORD)offset;
+		overlapped.OffsetHigh = (DWORD)(offset >> 32);
+		const DWORD chunkSizeBytes = sizeBytes > 0x40000000 ? 0x40000000 : (DWORD)sizeBytes;
+		DWORD bytesWritten = 0;
+		if (!WriteFile(hFile, pBytes, chunkSizeBytes, &bytesWritten, &overlapped) || bytesWritten == 0)
+			return false;
+		pBytes += bytesWritten;
+		offset += bytesWritten;
+		sizeBytes -= bytesWritten;
+	}
+	return true;
+}
+
+bool FileWriter::WriteAtomic(const char* path, const void* pData, size_t sizeBytes)
+{
+	HP_ASSERT(path && path[0]);
+
+	char tempPath[kMaxPath];
+	if (!SafeSnprintf(tempPath, sizeof(tempPath), "%s.%lu.tmp", path, (unsigned long)GetCurrentProcessId()))
+		return false;
+
+	HANDLE hFile = CreateFileA(tempPath, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		LOG_ERROR("Failed to open file for write: %s\n", tempPath);
+		return false;
+	}
+
+	const bool written = writeAt(hFile, 0, (const char*)pData, sizeBytes) && FlushFileBuffers(hFile);
+	CloseHandle(hFile);
+	if (!written || !MoveFileExA(tempPath, path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+	{
+		LOG_ERROR("Failed to write file: %s\n", path);
+		DeleteFileA(tempPath);
+		return false;
+	}
+	return true;
+}
+
+bool FileWriter::WriteRanges(const char* path, uint64_t fileSizeBytes, const void* pData, const Range* pRanges, size_t rangeCount)
+{
+	HP_ASSERT(path && path[0]);
+
+	HANDLE hFile = CreateFileA(path, GENERIC_WRITE | GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER currentSize;
+	bool written = GetFileSizeEx(hFile, &currentSize) && (uint64_t)currentSize.QuadPart == fileSizeBytes;
+	for (size_t rangeIndex = 0; written && rangeIndex < rangeCount; rangeIndex++)
+	{
+		const Range& range = pRanges[rangeIndex];
+		HP_ASSERT(range.offset + range.sizeBytes <= fileSizeBytes);
+		written = writeAt(hFile, range.offset, (const char*)pData + range.offset, range.sizeBytes);
+	}
+	CloseHandle(hFile);
+	return written;
+}
+
+#else
+
+static bool writeAt(int fd, uint64_t offset, const char* pBytes, size_t sizeBytes)
+{
+	while (sizeBytes > 0)
+	{
+		const ssize_t bytesWritten = pwrite(fd, pBytes, sizeBytes, (off_t)offset);
+		if (bytesWritten < 0 && errno == EINTR)
+			continue;
+		if (bytesWritten <= 0)
+			return false;
+		pBytes += bytesWritten;
+		offset += (uint64_t)bytesWritten;
+		sizeBytes -= (size_t)bytesWritten;
+	}
+	return true;
+}
+
+// So that the rename itself survives a crash
+static void syncDirectory(const char* path)
+{
+	char directory[kMaxPath];
+	SafeStrcpy(directory, sizeof(directory), path);
+	const int fd = open(dirname(directory), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return;
+	fsync(fd);
+	close(fd);
+}
+
+bool FileWriter::WriteAtomic(const char* path, const void* pData, size_t sizeBytes)
+{
+	HP_ASSERT(path && path[0]);
+
+	char tempPath[kMaxPath];
+	if (!SafeSnprintf(tempPath, sizeof(tempPath), "%s.%ld.tmp", path, (long)getpid()))
+		return false;
+
+	mode_t mode = 0666; // less umask
+	struct stat fileStat;
+	if (stat(path, &fileStat) == 0)
+		mode = fileStat.st_mode & 07777;
+
+	const int fd = open(tempPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+	if (fd < 0)
+	{
+		LOG_ERROR("Failed to open file for write: %s\n", tempPath);
+		return false;
+	}
+
+	const bool written = writeAt(fd, 0, (const char*)pData, sizeBytes) && fsync(fd) == 0;
+	const bool closed = close(fd) == 0;
+	if (!written || !closed || rename(tempPath, path) != 0)
+	{
+		LOG_ERROR("Failed to write file: %s\n", path);
+		unlink(tempPath);
+		return false;
+	}
+	syncDirectory(path);
+	return true;
+}
+
+bool FileWriter::WriteRanges(const char* path, uint64_t fileSizeBytes, const void* pData, const Range* pRanges, size_t rangeCount)
+{
+	HP_ASSERT(path && path[0]);
+
+	const int fd = open(path, O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	struct stat fileStat;
+	bool written = fstat(fd, &fileStat) == 0 && (uint64_t)fileStat.st_size == fileSizeBytes;
+	for (size_t rangeIndex = 0; written && rangeIndex < rangeCount; rangeIndex++)
+	{
+		const Range& range = pRanges[rangeIndex];
+		HP_ASSERT(range.offset + range.sizeBytes <= fileSizeBytes);
+		written = writeAt(fd, range.offset, (const char*)pData + range.offset, range.sizeBytes);
+	}
+	return close(fd) == 0 && written;
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Core/Helpers.h"
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+
+//
+// Saving files without risking the existing contents.
+//
+class FileWriter
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(FileWriter);
+
+	struct Range
+	{
+		uint64_t offset;
+		size_t sizeBytes;
+	};
+
+	// Writes a temporary file next to path, syncs it to disk and renames it over path, so a crash or full disk
+	// leaves either the old file or the new one, never a truncated one. An existing file's permissions are kept.
+	static bool WriteAtomic(const char* path, const void* pData, size_t sizeBytes);
+
+	// Overwrites ranges of an existing file in place from the same offsets of pData. Fails without writing if the
+	// file's size isn't fileSizeBytes. Not synced, for speed: a crash can lose the change but never truncates the
+	// file. On failure the file may be partially updated, so fall back to WriteAtomic.
+	static bool WriteRanges(const char* path, uint64_t fileSizeBytes, const void* pData, const Range* pRanges, size_t rangeCount);
+};
@@ -52,7 +52,7 @@ bool IniFile::Parse(const char* path, Handler* pHandler, void* pUserData)
 
 	// Read the entire ini file into memory
 
-	LOG_TRACE("Opened ini file for parsing: %s\n", path);
+	LOG_CHANNEL_TRACE(Ini, "Opened ini file for parsing: %s\n", path);
 
 	fseek(pFile, 0, SEEK_END);
 	unsigned int fileSize = ftell(pFile);
@@ -124,7 +124,7 @@ bool IniFile::Parse(const char* path, Handler* pHandler, void* pUserData)
 			// Call the handler
 			if (!pHandler(pSection, pKey, pValue, pUserData, lineNumber))
 			{
-				LOG_TRACE("Failed to parse ini file key/value pair on line %u\n", lineNumber);
+				LOG_CHANNEL_TRACE(Ini, "Failed to parse ini file key/value pair on line %u\n", lineNumber);
 			}
 		}
 
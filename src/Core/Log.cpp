@@ -2,24 +2,55 @@
 
 #include "Log.h"
 
+#include "Core/FileSystem.h" // kMaxPath
+#include "Core/Helpers.h" // Min
 #include "Core/StringHelpers.h"
 #include "Core/hp_assert.h"
 
 #include <stdarg.h>
 #include <stdio.h>
-#include <stdlib.h> // malloc, free
+#include <stdlib.h> // malloc, free, atexit
+#include <string.h> // memcpy, memchr
+#include <time.h> // localtime, strftime
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #ifdef _MSC_VER
 #include <Windows.h>  // OutputDebugString
 #endif
 
-static int s_logLevel = LOG_LEVEL_INFO;
 static LogCallback s_pLogCallback = nullptr;
+static LogReserveCallback s_pLogReserveCallback = nullptr;
+static LogCommitCallback s_pLogCommitCallback = nullptr;
+
+static void appendToLogFile(const char* text, size_t len, bool flush);
 
 void SetLogLevel(int logLevel)
 {
 	HP_ASSERT(logLevel >= LOG_LEVEL_MIN && logLevel <= LOG_LEVEL_MAX);
-	s_logLevel = logLevel;
+	g_logLevel.store(logLevel, std::memory_order_relaxed);
+}
+
+void SetLogChannelMask(uint32_t channelMask)
+{
+	g_logChannelMask.store(channelMask & kLogChannelMaskAll, std::memory_order_relaxed);
+}
+
+uint32_t GetLogChannelMask()
+{
+	return g_logChannelMask.load(std::memory_order_relaxed);
+}
+
+const char* GetLogChannelName(LogChannel channel)
+{
+	static const char* kLogChannelNames[] = { "General", "Process", "ModFile", "Fonts", "Ini", "UI" };
+	static_assert(COUNTOF_ARRAY(kLogChannelNames) == ENUM_COUNT(LogChannel));
+	HP_ASSERT((unsigned int)channel < ENUM_COUNT(LogChannel));
+	return kLogChannelNames[(unsigned int)channel];
 }
 
 void SetLogCallback(LogCallback pCallback)
@@ -27,9 +58,16 @@ void SetLogCallback(LogCallback pCallback)
 	s_pLogCallback = pCallback;
 }
 
+void SetLogSinkCallbacks(LogReserveCallback pReserveCallback, LogCommitCallback pCommitCallback)
+{
+	HP_ASSERT((pReserveCallback == nullptr) == (pCommitCallback == nullptr));
+	s_pLogReserveCallback = pReserveCallback;
+	s_pLogCommitCallback = pCommitCallback;
+}
+
 int GetLogLevel()
 {
-	return s_logLevel;
+	return g_logLevel.load(std::memory_order_relaxed);
 }
 
 void LogMsgV(int logLevel, FILE* pStream, const char* format, va_list argList)
@@ -48,11 +86,16 @@ void LogMsgV(int logLevel, FILE* pStream, const char* format, va_list argList)
 	if (s_pLogCallback)
 	{
 		va_copy(argcopy, argList);
-		s_pLogCallback(logLevel, format, argList);
+		s_pLogCallback(logLevel, format, argcopy);
 		va_end(argcopy); 
 	}
 	
-	// Send string to debugger (Visual Studio Output window) for convenience
+	// Send string to debugger (Visual Studio Output window) for convenience, and to the log file
+#ifndef _MSC_VER
+	// #TODO: Use syslog() on linux?
+	if (!IsLogFileOpen())
+		return;
+#endif
 	va_copy(argcopy, argList);
 	int bufferSize = _vscprintf(format, argcopy) + 1; // + 1 to null terminate (_vscprintf return value doesn't include null-terminator)
 	va_end(argcopy); 
@@ -67,9 +110,8 @@ void LogMsgV(int logLevel, FILE* pStream, const char* format, va_list argList)
 
 #ifdef _MSC_VER
 	OutputDebugString(debugString);
-#else
-	// #TODO: Use syslog() on linux?
 #endif
+	appendToLogFile(debugString, (size_t)(bufferSize - 1), /*flush*/logLevel == LOG_LEVEL_ERROR);
 
 	free(debugString);
 }
@@ -86,7 +128,7 @@ void LogMsg(FILE* pStream, const char* format, ...)
 
 void LogLevel(int logLevel, const char* format, ...)
 {
-	if (logLevel > s_logLevel)
+	if (logLevel > g_logLevel.load(std::memory_order_relaxed))
 		return;
 
 	// LOG_ERROR and LOG_WARN go to stderr. LOG_LEVEL_INFO, LOG_LEVEL_DEBUG and LOG_LEVEL_TRACE go to stdout
@@ -100,7 +142,7 @@ void LogLevel(int logLevel, const char* format, ...)
 
 void LogLevelV(int logLevel, const char* format, va_list argList)
 {
-	if (logLevel > s_logLevel)
+	if (logLevel > g_logLevel.load(std::memory_order_relaxed))
 		return;
 
 	// LOG_ERROR and LOG_WARN go to stderr. LOG_LEVEL_INFO, LOG_LEVEL_DEBUG and LOG_LEVEL_TRACE go to stdout
@@ -108,3 +150,383 @@ void LogLevelV(int logLevel, const char* format, va_list argList)
 
 	LogMsgV(logLevel, pStream, format, argList);
 }
+
+//------------------------------------------------------------------------------------------------
+// Raw text
+
+static void callLogCallback(const char* format, ...)
+{
+	va_list argList;
+	va_start(argList, format);
+	s_pLogCallback(LOG_LEVEL_NONE, format, argList);
+	va_end(argList);
+}
+
+// Writes to the stream, debugger and log file, but not the sink or callback
+static void writeRawToStream(FILE* pStream, const char* text, size_t len)
+{
+	HP_ASSERT(pStream != nullptr);
+
+	fwrite(text, 1, len, pStream);
+	appendToLogFile(text, len, /*flush*/false);
+
+#ifdef _MSC_VER
+	// Send string to debugger (Visual Studio Output window) for convenience
+	// n.b. Requires a null terminated copy
+	char* debugString = (char*)malloc(len + 1);
+	memcpy(debugString, text, len);
+	debugString[len] = '\0';
+	OutputDebugString(debugString);
+	free(debugString);
+#endif
+}
+
+void LogWrite(FILE* pStream, const char* text, size_t len)
+{
+	HP_ASSERT(text != nullptr || len == 0);
+
+	writeRawToStream(pStream, text, len);
+
+	while (s_pLogReserveCallback && len > 0)
+	{
+		size_t reservedSizeBytes = 0;
+		char* pReserved = s_pLogReserveCallback(reservedSizeBytes);
+		if (!pReserved)
+			break; // declined; use the log callback for the rest
+		HP_ASSERT(reservedSizeBytes > 0);
+		const size_t chunkSizeBytes = Min(len, reservedSizeBytes);
+		memcpy(pReserved, text, chunkSizeBytes);
+		s_pLogCommitCallback(pStream, pReserved, chunkSizeBytes);
+		text += chunkSizeBytes;
+		len -= chunkSizeBytes;
+	}
+
+	if (len > 0 && s_pLogCallback)
+	{
+		HP_ASSERT(len <= 0x7fffffff);
+		callLogCallback("%.*s", (int)len, text);
+	}
+}
+
+char* LogReserve(size_t& sizeBytes)
+{
+	sizeBytes = 0;
+	if (!s_pLogReserveCallback)
+		return nullptr;
+
+	char* pReserved = s_pLogReserveCallback(sizeBytes);
+	if (!pReserved)
+		sizeBytes = 0;
+	HP_ASSERT(!pReserved || sizeBytes > 0);
+	return pReserved;
+}
+
+void LogCommit(FILE* pStream, char* text, size_t len)
+{
+	HP_ASSERT(s_pLogCommitCallback != nullptr);
+
+	// Stream first, because the commit callback may modify the text in place
+	writeRawToStream(pStream, text, len);
+	s_pLogCommitCallback(pStream, text, len);
+}
+
+//------------------------------------------------------------------------------------------------
+// Log file
+//
+// Callers append timestamped lines to the front buffer under a mutex. The writer thread swaps the buffers and writes
+// the back one with a single fwrite, so callers only wait for a memcpy. If the front buffer fills while the writer
+// is still busy with the back one, messages are dropped and a note written in their place.
+
+static const size_t kLogFileBufferSizeBytes = 4 * 1024 * 1024;
+static const size_t kLogFileWriteThresholdBytes = 1024 * 1024; // wake the writer early, leaving room while it writes
+static const std::chrono::milliseconds kLogFileFlushInterval(1000);
+static const size_t kMaxLogFileTimestampLength = 28; // 20 digit seconds, '.', 6 digit microseconds, ' '
+
+static std::atomic<bool> s_logFileOpen = false; // checked without the lock
+static std::mutex s_logFileMutex;
+static std::condition_variable s_logFileWakeCondition;
+static std::condition_variable s_logFileFlushedCondition;
+static std::thread s_logFileThread;
+
+// Protected by s_logFileMutex
+static char* s_pLogFileBuffers[2] = {};
+static unsigned int s_logFileFrontIndex = 0;
+static size_t s_logFileFrontSizeBytes = 0;
+static bool s_logFileAtLineStart = true;
+static uint64_t s_logFileDroppedCount = 0; // messages, since the last write
+static bool s_logFileFlushRequested = false;
+static bool s_logFileQuit = false;
+static uint64_t s_logFileFlushRequestIndex = 0;
+static uint64_t s_logFileFlushedIndex = 0;
+
+// Set when opened. Only the writer thread uses the file after that.
+static char s_logFilePath[kMaxPath];
+static char s_logFileStartTimeString[32]; // wall clock time of s_logFileStartTime, for each file's first line
+static std::chrono::steady_clock::time_point s_logFileStartTime;
+static uint64_t s_logFileMaxSizeBytes = 0;
+static unsigned int s_logFileMaxRotatedCount = 0;
+static FILE* s_pLogFile = nullptr;
+static uint64_t s_logFileSizeBytes = 0;
+
+// e.g. "    12.345678 " (at least 6 digit seconds so that short runs line up)
+static size_t formatLogFileTimestamp(char* pOut, uint64_t microseconds)
+{
+	char digits[20];
+	size_t digitCount = 0;
+	uint64_t seconds = microseconds / 1000000;
+	do
+	{
+		digits[digitCount++] = (char)('0' + seconds % 10);
+		seconds /= 10;
+	} while (seconds > 0);
+
+	char* p = pOut;
+	for (size_t i = digitCount; i < 6; i++)
+		*p++ = ' ';
+	while (digitCount > 0)
+		*p++ = digits[--digitCount];
+	*p++ = '.';
+	uint32_t fraction = (uint32_t)(microseconds % 1000000);
+	for (int i = 5; i >= 0; i--)
+	{
+		p[i] = (char)('0' + fraction % 10);
+		fraction /= 10;
+	}
+	p += 6;
+	*p++ = ' ';
+	return (size_t)(p - pOut);
+}
+
+static void appendToLogFile(const char* text, size_t len, bool flush)
+{
+	if (!s_logFileOpen.load(std::memory_order_acquire) || len == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(s_logFileMutex);
+	if (s_logFileQuit)
+		return;
+
+	// The timestamp is taken under the lock so that they increase down the file
+	char timestamp[kMaxLogFileTimestampLength];
+	size_t timestampLength = 0; // formatted when first needed
+
+	char* pBuffer = s_pLogFileBuffers[s_logFileFrontIndex];
+	const size_t startSizeBytes = s_logFileFrontSizeBytes;
+	size_t sizeBytes = startSizeBytes;
+	bool atLineStart = s_logFileAtLineStart;
+	const char* p = text;
+	const char* pEnd = text + len;
+	while (p < pEnd)
+	{
+		if (atLineStart)
+		{
+			if (timestampLength == 0)
+			{
+				const uint64_t microseconds = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_logFileStartTime).count();
+				timestampLength = formatLogFileTimestamp(timestamp, microseconds);
+			}
+			if (sizeBytes + timestampLength > kLogFileBufferSizeBytes)
+				break;
+			memcpy(pBuffer + sizeBytes, timestamp, timestampLength);
+			sizeBytes += timestampLength;
+		}
+
+		const char* pLF = (const char*)memchr(p, '\n', (size_t)(pEnd - p));
+		const char* pLineEnd = pLF ? pLF + 1 : pEnd;
+		const size_t lineSizeBytes = (size_t)(pLineEnd - p);
+		if (sizeBytes + lineSizeBytes > kLogFileBufferSizeBytes)
+			break;
+		memcpy(pBuffer + sizeBytes, p, lineSizeBytes);
+		sizeBytes += lineSizeBytes;
+		atLineStart = pLF != nullptr;
+		p = pLineEnd;
+	}
+
+	if (p < pEnd)
+	{
+		// Didn't fit; drop the whole message
+		s_logFileDroppedCount++;
+		return;
+	}
+
+	s_logFileFrontSizeBytes = sizeBytes;
+	s_logFileAtLineStart = atLineStart;
+	if (flush)
+		s_logFileFlushRequested = true;
+	if (flush || (startSizeBytes < kLogFileWriteThresholdBytes && sizeBytes >= kLogFileWriteThresholdBytes))
+		s_logFileWakeCondition.notify_one();
+}
+
+// n.b. Don't log from the writer thread; report problems straight to stderr
+static bool openLogFileForWriting(bool rotate)
+{
+	if (rotate)
+	{
+		// path.n-1 -> path.n ... path -> path.1, deleting the oldest
+		char fromPath[kMaxPath + 16];
+		char toPath[kMaxPath + 16];
+		for (unsigned int index = s_logFileMaxRotatedCount; index > 0; index--)
+		{
+			if (index > 1)
+				SafeSnprintf(fromPath, sizeof(fromPath), "%s.%u", s_logFilePath, index - 1);
+			else
+				SafeSnprintf(fromPath, sizeof(fromPath), "%s", s_logFilePath);
+			SafeSnprintf(toPath, sizeof(toPath), "%s.%u", s_logFilePath, index);
+			remove(toPath); // rename won't replace an existing file on Windows
+			rename(fromPath, toPath);
+		}
+	}
+
+	s_pLogFile = fopen(s_logFilePath, "wb");
+	if (!s_pLogFile)
+		return false;
+
+	const int headerLength = fprintf(s_pLogFile, "Timestamps are seconds since %s\n", s_logFileStartTimeString);
+	s_logFileSizeBytes = headerLength > 0 ? (uint64_t)headerLength : 0;
+	return true;
+}
+
+static void writeToLogFile(const char* pData, size_t sizeBytes)
+{
+	if (s_logFileMaxSizeBytes > 0 && s_logFileSizeBytes > 0 && s_logFileSizeBytes + sizeBytes > s_logFileMaxSizeBytes)
+	{
+		if (s_pLogFile)
+			fclose(s_pLogFile);
+		if (!openLogFileForWriting(/*rotate*/true))
+			fprintf(stderr, "ERROR: Failed to rotate log file: %s\n", s_logFilePath);
+	}
+	if (!s_pLogFile)
+		return;
+
+	if (fwrite(pData, 1, sizeBytes, s_pLogFile) != sizeBytes)
+		fprintf(stderr, "ERROR: Failed to write log file: %s\n", s_logFilePath);
+	s_logFileSizeBytes += sizeBytes;
+}
+
+static void logFileThread()
+{
+	std::unique_lock<std::mutex> lock(s_logFileMutex);
+	while (true)
+	{
+		s_logFileWakeCondition.wait_for(lock, kLogFileFlushInterval,
+			[] { return s_logFileQuit || s_logFileFlushRequested || s_logFileFrontSizeBytes >= kLogFileWriteThresholdBytes; });
+
+		// Swap, then write the back buffer without the lock
+		const unsigned int backIndex = s_logFileFrontIndex;
+		const size_t backSizeBytes = s_logFileFrontSizeBytes;
+		const uint64_t droppedCount = s_logFileDroppedCount;
+		const uint64_t flushRequestIndex = s_logFileFlushRequestIndex;
+		const bool quit = s_logFileQuit;
+		s_logFileFrontIndex ^= 1;
+		s_logFileFrontSizeBytes = 0;
+		s_logFileDroppedCount = 0;
+		s_logFileFlushRequested = false;
+		lock.unlock();
+
+		if (backSizeBytes > 0)
+			writeToLogFile(s_pLogFileBuffers[backIndex], backSizeBytes);
+		if (droppedCount > 0)
+		{
+			char note[64];
+			SafeSnprintf(note, sizeof(note), "[%llu log messages dropped]\n", (unsigned long long)droppedCount);
+			writeToLogFile(note, strlen(note));
+		}
+		if ((backSizeBytes > 0 || droppedCount > 0) && s_pLogFile)
+			fflush(s_pLogFile);
+
+		lock.lock();
+		s_logFileFlushedIndex = flushRequestIndex;
+		s_logFileFlushedCondition.notify_all();
+		if (quit)
+			break;
+	}
+}
+
+bool OpenLogFile(const char* path, uint64_t maxFileSizeBytes, unsigned int maxRotatedFileCount)
+{
+	HP_ASSERT(path && path[0]);
+	CloseLogFile();
+
+	if (strlen(path) >= sizeof(s_logFilePath))
+		return false;
+	SafeStrcpy(s_logFilePath, sizeof(s_logFilePath), path);
+	s_logFileMaxSizeBytes = maxFileSizeBytes;
+	s_logFileMaxRotatedCount = maxRotatedFileCount;
+
+	// The only formatted wall clock time; lines are timestamped relative to it
+	s_logFileStartTime = std::chrono::steady_clock::now();
+	const time_t startTime = time(nullptr);
+	const struct tm* pLocalTime = localtime(&startTime);
+	if (!pLocalTime || strftime(s_logFileStartTimeString, sizeof(s_logFileStartTimeString), "%Y-%m-%d %H:%M:%S", pLocalTime) == 0)
+		s_logFileStartTimeString[0] = '\0';
+
+	// Keep the previous run's log
+	if (!openLogFileForWriting(/*rotate*/true))
+		return false;
+
+	s_pLogFileBuffers[0] = (char*)malloc(kLogFileBufferSizeBytes);
+	s_pLogFileBuffers[1] = (char*)malloc(kLogFileBufferSizeBytes);
+	HP_ASSERT(s_pLogFileBuffers[0] && s_pLogFileBuffers[1]);
+	s_logFileFrontIndex = 0;
+	s_logFileFrontSizeBytes = 0;
+	s_logFileAtLineStart = true;
+	s_logFileDroppedCount = 0;
+	s_logFileFlushRequested = false;
+	s_logFileQuit = false;
+	s_logFileThread = std::thread(logFileThread);
+
+	static bool s_closeAtExitRegistered = false;
+	if (!s_closeAtExitRegistered)
+	{
+		atexit(CloseLogFile); // so that the last second isn't lost, and the thread is joined before it's destroyed
+		s_closeAtExitRegistered = true;
+	}
+
+	s_logFileOpen.store(true, std::memory_order_release);
+	return true;
+}
+
+void CloseLogFile()
+{
+	if (!s_logFileOpen.load(std::memory_order_acquire))
+		return;
+	s_logFileOpen.store(false, std::memory_order_release);
+
+	{
+		std::lock_guard<std::mutex> lock(s_logFileMutex);
+		s_logFileQuit = true;
+		s_logFileWakeCondition.notify_one();
+	}
+	s_logFileThread.join(); // writes anything left
+
+	std::lock_guard<std::mutex> lock(s_logFileMutex);
+	for (char*& pBuffer : s_pLogFileBuffers)
+	{
+		free(pBuffer);
+		pBuffer = nullptr;
+	}
+	if (s_pLogFile)
+	{
+		fclose(s_pLogFile);
+		s_pLogFile = nullptr;
+	}
+}
+
+bool IsLogFileOpen()
+{
+	return s_logFileOpen.load(std::memory_order_acquire);
+}
+
+void FlushLogFile()
+{
+	if (!s_logFileOpen.load(std::memory_order_acquire))
+		return;
+
+	std::unique_lock<std::mutex> lock(s_logFileMutex);
+	if (s_logFileQuit)
+		return;
+	const uint64_t flushRequestIndex = ++s_logFileFlushRequestIndex;
+	s_logFileFlushRequested = true;
+	s_logFileWakeCondition.notify_one();
+	s_logFileFlushedCondition.wait(lock, [flushRequestIndex] { return s_logFileFlushedIndex >= flushRequestIndex; });
+}
@@ -5,8 +5,12 @@
 // n.b. macOS Application Bundle output appears in vscode Terminal rather than Output Window.
 //
 
+#include <stddef.h> // size_t
+#include <stdint.h>
 #include <stdio.h> // FILE
 
+#include <atomic>
+
 #define LOG_LEVEL_NONE (-3)
 #define LOG_LEVEL_ERROR (-2)
 #define LOG_LEVEL_WARN (-1)
@@ -17,9 +21,54 @@
 #define LOG_LEVEL_MIN LOG_LEVEL_NONE
 #define LOG_LEVEL_MAX LOG_LEVEL_TRACE
 
+// Messages above this level are compiled out, along with the evaluation of their arguments. Release builds
+// keep up to LOG_LEVEL_INFO; define LOG_COMPILE_LEVEL (e.g. -DLOG_COMPILE_LEVEL=2) to override.
+#ifndef LOG_COMPILE_LEVEL
+#ifdef RELEASE
+#define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+#else
+#define LOG_COMPILE_LEVEL LOG_LEVEL_MAX
+#endif
+#endif
+
+// Subsystems whose debug and trace messages can be enabled separately, so that one can be traced in depth
+// without the others. Errors, warnings and info are logged for every channel.
+enum class LogChannel : uint8_t
+{
+	General,
+	Process, // child processes, worker pool and tool cache
+	ModFile,
+	Fonts,
+	Ini,     // ini files and options
+	UI,      // window, displays and dialogues
+
+	Max = UI
+};
+
+#define LOG_CHANNEL_BIT(channel) (1u << (unsigned int)(channel))
+static const uint32_t kLogChannelMaskAll = (LOG_CHANNEL_BIT(LogChannel::Max) << 1) - 1;
+
 void SetLogLevel(int logLevel);
 int GetLogLevel();
 
+// Channels with LOG_CHANNEL_BIT set log debug and trace messages (up to the log level). All by default.
+void SetLogChannelMask(uint32_t channelMask);
+uint32_t GetLogChannelMask();
+
+const char* GetLogChannelName(LogChannel channel);
+
+// For the inline checks in the LOG_* macros, so that nothing is formatted (or va_start'ed) for messages that
+// won't be logged. Use SetLogLevel and SetLogChannelMask to change. Atomic, as any thread can log; relaxed, as a
+// change only needs to be seen eventually and orders nothing else.
+inline std::atomic<int> g_logLevel { LOG_LEVEL_INFO };
+inline std::atomic<uint32_t> g_logChannelMask { kLogChannelMaskAll };
+
+inline bool IsLogEnabled(int logLevel, LogChannel channel)
+{
+	return logLevel <= g_logLevel.load(std::memory_order_relaxed)
+		&& (logLevel <= LOG_LEVEL_INFO || (g_logChannelMask.load(std::memory_order_relaxed) & LOG_CHANNEL_BIT(channel)) != 0);
+}
+
 // Always logs, regardless of level
 // pStream should be stdout or stderr
 void LogMsg(FILE* pStream, const char* format, ...);
@@ -33,8 +82,58 @@ void LogLevelV(int logLevel, const char* format, va_list argList);
 typedef void (*LogCallback)(int logLevel, const char* format, va_list argList);
 void SetLogCallback(LogCallback pCallback);
 
-#define LOG_ERROR(...) LogLevel(LOG_LEVEL_ERROR, "ERROR: " __VA_ARGS__)
-#define LOG_WARN(...) LogLevel(LOG_LEVEL_WARN, "WARN: " __VA_ARGS__)
-#define LOG_INFO(...) LogLevel(LOG_LEVEL_INFO, __VA_ARGS__)
-#define LOG_DEBUG(...) LogLevel(LOG_LEVEL_DEBUG, __VA_ARGS__)
-#define LOG_TRACE(...) LogLevel(LOG_LEVEL_TRACE, __VA_ARGS__)
+// Always logs raw text, regardless of level. text is not a format string, so is safe for arbitrary child
+// process output. n.b. text is not null-terminated
+void LogWrite(FILE* pStream, const char* text, size_t len);
+
+// Optional destination for raw text (e.g. the Output window) that can lend out space to write into directly,
+// avoiding an intermediate copy.
+// The reserve callback returns space for at least one byte and sets sizeBytes, or nullptr if it can't lend space
+// right now (e.g. when called from a thread that doesn't own the sink), in which case the log callback is used.
+// The commit callback appends the first len bytes of the most recently reserved space, and may modify them in place.
+// pStream is where the text was written, stdout or stderr.
+typedef char* (*LogReserveCallback)(size_t& sizeBytes);
+typedef void (*LogCommitCallback)(FILE* pStream, char* text, size_t len);
+void SetLogSinkCallbacks(LogReserveCallback pReserveCallback, LogCommitCallback pCommitCallback);
+
+// Zero copy LogWrite for large writes e.g. reading child process output directly into the sink.
+// LogReserve returns nullptr if there is no sink or it declined, in which case use LogWrite.
+// Nothing may be logged between LogReserve and LogCommit.
+char* LogReserve(size_t& sizeBytes);
+void LogCommit(FILE* pStream, char* text, size_t len);
+
+// Also writes everything logged, including raw text, to a file. Each line is prefixed with the seconds since the
+// file was opened, from the monotonic clock. Lines are buffered and written in large blocks by a background thread
+// every second, or straight away after an error; if it can't keep up, messages are dropped (and counted) rather
+// than blocking the caller. When the file would exceed maxFileSizeBytes it is renamed to path.1 (path.1 to path.2
+// etc. up to maxRotatedFileCount) and a new one started. An existing file at path is rotated in the same way.
+// The file is closed at exit, if not before.
+static const uint64_t kDefaultLogFileMaxSizeBytes = 64 * 1024 * 1024;
+static const unsigned int kDefaultLogFileMaxRotatedCount = 4;
+bool OpenLogFile(const char* path, uint64_t maxFileSizeBytes = kDefaultLogFileMaxSizeBytes, unsigned int maxRotatedFileCount = kDefaultLogFileMaxRotatedCount);
+void CloseLogFile();
+bool IsLogFileOpen();
+
+// Blocks until everything logged so far has been written to the log file (e.g. before a crash or assert)
+void FlushLogFile();
+
+// Arguments are only evaluated if the message will be logged
+#define LOG_AT_LEVEL(logLevel, channel, ...) \
+	do \
+	{ \
+		if constexpr ((logLevel) <= LOG_COMPILE_LEVEL) \
+		{ \
+			if (IsLogEnabled((logLevel), (channel))) \
+				LogLevel((logLevel), __VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LOG_ERROR(...) LOG_AT_LEVEL(LOG_LEVEL_ERROR, LogChannel::General, "ERROR: " __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT_LEVEL(LOG_LEVEL_WARN, LogChannel::General, "WARN: " __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT_LEVEL(LOG_LEVEL_INFO, LogChannel::General, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT_LEVEL(LOG_LEVEL_DEBUG, LogChannel::General, __VA_ARGS__)
+#define LOG_TRACE(...) LOG_AT_LEVEL(LOG_LEVEL_TRACE, LogChannel::General, __VA_ARGS__)
+
+// e.g. LOG_CHANNEL_TRACE(Process, "Child process ID: %i\n", pid) logs "Process: Child process ID: 123"
+#define LOG_CHANNEL_DEBUG(channel, ...) LOG_AT_LEVEL(LOG_LEVEL_DEBUG, LogChannel::channel, #channel ": " __VA_ARGS__)
+#define LOG_CHANNEL_TRACE(channel, ...) LOG_AT_LEVEL(LOG_LEVEL_TRACE, LogChannel::channel, #channel ": " __VA_ARGS__)
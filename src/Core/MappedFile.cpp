@@ -0,0 +1,275 @@
+#include "MappedFile.h"
+
+#include "Core/FileSystem.h" // kMaxPath
+#include "Core/StringHelpers.h" // SafeSnprintf
+#include "Core/hp_assert.h"
+
+#ifdef _MSC_VER
+#include <Windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h> // open
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <unistd.h> // pread, pwrite, close, unlink, sysconf, getpid
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Create(const char* path)
+{
+	return create(path, /*temporary*/false);
+}
+
+#ifdef _MSC_VER
+
+bool MappedFile::CreateTemporary(const char* directory, const char* namePrefix)
+{
+	char path[kMaxPath];
+	if (!SafeSnprintf(path, sizeof(path), "%s%s%lu.tmp", directory, namePrefix, (unsigned long)GetCurrentProcessId()))
+		return false;
+	return create(path, /*temporary*/true);
+}
+
+bool MappedFile::create(const char* path, bool temporary)
+{
+	HP_ASSERT(path && path[0]);
+	Close();
+
+	DWORD flagsAndAttributes = FILE_ATTRIBUTE_NORMAL;
+	if (temporary)
+		flagsAndAttributes = FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE;
+	HANDLE hFile = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, CREATE_ALWAYS, flagsAndAttributes, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	m_hFile = hFile;
+	return true;
+}
+
+bool MappedFile::OpenReadOnly(const char* path, uint64_t& sizeBytes)
+{
+	HP_ASSERT(path && path[0]);
+	Close();
+
+	// Other programs can still write it, as ModWatcher expects
+	HANDLE hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(hFile, &fileSize))
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	m_hFile = hFile;
+	sizeBytes = (uint64_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_hFile)
+	{
+		CloseHandle((HANDLE)m_hFile);
+		m_hFile = nullptr;
+	}
+}
+
+bool MappedFile::IsOpen() const
+{
+	return m_hFile != nullptr;
+}
+
+bool MappedFile::Write(uint64_t offset, const void* pData, size_t sizeBytes)
+{
+	HP_ASSERT(IsOpen());
+
+	const char* pBytes = (const char*)pData;
+	while (sizeBytes > 0)
+	{
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = (DWORD)offset;
+		overlapped.OffsetHigh = (DWORD)(offset >> 32);
+		const DWORD chunkSizeBytes = sizeBytes > 0x40000000 ? 0x40000000 : (DWORD)sizeBytes;
+		DWORD bytesWritten = 0;
+		if (!WriteFile((HANDLE)m_hFile, pBytes, chunkSizeBytes, &bytesWritten, &overlapped) || bytesWritten == 0)
+			return false;
+		pBytes += bytesWritten;
+		offset += bytesWritten;
+		sizeBytes -= bytesWritten;
+	}
+	return true;
+}
+
+bool MappedFile::Read(uint64_t offset, void* pData, size_t sizeBytes, size_t& bytesRead) const
+{
+	HP_ASSERT(IsOpen());
+
+	bytesRead = 0;
+	while (bytesRead < sizeBytes)
+	{
+		OVERLAPPED overlapped = {};
+		overlapped.Offset = (DWORD)(offset + bytesRead);
+		overlapped.OffsetHigh = (DWORD)((offset + bytesRead) >> 32);
+		const size_t remainingBytes = sizeBytes - bytesRead;
+		const DWORD chunkSizeBytes = remainingBytes > 0x40000000 ? 0x40000000 : (DWORD)remainingBytes;
+		DWORD chunkBytesRead = 0;
+		if (!ReadFile((HANDLE)m_hFile, (char*)pData + bytesRead, chunkSizeBytes, &chunkBytesRead, &overlapped))
+			return GetLastError() == ERROR_HANDLE_EOF;
+		if (chunkBytesRead == 0)
+			break; // end of file
+		bytesRead += chunkBytesRead;
+	}
+	return true;
+}
+
+const char* MappedFile::Map(uint64_t offset, size_t sizeBytes)
+{
+	HP_ASSERT(IsOpen());
+	HP_ASSERT(offset % GetMapAlignment() == 0);
+
+	// The mapping object can be closed straight away; the view keeps it alive
+	HANDLE hMapping = CreateFileMappingA((HANDLE)m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!hMapping)
+		return nullptr;
+	const void* pView = MapViewOfFile(hMapping, FILE_MAP_READ, (DWORD)(offset >> 32), (DWORD)offset, sizeBytes);
+	CloseHandle(hMapping);
+	return (const char*)pView;
+}
+
+void MappedFile::Unmap(const char* pView, size_t /*sizeBytes*/)
+{
+	if (pView)
+		UnmapViewOfFile(pView);
+}
+
+size_t MappedFile::GetMapAlignment()
+{
+	SYSTEM_INFO systemInfo;
+	GetSystemInfo(&systemInfo);
+	return systemInfo.dwAllocationGranularity;
+}
+
+#else
+
+bool MappedFile::CreateTemporary(const char* directory, const char* namePrefix)
+{
+	char path[kMaxPath];
+	if (!SafeSnprintf(path, sizeof(path), "%s%s%ld.tmp", directory, namePrefix, (long)getpid()))
+		return false;
+	return create(path, /*temporary*/true);
+}
+
+bool MappedFile::create(const char* path, bool temporary)
+{
+	HP_ASSERT(path && path[0]);
+	Close();
+
+	m_fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if (m_fd < 0)
+		return false;
+
+	if (temporary)
+		unlink(path);
+	return true;
+}
+
+bool MappedFile::OpenReadOnly(const char* path, uint64_t& sizeBytes)
+{
+	HP_ASSERT(path && path[0]);
+	Close();
+
+	m_fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (m_fd < 0)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(m_fd, &fileStat) != 0)
+	{
+		Close();
+		return false;
+	}
+
+	sizeBytes = (uint64_t)fileStat.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_fd >= 0)
+	{
+		close(m_fd);
+		m_fd = -1;
+	}
+}
+
+bool MappedFile::IsOpen() const
+{
+	return m_fd >= 0;
+}
+
+bool MappedFile::Write(uint64_t offset, const void* pData, size_t sizeBytes)
+{
+	HP_ASSERT(IsOpen());
+
+	const char* pBytes = (const char*)pData;
+	while (sizeBytes > 0)
+	{
+		const ssize_t bytesWritten = pwrite(m_fd, pBytes, sizeBytes, (off_t)offset);
+		if (bytesWritten < 0 && errno == EINTR)
+			continue;
+		if (bytesWritten <= 0)
+			return false;
+		pBytes += bytesWritten;
+		offset += (uint64_t)bytesWritten;
+		sizeBytes -= (size_t)bytesWritten;
+	}
+	return true;
+}
+
+bool MappedFile::Read(uint64_t offset, void* pData, size_t sizeBytes, size_t& bytesRead) const
+{
+	HP_ASSERT(IsOpen());
+
+	bytesRead = 0;
+	while (bytesRead < sizeBytes)
+	{
+		const ssize_t chunkBytesRead = pread(m_fd, (char*)pData + bytesRead, sizeBytes - bytesRead, (off_t)(offset + bytesRead));
+		if (chunkBytesRead < 0 && errno == EINTR)
+			continue;
+		if (chunkBytesRead < 0)
+			return false;
+		if (chunkBytesRead == 0)
+			break; // end of file
+		bytesRead += (size_t)chunkBytesRead;
+	}
+	return true;
+}
+
+const char* MappedFile::Map(uint64_t offset, size_t sizeBytes)
+{
+	HP_ASSERT(IsOpen());
+	HP_ASSERT(offset % GetMapAlignment() == 0);
+
+	void* pView = mmap(nullptr, sizeBytes, PROT_READ, MAP_SHARED, m_fd, (off_t)offset);
+	return pView == MAP_FAILED ? nullptr : (const char*)pView;
+}
+
+void MappedFile::Unmap(const char* pView, size_t sizeBytes)
+{
+	if (pView)
+		munmap((void*)pView, sizeBytes);
+}
+
+size_t MappedFile::GetMapAlignment()
+{
+	return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+#endif
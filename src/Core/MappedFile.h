@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+
+//
+// A file written with explicit offsets and read back through read-only memory mapped views, so that large
+// amounts of data can be kept out of the heap while remaining directly addressable. The OS pages views in
+// on demand and can drop them under memory pressure, as they are backed by the file.
+//
+// An existing file can also be opened read-only, to map views of it or read it. Reading copies, but unlike reading a
+// view it can't crash (SIGBUS on POSIX) if another program truncates the file: it just reads less.
+//
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// Creates an empty file, replacing any existing file
+	bool Create(const char* path);
+
+	// Creates an empty file in directory, named uniquely to this process, which is deleted when closed or if the
+	// process exits without closing it. (POSIX: it is unlinked immediately, so only the handle refers to it.)
+	bool CreateTemporary(const char* directory, const char* namePrefix);
+
+	// Opens an existing file read-only, so Write fails. Views of [0, sizeBytes) can be mapped.
+	bool OpenReadOnly(const char* path, uint64_t& sizeBytes);
+
+	void Close();
+	bool IsOpen() const;
+
+	bool Write(uint64_t offset, const void* pData, size_t sizeBytes);
+
+	// Reads up to sizeBytes from offset, stopping at the end of the file. Can be called on several threads at once.
+	bool Read(uint64_t offset, void* pData, size_t sizeBytes, size_t& bytesRead) const;
+
+	// Read-only view of [offset, offset + sizeBytes), which must have been written. offset must be a multiple of
+	// GetMapAlignment(). Views remain valid until unmapped, even after the file is closed. Returns nullptr on failure.
+	const char* Map(uint64_t offset, size_t sizeBytes);
+	static void Unmap(const char* pView, size_t sizeBytes);
+
+	// Page size on POSIX, allocation granularity (64 KB) on Windows
+	static size_t GetMapAlignment();
+
+private:
+	bool create(const char* path, bool temporary);
+
+#ifdef _MSC_VER
+	void* m_hFile = nullptr; // HANDLE
+#else
+	int m_fd = -1;
+#endif
+};
@@ -0,0 +1,216 @@
+#include "ProcessStats.h"
+
+#include "Core/StringHelpers.h"
+#include "Core/Log.h"
+#include "Core/hp_assert.h"
+
+#include <stdio.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <Windows.h> // GetProcessTimes
+#else
+#include <sys/resource.h> // getrusage
+#endif
+
+struct JobRecord
+{
+	std::string commandLine;
+	Process::Stats stats;
+};
+
+struct CompletedBatch
+{
+	std::string name;
+	std::vector<JobRecord> jobs;
+};
+
+static const char kSessionBatchName[] = "session";
+
+// Batches with jobs are kept after they end, for ExportCsv
+static const size_t kMaxCompletedBatchCount = 16;
+
+static char s_batchName[64] = "session";
+static std::vector<JobRecord> s_jobs;
+static bool s_batchActive;
+static double s_batchStartParentCpuSeconds;
+static std::chrono::steady_clock::time_point s_batchStartTime = std::chrono::steady_clock::now();
+static std::vector<CompletedBatch> s_completedBatches; // oldest first
+
+static const double kBytesPerMB = 1024.0 * 1024.0;
+
+//------------------------------------------------------------------------------------------------
+
+static void writeCsvString(FILE* pFile, const char* str)
+{
+	// RFC 4180: enclose in double quotes and escape double quotes by doubling them
+	fputc('"', pFile);
+	for (const char* p = str; *p; p++)
+	{
+		if (*p == '"')
+			fputc('"', pFile);
+		fputc(*p, pFile);
+	}
+	fputc('"', pFile);
+}
+
+static void writeCsvRows(FILE* pFile, const char* batchName, const std::vector<JobRecord>& jobs)
+{
+	for (size_t jobIndex = 0; jobIndex < jobs.size(); jobIndex++)
+	{
+		const JobRecord& job = jobs[jobIndex];
+		const Process::Stats& stats = job.stats;
+		writeCsvString(pFile, batchName);
+		fprintf(pFile, ",%u,", (unsigned int)jobIndex);
+		writeCsvString(pFile, job.commandLine.c_str());
+		fprintf(pFile, ",%u,%.6f,%.6f,%.6f,%llu,%llu,%llu,%llu,%llu\n",
+			stats.exitCode, stats.wallSeconds, stats.userCpuSeconds, stats.systemCpuSeconds,
+			(unsigned long long)stats.maxRssBytes,
+			(unsigned long long)stats.voluntaryContextSwitches, (unsigned long long)stats.involuntaryContextSwitches,
+			(unsigned long long)stats.blockInputOps, (unsigned long long)stats.blockOutputOps);
+	}
+}
+
+// Keeps the current batch's records, if any, for ExportCsv
+static void startBatch(const char* name, bool active)
+{
+	if (!s_jobs.empty())
+	{
+		if (s_completedBatches.size() >= kMaxCompletedBatchCount)
+			s_completedBatches.erase(s_completedBatches.begin());
+		s_completedBatches.push_back(CompletedBatch { s_batchName, std::move(s_jobs) });
+	}
+
+	SafeStrncpy(s_batchName, sizeof(s_batchName), name, Min(strlen(name), sizeof(s_batchName) - 1));
+	s_jobs.clear();
+	s_batchActive = active;
+	s_batchStartParentCpuSeconds = ProcessStats::GetParentCpuSeconds();
+	s_batchStartTime = std::chrono::steady_clock::now();
+}
+
+//------------------------------------------------------------------------------------------------
+
+void ProcessStats::BeginBatch(const char* name)
+{
+	HP_ASSERT(name && name[0]);
+
+	if (s_batchActive)
+		EndBatch();
+
+	startBatch(name, true);
+}
+
+void ProcessStats::EndBatch()
+{
+	if (!s_batchActive)
+		return;
+
+	Process::Stats totals;
+	unsigned int failedJobCount = 0;
+	for (const JobRecord& job : s_jobs)
+	{
+		const Process::Stats& stats = job.stats;
+		if (stats.exitCode != 0)
+			failedJobCount++;
+		totals.wallSeconds += stats.wallSeconds;
+		totals.userCpuSeconds += stats.userCpuSeconds;
+		totals.systemCpuSeconds += stats.systemCpuSeconds;
+		totals.maxRssBytes = Max(totals.maxRssBytes, stats.maxRssBytes);
+		totals.voluntaryContextSwitches += stats.voluntaryContextSwitches;
+		totals.involuntaryContextSwitches += stats.involuntaryContextSwitches;
+		totals.blockInputOps += stats.blockInputOps;
+		totals.blockOutputOps += stats.blockOutputOps;
+	}
+
+	const double batchWallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - s_batchStartTime).count();
+	const double parentCpuSeconds = GetParentCpuSeconds() - s_batchStartParentCpuSeconds;
+
+	LOG_INFO("Batch '%s': %u jobs (%u failed) in %.3fs\n", s_batchName, (unsigned int)s_jobs.size(), failedJobCount, batchWallSeconds);
+	LOG_INFO("  Children: wall %.3fs  user %.3fs  sys %.3fs  peak RSS %.1f MB  ctx switches %llu/%llu  block I/O %llu/%llu\n",
+		totals.wallSeconds, totals.userCpuSeconds, totals.systemCpuSeconds, (double)totals.maxRssBytes / kBytesPerMB,
+		(unsigned long long)totals.voluntaryContextSwitches, (unsigned long long)totals.involuntaryContextSwitches,
+		(unsigned long long)totals.blockInputOps, (unsigned long long)totals.blockOutputOps);
+	LOG_INFO("  hoffgui: cpu %.3fs\n", parentCpuSeconds);
+
+	// Later jobs are the session's again, and this batch's are kept
+	startBatch(kSessionBatchName, false);
+}
+
+void ProcessStats::Record(const char* argv[], const Process::Stats& stats)
+{
+	HP_ASSERT(argv && argv[0]);
+
+	JobRecord job;
+	for (unsigned int argIndex = 0; argv[argIndex] != nullptr; argIndex++)
+	{
+		if (argIndex > 0)
+			job.commandLine += ' ';
+		job.commandLine += argv[argIndex];
+	}
+	job.stats = stats;
+	s_jobs.push_back(job);
+
+	LOG_INFO("Process exited with code %u: wall %.3fs  user %.3fs  sys %.3fs  peak RSS %.1f MB  ctx switches %llu/%llu  block I/O %llu/%llu\n",
+		stats.exitCode, stats.wallSeconds, stats.userCpuSeconds, stats.systemCpuSeconds, (double)stats.maxRssBytes / kBytesPerMB,
+		(unsigned long long)stats.voluntaryContextSwitches, (unsigned long long)stats.involuntaryContextSwitches,
+		(unsigned long long)stats.blockInputOps, (unsigned long long)stats.blockOutputOps);
+}
+
+unsigned int ProcessStats::GetJobCount()
+{
+	size_t jobCount = s_jobs.size();
+	for (const CompletedBatch& batch : s_completedBatches)
+		jobCount += batch.jobs.size();
+	return (unsigned int)jobCount;
+}
+
+double ProcessStats::GetParentCpuSeconds()
+{
+#ifdef _MSC_VER
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+		return 0.0;
+	const uint64_t kernelTicks = ((uint64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+	const uint64_t userTicks = ((uint64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+	return (double)(kernelTicks + userTicks) * 1e-7; // 100 nanosecond units
+#else
+	struct rusage usage = {};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0.0;
+	return (double)usage.ru_utime.tv_sec + (double)usage.ru_utime.tv_usec * 1e-6
+		+ (double)usage.ru_stime.tv_sec + (double)usage.ru_stime.tv_usec * 1e-6;
+#endif
+}
+
+bool ProcessStats::ExportCsv(const char* path)
+{
+	HP_ASSERT(path && path[0]);
+
+	FILE* pFile = fopen(path, "w");
+	if (!pFile)
+	{
+		LOG_ERROR("Failed to open file for write: %s\n", path);
+		return false;
+	}
+
+	fprintf(pFile, "batch,job,command,exit_code,wall_s,user_cpu_s,sys_cpu_s,max_rss_bytes,voluntary_ctx_switches,involuntary_ctx_switches,block_input_ops,block_output_ops\n");
+	for (const CompletedBatch& batch : s_completedBatches)
+		writeCsvRows(pFile, batch.name.c_str(), batch.jobs);
+	writeCsvRows(pFile, s_batchName, s_jobs);
+
+	const bool ok = ferror(pFile) == 0;
+	fclose(pFile);
+	pFile = nullptr;
+
+	if (!ok)
+	{
+		LOG_ERROR("Failed to write file: %s\n", path);
+		return false;
+	}
+
+	LOG_INFO("Exported %u process records to %s\n", GetJobCount(), path);
+	return true;
+}
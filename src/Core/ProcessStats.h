@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Core/ProcessWrap.h"
+
+//
+// Collects the resource usage of every child process launched during a batch, so it is possible to tell
+// whether slow batches are caused by the child tool or by hoffgui itself.
+//
+// Process::Launch records each job automatically. Jobs launched outside of an explicit batch are collected
+// in an implicit "session" batch. The records of the last few batches are kept after they end, for ExportCsv.
+//
+class ProcessStats
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(ProcessStats);
+
+	// Starts a new batch, ending any batch in progress
+	static void BeginBatch(const char* name);
+
+	// Logs a summary of the batch including the parent (hoffgui) CPU time consumed during the batch, then starts a
+	// new implicit "session" batch
+	static void EndBatch();
+
+	// Called by Process::Launch. Logs a one-line summary of the job.
+	static void Record(const char* argv[], const Process::Stats& stats);
+
+	// Of the current and kept batches, as exported by ExportCsv
+	static unsigned int GetJobCount();
+
+	// User + system CPU time consumed by hoffgui itself (not its children) since startup
+	static double GetParentCpuSeconds();
+
+	// One row per job of the kept batches, oldest first, then of the current batch
+	static bool ExportCsv(const char* path);
+};
@@ -1,12 +1,14 @@
 #include "ProcessWrap.h"
 
+#include "Core/ProcessStats.h"
+#include "Core/StringHelpers.h" // Strlcat
 #include "Core/Log.h"
 #include "Core/hp_assert.h"
 
-#include "SDL.h" // SDL_strlcat
-
 #include <stdlib.h> // EXIT_SUCCESS, EXIT_FAILURE
 
+#include <chrono>
+
 //------------------------------------------------------------------------------------------------
 //
 // argv is null terminated
@@ -22,14 +24,14 @@ static bool argsToCommandLine(const char* argv[], char* commandLine, size_t buff
 	{
 		if (i > 0)
 		{
-			if (SDL_strlcat(commandLine, " ", bufferSizeBytes) >= bufferSizeBytes)
+			if (Strlcat(commandLine, " ", bufferSizeBytes) >= bufferSizeBytes)
 			{
 				LOG_ERROR("Buffer overflow in argsToCommandLine\n");
 				return false;
 			}
 
 		}
-		if (SDL_strlcat(commandLine, argv[i], bufferSizeBytes) >= bufferSizeBytes)
+		if (Strlcat(commandLine, argv[i], bufferSizeBytes) >= bufferSizeBytes)
 		{
 			LOG_ERROR("Buffer overflow in argsToCommandLine\n");
 			return false;
@@ -40,20 +42,36 @@ static bool argsToCommandLine(const char* argv[], char* commandLine, size_t buff
 	return true;
 }
 
+// Optional capture of child output for the duration of a Launch call
+static Process::OutputCallback s_pOutputCallback;
+static void* s_pOutputCallbackUserData;
+
+static void forwardChildOutput(const char* text, size_t len)
+{
+	if (s_pOutputCallback)
+		s_pOutputCallback(text, len, s_pOutputCallbackUserData);
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
 #ifdef _MSC_VER
 
 #include <Windows.h> //_splitpath_s, _makepath_s
 #include <comdef.h> // _com_error
+#include <Psapi.h> // GetProcessMemoryInfo
 
 static const unsigned int kBufferSize = 4096;
 
 static HANDLE s_hChildStdErrRead;
-static char s_stderrBuffer[kBufferSize + 1] = {};
+static char s_stderrBuffer[kBufferSize] = {};
 static DWORD s_stderrStatus;
 static OVERLAPPED s_stderrOverlapped;
 
 static HANDLE s_hChildStdOutRead;
-static char s_stdoutBuffer[kBufferSize + 1] = {};
+static char s_stdoutBuffer[kBufferSize] = {};
 static DWORD s_stdoutStatus;
 static OVERLAPPED s_stdoutOverlapped;
 
@@ -179,10 +197,10 @@ static void CALLBACK stdErrReadCompleted(const DWORD errorCode, const DWORD byte
 	if (errorCode != ERROR_SUCCESS)
 		return;
 
-	HP_ASSERT(bytesRead < COUNTOF_ARRAY(s_stderrBuffer));
-	s_stderrBuffer[bytesRead] = '\0';
-	LogMsg(stderr, s_stderrBuffer);
-	s_stderrBuffer[0] = '\0';
+	// n.b. Both streams have a read in flight at once, so can't read directly into the log sink as on POSIX
+	HP_ASSERT(bytesRead <= kBufferSize);
+	forwardChildOutput(s_stderrBuffer, bytesRead);
+	LogWrite(stderr, s_stderrBuffer, bytesRead);
 
 	if (!ReadFileEx(s_hChildStdErrRead, s_stderrBuffer, /*nNumberOfBytesToRead*/kBufferSize, pOverlapped, stdErrReadCompleted))
 	{
@@ -192,7 +210,7 @@ static void CALLBACK stdErrReadCompleted(const DWORD errorCode, const DWORD byte
 		HRESULT hr = HRESULT_FROM_WIN32(s_stderrStatus);
 		_com_error err(hr);
 		LPCTSTR errMsg = err.ErrorMessage();
-		LOG_TRACE("ReadFileEx stderr GetLastError() = %u, HR = 0x%X, %s\n", s_stderrStatus, hr, errMsg);
+		LOG_CHANNEL_TRACE(Process, "ReadFileEx stderr GetLastError() = %u, HR = 0x%X, %s\n", s_stderrStatus, hr, errMsg);
 	}
 }
 
@@ -203,10 +221,9 @@ static void CALLBACK stdOutReadCompleted(const DWORD errorCode, const DWORD byte
 	if (errorCode != ERROR_SUCCESS)
 		return;
 
-	HP_ASSERT(bytesRead < COUNTOF_ARRAY(s_stdoutBuffer));
-	s_stdoutBuffer[bytesRead] = '\0';
-	LogMsg(stdout, s_stdoutBuffer);
-	s_stdoutBuffer[0] = '\0';
+	HP_ASSERT(bytesRead <= kBufferSize);
+	forwardChildOutput(s_stdoutBuffer, bytesRead);
+	LogWrite(stdout, s_stdoutBuffer, bytesRead);
 
 	if (!ReadFileEx(s_hChildStdOutRead, s_stdoutBuffer, /*nNumberOfBytesToRead*/kBufferSize, pOverlapped, stdOutReadCompleted))
 	{
@@ -216,7 +233,7 @@ static void CALLBACK stdOutReadCompleted(const DWORD errorCode, const DWORD byte
 		HRESULT hr = HRESULT_FROM_WIN32(s_stdoutStatus);
 		_com_error err(hr);
 		LPCTSTR errMsg = err.ErrorMessage();
-		LOG_TRACE("ReadFileEx stdout GetLastError() = %u, HR = 0x%X, %s\n", s_stdoutStatus, hr, errMsg);
+		LOG_CHANNEL_TRACE(Process, "ReadFileEx stdout GetLastError() = %u, HR = 0x%X, %s\n", s_stdoutStatus, hr, errMsg);
 	}
 }
 
@@ -226,7 +243,37 @@ static void CALLBACK stdOutReadCompleted(const DWORD errorCode, const DWORD byte
 // https://learn.microsoft.com/en-gb/windows/win32/procthread/creating-a-child-process-with-redirected-input-and-output
 // https://stackoverflow.com/questions/56499041/capture-output-from-console-program-with-overlapping-and-events
 //
-static unsigned int launchProcess(const char* argv[])
+static double fileTimeToSeconds(const FILETIME& fileTime)
+{
+	// FILETIME is in 100 nanosecond units
+	const uint64_t ticks = ((uint64_t)fileTime.dwHighDateTime << 32) | fileTime.dwLowDateTime;
+	return (double)ticks * 1e-7;
+}
+
+static void collectChildStats(HANDLE hProcess, Process::Stats& stats)
+{
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (GetProcessTimes(hProcess, &creationTime, &exitTime, &kernelTime, &userTime))
+	{
+		stats.userCpuSeconds = fileTimeToSeconds(userTime);
+		stats.systemCpuSeconds = fileTimeToSeconds(kernelTime);
+	}
+
+	PROCESS_MEMORY_COUNTERS memoryCounters = {};
+	if (GetProcessMemoryInfo(hProcess, &memoryCounters, sizeof(memoryCounters)))
+		stats.maxRssBytes = memoryCounters.PeakWorkingSetSize;
+
+	IO_COUNTERS ioCounters = {};
+	if (GetProcessIoCounters(hProcess, &ioCounters))
+	{
+		stats.blockInputOps = ioCounters.ReadOperationCount;
+		stats.blockOutputOps = ioCounters.WriteOperationCount;
+	}
+
+	// Context switch counts are not available per process without performance counters
+}
+
+static unsigned int launchProcess(const char* argv[], Process::Stats& stats)
 {
 	HP_ASSERT(argv && argv[0]);
 
@@ -287,6 +334,7 @@ static unsigned int launchProcess(const char* argv[])
 
 	LOG_INFO("Creating process: %s\n", commandLine);
 
+	const std::chrono::steady_clock::time_point spawnTime = std::chrono::steady_clock::now();
 	if (!CreateProcess(
 		NULL,             // n.b. The lpApplicationName parameter can be NULL. In that case, the module name must be the first white space–delimited token in the lpCommandLine string.
 		(LPSTR)commandLine,
@@ -355,9 +403,11 @@ static unsigned int launchProcess(const char* argv[])
 
 	// Wait until child process exits.
 	WaitForSingleObject(processInformation.hProcess, INFINITE);
+	stats.wallSeconds = secondsSince(spawnTime);
 
 	DWORD exitCode;
 	GetExitCodeProcess(processInformation.hProcess, &exitCode);
+	collectChildStats(processInformation.hProcess, stats);
 
 	CloseHandle(s_hChildStdOutRead);
 	s_hChildStdOutRead = NULL;
@@ -376,12 +426,13 @@ static unsigned int launchProcess(const char* argv[])
 #include <unistd.h> // fork
 //#include <spawn.h> // posix_spawn
 #include <sys/wait.h> // waitpid https://www.gnu.org/software/libc/manual/html_node/Process-Completion.html
+#include <sys/resource.h> // wait4, struct rusage
 #include <errno.h>
 
 #define READ_END 0
 #define WRITE_END 1
 
-static const unsigned int kBufferSize = 4096;
+static const unsigned int kBufferSize = 64 * 1024; // used when there is no log sink to read directly into
 static char s_childOutputBuffer[kBufferSize];
 
 //
@@ -404,39 +455,59 @@ static void printChildExitReason(pid_t cid, int status)
 {
 	if (WIFEXITED(status))
 	{
-		LOG_TRACE("child %d terminated normally, that is, by calling exit(3) or _exit(2), or by returning from main().\n", cid);
+		LOG_CHANNEL_TRACE(Process, "child %d terminated normally, that is, by calling exit(3) or _exit(2), or by returning from main().\n", cid);
 		if (WEXITSTATUS(status))
 		{
-			LOG_TRACE("child %d exit status %d.  This consists of the least significant 8 bits of the status argument that the child specified in a call to exit(3) or _exit(2) or as the argument for a return statement in main().\n", cid, WEXITSTATUS(status));
+			LOG_CHANNEL_TRACE(Process, "child %d exit status %d.  This consists of the least significant 8 bits of the status argument that the child specified in a call to exit(3) or _exit(2) or as the argument for a return statement in main().\n", cid, WEXITSTATUS(status));
 		}
 	}
 	if (WIFSIGNALED(status))
 	{
-		LOG_TRACE("child %d process was terminated by a signal.\n", cid);
+		LOG_CHANNEL_TRACE(Process, "child %d process was terminated by a signal.\n", cid);
 		if (WTERMSIG(status))
 		{
-			LOG_TRACE("child %d signal %d that caused the child process to terminate.\n", cid, WTERMSIG(status));
+			LOG_CHANNEL_TRACE(Process, "child %d signal %d that caused the child process to terminate.\n", cid, WTERMSIG(status));
 		}
 		if (WCOREDUMP(status))
 		{
-			LOG_TRACE("child %d produced a core dump.  WCOREDUMP() is not specified in POSIX.1-2001 and is not available on some UNIX implementations (e.g., AIX, SunOS).  Only use this enclosed in #ifdef WCOREDUMP ... #endif.\n", cid);
+			LOG_CHANNEL_TRACE(Process, "child %d produced a core dump.  WCOREDUMP() is not specified in POSIX.1-2001 and is not available on some UNIX implementations (e.g., AIX, SunOS).  Only use this enclosed in #ifdef WCOREDUMP ... #endif.\n", cid);
 		}
 	}
 	if (WIFSTOPPED(status))
 	{
-		LOG_TRACE("child %d process was stopped by delivery of a signal; this is only possible if the call was done using WUNTRACED or when the child is being traced (see ptrace(2)).\n", cid);
+		LOG_CHANNEL_TRACE(Process, "child %d process was stopped by delivery of a signal; this is only possible if the call was done using WUNTRACED or when the child is being traced (see ptrace(2)).\n", cid);
 		if (WSTOPSIG(status))
 		{
-			LOG_TRACE("child %d number of the signal which caused the child to stop.\n", cid);
+			LOG_CHANNEL_TRACE(Process, "child %d number of the signal which caused the child to stop.\n", cid);
 		}
 	}
 	if (WIFCONTINUED(status))
 	{
-		LOG_TRACE("child %d process was resumed by delivery of SIGCONT.\n", cid);
+		LOG_CHANNEL_TRACE(Process, "child %d process was resumed by delivery of SIGCONT.\n", cid);
 	}
 }
 
-static unsigned int launchProcess(const char* argv[])
+static double timevalToSeconds(const struct timeval& tv)
+{
+	return (double)tv.tv_sec + (double)tv.tv_usec * 1e-6;
+}
+
+static void collectChildStats(const struct rusage& usage, Process::Stats& stats)
+{
+	stats.userCpuSeconds = timevalToSeconds(usage.ru_utime);
+	stats.systemCpuSeconds = timevalToSeconds(usage.ru_stime);
+#ifdef __APPLE__
+	stats.maxRssBytes = (uint64_t)usage.ru_maxrss; // bytes on macOS
+#else
+	stats.maxRssBytes = (uint64_t)usage.ru_maxrss * 1024; // kilobytes on Linux
+#endif
+	stats.voluntaryContextSwitches = (uint64_t)usage.ru_nvcsw;
+	stats.involuntaryContextSwitches = (uint64_t)usage.ru_nivcsw;
+	stats.blockInputOps = (uint64_t)usage.ru_inblock;
+	stats.blockOutputOps = (uint64_t)usage.ru_oublock;
+}
+
+static unsigned int launchProcess(const char* argv[], Process::Stats& stats)
 {
 	char commandLine[2048];
 	if (!argsToCommandLine(argv, commandLine, sizeof(commandLine)))
@@ -460,7 +531,11 @@ static unsigned int launchProcess(const char* argv[])
 		return EXIT_FAILURE;
 	}
 
+	// Otherwise the child inherits, and flushes, any unwritten parent stdio buffers, duplicating parent output
+	fflush(NULL);
+
 	// fork() creates a clone of the parent’s memory state and file descriptors.
+	const std::chrono::steady_clock::time_point spawnTime = std::chrono::steady_clock::now();
 	pid_t pid = fork();
 	if (pid == -1)
 	{
@@ -503,7 +578,7 @@ static unsigned int launchProcess(const char* argv[])
 		// - Final argument must be NULL pointer to char
 
 		HP_ASSERT(argv[0] && argv[0][0]);
-		LOG_TRACE("Child: execv\n");
+		LOG_CHANNEL_TRACE(Process, "Child: execv\n");
 		fflush(NULL);
 		execv(argv[0], (char *const*)argv); // n.b. need execv*p* for system util ls	
 
@@ -514,7 +589,7 @@ static unsigned int launchProcess(const char* argv[])
 	}
 
 	// Parent process
-	LOG_TRACE("Child process ID: %i\n", pid);
+	LOG_CHANNEL_TRACE(Process, "Child process ID: %i\n", pid);
 
 	// The parent process does not need to write to the pipe, so that file descriptor can be closed
 	close(pipeFileDescs[WRITE_END]);
@@ -524,45 +599,71 @@ static unsigned int launchProcess(const char* argv[])
 	// so need to drain pipe. then wait for the child process to exit.
 	// #TODO: Run asynchronously so GUI remains responsive and Output Window shows progress.
 
-	LOG_TRACE("Capturing child process redirected stdout and stderr\n");
+	// Read directly into the log sink (the Output window) if there is one, to avoid copying
+	LOG_CHANNEL_TRACE(Process, "Capturing child process redirected stdout and stderr\n");
 	ssize_t totalBytesRead = 0;
 	for (;;)
 	{
-		ssize_t bytesRead = read(pipeFileDescs[READ_END], s_childOutputBuffer, sizeof(s_childOutputBuffer) - 1);
-//		LOG_TRACE("Read %u bytes from child process\n", (unsigned int)bytesRead); // disabled; creates too much spam
+		size_t bufferSizeBytes = 0;
+		char* pBuffer = LogReserve(bufferSizeBytes);
+		const bool reserved = pBuffer != nullptr;
+		if (!reserved)
+		{
+			pBuffer = s_childOutputBuffer;
+			bufferSizeBytes = sizeof(s_childOutputBuffer);
+		}
+
+		ssize_t bytesRead = read(pipeFileDescs[READ_END], pBuffer, bufferSizeBytes);
+//		LOG_CHANNEL_TRACE(Process, "Read %u bytes from child process\n", (unsigned int)bytesRead); // disabled; creates too much spam
 		if (bytesRead == 0) // EOF?
 			break;
 
-		HP_ASSERT((unsigned int)bytesRead < sizeof(s_childOutputBuffer));
-		s_childOutputBuffer[bytesRead] = '\0';
+		if (bytesRead == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			LOG_ERROR("Failed to read child process output: %s\n", strerror(errno));
+			break;
+		}
+
+		// Forward before committing, because committing may modify the text in place
+		forwardChildOutput(pBuffer, (size_t)bytesRead);
 
-		LogMsg(stderr, s_childOutputBuffer);
-		s_childOutputBuffer[0] = '\0';
+		if (reserved)
+			LogCommit(stderr, pBuffer, (size_t)bytesRead);
+		else
+			LogWrite(stderr, pBuffer, (size_t)bytesRead);
 
 		totalBytesRead += bytesRead;
 	}
 
-	LOG_TRACE("Total bytes read from child process: %u\n", (unsigned int)totalBytesRead);
+	LOG_CHANNEL_TRACE(Process, "Total bytes read from child process: %u\n", (unsigned int)totalBytesRead);
 
 	// No further need to read from the pipe
 	close(pipeFileDescs[READ_END]);
 
+	// wait4() is waitpid() plus the resource usage of the child
 	int status;
+	struct rusage usage = {};
 	errno = 0;
 	pid_t wpid;
 	do
 	{
-		wpid = waitpid(pid, &status, 0);
+		wpid = wait4(pid, &status, 0, &usage);
 	} while (wpid == -1 && errno == EINTR); // Mac fix. See https://stackoverflow.com/a/10160656
 
-	LOG_TRACE("waitpid returned %d\n", wpid);
+	stats.wallSeconds = secondsSince(spawnTime);
+
+	LOG_CHANNEL_TRACE(Process, "wait4 returned %d\n", wpid);
 	if (wpid == -1)
 	{
-		LOG_ERROR("waitpid failed: %s\n", strerror(errno));
+		LOG_ERROR("wait4 failed: %s\n", strerror(errno));
 		return EXIT_FAILURE;
 	}
 
-	LOG_TRACE("Child exited with status %i\n", status);
+	collectChildStats(usage, stats);
+
+	LOG_CHANNEL_TRACE(Process, "Child exited with status %i\n", status);
 	printChildExitReason(pid, status);
 
 	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
@@ -573,7 +674,19 @@ static unsigned int launchProcess(const char* argv[])
 
 #endif
 
-unsigned int Process::Launch(const char* argv[])
+unsigned int Process::Launch(const char* argv[], OutputCallback pOutputCallback /*= nullptr*/, void* pUserData /*= nullptr*/)
 {
-	return launchProcess(argv);
+	s_pOutputCallback = pOutputCallback;
+	s_pOutputCallbackUserData = pUserData;
+
+	Process::Stats stats;
+	unsigned int exitCode = launchProcess(argv, stats);
+	stats.exitCode = exitCode;
+
+	s_pOutputCallback = nullptr;
+	s_pOutputCallbackUserData = nullptr;
+
+	ProcessStats::Record(argv, stats);
+
+	return exitCode;
 }
@@ -2,12 +2,35 @@
 
 #include "Core/Helpers.h"
 
+#include <stdint.h>
+
 class Process
 {
 public:
 	NON_INSTANTIABLE_STATIC_CLASS(Process);
 
+	// Receives each chunk of child process stdout/stderr output as it is read, before it is logged.
+	// Must not log; the chunk may be in space reserved in the log sink (see LogReserve).
+	// n.b. text is not null-terminated
+	typedef void (*OutputCallback)(const char* text, size_t len, void* pUserData);
+
+	// Resource usage of a child process, collected when it exits
+	// Fields that are not available on the current platform are left at zero
+	struct Stats
+	{
+		unsigned int exitCode = 0;
+		double wallSeconds = 0.0;      // from spawn to exit
+		double userCpuSeconds = 0.0;
+		double systemCpuSeconds = 0.0;
+		uint64_t maxRssBytes = 0;      // peak resident set size (peak working set on Windows)
+		uint64_t voluntaryContextSwitches = 0;
+		uint64_t involuntaryContextSwitches = 0;
+		uint64_t blockInputOps = 0;    // I/O read operations on Windows
+		uint64_t blockOutputOps = 0;   // I/O write operations on Windows
+	};
+
 	// argv[] must be null terminated
 	// returns return code e.g. EXIT_SUCCESS
-	static unsigned int Launch(const char* argv[]);
+	// The resource usage of the child is recorded with ProcessStats
+	static unsigned int Launch(const char* argv[], OutputCallback pOutputCallback = nullptr, void* pUserData = nullptr);
 };
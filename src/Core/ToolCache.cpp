@@ -0,0 +1,522 @@
+#include "ToolCache.h"
+
+#include "Core/ProcessWrap.h"
+#include "Core/FileSystem.h"
+#include "Core/StringHelpers.h"
+#include "Core/Log.h"
+#include "Core/hp_assert.h"
+
+#include "Utils/Sha256.h"
+
+#include <stdio.h>
+#include <stdlib.h> // EXIT_SUCCESS, strtoul
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Bump if the key derivation or entry layout changes, so stale entries are never hit
+static const char kKeyVersion[] = "hoffgui-toolcache-1";
+
+static const char kDirectoryName[] = "toolcache";
+static const char kLogFilename[] = "log";
+static const char kMetaFilename[] = "meta";
+static const char kTempSuffix[] = ".tmp";
+
+static const unsigned int kKeyHexSize = Sha256::kHexStringSize;
+
+struct Entry
+{
+	char key[kKeyHexSize] = {};
+	uint64_t sizeBytes = 0;
+	std::filesystem::file_time_type lastAccess;
+};
+
+// Tool binaries are usually large and rarely change, so only re-hash when the size or modification time changes
+struct ToolDigest
+{
+	std::string path;
+	uintmax_t sizeBytes = 0;
+	std::filesystem::file_time_type lastWriteTime;
+	Sha256::Digest digest;
+};
+
+static ToolCache::Options* s_pOptions;
+static ToolCache::Stats s_stats;
+static char s_directory[kMaxPath];
+static std::vector<Entry> s_entries;
+static std::vector<ToolDigest> s_toolDigests;
+
+//------------------------------------------------------------------------------------------------
+
+static bool isKey(const char* name)
+{
+	if (strlen(name) != kKeyHexSize - 1)
+		return false;
+
+	for (const char* p = name; *p; p++)
+	{
+		if (!IsLowercaseHexDigit(*p))
+			return false;
+	}
+
+	return true;
+}
+
+static void makeEntryPath(char* path, size_t bufferSize, const char* key, const char* filename = nullptr)
+{
+	if (filename)
+		SafeSnprintf(path, bufferSize, "%s%s/%s", s_directory, key, filename);
+	else
+		SafeSnprintf(path, bufferSize, "%s%s", s_directory, key);
+}
+
+static void makeOutputFilename(char* filename, size_t bufferSize, unsigned int outputIndex)
+{
+	SafeSnprintf(filename, bufferSize, "out%u", outputIndex);
+}
+
+static unsigned int countPaths(const char* paths[])
+{
+	unsigned int count = 0;
+	if (paths)
+	{
+		while (paths[count] != nullptr)
+			count++;
+	}
+	return count;
+}
+
+static uint64_t calcDirectorySize(const std::filesystem::path& directory)
+{
+	uint64_t sizeBytes = 0;
+	std::error_code ec;
+	for (const std::filesystem::directory_entry& dirEntry : std::filesystem::directory_iterator(directory, ec))
+	{
+		if (dirEntry.is_regular_file(ec))
+			sizeBytes += dirEntry.file_size(ec);
+	}
+	return sizeBytes;
+}
+
+static void updateStats()
+{
+	s_stats.entryCount = (unsigned int)s_entries.size();
+	s_stats.sizeBytes = 0;
+	for (const Entry& entry : s_entries)
+		s_stats.sizeBytes += entry.sizeBytes;
+}
+
+static Entry* findEntry(const char* key)
+{
+	for (Entry& entry : s_entries)
+	{
+		if (strcmp(entry.key, key) == 0)
+			return &entry;
+	}
+	return nullptr;
+}
+
+static void removeEntry(size_t entryIndex)
+{
+	HP_ASSERT(entryIndex < s_entries.size());
+
+	char path[kMaxPath];
+	makeEntryPath(path, sizeof(path), s_entries[entryIndex].key);
+
+	std::error_code ec;
+	std::filesystem::remove_all(path, ec);
+	if (ec)
+		LOG_ERROR("Failed to remove tool cache entry %s: %s\n", path, ec.message().c_str());
+
+	s_entries.erase(s_entries.begin() + entryIndex);
+}
+
+static void evictIfRequired()
+{
+	HP_ASSERT(s_pOptions != nullptr);
+	const uint64_t maxSizeBytes = (uint64_t)s_pOptions->maxSizeMB * 1024 * 1024;
+
+	updateStats();
+	while (s_stats.sizeBytes > maxSizeBytes && !s_entries.empty())
+	{
+		size_t lruIndex = 0;
+		for (size_t entryIndex = 1; entryIndex < s_entries.size(); entryIndex++)
+		{
+			if (s_entries[entryIndex].lastAccess < s_entries[lruIndex].lastAccess)
+				lruIndex = entryIndex;
+		}
+
+		LOG_CHANNEL_DEBUG(Process, "Tool cache evicting entry %s\n", s_entries[lruIndex].key);
+		removeEntry(lruIndex);
+		s_stats.evictions++;
+		updateStats();
+	}
+}
+
+static void scanDirectory()
+{
+	s_entries.clear();
+
+	std::error_code ec;
+	for (const std::filesystem::directory_entry& dirEntry : std::filesystem::directory_iterator(s_directory, ec))
+	{
+		if (!dirEntry.is_directory(ec))
+			continue;
+
+		const std::string name = dirEntry.path().filename().string();
+		if (!isKey(name.c_str()))
+		{
+			// Most likely an incomplete .tmp entry left behind by a crash
+			LOG_CHANNEL_DEBUG(Process, "Removing stray tool cache directory: %s\n", name.c_str());
+			std::filesystem::remove_all(dirEntry.path(), ec);
+			continue;
+		}
+
+		Entry entry;
+		SafeStrcpy(entry.key, sizeof(entry.key), name.c_str());
+		entry.sizeBytes = calcDirectorySize(dirEntry.path());
+		entry.lastAccess = std::filesystem::last_write_time(dirEntry.path() / kMetaFilename, ec);
+		if (ec)
+		{
+			// Entries without a meta file are incomplete
+			std::filesystem::remove_all(dirEntry.path(), ec);
+			continue;
+		}
+		s_entries.push_back(entry);
+	}
+}
+
+//------------------------------------------------------------------------------------------------
+// Key derivation
+
+static void hashUint32(Sha256& sha, uint32_t val)
+{
+	// little endian for consistency across platforms
+	const uint8_t bytes[4] = { (uint8_t)val, (uint8_t)(val >> 8), (uint8_t)(val >> 16), (uint8_t)(val >> 24) };
+	sha.Update(bytes, sizeof(bytes));
+}
+
+static void hashString(Sha256& sha, const char* str)
+{
+	const size_t len = strlen(str);
+	hashUint32(sha, (uint32_t)len); // length prefix so { "ab", "c" } and { "a", "bc" } produce different keys
+	sha.Update(str, len);
+}
+
+static bool getToolDigest(const char* path, Sha256::Digest& digest)
+{
+	std::error_code ec;
+	const uintmax_t sizeBytes = std::filesystem::file_size(path, ec);
+	if (ec)
+		return false;
+	const std::filesystem::file_time_type lastWriteTime = std::filesystem::last_write_time(path, ec);
+	if (ec)
+		return false;
+
+	for (const ToolDigest& toolDigest : s_toolDigests)
+	{
+		if (toolDigest.path == path && toolDigest.sizeBytes == sizeBytes && toolDigest.lastWriteTime == lastWriteTime)
+		{
+			digest = toolDigest.digest;
+			return true;
+		}
+	}
+
+	if (!Sha256::HashFile(path, digest))
+		return false;
+
+	for (ToolDigest& toolDigest : s_toolDigests)
+	{
+		if (toolDigest.path == path)
+		{
+			toolDigest.sizeBytes = sizeBytes;
+			toolDigest.lastWriteTime = lastWriteTime;
+			toolDigest.digest = digest;
+			return true;
+		}
+	}
+
+	ToolDigest toolDigest;
+	toolDigest.path = path;
+	toolDigest.sizeBytes = sizeBytes;
+	toolDigest.lastWriteTime = lastWriteTime;
+	toolDigest.digest = digest;
+	s_toolDigests.push_back(toolDigest);
+	return true;
+}
+
+static bool computeKey(const char* argv[], const char* inputPaths[], char* key, size_t keySize)
+{
+	HP_ASSERT(argv && argv[0]);
+
+	Sha256 sha;
+	hashString(sha, kKeyVersion);
+
+	Sha256::Digest digest;
+	if (!getToolDigest(argv[0], digest))
+	{
+		LOG_WARN("Tool cache failed to hash tool binary: %s\n", argv[0]);
+		return false;
+	}
+	sha.Update(digest.bytes, sizeof(digest.bytes));
+
+	const unsigned int argCount = countPaths(argv);
+	hashUint32(sha, argCount);
+	for (unsigned int argIndex = 0; argIndex < argCount; argIndex++)
+		hashString(sha, argv[argIndex]);
+
+	const unsigned int inputCount = countPaths(inputPaths);
+	hashUint32(sha, inputCount);
+	for (unsigned int inputIndex = 0; inputIndex < inputCount; inputIndex++)
+	{
+		if (!Sha256::HashFile(inputPaths[inputIndex], digest))
+		{
+			LOG_WARN("Tool cache failed to hash input file: %s\n", inputPaths[inputIndex]);
+			return false;
+		}
+		sha.Update(digest.bytes, sizeof(digest.bytes));
+	}
+
+	Sha256::ToHexString(sha.Finish(), key, keySize);
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+// Entry read/write
+
+static bool readTextFile(const char* path, std::string& text)
+{
+	FILE* pFile = fopen(path, "rb");
+	if (!pFile)
+		return false;
+
+	char buffer[16 * 1024];
+	for (;;)
+	{
+		const size_t bytesRead = fread(buffer, 1, sizeof(buffer), pFile);
+		if (bytesRead == 0)
+			break;
+		text.append(buffer, bytesRead);
+	}
+
+	const bool error = ferror(pFile) != 0;
+	fclose(pFile);
+	return !error;
+}
+
+static bool writeFile(const char* path, const void* pData, size_t sizeBytes)
+{
+	FILE* pFile = fopen(path, "wb");
+	if (!pFile)
+	{
+		LOG_ERROR("Failed to open file for write: %s\n", path);
+		return false;
+	}
+
+	const size_t bytesWritten = fwrite(pData, 1, sizeBytes, pFile);
+	fclose(pFile);
+	return bytesWritten == sizeBytes;
+}
+
+static bool restoreEntry(const char* key, const char* outputPaths[])
+{
+	Entry* pEntry = findEntry(key);
+	if (!pEntry)
+		return false;
+
+	char path[kMaxPath];
+	makeEntryPath(path, sizeof(path), key, kMetaFilename);
+	std::string meta;
+	if (!readTextFile(path, meta))
+		return false;
+
+	const unsigned int outputCount = countPaths(outputPaths);
+	if (strtoul(meta.c_str(), nullptr, 10) != outputCount)
+	{
+		LOG_WARN("Tool cache entry %s has unexpected output count\n", key);
+		return false;
+	}
+
+	for (unsigned int outputIndex = 0; outputIndex < outputCount; outputIndex++)
+	{
+		char filename[32];
+		makeOutputFilename(filename, sizeof(filename), outputIndex);
+		makeEntryPath(path, sizeof(path), key, filename);
+		if (!FileSystem::Copy(path, outputPaths[outputIndex]))
+			return false;
+	}
+
+	// Replay the captured tool output so a hit looks the same as a miss in the Output window
+	makeEntryPath(path, sizeof(path), key, kLogFilename);
+	std::string log;
+	if (readTextFile(path, log) && !log.empty())
+		LogWrite(stderr, log.data(), log.size());
+
+	// Touch the meta file to record the access time for LRU eviction
+	makeEntryPath(path, sizeof(path), key, kMetaFilename);
+	std::error_code ec;
+	const std::filesystem::file_time_type now = std::filesystem::file_time_type::clock::now();
+	std::filesystem::last_write_time(path, now, ec);
+	pEntry->lastAccess = now;
+
+	return true;
+}
+
+static void storeEntry(const char* key, const std::string& log, const char* outputPaths[])
+{
+	char tempPath[kMaxPath];
+	SafeSnprintf(tempPath, sizeof(tempPath), "%s%s%s", s_directory, key, kTempSuffix);
+
+	std::error_code ec;
+	std::filesystem::remove_all(tempPath, ec);
+	if (!FileSystem::MakeDir(tempPath))
+		return;
+
+	// Write everything into a temporary directory then rename, so a partially written entry is never hit
+	bool ok = true;
+	char path[kMaxPath];
+	const unsigned int outputCount = countPaths(outputPaths);
+	for (unsigned int outputIndex = 0; ok && outputIndex < outputCount; outputIndex++)
+	{
+		char filename[32];
+		makeOutputFilename(filename, sizeof(filename), outputIndex);
+		FileSystem::MakePath(path, sizeof(path), tempPath, filename);
+		ok = FileSystem::Exists(outputPaths[outputIndex]) && FileSystem::Copy(outputPaths[outputIndex], path);
+	}
+
+	if (ok)
+	{
+		FileSystem::MakePath(path, sizeof(path), tempPath, kLogFilename);
+		ok = writeFile(path, log.data(), log.size());
+	}
+
+	if (ok)
+	{
+		char meta[32];
+		SafeSnprintf(meta, sizeof(meta), "%u\n", outputCount);
+		FileSystem::MakePath(path, sizeof(path), tempPath, kMetaFilename);
+		ok = writeFile(path, meta, strlen(meta));
+	}
+
+	char entryPath[kMaxPath];
+	makeEntryPath(entryPath, sizeof(entryPath), key);
+	if (ok)
+	{
+		std::filesystem::remove_all(entryPath, ec);
+		std::filesystem::rename(tempPath, entryPath, ec);
+		ok = !ec;
+	}
+
+	if (!ok)
+	{
+		LOG_WARN("Failed to store tool cache entry %s\n", key);
+		std::filesystem::remove_all(tempPath, ec);
+		return;
+	}
+
+	Entry* pEntry = findEntry(key);
+	if (!pEntry)
+	{
+		s_entries.emplace_back();
+		pEntry = &s_entries.back();
+		SafeStrcpy(pEntry->key, sizeof(pEntry->key), key);
+	}
+	pEntry->sizeBytes = calcDirectorySize(entryPath);
+	pEntry->lastAccess = std::filesystem::file_time_type::clock::now();
+
+	evictIfRequired();
+}
+
+static void captureOutput(const char* text, size_t len, void* pUserData)
+{
+	HP_ASSERT(pUserData != nullptr);
+	std::string& log = *(std::string*)pUserData;
+	log.append(text, len);
+}
+
+//------------------------------------------------------------------------------------------------
+
+void ToolCache::Init(Options* pOptions)
+{
+	HP_ASSERT(pOptions != nullptr);
+	s_pOptions = pOptions;
+
+	FileSystem::MakePath(s_directory, sizeof(s_directory), FileSystem::GetUserPrefDirectory(), kDirectoryName);
+	if (!FileSystem::Exists(s_directory) && !FileSystem::MakeDir(s_directory))
+	{
+		LOG_ERROR("Failed to create tool cache directory: %s\n", s_directory);
+		s_directory[0] = '\0';
+		return;
+	}
+	SafeStrcat(s_directory, sizeof(s_directory), "/");
+
+	scanDirectory();
+	evictIfRequired();
+
+	LOG_CHANNEL_TRACE(Process, "Tool cache: %u entries, %llu bytes in %s\n", s_stats.entryCount, (unsigned long long)s_stats.sizeBytes, s_directory);
+}
+
+void ToolCache::Shutdown()
+{
+	s_entries.clear();
+	s_toolDigests.clear();
+	s_pOptions = nullptr;
+}
+
+unsigned int ToolCache::Launch(const char* argv[], const char* inputPaths[], const char* outputPaths[])
+{
+	HP_ASSERT(argv && argv[0]);
+
+	const bool enabled = s_pOptions && s_pOptions->enabled && s_directory[0] != '\0';
+	char key[kKeyHexSize];
+	if (!enabled || !computeKey(argv, inputPaths, key, sizeof(key)))
+		return Process::Launch(argv);
+
+	if (restoreEntry(key, outputPaths))
+	{
+		s_stats.hits++;
+		LOG_INFO("Tool cache hit: %.16s (%s)\n", key, argv[0]);
+		return EXIT_SUCCESS;
+	}
+
+	s_stats.misses++;
+	LOG_CHANNEL_DEBUG(Process, "Tool cache miss: %.16s (%s)\n", key, argv[0]);
+
+	std::string log;
+	const unsigned int exitCode = Process::Launch(argv, captureOutput, &log);
+	if (exitCode == EXIT_SUCCESS)
+		storeEntry(key, log, outputPaths);
+
+	return exitCode;
+}
+
+void ToolCache::Clear()
+{
+	while (!s_entries.empty())
+		removeEntry(s_entries.size() - 1);
+	updateStats();
+}
+
+void ToolCache::Trim()
+{
+	if (s_pOptions)
+		evictIfRequired();
+}
+
+const ToolCache::Stats& ToolCache::GetStats()
+{
+	return s_stats;
+}
+
+void ToolCache::ResetHitMissCounters()
+{
+	s_stats.hits = 0;
+	s_stats.misses = 0;
+	s_stats.evictions = 0;
+}
+
+const char* ToolCache::GetDirectory()
+{
+	return s_directory;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Core/Helpers.h"
+
+#include <stdint.h>
+
+//
+// Content-addressed cache of external tool results.
+//
+// Each entry is keyed by a SHA-256 of the tool binary, the argv vector and the bytes of every input file.
+// An entry stores the tool's output files and captured stdout/stderr. On a hit the outputs are copied
+// into place and the log is replayed, so the tool is not launched at all.
+//
+// Entries live in <user pref dir>/toolcache/<key>/ and are evicted least recently used first when the
+// total size exceeds the configured limit.
+//
+class ToolCache
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(ToolCache);
+
+	struct Options
+	{
+		bool enabled = true;
+		unsigned int maxSizeMB = 256;
+	};
+
+	struct Stats
+	{
+		unsigned int hits = 0;
+		unsigned int misses = 0;
+		unsigned int evictions = 0;
+		unsigned int entryCount = 0;
+		uint64_t sizeBytes = 0;
+	};
+
+	// Must be called after FileSystem::Init
+	static void Init(Options* pOptions);
+	static void Shutdown();
+
+	// Drop-in replacement for Process::Launch, for tools whose outputs depend only on their inputs
+	// #TODO: Launch external tools (e.g. converters) through this once hoffgui runs any. The only launches so far
+	// are benchmarks, which must not be cached.
+	// argv[], inputPaths[] and outputPaths[] must be null terminated. inputPaths and outputPaths may be nullptr.
+	// Only successful (EXIT_SUCCESS) results are cached.
+	static unsigned int Launch(const char* argv[], const char* inputPaths[], const char* outputPaths[]);
+
+	// Deletes all entries from disk
+	static void Clear();
+
+	// Evicts least recently used entries until the cache is within the size limit e.g. after the limit is reduced
+	static void Trim();
+
+	static const Stats& GetStats();
+	static void ResetHitMissCounters();
+
+	// Always has a trailing slash
+	static const char* GetDirectory();
+};
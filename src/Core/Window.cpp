@@ -20,7 +20,7 @@ bool Window::Create(const char* title, int x, int y, unsigned int w, unsigned in
 	HP_ASSERT(w > 0);
 	HP_ASSERT(h > 0);
 
-	LOG_TRACE("CreateWindow x=%d y=%d, w=%u h=%u maximised=%u fullscreen=%u\n", x, y, w, h, maximised ? 1 : 0, fullscreen ? 1 : 0);
+	LOG_CHANNEL_TRACE(UI, "CreateWindow x=%d y=%d, w=%u h=%u maximised=%u fullscreen=%u\n", x, y, w, h, maximised ? 1 : 0, fullscreen ? 1 : 0);
 
 	Uint32 windowFlags = (SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
 
@@ -50,7 +50,7 @@ bool Window::Create(const char* title, int x, int y, unsigned int w, unsigned in
 	s_initialHeight = h;
 
 	SDL_GetWindowSize(s_pWindow, (int*)&w, (int*)&h);
-	LOG_TRACE("SDL_GetWindowSize w=%d h=%d\n", w, h);
+	LOG_CHANNEL_TRACE(UI, "SDL_GetWindowSize w=%d h=%d\n", w, h);
 
 	SafeStrcpy(s_title, sizeof(s_title), title);
 
@@ -91,7 +91,7 @@ void Window::GetPosition(int& x, int& y)
 void Window::SetPosition(int x, int y)
 {
 	HP_ASSERT(s_pWindow != nullptr);
-	LOG_TRACE("SDL_SetWindowPosition x=%u y=%u\n", x, y);
+	LOG_CHANNEL_TRACE(UI, "SDL_SetWindowPosition x=%u y=%u\n", x, y);
 	SDL_SetWindowPosition(s_pWindow, x, y);
 }
 
@@ -106,7 +106,7 @@ void Window::SetSize(unsigned int w, unsigned int h)
 	HP_ASSERT(s_pWindow != nullptr);
 	HP_ASSERT(w > 0);
 	HP_ASSERT(h > 0);
-	LOG_TRACE("SDL_SetWindowSize w=%u h=%u\n", w, h);
+	LOG_CHANNEL_TRACE(UI, "SDL_SetWindowSize w=%u h=%u\n", w, h);
 	SDL_SetWindowSize(s_pWindow, (int)w, (int)h);
 }
 
@@ -147,7 +147,7 @@ bool Window::IsFullscreen()
 void Window::SetFullscreen(bool fullscreen)
 {
 	HP_ASSERT(s_pWindow != nullptr);
-	LOG_TRACE("SetFullscreen fullscreen=%u\n", fullscreen ? 1 : 0);
+	LOG_CHANNEL_TRACE(UI, "SetFullscreen fullscreen=%u\n", fullscreen ? 1 : 0);
 	if (SDL_SetWindowFullscreen(s_pWindow, fullscreen ? SDL_WINDOW_FULLSCREEN_DESKTOP : 0) != 0)
 	{
 		LOG_ERROR("SDL_SetWindowFullscreen failed: %s\n", SDL_GetError());
@@ -159,7 +159,7 @@ void Window::SetFullscreen(bool fullscreen)
 	{
 		int w, h;
 		SDL_GetWindowSize(s_pWindow, (int*)&w, (int*)&h);
-		LOG_TRACE("SDL_GetWindowSize w=%d h=%d\n", w, h);
+		LOG_CHANNEL_TRACE(UI, "SDL_GetWindowSize w=%d h=%d\n", w, h);
 		if (w == 1 && h == 1)
 		{
 			// Restore default window size and position
@@ -0,0 +1,697 @@
+#include "WorkerPool.h"
+
+#include "Core/WorkerProtocol.h"
+#include "Core/Log.h"
+#include "Core/StringHelpers.h"
+#include "Core/hp_assert.h"
+
+#include <stdlib.h> // EXIT_FAILURE
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+
+#ifdef _MSC_VER
+static const char* kStandInWorkerFilename = "hoffgui_standin_worker.exe";
+#else
+static const char* kStandInWorkerFilename = "hoffgui_standin_worker";
+#endif
+
+static const char kWorkerModeArg[] = "--worker";
+
+struct Job
+{
+	unsigned int id = 0;
+	std::vector<uint8_t> request; // complete frame
+	WorkerPool::CompletionCallback pCallback = nullptr;
+	void* pUserData = nullptr;
+};
+
+static WorkerPool::Options* s_pOptions;
+static std::string s_standInWorkerDirectory;
+static bool s_running;
+static bool s_stopping; // Submit is rejected while Stop waits for in-flight jobs
+static std::deque<Job> s_queuedJobs;
+static unsigned int s_nextJobId = 1;
+static WorkerPool::Stats s_stats;
+
+static void completeJob(Job& job, unsigned int exitCode, const char* output, size_t outputSizeBytes)
+{
+	s_stats.jobsCompleted++;
+	if (exitCode != EXIT_SUCCESS)
+		s_stats.jobsFailed++;
+
+	if (job.pCallback)
+		job.pCallback(job.id, exitCode, output, outputSizeBytes, job.pUserData);
+}
+
+static void failJob(Job& job, const char* reason)
+{
+	LOG_ERROR("Worker job %u failed: %s\n", job.id, reason);
+	completeJob(job, EXIT_FAILURE, reason, strlen(reason));
+}
+
+static void failQueuedJobs(const char* reason)
+{
+	while (!s_queuedJobs.empty())
+	{
+		Job job = std::move(s_queuedJobs.front());
+		s_queuedJobs.pop_front();
+		failJob(job, reason);
+	}
+}
+
+#ifdef _MSC_VER
+
+//------------------------------------------------------------------------------------------------
+// #TODO: Windows implementation
+
+static unsigned int getLiveWorkerCount() { return 0; }
+static unsigned int getBusyWorkerCount() { return 0; }
+
+static bool startWorkers(const char* workerPath, unsigned int workerCount, const char* const workerArgs[])
+{
+	HP_UNUSED(workerPath);
+	HP_UNUSED(workerCount);
+	HP_UNUSED(workerArgs);
+	LOG_WARN("Worker pool is not yet supported on Windows\n");
+	return false;
+}
+
+static void stopWorkers()
+{
+}
+
+static void pumpWorkers(int timeoutMs)
+{
+	HP_UNUSED(timeoutMs);
+}
+
+#else
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h> // strerror
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <thread>
+
+#define READ_END 0
+#define WRITE_END 1
+
+struct Worker
+{
+	pid_t pid = -1;
+	int requestFd = -1;  // write end of pipe connected to worker stdin
+	int responseFd = -1; // read end of pipe connected to worker stdout, non-blocking
+	std::vector<uint8_t> responseBuffer;
+	bool busy = false;
+	bool hasCompletedJob = false;
+	unsigned int earlyDeathCount = 0; // consecutive deaths before completing a job, which back off the respawn
+	bool respawnPending = false;
+	std::chrono::steady_clock::time_point respawnTime;
+	Job job;
+};
+
+// A worker that keeps dying, e.g. because every job given to it crashes the tool, is respawned after a delay that
+// doubles with each death, and the pool respawns at most kMaxRespawnsPerWorker times per worker in kRespawnWindow.
+// Past that limit dead workers wait for the window to pass rather than being given up on.
+static const unsigned int kMaxRespawnsPerWorker = 4;
+static const std::chrono::seconds kRespawnWindow(60);
+static const std::chrono::milliseconds kMinRespawnDelay(100);
+static const std::chrono::milliseconds kMaxRespawnDelay(5000);
+
+static std::vector<Worker> s_workers;
+static std::string s_workerPath;
+static std::vector<std::string> s_workerArgs;
+static std::deque<std::chrono::steady_clock::time_point> s_respawnTimes; // within kRespawnWindow
+
+static uint8_t s_readBuffer[64 * 1024];
+
+static bool isAlive(const Worker& worker)
+{
+	return worker.pid != -1;
+}
+
+static unsigned int getLiveWorkerCount()
+{
+	unsigned int count = 0;
+	for (const Worker& worker : s_workers)
+		count += isAlive(worker) ? 1 : 0;
+	return count;
+}
+
+static unsigned int getBusyWorkerCount()
+{
+	unsigned int count = 0;
+	for (const Worker& worker : s_workers)
+		count += worker.busy ? 1 : 0;
+	return count;
+}
+
+static void setCloseOnExec(int fd)
+{
+	fcntl(fd, F_SETFD, fcntl(fd, F_GETFD) | FD_CLOEXEC);
+}
+
+static bool spawnWorker(Worker& worker)
+{
+	HP_ASSERT(!isAlive(worker));
+
+	int requestPipe[2];
+	int responsePipe[2];
+	if (pipe(requestPipe) == -1)
+	{
+		LOG_ERROR("Worker pool pipe() failed: %s\n", strerror(errno));
+		return false;
+	}
+	if (pipe(responsePipe) == -1)
+	{
+		LOG_ERROR("Worker pool pipe() failed: %s\n", strerror(errno));
+		close(requestPipe[READ_END]);
+		close(requestPipe[WRITE_END]);
+		return false;
+	}
+
+	// Parent ends must not leak into other workers or into processes started by Process::Launch
+	setCloseOnExec(requestPipe[WRITE_END]);
+	setCloseOnExec(responsePipe[READ_END]);
+
+	std::vector<const char*> argv;
+	argv.push_back(s_workerPath.c_str());
+	argv.push_back(kWorkerModeArg);
+	for (const std::string& arg : s_workerArgs)
+		argv.push_back(arg.c_str());
+	argv.push_back(nullptr);
+
+	fflush(NULL); // otherwise the child inherits and later flushes unwritten parent stdio buffers
+
+	const pid_t pid = fork();
+	if (pid == -1)
+	{
+		LOG_ERROR("Worker pool fork() failed: %s\n", strerror(errno));
+		close(requestPipe[READ_END]);
+		close(requestPipe[WRITE_END]);
+		close(responsePipe[READ_END]);
+		close(responsePipe[WRITE_END]);
+		return false;
+	}
+
+	if (pid == 0) // child
+	{
+		dup2(requestPipe[READ_END], STDIN_FILENO);
+		dup2(responsePipe[WRITE_END], STDOUT_FILENO);
+		close(requestPipe[READ_END]);
+		close(requestPipe[WRITE_END]);
+		close(responsePipe[READ_END]);
+		close(responsePipe[WRITE_END]);
+
+		// stderr is inherited, so worker diagnostics appear in the hoffgui console
+		execv(argv[0], (char* const*)argv.data());
+
+		// Only async-signal-safe calls after fork
+		const char kMessage[] = "Worker execv failed\n";
+		ssize_t result = write(STDERR_FILENO, kMessage, sizeof(kMessage) - 1);
+		HP_UNUSED(result);
+		_exit(127);
+	}
+
+	close(requestPipe[READ_END]);
+	close(responsePipe[WRITE_END]);
+	fcntl(responsePipe[READ_END], F_SETFL, fcntl(responsePipe[READ_END], F_GETFL) | O_NONBLOCK);
+
+	worker.pid = pid;
+	worker.requestFd = requestPipe[WRITE_END];
+	worker.responseFd = responsePipe[READ_END];
+	worker.responseBuffer.clear();
+	worker.busy = false;
+	worker.hasCompletedJob = false;
+	worker.respawnPending = false;
+
+	LOG_CHANNEL_TRACE(Process, "Worker process %d started\n", pid);
+	return true;
+}
+
+// Closing stdin tells the worker to exit
+static void closeWorker(Worker& worker)
+{
+	if (!isAlive(worker))
+		return;
+
+	close(worker.requestFd);
+	close(worker.responseFd);
+	worker.requestFd = -1;
+	worker.responseFd = -1;
+
+	int status = 0;
+	while (waitpid(worker.pid, &status, 0) == -1 && errno == EINTR)
+		;
+	LOG_CHANNEL_TRACE(Process, "Worker process %d exited with status %d\n", worker.pid, status);
+
+	worker.pid = -1;
+	worker.responseBuffer.clear();
+}
+
+static void scheduleRespawn(Worker& worker)
+{
+	std::chrono::milliseconds delay(0);
+	if (worker.hasCompletedJob)
+		worker.earlyDeathCount = 0;
+	else
+	{
+		worker.earlyDeathCount++;
+		delay = kMinRespawnDelay * (1 << Min(worker.earlyDeathCount - 1, 16u));
+		delay = Min(delay, kMaxRespawnDelay);
+	}
+
+	worker.respawnPending = true;
+	worker.respawnTime = std::chrono::steady_clock::now() + delay;
+}
+
+static bool hasRespawnsLeft(std::chrono::steady_clock::time_point now)
+{
+	while (!s_respawnTimes.empty() && now - s_respawnTimes.front() >= kRespawnWindow)
+		s_respawnTimes.pop_front();
+	return s_respawnTimes.size() < kMaxRespawnsPerWorker * s_workers.size();
+}
+
+static void respawnDueWorkers()
+{
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	for (Worker& worker : s_workers)
+	{
+		if (!worker.respawnPending || worker.respawnTime > now)
+			continue;
+		if (!hasRespawnsLeft(now))
+			return;
+
+		s_respawnTimes.push_back(now);
+		if (spawnWorker(worker))
+			s_stats.workerRespawns++;
+		else
+			scheduleRespawn(worker);
+	}
+}
+
+// Returns the milliseconds until the next respawn, or -1 if there is none to wait for because none is pending or
+// the respawn limit has been reached
+static int getRespawnTimeoutMs()
+{
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (!hasRespawnsLeft(now))
+		return -1;
+
+	int timeoutMs = -1;
+	for (const Worker& worker : s_workers)
+	{
+		if (!worker.respawnPending)
+			continue;
+		const int workerTimeoutMs = worker.respawnTime > now
+			? (int)std::chrono::ceil<std::chrono::milliseconds>(worker.respawnTime - now).count()
+			: 0;
+		timeoutMs = timeoutMs == -1 ? workerTimeoutMs : Min(timeoutMs, workerTimeoutMs);
+	}
+	return timeoutMs;
+}
+
+// Nothing would run queued jobs, so rather than letting WaitAll hang they are failed
+static void failQueuedJobsIfNoWorkers()
+{
+	if (s_queuedJobs.empty() || getLiveWorkerCount() > 0 || getRespawnTimeoutMs() != -1)
+		return;
+
+	LOG_ERROR("No worker processes running: %s\n", s_workerPath.c_str());
+	failQueuedJobs("no worker processes running");
+}
+
+static void handleWorkerDeath(Worker& worker, const char* reason)
+{
+	LOG_WARN("Worker process %d %s\n", worker.pid, reason);
+
+	closeWorker(worker);
+
+	if (worker.busy)
+	{
+		worker.busy = false;
+		failJob(worker.job, "worker process died");
+	}
+
+	scheduleRespawn(worker);
+	respawnDueWorkers();
+	failQueuedJobsIfNoWorkers();
+}
+
+static bool writeAll(int fd, const uint8_t* pData, size_t sizeBytes)
+{
+	while (sizeBytes > 0)
+	{
+		const ssize_t bytesWritten = write(fd, pData, sizeBytes);
+		if (bytesWritten == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			return false; // EPIPE if the worker has exited
+		}
+		pData += bytesWritten;
+		sizeBytes -= (size_t)bytesWritten;
+	}
+	return true;
+}
+
+static void dispatchQueuedJobs()
+{
+	for (Worker& worker : s_workers)
+	{
+		if (s_queuedJobs.empty())
+			return;
+
+		if (!isAlive(worker) || worker.busy)
+			continue;
+
+		worker.job = std::move(s_queuedJobs.front());
+		s_queuedJobs.pop_front();
+		worker.busy = true;
+
+		// Requests are small, so a blocking write will not stall for long
+		if (!writeAll(worker.requestFd, worker.job.request.data(), worker.job.request.size()))
+		{
+			// Requeue the job rather than failing it; it has not started
+			worker.busy = false;
+			s_queuedJobs.push_front(std::move(worker.job));
+			handleWorkerDeath(worker, "closed its request pipe");
+		}
+	}
+}
+
+// Returns false if the worker died or sent a corrupt response
+static bool readResponses(Worker& worker)
+{
+	// Responses sent before the worker exited are still delivered, so death is only handled once they are
+	bool died = false;
+	int readError = 0;
+	for (;;)
+	{
+		const ssize_t bytesRead = read(worker.responseFd, s_readBuffer, sizeof(s_readBuffer));
+		if (bytesRead == 0)
+		{
+			died = true;
+			break;
+		}
+		if (bytesRead == -1)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			died = true;
+			readError = errno;
+			break;
+		}
+		worker.responseBuffer.insert(worker.responseBuffer.end(), s_readBuffer, s_readBuffer + bytesRead);
+	}
+
+	size_t consumedBytes = 0;
+	for (;;)
+	{
+		bool corrupt = false;
+		const uint8_t* pFrame = worker.responseBuffer.data() + consumedBytes;
+		const size_t frameSizeBytes = WorkerProtocol::GetCompleteFrameSize(pFrame, worker.responseBuffer.size() - consumedBytes, corrupt);
+		uint32_t exitCode = 0;
+		const char* output = nullptr;
+		size_t outputSizeBytes = 0;
+		if (!corrupt && frameSizeBytes > 0)
+		{
+			corrupt = !worker.busy // unsolicited response
+				|| !WorkerProtocol::DecodeResponse(pFrame + WorkerProtocol::kFrameHeaderSizeBytes, frameSizeBytes - WorkerProtocol::kFrameHeaderSizeBytes,
+					exitCode, output, outputSizeBytes);
+		}
+		if (corrupt)
+		{
+			// The stream cannot be resynchronised, so restart the worker
+			kill(worker.pid, SIGKILL);
+			handleWorkerDeath(worker, "sent a corrupt response");
+			return false;
+		}
+		if (frameSizeBytes == 0)
+			break;
+
+		// Move the job out first; the callback may submit more jobs
+		Job job = std::move(worker.job);
+		worker.busy = false;
+		worker.hasCompletedJob = true;
+		completeJob(job, exitCode, output, outputSizeBytes);
+		consumedBytes += frameSizeBytes;
+	}
+
+	worker.responseBuffer.erase(worker.responseBuffer.begin(), worker.responseBuffer.begin() + consumedBytes);
+
+	if (died)
+	{
+		handleWorkerDeath(worker, readError != 0 ? strerror(readError) : "exited"); // fails its job if it died before responding
+		return false;
+	}
+	return true;
+}
+
+static void pumpWorkers(int timeoutMs)
+{
+	respawnDueWorkers();
+	dispatchQueuedJobs();
+
+	pollfd pollFds[WorkerPool::kMaxWorkerCount];
+	unsigned int workerIndices[WorkerPool::kMaxWorkerCount];
+	nfds_t pollFdCount = 0;
+	for (unsigned int workerIndex = 0; workerIndex < s_workers.size(); workerIndex++)
+	{
+		const Worker& worker = s_workers[workerIndex];
+		if (!isAlive(worker))
+			continue;
+		pollFds[pollFdCount].fd = worker.responseFd;
+		pollFds[pollFdCount].events = POLLIN;
+		pollFds[pollFdCount].revents = 0;
+		workerIndices[pollFdCount] = workerIndex;
+		pollFdCount++;
+	}
+
+	// Queued jobs waiting for a respawn wake the wait at the respawn time, rather than when a busy worker responds
+	int pollTimeoutMs = getBusyWorkerCount() > 0 ? timeoutMs : 0;
+	const int respawnTimeoutMs = s_queuedJobs.empty() || timeoutMs == 0 ? -1 : getRespawnTimeoutMs();
+	if (respawnTimeoutMs != -1)
+	{
+		const int waitMs = timeoutMs == -1 ? respawnTimeoutMs : Min(timeoutMs, respawnTimeoutMs);
+		if (pollTimeoutMs == 0 || pollTimeoutMs == -1 || pollTimeoutMs > waitMs)
+			pollTimeoutMs = waitMs;
+	}
+
+	if (pollFdCount == 0)
+	{
+		failQueuedJobsIfNoWorkers();
+		if (!s_queuedJobs.empty() && pollTimeoutMs > 0)
+			std::this_thread::sleep_for(std::chrono::milliseconds(pollTimeoutMs));
+		return;
+	}
+
+	// Idle workers are polled too, so that a worker that dies while idle is noticed and respawned
+	const int readyCount = poll(pollFds, pollFdCount, pollTimeoutMs);
+	if (readyCount <= 0)
+		return;
+
+	for (nfds_t pollFdIndex = 0; pollFdIndex < pollFdCount; pollFdIndex++)
+	{
+		if (pollFds[pollFdIndex].revents != 0)
+			readResponses(s_workers[workerIndices[pollFdIndex]]);
+	}
+
+	dispatchQueuedJobs();
+}
+
+static bool startWorkers(const char* workerPath, unsigned int workerCount, const char* const workerArgs[])
+{
+	// Writing to the pipe of a worker that has died must return EPIPE rather than terminate hoffgui
+	signal(SIGPIPE, SIG_IGN);
+
+	// Checked here because a failed execv is only reported by the worker exiting
+	if (access(workerPath, X_OK) == -1)
+	{
+		LOG_ERROR("Worker executable not found: %s (%s)\n", workerPath, strerror(errno));
+		return false;
+	}
+
+	s_workerPath = workerPath;
+	s_respawnTimes.clear();
+	s_workerArgs.clear();
+	for (unsigned int argIndex = 0; workerArgs && workerArgs[argIndex]; argIndex++)
+		s_workerArgs.push_back(workerArgs[argIndex]);
+
+	s_workers.resize(workerCount);
+	for (Worker& worker : s_workers)
+	{
+		if (!spawnWorker(worker))
+		{
+			for (Worker& startedWorker : s_workers)
+				closeWorker(startedWorker);
+			s_workers.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void stopWorkers()
+{
+	for (Worker& worker : s_workers)
+		closeWorker(worker);
+	s_workers.clear();
+}
+
+#endif
+
+//------------------------------------------------------------------------------------------------
+
+void WorkerPool::Init(Options* pOptions, const char* standInWorkerDirectory)
+{
+	HP_ASSERT(pOptions);
+	HP_ASSERT(standInWorkerDirectory);
+	s_pOptions = pOptions;
+	s_standInWorkerDirectory = standInWorkerDirectory;
+
+	if (pOptions->enabled)
+		Restart();
+}
+
+void WorkerPool::Shutdown()
+{
+	Stop();
+	s_pOptions = nullptr;
+}
+
+bool WorkerPool::Restart()
+{
+	HP_ASSERT(s_pOptions);
+
+	Stop();
+
+	if (!s_pOptions->enabled)
+		return true;
+
+	char standInWorkerPath[kMaxPath];
+	const char* workerPath = s_pOptions->workerPath;
+	if (!workerPath[0])
+	{
+		GetStandInWorkerPath(standInWorkerPath, sizeof(standInWorkerPath));
+		workerPath = standInWorkerPath;
+	}
+
+	return Start(workerPath, s_pOptions->workerCount);
+}
+
+bool WorkerPool::Start(const char* workerPath, unsigned int workerCount, const char* const workerArgs[])
+{
+	HP_ASSERT(workerPath && workerPath[0]);
+
+	if (s_running)
+		Stop();
+
+	workerCount = Clamp(workerCount, 1u, kMaxWorkerCount);
+
+	if (!startWorkers(workerPath, workerCount, workerArgs))
+	{
+		LOG_ERROR("Failed to start worker pool: %s\n", workerPath);
+		return false;
+	}
+
+	s_running = true;
+	LOG_INFO("Started %u worker processes: %s\n", workerCount, workerPath);
+	return true;
+}
+
+void WorkerPool::Stop()
+{
+	if (!s_running)
+		return;
+
+	// Let in-flight jobs finish so their callbacks are called, but don't start any more
+	s_stopping = true;
+	std::deque<Job> queuedJobs;
+	queuedJobs.swap(s_queuedJobs);
+	while (getBusyWorkerCount() > 0 && getLiveWorkerCount() > 0)
+		pumpWorkers(/*timeoutMs*/-1);
+	queuedJobs.swap(s_queuedJobs);
+	failQueuedJobs("worker pool stopped");
+
+	stopWorkers();
+	s_running = false;
+	s_stopping = false;
+	LOG_INFO("Stopped worker pool\n");
+}
+
+bool WorkerPool::IsRunning()
+{
+	return s_running;
+}
+
+unsigned int WorkerPool::Submit(const char* argv[], CompletionCallback pCallback, void* pUserData)
+{
+	HP_ASSERT(argv && argv[0]);
+
+	if (!s_running || s_stopping)
+		return 0;
+
+	Job job;
+	job.id = s_nextJobId++;
+	if (s_nextJobId == 0)
+		s_nextJobId = 1; // 0 is reserved for failure
+	job.pCallback = pCallback;
+	job.pUserData = pUserData;
+	WorkerProtocol::EncodeRequest(argv, job.request);
+
+	const unsigned int jobId = job.id;
+	s_queuedJobs.push_back(std::move(job));
+	s_stats.jobsSubmitted++;
+	return jobId;
+}
+
+void WorkerPool::Update()
+{
+	if (s_running)
+		pumpWorkers(/*timeoutMs*/0);
+}
+
+void WorkerPool::WaitAll()
+{
+	while (s_running && (!s_queuedJobs.empty() || getBusyWorkerCount() > 0))
+		pumpWorkers(/*timeoutMs*/-1);
+}
+
+unsigned int WorkerPool::GetWorkerCount()
+{
+	return getLiveWorkerCount();
+}
+
+unsigned int WorkerPool::GetBusyWorkerCount()
+{
+	return getBusyWorkerCount();
+}
+
+unsigned int WorkerPool::GetQueuedJobCount()
+{
+	return (unsigned int)s_queuedJobs.size();
+}
+
+const WorkerPool::Stats& WorkerPool::GetStats()
+{
+	return s_stats;
+}
+
+void WorkerPool::GetStandInWorkerPath(char* path, size_t pathSize)
+{
+	// Not FileSystem::MakePath, so that tools using the pool don't depend on SDL
+	const size_t directoryLength = s_standInWorkerDirectory.size();
+	const bool hasSeparator = directoryLength > 0 && (s_standInWorkerDirectory[directoryLength - 1] == '/' || s_standInWorkerDirectory[directoryLength - 1] == '\\');
+	SafeSnprintf(path, pathSize, "%s%s%s", s_standInWorkerDirectory.c_str(), hasSeparator ? "" : "/", kStandInWorkerFilename);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Core/FileSystem.h" // kMaxPath
+#include "Core/Helpers.h"
+
+#include <stdint.h>
+
+//
+// Optional pool of long-lived worker processes, so that the cost of process creation and tool startup is paid
+// once per worker rather than once per job.
+//
+// Each worker is launched as "<workerPath> --worker [workerArgs...]" and speaks the WorkerProtocol over its
+// stdin (requests) and stdout (responses). Jobs are queued by Submit and dispatched to idle workers by Update,
+// which never blocks and is intended to be called once per frame. Completion callbacks are called from Update
+// or WaitAll on the calling thread.
+//
+// A worker that dies is respawned and its in-flight job is failed with EXIT_FAILURE. A worker that dies again before
+// completing a job is respawned after a growing delay, and respawns are rate limited, so that a job that crashes the
+// tool can't drain the pool for good or make it fork continuously. Queued jobs are failed while no worker is running
+// and none can be respawned.
+//
+// #TODO: Windows implementation (named pipes + overlapped reads). Start() currently fails on Windows.
+//
+class WorkerPool
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(WorkerPool);
+
+	struct Options
+	{
+		bool enabled = false;
+		unsigned int workerCount = 4;
+		char workerPath[kMaxPath] = {}; // empty = stand-in worker next to the hoffgui executable
+	};
+
+	struct Stats
+	{
+		unsigned int jobsSubmitted = 0;
+		unsigned int jobsCompleted = 0;
+		unsigned int jobsFailed = 0;    // non-zero exit code or worker died
+		unsigned int workerRespawns = 0;
+	};
+
+	// n.b. output is not null-terminated
+	typedef void (*CompletionCallback)(unsigned int jobId, unsigned int exitCode, const char* output, size_t outputSizeBytes, void* pUserData);
+
+	static constexpr unsigned int kMaxWorkerCount = 64;
+
+	// Starts the pool if enabled in options. standInWorkerDirectory is where GetStandInWorkerPath looks.
+	static void Init(Options* pOptions, const char* standInWorkerDirectory);
+	static void Shutdown();
+
+	// Applies the current options e.g. after they are changed. Stops the pool if it is disabled.
+	static bool Restart();
+
+	// workerArgs[] is optional and must be null terminated
+	static bool Start(const char* workerPath, unsigned int workerCount, const char* const workerArgs[] = nullptr);
+
+	// Waits for in-flight jobs, fails queued jobs and closes the workers. Submit is rejected meanwhile, including
+	// from the completion callbacks of the in-flight jobs.
+	static void Stop();
+
+	static bool IsRunning();
+
+	// argv[] must be null terminated. argv[0] is passed to the worker as the tool name.
+	// Returns the job id, or 0 if the pool is not running or is stopping
+	static unsigned int Submit(const char* argv[], CompletionCallback pCallback, void* pUserData = nullptr);
+
+	// Non-blocking. Collects responses, calls completion callbacks and dispatches queued jobs to idle workers.
+	static void Update();
+
+	// Blocks until all submitted jobs have completed
+	static void WaitAll();
+
+	static unsigned int GetWorkerCount();
+	static unsigned int GetBusyWorkerCount();
+	static unsigned int GetQueuedJobCount();
+	static const Stats& GetStats();
+
+	// Path of the stand-in worker built alongside hoffgui
+	static void GetStandInWorkerPath(char* path, size_t pathSize);
+};
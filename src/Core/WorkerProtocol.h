@@ -0,0 +1,133 @@
+#pragma once
+
+//
+// Persistent worker request/response protocol
+//
+// Shared by hoffgui (WorkerPool) and worker executables. Header only so that worker executables do not need to
+// link against anything else.
+//
+// Every message is a frame: a 32-bit little endian payload size, followed by the payload bytes.
+//
+// Request payload:   uint32 argCount, then argCount x (uint32 length, bytes)   (argv[0] is the tool name)
+// Response payload:  uint32 exitCode, followed by the captured tool output (stdout+stderr) to end of payload
+//
+// A worker reads requests from stdin and writes responses to stdout, one response per request, in order.
+// A worker exits when stdin is closed.
+//
+
+#include "Core/Helpers.h"
+
+#include <stdint.h>
+#include <string.h> // strlen
+
+#include <string>
+#include <vector>
+
+class WorkerProtocol
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(WorkerProtocol);
+
+	static const uint32_t kFrameHeaderSizeBytes = 4;
+	static const uint32_t kMaxPayloadSizeBytes = 64 * 1024 * 1024; // sanity limit; a larger size means the stream is corrupt
+
+	static void AppendUint32(std::vector<uint8_t>& buffer, uint32_t val)
+	{
+		const uint8_t bytes[4] = { (uint8_t)val, (uint8_t)(val >> 8), (uint8_t)(val >> 16), (uint8_t)(val >> 24) };
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(bytes));
+	}
+
+	static uint32_t ReadUint32(const uint8_t* p)
+	{
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+
+	// Appends a complete request frame (header + payload) to buffer
+	// argv[] must be null terminated
+	static void EncodeRequest(const char* const argv[], std::vector<uint8_t>& buffer)
+	{
+		const size_t frameStart = buffer.size();
+		AppendUint32(buffer, 0); // payload size, patched below
+
+		uint32_t argCount = 0;
+		while (argv[argCount] != nullptr)
+			argCount++;
+
+		AppendUint32(buffer, argCount);
+		for (uint32_t argIndex = 0; argIndex < argCount; argIndex++)
+		{
+			const uint32_t len = (uint32_t)strlen(argv[argIndex]);
+			AppendUint32(buffer, len);
+			buffer.insert(buffer.end(), (const uint8_t*)argv[argIndex], (const uint8_t*)argv[argIndex] + len);
+		}
+
+		const uint32_t payloadSizeBytes = (uint32_t)(buffer.size() - frameStart - kFrameHeaderSizeBytes);
+		buffer[frameStart + 0] = (uint8_t)payloadSizeBytes;
+		buffer[frameStart + 1] = (uint8_t)(payloadSizeBytes >> 8);
+		buffer[frameStart + 2] = (uint8_t)(payloadSizeBytes >> 16);
+		buffer[frameStart + 3] = (uint8_t)(payloadSizeBytes >> 24);
+	}
+
+	// Returns false if the payload is malformed
+	static bool DecodeRequest(const uint8_t* pPayload, size_t payloadSizeBytes, std::vector<std::string>& args)
+	{
+		args.clear();
+		if (payloadSizeBytes < 4)
+			return false;
+
+		const uint32_t argCount = ReadUint32(pPayload);
+		size_t pos = 4;
+		for (uint32_t argIndex = 0; argIndex < argCount; argIndex++)
+		{
+			if (pos + 4 > payloadSizeBytes)
+				return false;
+			const uint32_t len = ReadUint32(pPayload + pos);
+			pos += 4;
+			if (pos + len > payloadSizeBytes)
+				return false;
+			args.emplace_back((const char*)pPayload + pos, len);
+			pos += len;
+		}
+
+		return pos == payloadSizeBytes;
+	}
+
+	// Appends a complete response frame (header + payload) to buffer
+	static void EncodeResponse(uint32_t exitCode, const char* output, size_t outputSizeBytes, std::vector<uint8_t>& buffer)
+	{
+		AppendUint32(buffer, (uint32_t)(4 + outputSizeBytes));
+		AppendUint32(buffer, exitCode);
+		buffer.insert(buffer.end(), (const uint8_t*)output, (const uint8_t*)output + outputSizeBytes);
+	}
+
+	// Returns false if the payload is malformed
+	static bool DecodeResponse(const uint8_t* pPayload, size_t payloadSizeBytes, uint32_t& exitCode, const char*& output, size_t& outputSizeBytes)
+	{
+		if (payloadSizeBytes < 4)
+			return false;
+
+		exitCode = ReadUint32(pPayload);
+		output = (const char*)pPayload + 4;
+		outputSizeBytes = payloadSizeBytes - 4;
+		return true;
+	}
+
+	// Returns the size of the first complete frame in buffer (header + payload) or 0 if more bytes are required
+	// Sets corrupt if the header is invalid
+	static size_t GetCompleteFrameSize(const uint8_t* pBuffer, size_t bufferSizeBytes, bool& corrupt)
+	{
+		corrupt = false;
+		if (bufferSizeBytes < kFrameHeaderSizeBytes)
+			return 0;
+
+		const uint32_t payloadSizeBytes = ReadUint32(pBuffer);
+		if (payloadSizeBytes > kMaxPayloadSizeBytes)
+		{
+			corrupt = true;
+			return 0;
+		}
+
+		const size_t frameSizeBytes = kFrameHeaderSizeBytes + payloadSizeBytes;
+		return bufferSizeBytes >= frameSizeBytes ? frameSizeBytes : 0;
+	}
+};
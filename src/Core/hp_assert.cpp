@@ -73,4 +73,7 @@ void HpAssertMessage(const char* expr, const char* type, const char* file, int l
 	{
 		free(message);
 	}
+
+	// Get everything up to the assert on disk before breaking into the debugger or aborting
+	FlushLogFile();
 }
@@ -0,0 +1,246 @@
+#include "AnsiDecoder.h"
+
+static const char kEsc = '\x1b';
+static const char kBel = '\x07';
+
+// Similar to the VS Code terminal's dark theme, for legibility on the default ImGui dark style
+static const uint32_t kBasicColors[16] =
+{
+	0x000000, 0xcd3131, 0x0dbc79, 0xe5e510, 0x2472c8, 0xbc3fbc, 0x11a8cd, 0xe5e5e5,
+	0x666666, 0xf14c4c, 0x23d18b, 0xf5f543, 0x3b8eea, 0xd670d6, 0x29b8db, 0xffffff,
+};
+
+static uint32_t makeColor(uint32_t rgb)
+{
+	return 0xff000000 | (rgb & 0xffffff);
+}
+
+void AnsiDecoder::Reset()
+{
+	*this = AnsiDecoder();
+}
+
+AnsiDecoder::Result AnsiDecoder::Decode(char c)
+{
+	switch (m_state)
+	{
+	case State::Text:
+		if (c != kEsc)
+			return Result::Text;
+		m_state = State::Escape;
+		return Result::Consumed;
+
+	case State::Escape:
+		if (c == '[')
+		{
+			m_state = State::Csi;
+			m_csiPrivate = false;
+			m_paramCount = 0;
+			m_params[0] = 0;
+		}
+		else if (c == ']')
+		{
+			m_state = State::Osc;
+			m_oscLength = 0;
+		}
+		else if (c == '(' || c == ')' || c == '*' || c == '+')
+			m_state = State::Charset;
+		else
+			m_state = State::Text; // two character sequence e.g. ESC 7
+		return Result::Consumed;
+
+	case State::Charset:
+		m_state = State::Text;
+		return Result::Consumed;
+
+	case State::Csi:
+		if (c >= '0' && c <= '9')
+			addParamDigit(c);
+		else if (c == ';' || c == ':')
+			addParamSeparator();
+		else if (c >= '<' && c <= '?')
+			m_csiPrivate = true;
+		else if (c >= ' ' && c <= '/')
+			; // intermediate
+		else if (c >= '@' && c <= '~')
+		{
+			// Final character
+			m_state = State::Text;
+			if (c == 'm' && !m_csiPrivate && applySgr())
+				return Result::ColorChanged;
+		}
+		else if (c == kEsc)
+			m_state = State::Escape; // abandon the sequence for a new one
+		else
+		{
+			// Control character (e.g. LF) or garbage: abandon the sequence and treat it as text
+			m_state = State::Text;
+			return Result::Text;
+		}
+		return Result::Consumed;
+
+	case State::Osc:
+		if (c == kBel)
+			m_state = State::Text;
+		else if (c == kEsc)
+			m_state = State::OscEscape;
+		else if (++m_oscLength >= kMaxOscLength)
+			m_state = State::Text;
+		return Result::Consumed;
+
+	case State::OscEscape:
+		m_state = State::Text; // normally '\' of ST
+		return Result::Consumed;
+	}
+
+	return Result::Text;
+}
+
+size_t AnsiDecoder::DecodeSequence(const char* pText, size_t len, bool& colorChanged)
+{
+	// Same as calling Decode for each character, but in one call per sequence rather than per character
+	colorChanged = false;
+	size_t charIndex = 0;
+
+	// Parameters of a CSI sequence, which includes SGR, are parsed in one tight loop. Whatever follows them
+	// (usually just the final character) and every other kind of sequence are decoded a character at a time.
+	if (m_state == State::Text && len >= 2 && pText[0] == kEsc && pText[1] == '[')
+	{
+		m_state = State::Csi;
+		m_csiPrivate = false;
+		m_paramCount = 0;
+		m_params[0] = 0;
+		for (charIndex = 2; charIndex < len; charIndex++)
+		{
+			const char c = pText[charIndex];
+			if (c >= '0' && c <= '9')
+				addParamDigit(c);
+			else if (c == ';' || c == ':')
+				addParamSeparator();
+			else
+				break;
+		}
+		if (charIndex < len && pText[charIndex] == 'm')
+		{
+			m_state = State::Text;
+			colorChanged = applySgr();
+			return charIndex + 1;
+		}
+	}
+
+	for (; charIndex < len; charIndex++)
+	{
+		const Result result = Decode(pText[charIndex]);
+		if (result == Result::Text)
+			return charIndex; // not in a sequence, or abandoned it
+		if (result == Result::ColorChanged)
+			colorChanged = true;
+		if (m_state == State::Text)
+			return charIndex + 1; // end of sequence
+	}
+	return len;
+}
+
+void AnsiDecoder::addParamDigit(char c)
+{
+	if (m_paramCount == 0)
+		m_paramCount = 1;
+	unsigned int& param = m_params[m_paramCount - 1];
+	if (param < 100000) // ignore absurd values rather than overflow
+		param = param * 10 + (unsigned int)(c - '0');
+}
+
+void AnsiDecoder::addParamSeparator()
+{
+	if (m_paramCount == 0)
+		m_paramCount = 1; // leading separator; first param is empty i.e. 0
+	if (m_paramCount < kMaxParams)
+		m_params[m_paramCount++] = 0;
+}
+
+uint32_t AnsiDecoder::getBasicColor(unsigned int colorIndex) const
+{
+	// Bold brightens the 8 basic colours, as most terminals do
+	if (m_bold && colorIndex < 8)
+		colorIndex += 8;
+	return makeColor(kBasicColors[colorIndex & 15]);
+}
+
+uint32_t AnsiDecoder::get256Color(unsigned int colorIndex) const
+{
+	if (colorIndex < 16)
+		return makeColor(kBasicColors[colorIndex]);
+
+	if (colorIndex < 232)
+	{
+		// 6x6x6 cube
+		static const uint32_t kCubeLevels[6] = { 0x00, 0x5f, 0x87, 0xaf, 0xd7, 0xff };
+		const unsigned int cubeIndex = colorIndex - 16;
+		return makeColor((kCubeLevels[cubeIndex / 36] << 16) | (kCubeLevels[(cubeIndex / 6) % 6] << 8) | kCubeLevels[cubeIndex % 6]);
+	}
+
+	// Greyscale ramp
+	const uint32_t level = 8 + ((colorIndex > 255 ? 255 : colorIndex) - 232) * 10;
+	return makeColor((level << 16) | (level << 8) | level);
+}
+
+bool AnsiDecoder::applySgr()
+{
+	const uint32_t oldTextColor = m_textColor;
+
+	// No parameters is the same as 0 (reset)
+	const unsigned int paramCount = m_paramCount > 0 ? m_paramCount : 1;
+	for (unsigned int paramIndex = 0; paramIndex < paramCount; paramIndex++)
+	{
+		const unsigned int param = m_params[paramIndex];
+		if (param == 0)
+		{
+			m_basicColorIndex = -1;
+			m_bold = false;
+			m_extendedColor = 0;
+		}
+		else if (param == 1)
+			m_bold = true;
+		else if (param == 22)
+			m_bold = false;
+		else if (param >= 30 && param <= 37)
+		{
+			m_basicColorIndex = (int)(param - 30);
+			m_extendedColor = 0;
+		}
+		else if (param >= 90 && param <= 97)
+		{
+			m_basicColorIndex = (int)(param - 90 + 8);
+			m_extendedColor = 0;
+		}
+		else if (param == 39)
+		{
+			m_basicColorIndex = -1;
+			m_extendedColor = 0;
+		}
+		else if (param == 38 && paramIndex + 2 < paramCount && m_params[paramIndex + 1] == 5)
+		{
+			m_basicColorIndex = -1;
+			m_extendedColor = get256Color(m_params[paramIndex + 2]);
+			paramIndex += 2;
+		}
+		else if (param == 38 && paramIndex + 4 < paramCount && m_params[paramIndex + 1] == 2)
+		{
+			m_basicColorIndex = -1;
+			m_extendedColor = makeColor(((m_params[paramIndex + 2] & 0xff) << 16) | ((m_params[paramIndex + 3] & 0xff) << 8) | (m_params[paramIndex + 4] & 0xff));
+			paramIndex += 4;
+		}
+		else if (param == 48 && paramIndex + 1 < paramCount)
+			paramIndex += m_params[paramIndex + 1] == 5 ? 2 : 4; // background colour; skip its parameters
+		// else background, underline etc. not shown
+	}
+
+	if (m_extendedColor)
+		m_textColor = m_extendedColor;
+	else if (m_basicColorIndex >= 0)
+		m_textColor = getBasicColor((unsigned int)m_basicColorIndex);
+	else
+		m_textColor = kDefaultTextColor;
+
+	return m_textColor != oldTextColor;
+}
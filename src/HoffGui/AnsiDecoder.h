@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+
+//
+// Decodes ANSI escape sequences (as used by tools for coloured output) one character at a time, so that
+// sequences split across reads are handled.
+//
+// Only the foreground colour of SGR sequences (ESC [ ... m) is interpreted: the 16 basic colours (with bold
+// as bright), 256 colour and 24-bit colour. Every other CSI, OSC and two character sequence is removed.
+//
+class AnsiDecoder
+{
+public:
+	static constexpr uint32_t kDefaultTextColor = 0; // otherwise 0xffRRGGBB
+
+	enum class Result
+	{
+		Text,        // c is text, not part of a sequence
+		Consumed,    // c is part of a sequence; remove it
+		ColorChanged // c ends a sequence that changed the text colour; remove it
+	};
+
+	Result Decode(char c);
+
+	// Decodes the sequence being started (at an ESC) or continued, stopping after it ends. Returns the number of
+	// characters consumed, which is 0 if pText starts with text. colorChanged is set if the sequence changed the colour.
+	size_t DecodeSequence(const char* pText, size_t len, bool& colorChanged);
+
+	bool IsInSequence() const { return m_state != State::Text; }
+	uint32_t GetTextColor() const { return m_textColor; }
+
+	void Reset();
+
+private:
+	enum class State : uint8_t
+	{
+		Text,
+		Escape,      // after ESC
+		Charset,     // after ESC ( etc., which takes one more character
+		Csi,         // after ESC [
+		Osc,         // after ESC ], until BEL or ESC
+		OscEscape,   // ESC within OSC, expecting the '\' of ST
+	};
+
+	// Enough for 38;2;r;g;b plus a few more
+	static constexpr unsigned int kMaxParams = 16;
+
+	// Unterminated OSC sequences are abandoned after this many characters rather than hiding all further output
+	static constexpr unsigned int kMaxOscLength = 4096;
+
+	void addParamDigit(char c);
+	void addParamSeparator();
+	bool applySgr(); // returns true if the colour changed
+	uint32_t getBasicColor(unsigned int colorIndex) const;
+	uint32_t get256Color(unsigned int colorIndex) const;
+
+	State m_state = State::Text;
+	bool m_csiPrivate = false;
+	unsigned int m_paramCount = 0;
+	unsigned int m_params[kMaxParams] = {};
+	unsigned int m_oscLength = 0;
+
+	int m_basicColorIndex = -1; // 0-7 for 30-37, 8-15 for 90-97, or -1
+	uint32_t m_extendedColor = 0; // from 38;5;n or 38;2;r;g;b, which overrides the basic colour
+	bool m_bold = false;
+	uint32_t m_textColor = kDefaultTextColor;
+};
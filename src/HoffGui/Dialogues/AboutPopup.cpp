@@ -45,7 +45,7 @@ static const char kLinkText[] = "[https://www.twitch.tv/djh0ffman](https://www.t
 
 static void aboutLinkCallback(ImGui::MarkdownLinkCallbackData data)
 {
-	LOG_TRACE("About link clicked. Text: %.*s  Link: %.*s\n", data.textLength, data.text, data.linkLength, data.link);
+	LOG_CHANNEL_TRACE(UI, "About link clicked. Text: %.*s  Link: %.*s\n", data.textLength, data.text, data.linkLength, data.link);
 
 	if (data.linkLength == 0)
 		return;
@@ -62,10 +62,10 @@ static void aboutLinkCallback(ImGui::MarkdownLinkCallbackData data)
 		return;
 
 #if defined _WIN32
-	LOG_TRACE("Opening URL: %s\n", url);
+	LOG_CHANNEL_TRACE(UI, "Opening URL: %s\n", url);
 	ShellExecuteA(NULL, "open", url, NULL, NULL, SW_SHOWNORMAL);
 #elif defined __linux__
-	LOG_TRACE("Opening URL: %s\n", url);
+	LOG_CHANNEL_TRACE(UI, "Opening URL: %s\n", url);
 	char command[1024];
 	SafeSnprintf(command, sizeof(command), "xdg-open %s", url);
 	int ret = system(command);
@@ -9,11 +9,17 @@
 #include "HoffGui/Dialogues/FileDialogue.h"
 
 #include "HoffGui/MainMenu.h"
+#include "HoffGui/OutputBuffer.h"
 #include "HoffGui/Options.h"
 
+#include "Mod/ModDocuments.h"
 #include "ImGuiWrap/Fonts.h"
 
+#include "Core/DeferredLog.h"
 #include "Core/FileSystem.h"
+#include "Core/FileWatcher.h"
+#include "Core/ToolCache.h"
+#include "Core/WorkerPool.h"
 #include "Core/Window.h"
 #include "Core/Log.h"
 #include "Core/StringHelpers.h"
@@ -26,6 +32,8 @@
 
 #include "SDL.h"
 
+#include <thread>
+
 //------------------------------------------------------------------------------------------------
 // State
 //------------------------------------------------------------------------------------------------
@@ -35,6 +43,7 @@ static bool s_initialised = false;
 static ImVec4 s_clearColor = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 
 static bool s_resetWindowLayout;
+static std::thread::id s_mainThreadId; // the only thread allowed to touch OutputBuffer directly
 
 //------------------------------------------------------------------------------------------------
 
@@ -45,20 +54,42 @@ static void logCallback(int logLevel, const char* format, va_list argList)
 	va_list argcopy;
 	va_copy(argcopy, argList);
 
-	// Append to output window
-	OutputWindow::Vfprintf(format, argList);
+	// Append to output window, tagged with the level for colouring and filtering.
+	// Other threads can't touch the output buffer, so stage for the next frame.
+	const OutputBuffer::Attributes attributes = OutputBuffer::MakeAttributes(logLevel, OutputBuffer::Source::App);
+	if (std::this_thread::get_id() == s_mainThreadId)
+	{
+		OutputBuffer::SetAttributes(attributes);
+		OutputBuffer::Vfprintf(format, argList);
+	}
+	else
+		OutputBuffer::PostV(attributes, format, argList);
 
 #if 0 // Deliberately disabled because has side effect of closing modal popups e.g. ProcessWithConfigDialogue
 	// Ensure the user is aware of any error messages
 	if (logLevel == LOG_LEVEL_ERROR || logLevel == LOG_LEVEL_WARN)
 		OutputWindow::Focus();
-#else
-	HP_UNUSED(logLevel);
 #endif
 
 	va_end(argcopy);
 }
 
+// Raw text e.g. child process output is read straight into the Output window buffer
+// Other threads get nullptr, so Log falls back to the log callback
+static char* logReserveCallback(size_t& sizeBytes)
+{
+	if (std::this_thread::get_id() != s_mainThreadId)
+		return nullptr;
+	return OutputBuffer::Reserve(sizeBytes);
+}
+
+static void logCommitCallback(FILE* pStream, char* text, size_t len)
+{
+	const OutputBuffer::Source source = pStream == stderr ? OutputBuffer::Source::ChildStderr : OutputBuffer::Source::ChildStdout;
+	OutputBuffer::SetAttributes(OutputBuffer::MakeAttributes(LOG_LEVEL_INFO, source));
+	OutputBuffer::Commit(text, len);
+}
+
 //------------------------------------------------------------------------------------------------
 
 // Implementation of function defined in hp_assert.h
@@ -227,7 +258,9 @@ bool HoffGui::Init()
 {
 	HP_ASSERT(!s_initialised);
 
+	s_mainThreadId = std::this_thread::get_id();
 	SetLogCallback(logCallback);
+	SetLogSinkCallbacks(logReserveCallback, logCommitCallback);
 
 	LOG_INFO("Welcome to hoffgui V%s%s\n", GetAppVersion(), GetAppVersonSuffix());
 
@@ -247,8 +280,13 @@ bool HoffGui::Init()
 	if (!GetCommandLineArgs().ignoreIniFile)
 		LoadOptions(g_options);
 
+	OutputBuffer::Init(&g_options.outputBuffer, FileSystem::GetUserPrefDirectory());
 	OutputWindow::Init(&g_options.view.outputWindow);
+	FileWatcher::Init(); // optional
+	ModDocuments::Init(&g_options.modDocuments);
 	ModWindow::Init();
+	ToolCache::Init(&g_options.toolCache);
+	WorkerPool::Init(&g_options.workerPool, FileSystem::GetApplicationDirectory());
 
 	s_initialised = true;
 
@@ -261,8 +299,15 @@ void HoffGui::Shutdown()
 
 	SaveOptions(g_options);
 
+	WorkerPool::Shutdown();
+	ToolCache::Shutdown();
 	ModWindow::Shutdown();
+	ModDocuments::Shutdown();
+	FileWatcher::Shutdown();
+	DeferredLog::Shutdown();
 	OutputWindow::Shutdown();
+	OutputBuffer::Shutdown();
+	SetLogSinkCallbacks(nullptr, nullptr);
 	SetLogCallback(nullptr);
 	s_initialised = false;
 }
@@ -285,8 +330,18 @@ bool HoffGui::Update()
 
 	updateGlobalKeyboardShortcuts();
 
+	// Collect worker results before the windows that display them are updated
+	WorkerPool::Update();
+	FileWatcher::Update();
+
+	// Format deferred log records from the last frame, so that the Output window shows them this frame
+	DeferredLog::Flush();
+
 	updateWindows();
 
+	// After the windows, so that documents shown this frame are kept
+	ModDocuments::Update();
+
 	return true;
 }
 
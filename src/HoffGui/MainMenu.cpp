@@ -10,16 +10,27 @@
 #include "HoffGui/Options.h"
 #include "HoffGui/HoffGui.h"
 #include "HoffGui/RecentFiles.h"
-#include "Mod/ModFile.h"
+#include "Mod/ModDocument.h"
+#include "Mod/ModDocuments.h"
+#include "Mod/ModFileReader.h"
+#include "Mod/ModSaver.h"
+#include "Mod/ModScanner.h"
 
 #include "ImGuiWrap/Fonts.h"
 
+#include "Core/ProcessStats.h"
+#include "Core/ProcessWrap.h"
 #include "Core/StringHelpers.h"
 #include "Core/Window.h"
+#include "Core/WorkerPool.h"
 #include "Core/Log.h"
 
 #include "ImGuiWrap/ImGuiWrap.h"
 
+#include <stdlib.h> // EXIT_SUCCESS
+
+#include <chrono>
+
 static bool s_visible = true;
 
 struct Actions
@@ -31,6 +42,7 @@ struct Actions
 	bool closeFile = false;
 	bool saveFile = false;
 	bool saveFileAs = false;
+	bool scanForModules = false;
 	bool openAboutPopup = false;
 	bool quit = false;
 };
@@ -77,17 +89,26 @@ static void doFileMenu(Actions& actions)
 
 		ImGui::Separator();
 
-		if (ImGui::MenuItem("Close", /*shortcut*/nullptr, /*selected*/false, /*enabled*/ModFile::IsLoaded()))
+		// Commands apply to the active document
+		const ModDocument* pActiveDocument = ModDocuments::Get(ModDocuments::GetActive());
+
+		if (ImGui::MenuItem("Close", /*shortcut*/nullptr, /*selected*/false, /*enabled*/pActiveDocument != nullptr))
 			actions.closeFile = true;
 
 		ImGui::Separator();
 
-		if (ImGui::MenuItem("Save.", /*shortcut*/nullptr, /*pSelected*/nullptr, /*enabled*/ModFile::IsLoaded() && ModFile::GetPath()[0] != '\0'))
+		if (ImGui::MenuItem("Save.", /*shortcut*/nullptr, /*pSelected*/nullptr, /*enabled*/pActiveDocument && pActiveDocument->GetPath()[0] != '\0' && !pActiveDocument->IsReadOnly()))
 			actions.saveFile = true;
 
-		if (ImGui::MenuItem("Save as...", /*shortcut*/nullptr, /*pSelected*/nullptr, /*enabled*/ModFile::IsLoaded()))
+		if (ImGui::MenuItem("Save as...", /*shortcut*/nullptr, /*pSelected*/nullptr, /*enabled*/pActiveDocument != nullptr))
 			actions.saveFileAs = true;
 
+		ImGui::Separator();
+
+		// e.g. in disk images and memory dumps
+		if (ImGui::MenuItem("Scan for modules", /*shortcut*/nullptr, /*pSelected*/nullptr, /*enabled*/pActiveDocument != nullptr))
+			actions.scanForModules = true;
+
 		ImGui::Separator();
 		if (ImGui::MenuItem("Exit", /*shortcut*/nullptr))
 			actions.quit = true;
@@ -198,12 +219,76 @@ static void doWindowMenu()
 	}
 }
 
+#ifndef RELEASE
+static void workerPoolBenchmarkCallback(unsigned int jobId, unsigned int exitCode, const char* output, size_t outputSizeBytes, void* pUserData)
+{
+	HP_UNUSED(jobId);
+	HP_UNUSED(output);
+	HP_UNUSED(outputSizeBytes);
+	unsigned int& failedJobCount = *(unsigned int*)pUserData;
+	if (exitCode != EXIT_SUCCESS)
+		failedJobCount++;
+}
+
+// Runs the same jobs through the stand-in worker, once with a process per job and once with the worker pool.
+// Blocks the UI for a few seconds.
+static void runWorkerPoolBenchmark()
+{
+	static const unsigned int kJobCount = 100;
+	static const unsigned int kWorkerCount = 4;
+	static const char* kStartupMsString = "20"; // simulated tool startup cost
+
+	char workerPath[kMaxPath];
+	WorkerPool::GetStandInWorkerPath(workerPath, sizeof(workerPath));
+
+	// Process per job
+	ProcessStats::BeginBatch("worker pool benchmark: process per job");
+	const std::chrono::steady_clock::time_point launchStartTime = std::chrono::steady_clock::now();
+	unsigned int launchFailedJobCount = 0;
+	for (unsigned int jobIndex = 0; jobIndex < kJobCount; jobIndex++)
+	{
+		// Not through ToolCache, which would skip the launches being measured
+		const char* argv[] = { workerPath, "--startup-ms", kStartupMsString, "--output-bytes", "1024", nullptr };
+		if (Process::Launch(argv) != EXIT_SUCCESS)
+			launchFailedJobCount++;
+	}
+	const double launchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - launchStartTime).count();
+	ProcessStats::EndBatch();
+
+	// Worker pool, including worker startup
+	const std::chrono::steady_clock::time_point poolStartTime = std::chrono::steady_clock::now();
+	unsigned int poolFailedJobCount = 0;
+	const char* workerArgs[] = { "--startup-ms", kStartupMsString, nullptr };
+	if (!WorkerPool::Start(workerPath, kWorkerCount, workerArgs))
+	{
+		LOG_ERROR("Worker pool benchmark failed to start worker pool\n");
+		WorkerPool::Restart();
+		return;
+	}
+	for (unsigned int jobIndex = 0; jobIndex < kJobCount; jobIndex++)
+	{
+		const char* argv[] = { "standin", "--output-bytes", "1024", nullptr };
+		WorkerPool::Submit(argv, workerPoolBenchmarkCallback, &poolFailedJobCount);
+	}
+	WorkerPool::WaitAll();
+	const double poolSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - poolStartTime).count();
+
+	// Restore the configured pool
+	WorkerPool::Restart();
+
+	LOG_INFO("Worker pool benchmark: %u jobs, %sms simulated tool startup\n", kJobCount, kStartupMsString);
+	LOG_INFO("  Process per job:      %.3fs (%.1f jobs/s, %u failed)\n", launchSeconds, kJobCount / launchSeconds, launchFailedJobCount);
+	LOG_INFO("  Worker pool (%u workers): %.3fs (%.1f jobs/s, %u failed)\n", kWorkerCount, poolSeconds, kJobCount / poolSeconds, poolFailedJobCount);
+}
+#endif
+
 static void doDevMenu()
 {
 #ifndef RELEASE
 	if (ImGui::BeginMenu("Dev"))
 	{
-		ImGui::MenuItem("Placeholder", /*shortcut*/nullptr, /*selected*/false, /*enabled*/false);
+		if (ImGui::MenuItem("Worker pool benchmark"))
+			runWorkerPoolBenchmark();
 		ImGui::EndMenu();
 	}
 #endif
@@ -240,23 +325,30 @@ static void openRecentFile(unsigned int recentFileIndex)
 
 	const char* path = RecentFiles::GetFileFullPath(recentFileIndex);
 
-	if (!FileSystem::Exists(path))
+	// A member of a zip archive is found by its archive's path
+	char filePath[kMaxPath];
+	ModFileReader::GetFilePath(path, filePath, sizeof(filePath));
+	if (!FileSystem::Exists(filePath))
 	{
 		LOG_ERROR("Recent file not found. Removing from list: %s\n", path);
 		RecentFiles::RemoveByIndex(recentFileIndex);
 		return;
 	}
 
-	if (ModFile::Load(path))
-		ModWindow::SetFilePath(path);
-	else
-		LOG_ERROR("Failed to load file\n");
+	ModWindow::Open(path);
+}
+
+static void addSavedFileToRecentFiles(ModDocumentHandle handle, const char* path, void* pUserData)
+{
+	HP_UNUSED(handle);
+	HP_UNUSED(pUserData);
+	RecentFiles::Add(path);
 }
 
 static void processActions(const Actions& actions)
 {
 	if (actions.openNewFilePopup)
-		ModFile::New();
+		ModWindow::Focus(ModDocuments::New());
 
 	if (actions.openExistingFilePopup)
 	{
@@ -265,39 +357,27 @@ static void processActions(const Actions& actions)
 		// This call blocks until user selects a file or cancels
 		FileDialogue::OpenFileDialogue("File", path, sizeof(path)); // n.b. no return code. If cancelled then path is empty
 
+		// Added to recent files once loaded
 		if (path[0] != '\0')
-		{
-			if (ModFile::Load(path))
-			{
-				LOG_INFO("Loaded file: %s\n", path);
-				ModWindow::SetFilePath(path);
-				RecentFiles::Add(path);
-			}
-			else
-			{
-				LOG_ERROR("Failed to load file: %s\n", path);
-			}
-		}
+			ModWindow::Open(path);
 	}
 
 	if (actions.openRecentFile)
 		openRecentFile(actions.recentFileIndex);
 
-	if (actions.closeFile)
-	{
-		ModFile::Free();
-		ModWindow::SetFilePath(nullptr);
-	}
+	ModDocument* pActiveDocument = ModDocuments::Get(ModDocuments::GetActive());
 
-	if (actions.saveFile)
+	if (actions.closeFile && pActiveDocument)
 	{
-		if (ModFile::Save())
-			LOG_INFO("File saved: %s\n", ModFile::GetPath());
-		else
-			LOG_ERROR("Failed to save file\n");
+		ModDocuments::Close(ModDocuments::GetActive());
+		pActiveDocument = nullptr;
 	}
 
-	if (actions.saveFileAs)
+	// Saved in the background. The result is logged.
+	if (actions.saveFile && pActiveDocument)
+		ModSaver::Save(ModDocuments::GetActive());
+
+	if (actions.saveFileAs && pActiveDocument)
 	{
 		char path[kMaxPath] = {};
 
@@ -305,18 +385,13 @@ static void processActions(const Actions& actions)
 		FileDialogue::SaveFileDialogue("Save file", path, sizeof(path)); // n.b. no return code. If cancelled then path is empty
 
 		if (path[0] != '\0')
-		{
-			if (ModFile::SaveAs(path))
-			{
-				LOG_INFO("File saved: %s\n", path);
-				ModWindow::SetFilePath(path);
-				RecentFiles::Add(path);
-			}
-			else
-				LOG_ERROR("Failed to save file: %s\n", path);
-		}
+			ModSaver::Save(ModDocuments::GetActive(), path, addSavedFileToRecentFiles);
 	}
 
+	// Found modules are listed in a MOD window
+	if (actions.scanForModules && pActiveDocument && ModScanner::Start(ModDocuments::GetActive()))
+		ModWindow::SetVisible(true);
+
 	if (actions.openAboutPopup)
 		ImGui::OpenPopup(AboutPopup::kName);
 }
@@ -52,41 +52,41 @@ static void writeWindowSection(FILE* pFile)
 	HP_ASSERT(pFile != nullptr);
 
 	IniFile::WriteSection(pFile, "Window");
-	LOG_TRACE("Writing [Window] settings:\n");
+	LOG_CHANNEL_TRACE(Ini, "Writing [Window] settings:\n");
 
 	// position
 	int x, y;
 	Window::GetPosition(x, y);
 	IniFile::WriteInt(pFile, "x", x);
 	IniFile::WriteInt(pFile, "y", y);
-	LOG_TRACE("x=%u y=%u\n", x, y);
+	LOG_CHANNEL_TRACE(Ini, "x=%u y=%u\n", x, y);
 
 	// size
 	unsigned int w, h;
 	Window::GetSize(w, h);
 	IniFile::WriteUint(pFile, "w", w);
 	IniFile::WriteUint(pFile, "h", h);
-	LOG_TRACE("w=%u h=%u\n", w, h);
+	LOG_CHANNEL_TRACE(Ini, "w=%u h=%u\n", w, h);
 
 	// display (monitor) index
 	int displayIndex = Window::GetDisplayIndex();
 	if (displayIndex >= 0)
 	{
 		IniFile::WriteInt(pFile, "displayIndex", displayIndex);
-		LOG_TRACE("displayIndex=%d\n", displayIndex);
+		LOG_CHANNEL_TRACE(Ini, "displayIndex=%d\n", displayIndex);
 	}
 
 	// maximised
 	IniFile::WriteBool(pFile, "maximised", Window::IsMaximised());
-	LOG_TRACE("maximised=%u\n", Window::IsMaximised() ? 1 : 0);
+	LOG_CHANNEL_TRACE(Ini, "maximised=%u\n", Window::IsMaximised() ? 1 : 0);
 
 	// minimised
 	IniFile::WriteBool(pFile, "minimised", Window::IsMinimised());
-	LOG_TRACE("minimised=%u\n", Window::IsMinimised() ? 1 : 0);
+	LOG_CHANNEL_TRACE(Ini, "minimised=%u\n", Window::IsMinimised() ? 1 : 0);
 
 	// fullscreen
 	IniFile::WriteBool(pFile, "fullscreen", Window::IsFullscreen());
-	LOG_TRACE("fullscreen=%u\n", Window::IsFullscreen() ? 1 : 0);
+	LOG_CHANNEL_TRACE(Ini, "fullscreen=%u\n", Window::IsFullscreen() ? 1 : 0);
 }
 
 static void writeViewSection(FILE* pFile, const ViewOptions& options)
@@ -154,12 +154,16 @@ static void writeOutputWindowSection(FILE* pFile, const OutputWindow::Options& o
 	IniFile::WriteSection(pFile, "OutputWindow");
 	WRITE_OPTIONS_BOOL(useDefaultFont);
 	WRITE_OPTIONS_ENUM(fontType); // #TODO: Save string instead to make robust to font changes
+	WRITE_OPTIONS_BOOL(showTimestamps);
+	WRITE_OPTIONS_BOOL(wordWrap);
 }
 
 static bool parseOutputWindowOption(const char* key, const char* value, OutputWindow::Options& options, unsigned int lineNumber)
 {
 	PARSE_OPTIONS_BOOL(useDefaultFont)
 	else PARSE_OPTIONS_ENUM(fontType)
+	else PARSE_OPTIONS_BOOL(showTimestamps)
+	else PARSE_OPTIONS_BOOL(wordWrap)
 	else
 	{
 		LOG_ERROR("Unrecognised OutputWindow option on line %u: %s=%s\n", lineNumber, key, value);
@@ -169,6 +173,56 @@ static bool parseOutputWindowOption(const char* key, const char* value, OutputWi
 	return true;
 }
 
+static void writeOutputBufferSection(FILE* pFile, const OutputBuffer::Options& options)
+{
+	HP_ASSERT(pFile != nullptr);
+
+	IniFile::WriteSection(pFile, "OutputBuffer");
+	WRITE_OPTIONS_UINT(memoryBudgetMB);
+	WRITE_OPTIONS_BOOL(spillToDisk);
+	WRITE_OPTIONS_UINT(maxSpillSizeMB);
+}
+
+static bool parseOutputBufferOption(const char* key, const char* value, OutputBuffer::Options& options, unsigned int lineNumber)
+{
+	PARSE_OPTIONS_UINT(memoryBudgetMB)
+	else PARSE_OPTIONS_BOOL(spillToDisk)
+	else PARSE_OPTIONS_UINT(maxSpillSizeMB)
+	else
+	{
+		LOG_ERROR("Unrecognised OutputBuffer option on line %u: %s=%s\n", lineNumber, key, value);
+		return false;
+	}
+
+	return true;
+}
+
+//-----------------------------------------------------------------------------------------------------
+
+static void writeModDocumentsSection(FILE* pFile, const ModDocuments::Options& options)
+{
+	HP_ASSERT(pFile != nullptr);
+
+	IniFile::WriteSection(pFile, "ModDocuments");
+	WRITE_OPTIONS_UINT(memoryBudgetMB);
+	WRITE_OPTIONS_BOOL(reloadChangedFiles);
+	WRITE_OPTIONS_UINT(windowedThresholdMB);
+}
+
+static bool parseModDocumentsOption(const char* key, const char* value, ModDocuments::Options& options, unsigned int lineNumber)
+{
+	PARSE_OPTIONS_UINT(memoryBudgetMB)
+	else PARSE_OPTIONS_BOOL(reloadChangedFiles)
+	else PARSE_OPTIONS_UINT(windowedThresholdMB)
+	else
+	{
+		LOG_ERROR("Unrecognised ModDocuments option on line %u: %s=%s\n", lineNumber, key, value);
+		return false;
+	}
+
+	return true;
+}
+
 //-----------------------------------------------------------------------------------------------------
 
 static void writeResourceSection(FILE* pFile, const ResourceOptions& options)
@@ -192,6 +246,52 @@ static bool parseResourceOption(const char* key, const char* value, ResourceOpti
 	return true;
 }
 
+static void writeToolCacheSection(FILE* pFile, const ToolCache::Options& options)
+{
+	HP_ASSERT(pFile != nullptr);
+
+	IniFile::WriteSection(pFile, "ToolCache");
+	WRITE_OPTIONS_BOOL(enabled);
+	WRITE_OPTIONS_UINT(maxSizeMB);
+}
+
+static bool parseToolCacheOption(const char* key, const char* value, ToolCache::Options& options, unsigned int lineNumber)
+{
+	PARSE_OPTIONS_BOOL(enabled)
+	else PARSE_OPTIONS_UINT(maxSizeMB)
+	else
+	{
+		LOG_ERROR("Unrecognised ToolCache option on line %u: %s=%s\n", lineNumber, key, value);
+		return false;
+	}
+
+	return true;
+}
+
+static void writeWorkerPoolSection(FILE* pFile, const WorkerPool::Options& options)
+{
+	HP_ASSERT(pFile != nullptr);
+
+	IniFile::WriteSection(pFile, "WorkerPool");
+	WRITE_OPTIONS_BOOL(enabled);
+	WRITE_OPTIONS_UINT(workerCount);
+	WRITE_OPTIONS_STRING(workerPath);
+}
+
+static bool parseWorkerPoolOption(const char* key, const char* value, WorkerPool::Options& options, unsigned int lineNumber)
+{
+	PARSE_OPTIONS_BOOL(enabled)
+	else PARSE_OPTIONS_UINT(workerCount)
+	else PARSE_OPTIONS_STRING(workerPath)
+	else
+	{
+		LOG_ERROR("Unrecognised WorkerPool option on line %u: %s=%s\n", lineNumber, key, value);
+		return false;
+	}
+
+	return true;
+}
+
 static void writeRecentFilesSection(FILE* pFile)
 {
 	HP_ASSERT(pFile != nullptr);
@@ -221,7 +321,7 @@ static bool optionsIniHandler(const char* pSection, const char* key, const char*
 	HP_ASSERT(pUserData != nullptr);
 	Options& options = *(Options*)pUserData;
 
-	LOG_TRACE("Line %u: section=%s %s=%s\n", lineNumber, pSection ? pSection : "<none>", key, value);
+	LOG_CHANNEL_TRACE(Ini, "Line %u: section=%s %s=%s\n", lineNumber, pSection ? pSection : "<none>", key, value);
 
 	if (pSection == nullptr)
 		return false;
@@ -243,10 +343,26 @@ static bool optionsIniHandler(const char* pSection, const char* key, const char*
 	{
 		return parseOutputWindowOption(key, value, options.view.outputWindow, lineNumber);
 	}
+	else if (strcmp(pSection, "OutputBuffer") == 0)
+	{
+		return parseOutputBufferOption(key, value, options.outputBuffer, lineNumber);
+	}
+	else if (strcmp(pSection, "ModDocuments") == 0)
+	{
+		return parseModDocumentsOption(key, value, options.modDocuments, lineNumber);
+	}
 	else if (strcmp(pSection, "Resource") == 0)
 	{
 		return parseResourceOption(key, value, options.resource, lineNumber);
 	}
+	else if (strcmp(pSection, "ToolCache") == 0)
+	{
+		return parseToolCacheOption(key, value, options.toolCache, lineNumber);
+	}
+	else if (strcmp(pSection, "WorkerPool") == 0)
+	{
+		return parseWorkerPoolOption(key, value, options.workerPool, lineNumber);
+	}
 	else if (strcmp(pSection, "RecentFiles") == 0)
 	{
 		return parseRecentFilesOption(key, value);
@@ -265,7 +381,7 @@ bool LoadOptions(Options& options)
 
 	if (!FileSystem::Exists(optionsPath))
 	{
-		LOG_TRACE("Options file not found: %s\n", optionsPath);
+		LOG_CHANNEL_TRACE(Ini, "Options file not found: %s\n", optionsPath);
 		return false;
 	}
 
@@ -299,7 +415,11 @@ bool SaveOptions(const Options& options)
 	writeViewSection(pFile, options.view);
 	writeWindowVisibilitySection(pFile);
 	writeOutputWindowSection(pFile, options.view.outputWindow);
+	writeOutputBufferSection(pFile, options.outputBuffer);
+	writeModDocumentsSection(pFile, options.modDocuments);
 	writeResourceSection(pFile, options.resource);
+	writeToolCacheSection(pFile, options.toolCache);
+	writeWorkerPoolSection(pFile, options.workerPool);
 	writeRecentFilesSection(pFile);
 
 	fclose(pFile);
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "HoffGui/Windows/OutputWindow.h"
+#include "HoffGui/OutputBuffer.h"
+#include "Mod/ModDocuments.h"
 
 #include "Core/FileSystem.h" // kMaxPath
+#include "Core/ToolCache.h"
+#include "Core/WorkerPool.h"
 
 struct ViewOptions
 {
@@ -19,6 +23,10 @@ struct Options
 {
 	ViewOptions view;
 	ResourceOptions resource;
+	OutputBuffer::Options outputBuffer;
+	ModDocuments::Options modDocuments;
+	ToolCache::Options toolCache;
+	WorkerPool::Options workerPool;
 };
 
 // e.g. "C:\Users\Howard\AppData\Roaming\TTE\hoffgui\hoffgui.ini"
@@ -0,0 +1,894 @@
+#include "OutputBuffer.h"
+
+#include "HoffGui/AnsiDecoder.h"
+
+#include "Core/FileSystem.h" // kMaxPath
+#include "Core/Helpers.h" // Min
+#include "Core/MappedFile.h"
+#include "Core/StringHelpers.h" // _vscprintf
+#include "Core/hp_assert.h"
+#include "Core/Log.h"
+
+#include <stdio.h> // vsnprintf
+#include <string.h> // strlen, memchr, memcpy
+#include <stdlib.h> // malloc, free
+
+#include <algorithm> // std::upper_bound
+#include <atomic>
+#include <bit> // std::countr_zero
+#include <chrono>
+#include <deque>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define OUTPUT_BUFFER_SSE2 1
+#include <emmintrin.h>
+#else
+// #TODO: NEON
+#define OUTPUT_BUFFER_SSE2 0
+#endif
+
+// Segments cover consecutive aligned ranges of positions: segment n holds [n * kSegmentSizeBytes, (n + 1) * kSegmentSizeBytes).
+// A multiple of the spill file's map alignment.
+static const unsigned int kSegmentSizeBytes = 1024 * 1024;
+
+// At least the segment being written and the one before, so a CR after a segment boundary can return to the start of
+// the line
+static const unsigned int kMinMemorySegmentCount = 2;
+
+struct OutputBuffer::Segment
+{
+	char* pText = nullptr; // kSegmentSizeBytes of heap memory, or a read-only view of the spill file if spilled
+	int spillSlot = -1;    // >= 0 if spilled
+	unsigned int spillFileGeneration = 0;
+
+	Segment() = default;
+	Segment(const Segment&) = delete;
+	Segment& operator=(const Segment&) = delete;
+	~Segment();
+};
+
+static const OutputBuffer::Options* s_pOptions; // nullptr until Init
+
+// Spill file: a pool of segment sized slots, reused as spilled segments are discarded
+static char s_spillDirectory[kMaxPath];
+static MappedFile s_spillFile;
+static unsigned int s_spillFileGeneration; // so that slots of a previous file are not returned to the pool
+static unsigned int s_spillSlotCount; // file size in slots
+static std::vector<unsigned int> s_freeSpillSlots;
+static bool s_spillFailed; // not retried until Init
+
+// n.b. After the spill file, so that segments are destroyed first at exit
+static std::deque<std::shared_ptr<OutputBuffer::Segment>> s_segments; // s_segments[i] is segment number s_firstSegmentNumber + i
+static uint64_t s_firstSegmentNumber;
+static size_t s_spilledSegmentCount; // the first segments are spilled, the rest are in memory
+static char* s_pSpareSegmentText; // memory of the last segment spilled, for the next segment
+
+static uint64_t s_startPosition; // see GetStartPosition
+static uint64_t s_endPosition;
+static uint64_t s_discardedBytes;
+
+static uint64_t s_totalBytesAppended;
+static bool s_pendingCarriageReturn; // the last character appended was a CR
+
+// Attributes of the text, as runs starting at ascending positions. The last run is the current attributes.
+// Runs entirely before the start position are removed; the first may start before it.
+// Packed into 16 bytes, as coloured output has a run every few characters and they don't fit in cache.
+struct AttributeRun
+{
+	uint64_t beginPosition : 48; // 256 TB
+	uint64_t logLevel : 8; // int8_t
+	uint64_t source : 8;
+	uint32_t timeMs;
+	uint32_t textColor;
+
+	AttributeRun(uint64_t position, const OutputBuffer::Attributes& attributes) : beginPosition(position) { SetAttributes(attributes); }
+
+	OutputBuffer::Attributes GetAttributes() const
+	{
+		OutputBuffer::Attributes attributes;
+		attributes.logLevel = (int8_t)logLevel;
+		attributes.source = (OutputBuffer::Source)source;
+		attributes.timeMs = timeMs;
+		attributes.textColor = textColor;
+		return attributes;
+	}
+
+	void SetAttributes(const OutputBuffer::Attributes& attributes)
+	{
+		logLevel = (uint8_t)attributes.logLevel;
+		source = (uint8_t)attributes.source;
+		timeMs = attributes.timeMs;
+		textColor = attributes.textColor;
+	}
+};
+static_assert(sizeof(AttributeRun) == 16, "AttributeRun is not packed");
+static std::deque<AttributeRun> s_attributeRuns = { AttributeRun(0, {}) };
+
+// Escape sequence state per source, as a sequence or colour may span several appends
+static const char kEsc = '\x1b';
+static AnsiDecoder s_ansiDecoders[3]; // indexed by Source
+
+static const std::chrono::steady_clock::time_point s_startSteadyTime = std::chrono::steady_clock::now();
+static const uint64_t s_startTime = (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+// Staging queue for other threads: an intrusive lock-free stack of messages, newest first.
+// Producers push with compare-exchange; the consumer takes the whole stack with a single exchange, so neither
+// side ever waits for the other.
+struct StagedMessage
+{
+	StagedMessage* pNext;
+	OutputBuffer::Attributes attributes;
+	size_t len;
+	// followed by len bytes of text
+};
+static std::atomic<StagedMessage*> s_pStagedHead;
+
+//------------------------------------------------------------------------------------------------
+
+static uint64_t getSegmentNumber(uint64_t position)
+{
+	return position / kSegmentSizeBytes;
+}
+
+static unsigned int getSegmentOffset(uint64_t position)
+{
+	return (unsigned int)(position % kSegmentSizeBytes);
+}
+
+static uint64_t getSegmentsEndPosition()
+{
+	return (s_firstSegmentNumber + s_segments.size()) * kSegmentSizeBytes;
+}
+
+static size_t getMemorySegmentCount()
+{
+	return s_segments.size() - s_spilledSegmentCount;
+}
+
+// Text at position, which must be in a segment
+static char* getText(uint64_t position)
+{
+	const uint64_t segmentNumber = getSegmentNumber(position);
+	HP_ASSERT(segmentNumber >= s_firstSegmentNumber && segmentNumber - s_firstSegmentNumber < s_segments.size());
+	return s_segments[(size_t)(segmentNumber - s_firstSegmentNumber)]->pText + getSegmentOffset(position);
+}
+
+// Spilled text is read-only
+static uint64_t getMinWritePosition()
+{
+	return Max(s_startPosition, (s_firstSegmentNumber + s_spilledSegmentCount) * kSegmentSizeBytes);
+}
+
+static size_t getMemoryBudgetSegmentCount()
+{
+	static const OutputBuffer::Options kDefaultOptions;
+	const OutputBuffer::Options& options = s_pOptions ? *s_pOptions : kDefaultOptions;
+	return Max((size_t)options.memoryBudgetMB * (1024 * 1024 / kSegmentSizeBytes), (size_t)kMinMemorySegmentCount);
+}
+
+static size_t getMaxSpilledSegmentCount()
+{
+	if (!s_pOptions || !s_pOptions->spillToDisk || s_spillFailed)
+		return 0;
+	return (size_t)s_pOptions->maxSpillSizeMB * (1024 * 1024 / kSegmentSizeBytes);
+}
+
+OutputBuffer::Segment::~Segment()
+{
+	if (spillSlot < 0)
+	{
+		free(pText);
+		return;
+	}
+
+	MappedFile::Unmap(pText, kSegmentSizeBytes);
+	if (s_spillFile.IsOpen() && spillFileGeneration == s_spillFileGeneration)
+		s_freeSpillSlots.push_back((unsigned int)spillSlot);
+}
+
+// n.b. Can't log directly from here, as logging appends to the buffer
+static void postSpillError(const char* message)
+{
+	s_spillFailed = true;
+	char text[256];
+	SafeSnprintf(text, sizeof(text), "Output history: %s. Older output will be discarded.\n", message);
+	OutputBuffer::Post(OutputBuffer::MakeAttributes(LOG_LEVEL_ERROR, OutputBuffer::Source::App), text, strlen(text));
+}
+
+static bool openSpillFile()
+{
+	HP_ASSERT(kSegmentSizeBytes % MappedFile::GetMapAlignment() == 0);
+	if (!s_spillFile.CreateTemporary(s_spillDirectory, "output"))
+	{
+		postSpillError("failed to create spill file");
+		return false;
+	}
+
+	s_spillFileGeneration++;
+	s_spillSlotCount = 0;
+	s_freeSpillSlots.clear();
+	return true;
+}
+
+// Moves the oldest segment in memory to the spill file. Returns false if spilling is disabled or failed.
+static bool spillSegment()
+{
+	if (getMaxSpilledSegmentCount() == 0)
+		return false;
+	if (!s_spillFile.IsOpen() && !openSpillFile())
+		return false;
+
+	unsigned int slot;
+	if (!s_freeSpillSlots.empty())
+	{
+		slot = s_freeSpillSlots.back();
+		s_freeSpillSlots.pop_back();
+	}
+	else
+		slot = s_spillSlotCount++;
+
+	std::shared_ptr<OutputBuffer::Segment>& pSegment = s_segments[s_spilledSegmentCount];
+	const uint64_t offset = (uint64_t)slot * kSegmentSizeBytes;
+	const char* pView = nullptr;
+	if (s_spillFile.Write(offset, pSegment->pText, kSegmentSizeBytes))
+		pView = s_spillFile.Map(offset, kSegmentSizeBytes);
+	if (!pView)
+	{
+		s_freeSpillSlots.push_back(slot);
+		postSpillError("failed to write spill file");
+		return false;
+	}
+
+	// A new segment object, as the old one may be shared with another thread, which keeps reading its memory
+	std::shared_ptr<OutputBuffer::Segment> pSpilledSegment = std::make_shared<OutputBuffer::Segment>();
+	pSpilledSegment->pText = (char*)pView;
+	pSpilledSegment->spillSlot = (int)slot;
+	pSpilledSegment->spillFileGeneration = s_spillFileGeneration;
+
+	if (pSegment.use_count() == 1 && !s_pSpareSegmentText)
+	{
+		s_pSpareSegmentText = pSegment->pText;
+		pSegment->pText = nullptr;
+	}
+	pSegment = pSpilledSegment;
+	s_spilledSegmentCount++;
+	return true;
+}
+
+// Returns the position after the next LF, or the end position if none
+static uint64_t findNextLineStart(uint64_t position)
+{
+	while (position < s_endPosition)
+	{
+		const OutputBuffer::Range range = OutputBuffer::GetRange(position, s_endPosition);
+		const char* pLF = (const char*)memchr(range.pBegin, '\n', (size_t)(range.pEnd - range.pBegin));
+		if (pLF)
+			return position + (uint64_t)(pLF - range.pBegin) + 1;
+		position += (uint64_t)(range.pEnd - range.pBegin);
+	}
+	return s_endPosition;
+}
+
+// Discards the oldest segment, along with the rest of the last line in it
+static void discardFirstSegment()
+{
+	HP_ASSERT(!s_segments.empty());
+	const uint64_t segmentEndPosition = (s_firstSegmentNumber + 1) * kSegmentSizeBytes;
+	const bool endsLine = s_startPosition < segmentEndPosition && *getText(segmentEndPosition - 1) == '\n';
+
+	s_segments.pop_front();
+	s_firstSegmentNumber++;
+	if (s_spilledSegmentCount > 0)
+		s_spilledSegmentCount--;
+
+	if (s_startPosition >= segmentEndPosition)
+		return; // nothing in it e.g. after Clear
+
+	const uint64_t startPosition = endsLine ? segmentEndPosition : findNextLineStart(segmentEndPosition);
+	s_discardedBytes += startPosition - s_startPosition;
+	s_startPosition = startPosition;
+}
+
+static void addSegment()
+{
+	if (s_segments.empty())
+		s_firstSegmentNumber = getSegmentNumber(s_endPosition);
+
+	// Make room in memory, then on disk
+	const size_t memoryBudgetSegmentCount = getMemoryBudgetSegmentCount();
+	while (getMemorySegmentCount() >= memoryBudgetSegmentCount)
+	{
+		if (!spillSegment())
+			discardFirstSegment();
+	}
+	while (s_spilledSegmentCount > getMaxSpilledSegmentCount())
+		discardFirstSegment();
+
+	std::shared_ptr<OutputBuffer::Segment> pSegment = std::make_shared<OutputBuffer::Segment>();
+	if (s_pSpareSegmentText)
+	{
+		pSegment->pText = s_pSpareSegmentText;
+		s_pSpareSegmentText = nullptr;
+	}
+	else
+	{
+		pSegment->pText = (char*)malloc(kSegmentSizeBytes);
+		if (!pSegment->pText)
+			HP_FATAL_ERROR("Failed to allocate output buffer segment");
+	}
+	s_segments.push_back(pSegment);
+}
+
+//------------------------------------------------------------------------------------------------
+
+void OutputBuffer::Init(const Options* pOptions, const char* spillDirectory)
+{
+	HP_ASSERT(pOptions != nullptr);
+	HP_ASSERT(spillDirectory != nullptr);
+	s_pOptions = pOptions;
+	SafeStrcpy(s_spillDirectory, sizeof(s_spillDirectory), spillDirectory);
+	s_spillFailed = false;
+}
+
+void OutputBuffer::Shutdown()
+{
+	// Anything appended from now on e.g. log messages while shutting down is kept in memory only
+	s_pOptions = nullptr;
+	Clear();
+	free(s_pSpareSegmentText);
+	s_pSpareSegmentText = nullptr;
+	s_spillFile.Close();
+}
+
+void OutputBuffer::Clear()
+{
+	// Discard everything. The end position is kept so that positions remain unique.
+	s_startPosition = s_endPosition;
+	s_pendingCarriageReturn = false;
+
+	// Memory is reallocated as needed, starting small again
+	s_segments.clear();
+	s_spilledSegmentCount = 0;
+
+	// Keep only the current attributes, without colour
+	for (AnsiDecoder& ansiDecoder : s_ansiDecoders)
+		ansiDecoder.Reset();
+	s_attributeRuns.erase(s_attributeRuns.begin(), s_attributeRuns.end() - 1);
+	s_attributeRuns.back().beginPosition = s_endPosition;
+	s_attributeRuns.back().textColor = AnsiDecoder::kDefaultTextColor;
+}
+
+static void setAttributesAt(uint64_t position, const OutputBuffer::Attributes& attributes)
+{
+	AttributeRun& currentRun = s_attributeRuns.back();
+	HP_ASSERT(position >= currentRun.beginPosition);
+	if (currentRun.GetAttributes() == attributes)
+		return;
+
+	if (currentRun.beginPosition == position)
+		currentRun.SetAttributes(attributes); // nothing appended with the current attributes
+	else
+		s_attributeRuns.push_back({ position, attributes });
+}
+
+// Same as setAttributesAt with only the text colour changed, for escape sequences
+static void setTextColorAt(uint64_t position, uint32_t textColor)
+{
+	AttributeRun& currentRun = s_attributeRuns.back();
+	HP_ASSERT(position >= currentRun.beginPosition);
+	if (currentRun.beginPosition == position)
+	{
+		currentRun.textColor = textColor; // nothing appended with the current colour
+		return;
+	}
+
+	AttributeRun run = currentRun;
+	run.beginPosition = position;
+	run.textColor = textColor;
+	s_attributeRuns.push_back(run);
+}
+
+void OutputBuffer::SetAttributes(const Attributes& attributes)
+{
+	// The text colour is the current colour of the source's escape sequences
+	Attributes withTextColor = attributes;
+	withTextColor.textColor = s_ansiDecoders[(unsigned int)attributes.source].GetTextColor();
+	setAttributesAt(s_endPosition, withTextColor);
+}
+
+// Last run starting at or before position
+static std::deque<AttributeRun>::const_iterator findAttributeRun(uint64_t position)
+{
+	HP_ASSERT(!s_attributeRuns.empty());
+	auto it = std::upper_bound(s_attributeRuns.cbegin(), s_attributeRuns.cend(), position,
+		[](uint64_t pos, const AttributeRun& run) { return pos < run.beginPosition; });
+	if (it != s_attributeRuns.cbegin())
+		--it;
+	return it;
+}
+
+OutputBuffer::Attributes OutputBuffer::GetAttributes(uint64_t position)
+{
+	return findAttributeRun(position)->GetAttributes();
+}
+
+unsigned int OutputBuffer::GetSpans(uint64_t beginPosition, uint64_t endPosition, Span* pSpans, unsigned int maxSpanCount)
+{
+	HP_ASSERT(pSpans != nullptr && maxSpanCount > 0);
+	if (beginPosition >= endPosition)
+		return 0;
+
+	unsigned int spanCount = 0;
+	auto it = findAttributeRun(beginPosition);
+	uint64_t spanBeginPosition = beginPosition;
+	while (true)
+	{
+		auto nextIt = it + 1;
+		const bool isLastSpan = nextIt == s_attributeRuns.cend() || nextIt->beginPosition >= endPosition || spanCount + 1 == maxSpanCount;
+		const uint64_t spanEndPosition = isLastSpan ? endPosition : nextIt->beginPosition;
+		if (spanEndPosition > spanBeginPosition)
+			pSpans[spanCount++] = { spanBeginPosition, spanEndPosition, it->GetAttributes() };
+		if (isLastSpan)
+			break;
+		spanBeginPosition = spanEndPosition;
+		it = nextIt;
+	}
+	return spanCount;
+}
+
+void OutputBuffer::GetSpans(uint64_t beginPosition, uint64_t endPosition, std::vector<Span>& spans)
+{
+	spans.clear();
+	if (beginPosition >= endPosition)
+		return;
+
+	auto it = findAttributeRun(beginPosition);
+	uint64_t spanBeginPosition = beginPosition;
+	while (true)
+	{
+		auto nextIt = it + 1;
+		const bool isLastSpan = nextIt == s_attributeRuns.cend() || nextIt->beginPosition >= endPosition;
+		const uint64_t spanEndPosition = isLastSpan ? endPosition : nextIt->beginPosition;
+		if (spanEndPosition > spanBeginPosition)
+			spans.push_back({ spanBeginPosition, spanEndPosition, it->GetAttributes() });
+		if (isLastSpan)
+			break;
+		spanBeginPosition = spanEndPosition;
+		it = nextIt;
+	}
+}
+
+OutputBuffer::Attributes OutputBuffer::MakeAttributes(int logLevel, Source source)
+{
+	Attributes attributes;
+	attributes.logLevel = (int8_t)logLevel;
+	attributes.source = source;
+	attributes.timeMs = (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - s_startSteadyTime).count();
+	return attributes;
+}
+
+uint64_t OutputBuffer::GetStartTime()
+{
+	return s_startTime;
+}
+
+// Removes runs that only cover discarded text
+static void discardAttributeRuns()
+{
+	// Found by binary search, so that runs are not read one at a time. Coloured text has a run every few characters.
+	const uint64_t startPosition = OutputBuffer::GetStartPosition();
+	if (s_attributeRuns.size() < 2 || s_attributeRuns[1].beginPosition > startPosition)
+		return;
+	s_attributeRuns.erase(s_attributeRuns.begin(), findAttributeRun(startPosition));
+}
+
+// After a CR moves the end position back to minEndPosition, the current text overwrites anything after it.
+// Must be called immediately, before anything else is appended.
+static void rewindAttributeRuns(uint64_t minEndPosition)
+{
+	if (s_attributeRuns.back().beginPosition <= minEndPosition)
+		return;
+
+	const OutputBuffer::Attributes currentAttributes = s_attributeRuns.back().GetAttributes();
+	while (s_attributeRuns.size() > 1 && s_attributeRuns.back().beginPosition >= minEndPosition)
+		s_attributeRuns.pop_back();
+	if (s_attributeRuns.back().beginPosition >= minEndPosition)
+		s_attributeRuns.back() = { minEndPosition, currentAttributes };
+	else
+		s_attributeRuns.push_back({ minEndPosition, currentAttributes });
+}
+
+// Carriage Return back to start of current line, but not into spilled (read-only) or discarded text
+static void returnToStartOfLine(uint64_t& endPosition)
+{
+	const uint64_t minPosition = getMinWritePosition();
+	while (endPosition > minPosition && *getText(endPosition - 1) != '\n')
+		endPosition--;
+}
+
+char* OutputBuffer::Reserve(size_t& sizeBytes)
+{
+	// Large enough for a pipe read, small enough that segments are filled evenly
+	static const unsigned int kMaxReserveSizeBytes = 64 * 1024;
+
+	// Start a new segment when the last is full. Older segments are spilled or discarded to make room.
+	if (s_segments.empty() || s_endPosition == getSegmentsEndPosition())
+		addSegment();
+	discardAttributeRuns();
+
+	// Don't span segments within a reservation; the caller needs contiguous space. At worst this means one short read per segment.
+	sizeBytes = Min(kMaxReserveSizeBytes, kSegmentSizeBytes - getSegmentOffset(s_endPosition));
+	return getText(s_endPosition);
+}
+
+// Moves text being committed back to position, after CRs or escape sequences were removed before it.
+// n.b. The destination may start in the previous segment.
+static void copyToPosition(uint64_t position, const char* pText, unsigned int len)
+{
+	char* pDest = getText(position);
+	if (pDest == pText)
+		return; // nothing removed yet
+
+	const unsigned int firstLen = Min(len, kSegmentSizeBytes - getSegmentOffset(position));
+	memmove(pDest, pText, firstLen);
+	if (firstLen < len)
+		memmove(getText(position + firstLen), pText + firstLen, len - firstLen);
+}
+
+// Copies text to pDest, which is at or before it, up to the next CR or ESC. Returns the number of characters copied.
+// Coloured output has a few characters of text between escape sequences, which is too few for memchr and memmove
+// calls to pay off.
+static size_t copyPlainText(char* pDest, const char* pText, size_t len)
+{
+	size_t offset = 0;
+
+#if OUTPUT_BUFFER_SSE2
+	const __m128i esc = _mm_set1_epi8(kEsc);
+	const __m128i carriageReturn = _mm_set1_epi8('\r');
+	for (; offset + 16 <= len; offset += 16)
+	{
+		const __m128i block = _mm_loadu_si128((const __m128i*)(pText + offset));
+		const unsigned int stopMask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, esc), _mm_cmpeq_epi8(block, carriageReturn)));
+		const size_t plainLen = stopMask != 0 ? (size_t)std::countr_zero(stopMask) : 16;
+
+		// Stored whole unless that would overwrite the stop or text after it, which hasn't been read yet. The
+		// characters stored after the plain text are overwritten by whatever is copied next.
+		if ((size_t)(pText - pDest) + plainLen >= 16)
+			_mm_storeu_si128((__m128i*)(pDest + offset), block);
+		else
+		{
+			for (size_t charIndex = 0; charIndex < plainLen; charIndex++)
+				pDest[offset + charIndex] = pText[offset + charIndex];
+		}
+		if (stopMask != 0)
+			return offset + plainLen;
+	}
+#endif
+
+	for (; offset < len; offset++)
+	{
+		const char c = pText[offset];
+		if (c == '\r' || c == kEsc)
+			break;
+		pDest[offset] = c;
+	}
+	return offset;
+}
+
+void OutputBuffer::Commit(char* text, size_t len)
+{
+	HP_ASSERT(text == getText(s_endPosition)); // was something appended since Reserve?
+	HP_ASSERT(getSegmentOffset(s_endPosition) + len <= kSegmentSizeBytes);
+
+	s_totalBytesAppended += len;
+
+	AnsiDecoder& ansiDecoder = s_ansiDecoders[(unsigned int)s_attributeRuns.back().source];
+
+	// Fast path: no CRs or escape sequences to process, so the text is already in place
+	if (!s_pendingCarriageReturn && !ansiDecoder.IsInSequence() && memchr(text, '\r', len) == nullptr && memchr(text, kEsc, len) == nullptr)
+	{
+		s_endPosition += len;
+		return;
+	}
+
+	// Process CRs and escape sequences, compacting in place
+	// To support console style "progress bars", if a CR (\r 0xd) is found that is not followed by a LF (\n 0xa),
+	// then back up to start of line. IRA uses this for percentages I think.
+	// Escape sequences are removed, and colour changes recorded as attribute runs.
+	// The write position never overtakes the read position, but may move back before text, into earlier segments.
+	// Until it does, it is addressed relative to text rather than through getText.
+	const uint64_t textPosition = s_endPosition;
+	uint64_t endPosition = s_endPosition;
+	size_t charIndex = 0;
+	while (charIndex < len)
+	{
+		// Copy plain text in bulk, up to the next CR or ESC
+		if (!s_pendingCarriageReturn && !ansiDecoder.IsInSequence())
+		{
+			char* pText = text + charIndex;
+			size_t plainLen;
+			if (endPosition < textPosition)
+			{
+				plainLen = copyPlainText(pText, pText, len - charIndex); // find the length only
+				copyToPosition(endPosition, pText, (unsigned int)plainLen);
+			}
+			else
+				plainLen = copyPlainText(text + (endPosition - textPosition), pText, len - charIndex);
+
+			if (plainLen > 0)
+			{
+				endPosition += plainLen;
+				charIndex += plainLen;
+				if (charIndex == len)
+					break;
+			}
+		}
+
+		// Remove a whole escape sequence at a time
+		if (ansiDecoder.IsInSequence() || text[charIndex] == kEsc)
+		{
+			bool colorChanged;
+			const size_t sequenceLen = ansiDecoder.DecodeSequence(text + charIndex, len - charIndex, colorChanged);
+			if (colorChanged)
+				setTextColorAt(endPosition, ansiDecoder.GetTextColor());
+			charIndex += sequenceLen;
+			if (sequenceLen > 0)
+				continue;
+			// else an abandoned sequence; the character is text
+		}
+
+		const char c = text[charIndex++];
+
+		// Can't tell whether a CR is part of a CR LF pair until the next character, which may be in the next commit
+		if (c == '\r') // CR?
+		{
+			s_pendingCarriageReturn = true;
+			continue;
+		}
+
+		if (s_pendingCarriageReturn)
+		{
+			s_pendingCarriageReturn = false;
+			if (c != '\n')
+			{
+				returnToStartOfLine(endPosition);
+				rewindAttributeRuns(endPosition);
+			}
+			// else a CR LF pair; the CR is dropped, which renders the same
+		}
+
+		if (endPosition < textPosition)
+			*getText(endPosition) = c;
+		else
+			text[endPosition - textPosition] = c;
+		endPosition++;
+	}
+	s_endPosition = endPosition; // may move back
+}
+
+void OutputBuffer::AppendString(const char* str, size_t len)
+{
+	while (len > 0)
+	{
+		size_t reservedSizeBytes = 0;
+		char* pReserved = Reserve(reservedSizeBytes);
+		const size_t chunkSizeBytes = Min(len, reservedSizeBytes);
+		memcpy(pReserved, str, chunkSizeBytes);
+		Commit(pReserved, chunkSizeBytes);
+		str += chunkSizeBytes;
+		len -= chunkSizeBytes;
+	}
+}
+
+void OutputBuffer::Printf(const char* format, ...)
+{
+	HP_ASSERT(format != nullptr);
+
+	va_list argList;
+	va_start(argList, format);
+	Vfprintf(format, argList);
+	va_end(argList);
+}
+
+void OutputBuffer::Vfprintf(const char* format, va_list argList)
+{
+	va_list argcopy;
+	va_copy(argcopy, argList);
+	int ret = _vscprintf(format, argcopy) + 1; // + 1 to null terminate (_vscprintf return value doesn't include null-terminator)
+	va_end(argcopy);
+	if (ret == -1)
+	{
+		LOG_ERROR("_vscprintf failed with code %d\n", ret);
+		return;
+	}
+
+	size_t bufferSize = (size_t)ret;
+
+	char* buffer = (char*)malloc(bufferSize);
+
+	// Populate the buffer with the contents of the format string.
+	va_copy(argcopy, argList);
+	vsnprintf(buffer, bufferSize, format, argcopy);
+	va_end(argcopy);
+
+	HP_ASSERT(bufferSize > 0 && (strlen(buffer) == bufferSize - 1));
+	AppendString(buffer, bufferSize - 1);
+
+	free(buffer);
+}
+
+static StagedMessage* allocStagedMessage(const OutputBuffer::Attributes& attributes, size_t len)
+{
+	StagedMessage* pMessage = (StagedMessage*)malloc(sizeof(StagedMessage) + len + 1); // + 1 for vsnprintf's null terminator
+	if (pMessage)
+	{
+		pMessage->attributes = attributes;
+		pMessage->len = len;
+	}
+	return pMessage;
+}
+
+static char* getStagedMessageText(StagedMessage* pMessage)
+{
+	return (char*)(pMessage + 1);
+}
+
+static void pushStagedMessage(StagedMessage* pMessage)
+{
+	pMessage->pNext = s_pStagedHead.load(std::memory_order_relaxed);
+	while (!s_pStagedHead.compare_exchange_weak(pMessage->pNext, pMessage, std::memory_order_release, std::memory_order_relaxed))
+		; // pNext was updated to the current head; retry
+}
+
+void OutputBuffer::Post(const Attributes& attributes, const char* text, size_t len)
+{
+	HP_ASSERT(text != nullptr || len == 0);
+	if (len == 0)
+		return;
+
+	StagedMessage* pMessage = allocStagedMessage(attributes, len);
+	if (!pMessage)
+		return; // n.b. can't log
+
+	memcpy(getStagedMessageText(pMessage), text, len);
+	pushStagedMessage(pMessage);
+}
+
+void OutputBuffer::PostV(const Attributes& attributes, const char* format, va_list argList)
+{
+	HP_ASSERT(format != nullptr);
+
+	va_list argcopy;
+	va_copy(argcopy, argList);
+	const int len = _vscprintf(format, argcopy);
+	va_end(argcopy);
+	if (len <= 0)
+		return;
+
+	StagedMessage* pMessage = allocStagedMessage(attributes, (size_t)len);
+	if (!pMessage)
+		return; // n.b. can't log
+
+	va_copy(argcopy, argList);
+	vsnprintf(getStagedMessageText(pMessage), (size_t)len + 1, format, argcopy);
+	va_end(argcopy);
+	pushStagedMessage(pMessage);
+}
+
+void OutputBuffer::SpliceStaged()
+{
+	// Cheap check first, as this is called every frame and nearly always empty
+	if (s_pStagedHead.load(std::memory_order_relaxed) == nullptr)
+		return;
+
+	StagedMessage* pMessage = s_pStagedHead.exchange(nullptr, std::memory_order_acquire);
+
+	// Reverse to oldest first
+	StagedMessage* pOldest = nullptr;
+	while (pMessage)
+	{
+		StagedMessage* pNext = pMessage->pNext;
+		pMessage->pNext = pOldest;
+		pOldest = pMessage;
+		pMessage = pNext;
+	}
+
+	const Attributes currentAttributes = s_attributeRuns.back().GetAttributes();
+	while (pOldest)
+	{
+		StagedMessage* pNext = pOldest->pNext;
+		SetAttributes(pOldest->attributes);
+		AppendString(getStagedMessageText(pOldest), pOldest->len);
+		free(pOldest);
+		pOldest = pNext;
+	}
+	SetAttributes(currentAttributes);
+}
+
+uint64_t OutputBuffer::GetStartPosition()
+{
+	return s_startPosition;
+}
+
+uint64_t OutputBuffer::GetEndPosition()
+{
+	return s_endPosition;
+}
+
+uint64_t OutputBuffer::GetTotalBytesAppended()
+{
+	return s_totalBytesAppended;
+}
+
+OutputBuffer::Range OutputBuffer::GetRange(uint64_t beginPosition, uint64_t endPosition)
+{
+	endPosition = Min(endPosition, s_endPosition);
+	if (beginPosition < s_startPosition || beginPosition >= endPosition)
+		return { nullptr, nullptr };
+
+	const char* pBegin = getText(beginPosition);
+	const uint64_t len = Min(endPosition - beginPosition, (uint64_t)(kSegmentSizeBytes - getSegmentOffset(beginPosition)));
+	return { pBegin, pBegin + len };
+}
+
+OutputBuffer::Range OutputBuffer::GetText(uint64_t beginPosition, uint64_t endPosition, std::string& scratch)
+{
+	endPosition = Min(endPosition, s_endPosition);
+	const Range range = GetRange(beginPosition, endPosition);
+	if (range.pBegin && beginPosition + (uint64_t)(range.pEnd - range.pBegin) == endPosition)
+		return range; // contiguous
+
+	scratch.clear();
+	uint64_t position = beginPosition;
+	while (position < endPosition)
+	{
+		const Range segmentRange = GetRange(position, endPosition);
+		if (!segmentRange.pBegin)
+			break;
+		scratch.append(segmentRange.pBegin, segmentRange.pEnd);
+		position += (uint64_t)(segmentRange.pEnd - segmentRange.pBegin);
+	}
+	return { scratch.data(), scratch.data() + scratch.size() };
+}
+
+OutputBuffer::Range OutputBuffer::SharedText::GetRange(uint64_t beginPosition, uint64_t endPosition) const
+{
+	endPosition = Min(endPosition, m_endPosition);
+	if (beginPosition < m_beginPosition || beginPosition >= endPosition)
+		return { nullptr, nullptr };
+
+	const Segment& segment = *m_segments[(size_t)(getSegmentNumber(beginPosition) - m_firstSegmentNumber)];
+	const unsigned int segmentOffset = getSegmentOffset(beginPosition);
+	const uint64_t len = Min(endPosition - beginPosition, (uint64_t)(kSegmentSizeBytes - segmentOffset));
+	return { segment.pText + segmentOffset, segment.pText + segmentOffset + len };
+}
+
+std::shared_ptr<const OutputBuffer::SharedText> OutputBuffer::ShareText(uint64_t beginPosition, uint64_t endPosition)
+{
+	std::shared_ptr<SharedText> pSharedText = std::make_shared<SharedText>();
+	beginPosition = Max(beginPosition, s_startPosition);
+	endPosition = Max(Min(endPosition, s_endPosition), beginPosition);
+	pSharedText->m_beginPosition = beginPosition;
+	pSharedText->m_endPosition = endPosition;
+	if (beginPosition == endPosition)
+		return pSharedText;
+
+	// Holding the segments keeps their memory or spill file views, even after they leave the buffer
+	const uint64_t firstSegmentNumber = getSegmentNumber(beginPosition);
+	const uint64_t endSegmentNumber = getSegmentNumber(endPosition - 1) + 1;
+	pSharedText->m_firstSegmentNumber = firstSegmentNumber;
+	pSharedText->m_segments.reserve((size_t)(endSegmentNumber - firstSegmentNumber));
+	for (uint64_t segmentNumber = firstSegmentNumber; segmentNumber < endSegmentNumber; segmentNumber++)
+		pSharedText->m_segments.push_back(s_segments[(size_t)(segmentNumber - s_firstSegmentNumber)]);
+	return pSharedText;
+}
+
+OutputBuffer::Stats OutputBuffer::GetStats()
+{
+	Stats stats;
+	stats.memorySizeBytes = (uint64_t)getMemorySegmentCount() * kSegmentSizeBytes;
+	stats.spilledSizeBytes = (uint64_t)s_spilledSegmentCount * kSegmentSizeBytes;
+	stats.discardedBytes = s_discardedBytes;
+	stats.spillFailed = s_spillFailed;
+	return stats;
+}
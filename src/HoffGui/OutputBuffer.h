@@ -0,0 +1,168 @@
+#pragma once
+
+#include "Core/Helpers.h"
+
+#include <stdarg.h> // va_list
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+//
+// Text storage behind the Output window: everything appended since startup, in fixed size segments.
+//
+// The most recent segments are kept in memory, allocated as needed up to the memory budget. Older segments
+// are spilled to a temporary file in the user pref directory and read back through memory mapped views, so
+// long sessions keep their whole history without holding it in the heap. Beyond the spill size limit (or
+// before Init, or if spilling fails) the oldest segments are discarded, along with the rest of the line.
+//
+// Kept separate from OutputWindow so that it has no ImGui dependency and can be driven by benchmarks.
+//
+// Not thread safe, except for Post/PostV and reading SharedText. Other threads post messages to a lock-free
+// staging queue which the main thread splices into the buffer once per frame.
+//
+class OutputBuffer
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(OutputBuffer);
+
+	struct Options
+	{
+		unsigned int memoryBudgetMB = 32;
+		bool spillToDisk = true;
+		unsigned int maxSpillSizeMB = 4096;
+	};
+
+	struct Stats
+	{
+		uint64_t memorySizeBytes = 0;  // text segments in memory
+		uint64_t spilledSizeBytes = 0; // text segments in the spill file
+		uint64_t discardedBytes = 0;   // since startup (or Clear)
+		bool spillFailed = false;      // spilling is disabled until restart
+	};
+
+	struct Range
+	{
+		const char* pBegin;
+		const char* pEnd;
+	};
+
+	// Older segments are spilled to a temporary file in spillDirectory (with trailing separator) e.g. the user pref
+	// directory. Until Init, and after Shutdown, nothing is spilled and the default memory budget applies.
+	static void Init(const Options* pOptions, const char* spillDirectory);
+	static void Shutdown();
+
+	enum class Source : uint8_t
+	{
+		App,         // hoffgui's own log messages
+		ChildStdout, // external tool output
+		ChildStderr,
+	};
+
+	// Describes appended text. Stored as runs, so costs nothing per byte.
+	struct Attributes
+	{
+		int8_t logLevel = 0; // LOG_LEVEL_*. Child output is LOG_LEVEL_INFO.
+		Source source = Source::App;
+		uint32_t timeMs = 0; // since GetStartTime, when appended (or posted)
+		uint32_t textColor = 0; // 0xffRRGGBB from escape sequences in the text, or 0 for default. Ignored by SetAttributes.
+
+		bool operator==(const Attributes& rhs) const { return logLevel == rhs.logLevel && source == rhs.source && timeMs == rhs.timeMs && textColor == rhs.textColor; }
+	};
+
+	static void Clear();
+
+	// Applies to everything appended until the attributes are next set. n.b. Does not append, so may be called
+	// between Reserve and Commit.
+	static void SetAttributes(const Attributes& attributes);
+
+	// Attributes of the text at position, which must not have been discarded
+	static Attributes GetAttributes(uint64_t position);
+
+	// Splits [beginPosition, endPosition) where the attributes change, e.g. for each colour.
+	// Returns the span count, at most maxSpanCount, in which case the last span extends to endPosition.
+	struct Span
+	{
+		uint64_t beginPosition;
+		uint64_t endPosition;
+		Attributes attributes;
+	};
+	static unsigned int GetSpans(uint64_t beginPosition, uint64_t endPosition, Span* pSpans, unsigned int maxSpanCount);
+
+	// Every span, e.g. to read the attributes on another thread along with SharedText
+	static void GetSpans(uint64_t beginPosition, uint64_t endPosition, std::vector<Span>& spans);
+
+	// Thread safe. Timestamped now.
+	static Attributes MakeAttributes(int logLevel, Source source);
+
+	// System clock time (Unix epoch, ms) from which Attributes::timeMs counts
+	static uint64_t GetStartTime();
+
+	// A CR that is not followed by a LF returns to the start of the current line, for console style progress output.
+	// ANSI escape sequences are removed, and their colours recorded in the attributes.
+	static void AppendString(const char* str, size_t len);
+	static void Printf(const char* format, ...);
+	static void Vfprintf(const char* format, va_list argList);
+
+	// Zero copy append: Reserve returns contiguous space at the end of the buffer (at least one byte) which the
+	// caller fills, e.g. with read(), then passes to Commit. Older segments are spilled or discarded to make room.
+	// Commit processes CRs in place. Nothing else may be appended between Reserve and Commit.
+	static char* Reserve(size_t& sizeBytes);
+	static void Commit(char* text, size_t len);
+
+	// Thread safe and lock-free: may be called from any thread. The message is copied to the staging queue and
+	// appended by the next SpliceStaged, so normally appears a frame later. Messages are appended whole, in the
+	// order each thread posted them, so never interleave mid-message.
+	static void Post(const Attributes& attributes, const char* text, size_t len);
+	static void PostV(const Attributes& attributes, const char* format, va_list argList);
+
+	// Main thread only. Appends everything posted so far.
+	static void SpliceStaged();
+
+	// Positions are byte offsets into everything appended since startup, so stay valid while the text they refer
+	// to is in the buffer, whether in memory or spilled.
+	// Text before the start position has been discarded. A CR can move the end position back, but never before
+	// the start of the current line (nor before the oldest segment in memory), so complete lines never change
+	// until they are discarded.
+	static uint64_t GetStartPosition();
+	static uint64_t GetEndPosition();
+
+	// Text in [beginPosition, endPosition) may span several segments. Returns the contiguous text at
+	// beginPosition, which ends at endPosition or the end of its segment, so call again from there for the rest.
+	// Empty if beginPosition is not in the buffer.
+	static Range GetRange(uint64_t beginPosition, uint64_t endPosition);
+
+	// For short text such as a line: the whole of [beginPosition, endPosition), copied into scratch only if it
+	// spans segments
+	static Range GetText(uint64_t beginPosition, uint64_t endPosition, std::string& scratch);
+
+	// Text which stays readable while held, even after the buffer spills or discards it, so that other threads
+	// can read it e.g. for a background search. Only complete lines should be shared, as the current line may
+	// still change. Create and destroy on the main thread; read from any thread.
+	struct Segment;
+	class SharedText
+	{
+	public:
+		uint64_t GetBeginPosition() const { return m_beginPosition; }
+		uint64_t GetEndPosition() const { return m_endPosition; }
+
+		// As OutputBuffer::GetRange, limited to the shared text
+		Range GetRange(uint64_t beginPosition, uint64_t endPosition) const;
+
+	private:
+		friend class OutputBuffer;
+
+		uint64_t m_beginPosition = 0;
+		uint64_t m_endPosition = 0;
+		uint64_t m_firstSegmentNumber = 0;
+		std::vector<std::shared_ptr<const Segment>> m_segments;
+	};
+	static std::shared_ptr<const SharedText> ShareText(uint64_t beginPosition, uint64_t endPosition);
+
+	static Stats GetStats();
+
+	// Total bytes appended since startup, including bytes since discarded. Never decreases, so can
+	// be used to detect new output.
+	static uint64_t GetTotalBytesAppended();
+};
@@ -0,0 +1,352 @@
+#include "OutputExport.h"
+
+#include "HoffGui/OutputBuffer.h"
+
+#include "Core/FileSystem.h" // kMaxPath
+#include "Core/StringHelpers.h"
+#include "Core/hp_assert.h"
+#include "Core/Log.h"
+
+#include <stdio.h>
+#include <string.h> // memchr
+#include <time.h> // localtime
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// TSV lines are gathered into writes of about this size
+static const size_t kWriteSizeBytes = 1024 * 1024;
+
+// How often the worker checks whether it has been cancelled, in lines (TSV) or segments (text)
+static const size_t kCancelCheckLineCount = 4096;
+
+struct ExportJob
+{
+	char path[kMaxPath] = {};
+	char tempPath[kMaxPath] = {}; // renamed to path when complete
+	OutputExport::Format format = OutputExport::Format::Text;
+
+	// Complete lines are shared; the current line may still change, so is copied
+	std::shared_ptr<const OutputBuffer::SharedText> pText;
+	std::string incompleteLine;
+	std::vector<OutputBuffer::Span> spans; // Tsv only
+
+	std::atomic<uint64_t> textBytesDone { 0 }; // for progress
+	std::atomic<bool> cancel { false };
+	std::atomic<bool> done { false };
+	bool ok = false; // written by the worker thread before done
+	uint64_t bytesWritten = 0;
+};
+
+static std::unique_ptr<ExportJob> s_pExportJob;
+static std::thread s_exportThread;
+
+//------------------------------------------------------------------------------------------------
+
+static const char* getLogLevelName(int logLevel)
+{
+	static const char* kLogLevelNames[] = { "none", "error", "warn", "info", "debug", "trace" }; // LOG_LEVEL_MIN to LOG_LEVEL_MAX
+	return kLogLevelNames[Clamp(logLevel, LOG_LEVEL_MIN, LOG_LEVEL_MAX) - LOG_LEVEL_MIN];
+}
+
+static const char* getSourceName(OutputBuffer::Source source)
+{
+	switch (source)
+	{
+	case OutputBuffer::Source::App: return "app";
+	case OutputBuffer::Source::ChildStdout: return "stdout";
+	case OutputBuffer::Source::ChildStderr: return "stderr";
+	}
+	return "";
+}
+
+// e.g. "2024-03-01 14:05:09.123"
+static void appendTimestamp(std::string& out, uint64_t timeMs)
+{
+	// Formatting the date is most of the cost, and consecutive lines are usually within the same second
+	static thread_local uint64_t s_lastSeconds = UINT64_MAX;
+	static thread_local char s_lastDateTime[32];
+
+	const uint64_t seconds = timeMs / 1000;
+	if (seconds != s_lastSeconds)
+	{
+		const time_t time = (time_t)seconds;
+		struct tm localTime = {};
+#ifdef _MSC_VER
+		localtime_s(&localTime, &time);
+#else
+		localtime_r(&time, &localTime);
+#endif
+		strftime(s_lastDateTime, sizeof(s_lastDateTime), "%Y-%m-%d %H:%M:%S", &localTime);
+		s_lastSeconds = seconds;
+	}
+
+	char milliseconds[8];
+	SafeSnprintf(milliseconds, sizeof(milliseconds), ".%03u", (unsigned int)(timeMs % 1000));
+	out += s_lastDateTime;
+	out += milliseconds;
+}
+
+static bool writeBytes(FILE* pFile, ExportJob& job, const char* pBytes, size_t sizeBytes)
+{
+	if (sizeBytes > 0 && fwrite(pBytes, 1, sizeBytes, pFile) != sizeBytes)
+		return false;
+	job.bytesWritten += sizeBytes;
+	return true;
+}
+
+// Segments are written straight from the buffer
+static bool writeText(FILE* pFile, ExportJob& job)
+{
+	const OutputBuffer::SharedText& text = *job.pText;
+	uint64_t position = text.GetBeginPosition();
+	while (position < text.GetEndPosition())
+	{
+		if (job.cancel.load(std::memory_order_relaxed))
+			return false;
+
+		const OutputBuffer::Range range = text.GetRange(position, text.GetEndPosition());
+		if (!writeBytes(pFile, job, range.pBegin, (size_t)(range.pEnd - range.pBegin)))
+			return false;
+		position += (uint64_t)(range.pEnd - range.pBegin);
+		job.textBytesDone.store(position - text.GetBeginPosition(), std::memory_order_relaxed);
+	}
+	return writeBytes(pFile, job, job.incompleteLine.data(), job.incompleteLine.size());
+}
+
+// Backslash escapes, as in e.g. PostgreSQL's text format, so that the text can't split the row or column
+static void appendTsvText(std::string& out, const char* pBegin, const char* pEnd)
+{
+	const char* pUnescaped = pBegin;
+	for (const char* p = pBegin; p < pEnd; p++)
+	{
+		char escaped;
+		switch (*p)
+		{
+		case '\t': escaped = 't'; break;
+		case '\n': escaped = 'n'; break;
+		case '\r': escaped = 'r'; break;
+		case '\\': escaped = '\\'; break;
+		default: continue;
+		}
+		out.append(pUnescaped, p);
+		out += '\\';
+		out += escaped;
+		pUnescaped = p + 1;
+	}
+	out.append(pUnescaped, pEnd);
+}
+
+static void appendTsvLine(std::string& out, const OutputBuffer::Attributes& attributes, const char* pBegin, const char* pEnd)
+{
+	appendTimestamp(out, OutputBuffer::GetStartTime() + attributes.timeMs);
+	out += '\t';
+	out += getLogLevelName(attributes.logLevel);
+	out += '\t';
+	out += getSourceName(attributes.source);
+	out += '\t';
+	appendTsvText(out, pBegin, pEnd);
+	out += '\n';
+}
+
+static bool writeTsv(FILE* pFile, ExportJob& job)
+{
+	const OutputBuffer::SharedText& text = *job.pText;
+	const std::vector<OutputBuffer::Span>& spans = job.spans;
+	size_t spanIndex = 0;
+	uint64_t lineCount = 0;
+
+	std::string out;
+	out.reserve(kWriteSizeBytes + 1024);
+	out += "time\tlevel\tsource\ttext\n";
+
+	// Lines spanning segments are joined in scratch
+	std::string scratch;
+	uint64_t position = text.GetBeginPosition();
+	while (position < text.GetEndPosition())
+	{
+		if ((++lineCount % kCancelCheckLineCount) == 0 && job.cancel.load(std::memory_order_relaxed))
+			return false;
+
+		const uint64_t lineBeginPosition = position;
+		const char* pLineBegin = nullptr;
+		const char* pLineEnd = nullptr;
+		scratch.clear();
+		while (position < text.GetEndPosition())
+		{
+			const OutputBuffer::Range range = text.GetRange(position, text.GetEndPosition());
+			const char* pLF = (const char*)memchr(range.pBegin, '\n', (size_t)(range.pEnd - range.pBegin));
+			const char* pEnd = pLF ? pLF : range.pEnd;
+			if (!pLF || !scratch.empty())
+			{
+				scratch.append(range.pBegin, pEnd);
+				pLineBegin = scratch.data();
+				pLineEnd = scratch.data() + scratch.size();
+			}
+			else
+			{
+				pLineBegin = range.pBegin;
+				pLineEnd = pEnd;
+			}
+			position += (uint64_t)(pEnd - range.pBegin);
+			if (pLF)
+			{
+				position++;
+				break;
+			}
+		}
+
+		while (spanIndex + 1 < spans.size() && spans[spanIndex].endPosition <= lineBeginPosition)
+			spanIndex++;
+		appendTsvLine(out, spans[spanIndex].attributes, pLineBegin, pLineEnd);
+
+		if (out.size() >= kWriteSizeBytes)
+		{
+			if (!writeBytes(pFile, job, out.data(), out.size()))
+				return false;
+			out.clear();
+			job.textBytesDone.store(position - text.GetBeginPosition(), std::memory_order_relaxed);
+		}
+	}
+
+	if (!job.incompleteLine.empty())
+	{
+		const char* pBegin = job.incompleteLine.data();
+		appendTsvLine(out, spans.back().attributes, pBegin, pBegin + job.incompleteLine.size());
+	}
+	return writeBytes(pFile, job, out.data(), out.size());
+}
+
+// After the last LF. Searches from position, which should be near the end e.g. the indexed end position.
+static uint64_t findCurrentLineStart(uint64_t position, uint64_t endPosition)
+{
+	uint64_t lineStartPosition = position;
+	while (position < endPosition)
+	{
+		const OutputBuffer::Range range = OutputBuffer::GetRange(position, endPosition);
+		for (const char* p = range.pBegin; p < range.pEnd; p++)
+		{
+			p = (const char*)memchr(p, '\n', (size_t)(range.pEnd - p));
+			if (!p)
+				break;
+			lineStartPosition = position + (uint64_t)(p - range.pBegin) + 1;
+		}
+		position += (uint64_t)(range.pEnd - range.pBegin);
+	}
+	return lineStartPosition;
+}
+
+static void exportThreadFunc(ExportJob* pJob)
+{
+	FILE* pFile = fopen(pJob->tempPath, "wb");
+	if (pFile)
+	{
+		pJob->ok = pJob->format == OutputExport::Format::Tsv ? writeTsv(pFile, *pJob) : writeText(pFile, *pJob);
+		if (fclose(pFile) != 0)
+			pJob->ok = false;
+		pFile = nullptr;
+
+		// Replaces any existing file, on Windows too
+		std::error_code error;
+		if (pJob->ok)
+			std::filesystem::rename(pJob->tempPath, pJob->path, error);
+		if (!pJob->ok || error)
+		{
+			pJob->ok = false;
+			remove(pJob->tempPath);
+		}
+	}
+	pJob->done.store(true, std::memory_order_release);
+}
+
+//------------------------------------------------------------------------------------------------
+
+void OutputExport::Shutdown()
+{
+	Cancel();
+	Update();
+	HP_ASSERT(!IsRunning());
+}
+
+bool OutputExport::Start(const char* path, Format format, uint64_t searchPosition)
+{
+	HP_ASSERT(path && path[0]);
+	if (s_pExportJob)
+		return false;
+
+	char tempPath[kMaxPath];
+	if (!SafeSnprintf(tempPath, sizeof(tempPath), "%s.tmp", path))
+	{
+		LOG_ERROR("Path too long: %s\n", path);
+		return false;
+	}
+
+	s_pExportJob = std::make_unique<ExportJob>();
+	ExportJob& job = *s_pExportJob;
+	SafeStrcpy(job.path, sizeof(job.path), path);
+	SafeStrcpy(job.tempPath, sizeof(job.tempPath), tempPath);
+	job.format = format;
+
+	// Sharing takes references to the segments rather than copying them
+	const uint64_t beginPosition = OutputBuffer::GetStartPosition();
+	const uint64_t endPosition = OutputBuffer::GetEndPosition();
+	const uint64_t lineStartPosition = findCurrentLineStart(Clamp(searchPosition, beginPosition, endPosition), endPosition);
+	job.pText = OutputBuffer::ShareText(beginPosition, lineStartPosition);
+	std::string scratch;
+	const OutputBuffer::Range range = OutputBuffer::GetText(lineStartPosition, endPosition, scratch);
+	job.incompleteLine.assign(range.pBegin, range.pEnd);
+	if (format == Format::Tsv)
+		OutputBuffer::GetSpans(beginPosition, endPosition, job.spans);
+
+	s_exportThread = std::thread(exportThreadFunc, s_pExportJob.get());
+	return true;
+}
+
+void OutputExport::Cancel()
+{
+	if (s_pExportJob)
+		s_pExportJob->cancel.store(true, std::memory_order_relaxed);
+}
+
+void OutputExport::Update()
+{
+	if (!s_pExportJob)
+		return;
+
+	// Cancelling is quick, so wait for it rather than poll
+	if (!s_pExportJob->done.load(std::memory_order_acquire) && !s_pExportJob->cancel.load(std::memory_order_relaxed))
+		return;
+	s_exportThread.join();
+
+	// Cancelling too late to stop the save doesn't undo it
+	const ExportJob& job = *s_pExportJob;
+	if (job.ok)
+		LOG_INFO("Saved %.1f MB of output to %s\n", (double)job.bytesWritten / (1024.0 * 1024.0), job.path);
+	else if (job.cancel.load(std::memory_order_relaxed))
+		LOG_INFO("Cancelled saving output to %s\n", job.path);
+	else
+		LOG_ERROR("Failed to save output to %s\n", job.path);
+
+	s_pExportJob.reset(); // releases the shared text, so must be on this thread
+}
+
+bool OutputExport::IsRunning()
+{
+	return s_pExportJob != nullptr;
+}
+
+float OutputExport::GetProgress()
+{
+	if (!s_pExportJob)
+		return 0.0f;
+
+	const ExportJob& job = *s_pExportJob;
+	const uint64_t totalBytes = job.pText->GetEndPosition() - job.pText->GetBeginPosition() + job.incompleteLine.size();
+	if (totalBytes == 0)
+		return 1.0f;
+	return (float)((double)job.textBytesDone.load(std::memory_order_relaxed) / (double)totalBytes);
+}
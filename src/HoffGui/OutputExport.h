@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Core/Helpers.h"
+
+#include <stdint.h>
+
+//
+// Saves the Output window's text to a file on a worker thread, so that a multi-gigabyte history neither blocks
+// the UI nor goes through the clipboard. The worker reads the buffer's shared segments directly, in large
+// writes; anything appended meanwhile is not included.
+//
+// Tsv adds a header row and, per line, the timestamp, log level and source of the line's first character.
+// The text is the last column, with tabs, CRs and backslashes escaped as \t, \r and \\.
+//
+// The file is written under a temporary name and renamed when complete, so a cancelled or failed save leaves no
+// partial file, and any existing file is kept.
+//
+class OutputExport
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(OutputExport);
+
+	enum class Format
+	{
+		Text,
+		Tsv,
+	};
+
+	static void Shutdown();
+
+	// Returns false if a save is already running. The current line is found by searching for the last LF from
+	// searchPosition, e.g. OutputIndex::GetIndexedEndPosition(), to save searching the whole buffer.
+	static bool Start(const char* path, Format format, uint64_t searchPosition = 0);
+	static void Cancel();
+
+	// Call once per frame. Logs the result when the save finishes.
+	static void Update();
+
+	static bool IsRunning();
+
+	// 0 to 1
+	static float GetProgress();
+};
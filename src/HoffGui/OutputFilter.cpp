@@ -0,0 +1,343 @@
+#include "OutputFilter.h"
+
+#include "HoffGui/OutputIndex.h"
+
+#include "Core/hp_assert.h"
+#include "Core/Log.h" // LOG_LEVEL_*
+
+#include <ctype.h> // tolower
+#include <string.h> // memchr, memcmp
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Re-filtering less than this is quick enough to do immediately
+static const uint64_t kBackgroundRefilterMinBytes = 1024 * 1024;
+
+// How often the background re-filter checks whether it has been cancelled
+static const size_t kCancelCheckLineCount = 4096;
+
+class Matcher
+{
+public:
+	// Returns false if the regex is invalid, with the reason in error
+	bool Init(const char* pattern, bool matchCase, bool useRegex, std::string& error)
+	{
+		m_pattern = pattern;
+		m_matchCase = matchCase;
+		m_useRegex = useRegex;
+
+		if (m_useRegex)
+		{
+			// std::regex reports errors with exceptions
+			try
+			{
+				std::regex::flag_type flags = std::regex::ECMAScript | std::regex::optimize;
+				if (!m_matchCase)
+					flags |= std::regex::icase;
+				m_regex.assign(m_pattern, flags);
+			}
+			catch (const std::regex_error&)
+			{
+				error = "Invalid regex"; // what() is unhelpful with some standard libraries
+				return false;
+			}
+		}
+		else if (!m_matchCase)
+		{
+			for (char& c : m_pattern)
+				c = (char)tolower((unsigned char)c);
+		}
+		return true;
+	}
+
+	bool IsMatch(const char* pBegin, const char* pEnd) const
+	{
+		if (m_useRegex)
+		{
+			try
+			{
+				return std::regex_search(pBegin, pEnd, m_regex);
+			}
+			catch (const std::regex_error&)
+			{
+				return false; // e.g. too complex for this line
+			}
+		}
+
+		const size_t patternLength = m_pattern.size();
+		if ((size_t)(pEnd - pBegin) < patternLength)
+			return false;
+		const char* pLast = pEnd - patternLength;
+
+		if (m_matchCase)
+		{
+			for (const char* p = pBegin; p <= pLast; p++)
+			{
+				p = (const char*)memchr(p, m_pattern[0], (size_t)(pLast - p) + 1);
+				if (!p)
+					return false;
+				if (memcmp(p, m_pattern.data(), patternLength) == 0)
+					return true;
+			}
+			return false;
+		}
+
+		for (const char* p = pBegin; p <= pLast; p++)
+		{
+			size_t charIndex = 0;
+			while (charIndex < patternLength && tolower((unsigned char)p[charIndex]) == m_pattern[charIndex])
+				charIndex++;
+			if (charIndex == patternLength)
+				return true;
+		}
+		return false;
+	}
+
+private:
+	std::string m_pattern; // lower case if !m_matchCase and !m_useRegex
+	bool m_matchCase = false;
+	bool m_useRegex = false;
+	std::regex m_regex;
+};
+
+struct RefilterJob
+{
+	Matcher matcher;
+
+	// Lines at or below the level filter, and their text. Shared text stays readable however much is appended
+	// meanwhile, so the main thread needn't copy it.
+	std::shared_ptr<const OutputBuffer::SharedText> pText;
+	std::vector<OutputIndex::LineRun> lineRuns;
+	uint64_t firstLineNumber = 0; // at the start of the text
+	uint64_t endLineNumber = 0;
+
+	std::deque<uint64_t> matches; // line numbers, written by the worker thread
+	std::atomic<bool> cancel { false };
+	std::atomic<bool> done { false };
+};
+
+static bool s_active;
+static std::string s_error;
+static Matcher s_matcher;
+static int s_maxLogLevel = LOG_LEVEL_MAX;
+static std::deque<uint64_t> s_matches; // OutputIndex line numbers, ascending
+static uint64_t s_testedEndLineNumber; // lines before this have been tested, unless a re-filter is running
+
+static std::unique_ptr<RefilterJob> s_pRefilterJob;
+static std::thread s_refilterThread;
+
+//------------------------------------------------------------------------------------------------
+
+static bool isLogLevelVisible(int logLevel, int maxLogLevel)
+{
+	return logLevel <= maxLogLevel || logLevel == LOG_LEVEL_NONE;
+}
+
+static void refilterThreadFunc(RefilterJob* pJob)
+{
+	// Walks the lines with memchr rather than looking up each in OutputIndex, which belongs to the main thread.
+	// Lines are joined in scratch only where they span segments.
+	const OutputBuffer::SharedText& text = *pJob->pText;
+	std::string scratch;
+	size_t runIndex = 0;
+	uint64_t lineNumber = pJob->lineRuns.empty() ? pJob->endLineNumber : pJob->lineRuns[0].firstLineNumber;
+	uint64_t position = text.GetBeginPosition();
+	uint64_t lineCount = 0;
+	for (uint64_t walkLineNumber = pJob->firstLineNumber; lineNumber < pJob->endLineNumber; walkLineNumber++)
+	{
+		if ((++lineCount % kCancelCheckLineCount) == 0 && pJob->cancel.load(std::memory_order_relaxed))
+			break;
+
+		// Find the end of the line at position
+		const char* pLineBegin = nullptr;
+		const char* pLineEnd = nullptr;
+		scratch.clear();
+		while (position < text.GetEndPosition())
+		{
+			const OutputBuffer::Range range = text.GetRange(position, text.GetEndPosition());
+			const char* pLF = (const char*)memchr(range.pBegin, '\n', (size_t)(range.pEnd - range.pBegin));
+			const char* pEnd = pLF ? pLF : range.pEnd;
+			if (!pLF || !scratch.empty())
+			{
+				scratch.append(range.pBegin, pEnd);
+				pLineBegin = scratch.data();
+				pLineEnd = scratch.data() + scratch.size();
+			}
+			else
+			{
+				pLineBegin = range.pBegin;
+				pLineEnd = pEnd;
+			}
+			position += (uint64_t)(pEnd - range.pBegin);
+			if (pLF)
+			{
+				position++;
+				break;
+			}
+		}
+
+		if (walkLineNumber != lineNumber)
+			continue; // above the level filter
+		if (pJob->matcher.IsMatch(pLineBegin, pLineEnd))
+			pJob->matches.push_back(lineNumber);
+
+		lineNumber++;
+		if (lineNumber == pJob->lineRuns[runIndex].endLineNumber)
+		{
+			if (++runIndex == pJob->lineRuns.size())
+				break;
+			lineNumber = pJob->lineRuns[runIndex].firstLineNumber;
+		}
+	}
+	pJob->done.store(true, std::memory_order_release);
+}
+
+static void cancelRefilter()
+{
+	if (!s_pRefilterJob)
+		return;
+
+	s_pRefilterJob->cancel.store(true, std::memory_order_relaxed);
+	s_refilterThread.join(); // checks for cancel frequently, so doesn't block for long
+	s_pRefilterJob.reset();
+}
+
+static bool isLineMatch(const Matcher& matcher, uint64_t lineNumber, std::string& scratch)
+{
+	if (!isLogLevelVisible(OutputIndex::GetLineAttributes(lineNumber).logLevel, s_maxLogLevel))
+		return false;
+
+	const OutputBuffer::Range range = OutputIndex::GetLineText(lineNumber, scratch);
+	return matcher.IsMatch(range.pBegin, range.pEnd);
+}
+
+// Tests lines not yet tested against the current filter
+static void testNewLines()
+{
+	std::string scratch;
+	const uint64_t endLineNumber = OutputIndex::GetEndLineNumber();
+	for (uint64_t lineNumber = Max(s_testedEndLineNumber, OutputIndex::GetFirstLineNumber()); lineNumber < endLineNumber; lineNumber++)
+	{
+		if (isLineMatch(s_matcher, lineNumber, scratch))
+			s_matches.push_back(lineNumber);
+	}
+	s_testedEndLineNumber = endLineNumber;
+}
+
+static void startRefilter()
+{
+	const uint64_t firstLineNumber = OutputIndex::GetFirstLineNumber();
+	const uint64_t endLineNumber = OutputIndex::GetEndLineNumber();
+	const uint64_t beginPosition = firstLineNumber < endLineNumber ? OutputIndex::GetLine(firstLineNumber).beginPosition : 0;
+	const uint64_t endPosition = OutputIndex::GetIndexedEndPosition();
+	if (firstLineNumber == endLineNumber || endPosition - beginPosition < kBackgroundRefilterMinBytes)
+	{
+		s_matches.clear();
+		s_testedEndLineNumber = firstLineNumber;
+		testNewLines();
+		return;
+	}
+
+	// The previous filter's matches stay until this finishes, rather than the window emptying meanwhile.
+	// Sharing the text only takes references to its segments, so is quick however large the buffer
+	s_pRefilterJob = std::make_unique<RefilterJob>();
+	s_pRefilterJob->matcher = s_matcher;
+	s_pRefilterJob->pText = OutputBuffer::ShareText(beginPosition, endPosition);
+	OutputIndex::GetLevelLineRuns(s_maxLogLevel, s_pRefilterJob->lineRuns);
+	s_pRefilterJob->firstLineNumber = firstLineNumber;
+	s_pRefilterJob->endLineNumber = endLineNumber;
+	s_refilterThread = std::thread(refilterThreadFunc, s_pRefilterJob.get());
+}
+
+//------------------------------------------------------------------------------------------------
+
+void OutputFilter::Shutdown()
+{
+	cancelRefilter();
+	s_active = false;
+	s_matches.clear();
+}
+
+bool OutputFilter::SetFilter(const char* pattern, bool matchCase, bool useRegex, int maxLogLevel)
+{
+	HP_ASSERT(pattern != nullptr);
+
+	cancelRefilter();
+	s_error.clear();
+	s_active = false;
+
+	if (pattern[0] == '\0')
+	{
+		s_matches.clear();
+		return true;
+	}
+
+	if (!s_matcher.Init(pattern, matchCase, useRegex, s_error))
+	{
+		s_matches.clear();
+		return false;
+	}
+	s_maxLogLevel = maxLogLevel;
+
+	s_active = true;
+	startRefilter();
+	return true;
+}
+
+bool OutputFilter::IsActive()
+{
+	return s_active;
+}
+
+const char* OutputFilter::GetError()
+{
+	return s_error.c_str();
+}
+
+void OutputFilter::Update(bool linesChanged)
+{
+	if (!s_active)
+		return;
+
+	if (s_pRefilterJob && s_pRefilterJob->done.load(std::memory_order_acquire))
+	{
+		s_refilterThread.join();
+		s_matches.swap(s_pRefilterJob->matches);
+		s_testedEndLineNumber = s_pRefilterJob->endLineNumber;
+		s_pRefilterJob.reset(); // releases the shared text, so must be on this thread
+		linesChanged = true; // test lines indexed while it was running
+	}
+
+	if (!linesChanged)
+		return;
+
+	// Forget discarded lines
+	const uint64_t firstLineNumber = OutputIndex::GetFirstLineNumber();
+	while (!s_matches.empty() && s_matches.front() < firstLineNumber)
+		s_matches.pop_front();
+
+	if (!s_pRefilterJob)
+		testNewLines();
+}
+
+bool OutputFilter::IsRefiltering()
+{
+	return s_pRefilterJob != nullptr;
+}
+
+size_t OutputFilter::GetMatchCount()
+{
+	return s_matches.size();
+}
+
+uint64_t OutputFilter::GetMatchLineNumber(size_t matchIndex)
+{
+	HP_ASSERT(matchIndex < s_matches.size());
+	return s_matches[matchIndex];
+}
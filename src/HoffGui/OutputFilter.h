@@ -0,0 +1,42 @@
+#pragma once
+
+#include "HoffGui/OutputBuffer.h"
+
+#include "Core/Helpers.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// Filters the Output window to the lines matching a substring (case-insensitive unless matchCase) or regex,
+// and at or below a log level. For a level filter alone, OutputIndex's per-level lists are quicker.
+//
+// The matches are an index over OutputIndex's line numbers, maintained incrementally: each new line is tested
+// once, when indexed. Changing the filter re-tests every line; for large buffers that runs on a worker thread
+// over the buffer's shared text, so the UI never waits for it. Lines appended meanwhile are tested when it finishes.
+//
+class OutputFilter
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(OutputFilter);
+
+	static void Shutdown();
+
+	// An empty pattern disables the filter. Returns false if the regex is invalid, in which case the filter is
+	// disabled and GetError describes why.
+	static bool SetFilter(const char* pattern, bool matchCase, bool useRegex, int maxLogLevel);
+	static bool IsActive();
+	static const char* GetError();
+
+	// Call once per frame, after OutputIndex::Update
+	static void Update(bool linesChanged);
+
+	// True while a re-filter is running in the background. The matches are those of the previous filter until it
+	// finishes, without lines appended meanwhile.
+	static bool IsRefiltering();
+
+	static size_t GetMatchCount();
+
+	// OutputIndex line number of the match
+	static uint64_t GetMatchLineNumber(size_t matchIndex);
+};
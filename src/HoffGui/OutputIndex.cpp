@@ -0,0 +1,240 @@
+#include "OutputIndex.h"
+
+#include "Core/hp_assert.h"
+#include "Core/Log.h" // LOG_LEVEL_*
+
+#include <string.h> // memchr
+
+#include <algorithm> // std::upper_bound
+#include <deque>
+
+// Line begin positions: for each block of kBlockLineCount lines, the first line's position, and for each line its
+// offset from that. Each line ends at the LF before the next line (or the indexed end position).
+static const unsigned int kBlockLineCount = 64;
+static std::deque<uint64_t> s_blockBeginPositions;
+static std::deque<uint32_t> s_lineOffsets;
+static uint64_t s_firstBlockLineNumber; // of s_lineOffsets.front(); a multiple of kBlockLineCount
+static uint64_t s_firstLineNumber;      // lines before this have been discarded
+static uint64_t s_indexedPosition;      // everything before this has been scanned
+
+// Line numbers at or below each level, for LOG_LEVEL_ERROR to LOG_LEVEL_DEBUG. LOG_LEVEL_TRACE is every line.
+// Stored as runs of consecutive lines, as most lines are usually at the same level as the line before.
+struct LevelRun
+{
+	uint64_t firstLineNumber;
+	uint64_t firstEntryIndex; // lines in the list before this run, including discarded lines
+};
+struct LevelList
+{
+	std::deque<LevelRun> runs;
+	uint64_t entryCount = 0; // including discarded lines
+};
+static const int kMinListLogLevel = LOG_LEVEL_ERROR;
+static const int kMaxListLogLevel = LOG_LEVEL_DEBUG;
+static LevelList s_levelLists[kMaxListLogLevel - kMinListLogLevel + 1];
+
+static uint64_t getEndLineNumber()
+{
+	return s_firstBlockLineNumber + s_lineOffsets.size();
+}
+
+static uint64_t getLineBeginPosition(uint64_t lineNumber)
+{
+	const size_t lineIndex = (size_t)(lineNumber - s_firstBlockLineNumber);
+	return s_blockBeginPositions[lineIndex / kBlockLineCount] + s_lineOffsets[lineIndex];
+}
+
+static uint64_t getRunLineCount(const LevelList& list, size_t runIndex)
+{
+	const uint64_t endEntryIndex = runIndex + 1 < list.runs.size() ? list.runs[runIndex + 1].firstEntryIndex : list.entryCount;
+	return endEntryIndex - list.runs[runIndex].firstEntryIndex;
+}
+
+// Entries for lines before the first line
+static uint64_t getDiscardedEntryCount(const LevelList& list)
+{
+	if (list.runs.empty())
+		return list.entryCount;
+
+	const LevelRun& run = list.runs.front();
+	if (s_firstLineNumber <= run.firstLineNumber)
+		return run.firstEntryIndex;
+	return run.firstEntryIndex + Min(s_firstLineNumber - run.firstLineNumber, getRunLineCount(list, 0));
+}
+
+static void addToLevelList(LevelList& list, uint64_t lineNumber)
+{
+	const size_t runCount = list.runs.size();
+	if (runCount == 0 || list.runs.back().firstLineNumber + getRunLineCount(list, runCount - 1) != lineNumber)
+		list.runs.push_back({ lineNumber, list.entryCount });
+	list.entryCount++;
+}
+
+static void addLine(uint64_t beginPosition)
+{
+	const uint64_t lineNumber = getEndLineNumber();
+	if ((lineNumber % kBlockLineCount) == 0)
+		s_blockBeginPositions.push_back(beginPosition);
+	const uint64_t offset = beginPosition - s_blockBeginPositions.back();
+	s_lineOffsets.push_back((uint32_t)Min(offset, (uint64_t)UINT32_MAX)); // #TODO: Blocks of lines longer than 4 GB
+
+	// LOG_LEVEL_NONE is always logged, so always shown
+	const int logLevel = OutputBuffer::GetAttributes(beginPosition).logLevel;
+	const int minListLogLevel = logLevel == LOG_LEVEL_NONE ? kMinListLogLevel : Max(logLevel, kMinListLogLevel);
+	for (int listLogLevel = minListLogLevel; listLogLevel <= kMaxListLogLevel; listLogLevel++)
+		addToLevelList(s_levelLists[listLogLevel - kMinListLogLevel], lineNumber);
+}
+
+static const LevelList* getLevelList(int maxLogLevel)
+{
+	if (maxLogLevel > kMaxListLogLevel)
+		return nullptr; // every line
+	return &s_levelLists[Max(maxLogLevel, kMinListLogLevel) - kMinListLogLevel];
+}
+
+void OutputIndex::Shutdown()
+{
+	s_blockBeginPositions.clear();
+	s_blockBeginPositions.shrink_to_fit();
+	s_lineOffsets.clear();
+	s_lineOffsets.shrink_to_fit();
+	for (LevelList& list : s_levelLists)
+	{
+		list.runs.clear();
+		list.runs.shrink_to_fit();
+	}
+}
+
+bool OutputIndex::Update()
+{
+	bool changed = false;
+
+	// Forget lines the buffer has discarded
+	const uint64_t startPosition = OutputBuffer::GetStartPosition();
+	const uint64_t endLineNumber = getEndLineNumber();
+	while (s_firstLineNumber < endLineNumber && getLineBeginPosition(s_firstLineNumber) < startPosition)
+	{
+		s_firstLineNumber++;
+		changed = true;
+	}
+	while (s_firstLineNumber - s_firstBlockLineNumber >= kBlockLineCount)
+	{
+		s_blockBeginPositions.pop_front();
+		s_lineOffsets.erase(s_lineOffsets.begin(), s_lineOffsets.begin() + kBlockLineCount);
+		s_firstBlockLineNumber += kBlockLineCount;
+	}
+	for (LevelList& list : s_levelLists)
+	{
+		while (!list.runs.empty() && list.runs.front().firstLineNumber + getRunLineCount(list, 0) <= s_firstLineNumber)
+			list.runs.pop_front();
+	}
+	if (s_indexedPosition < startPosition)
+		s_indexedPosition = startPosition; // a partial line was discarded e.g. by OutputBuffer::Clear
+
+	// Scan new text for complete lines. n.b. OutputBuffer removes the CR of CR LF pairs.
+	const uint64_t endPosition = OutputBuffer::GetEndPosition();
+	HP_ASSERT(endPosition >= s_indexedPosition); // CR never moves back over a LF
+	uint64_t lineBeginPosition = s_indexedPosition;
+	uint64_t position = s_indexedPosition;
+	while (position < endPosition)
+	{
+		const OutputBuffer::Range range = OutputBuffer::GetRange(position, endPosition);
+		const char* pBegin = range.pBegin;
+		const char* pEnd = range.pEnd;
+		for (const char* p = pBegin; p < pEnd; p++)
+		{
+			p = (const char*)memchr(p, '\n', (size_t)(pEnd - p));
+			if (!p)
+				break;
+
+			addLine(lineBeginPosition);
+			lineBeginPosition = position + (uint64_t)(p - pBegin) + 1;
+			changed = true;
+		}
+		position += (uint64_t)(pEnd - pBegin);
+	}
+	s_indexedPosition = lineBeginPosition;
+
+	return changed;
+}
+
+uint64_t OutputIndex::GetFirstLineNumber()
+{
+	return s_firstLineNumber;
+}
+
+uint64_t OutputIndex::GetEndLineNumber()
+{
+	return getEndLineNumber();
+}
+
+OutputIndex::Line OutputIndex::GetLine(uint64_t lineNumber)
+{
+	HP_ASSERT(lineNumber >= s_firstLineNumber && lineNumber < GetEndLineNumber());
+	const uint64_t beginPosition = getLineBeginPosition(lineNumber);
+	const uint64_t nextBeginPosition = lineNumber + 1 < GetEndLineNumber() ? getLineBeginPosition(lineNumber + 1) : s_indexedPosition;
+	return { beginPosition, nextBeginPosition - beginPosition - 1 }; // excluding the LF
+}
+
+OutputBuffer::Attributes OutputIndex::GetLineAttributes(uint64_t lineNumber)
+{
+	HP_ASSERT(lineNumber >= s_firstLineNumber && lineNumber < GetEndLineNumber());
+	return OutputBuffer::GetAttributes(getLineBeginPosition(lineNumber));
+}
+
+size_t OutputIndex::GetLevelLineCount(int maxLogLevel)
+{
+	const LevelList* pList = getLevelList(maxLogLevel);
+	if (!pList)
+		return (size_t)(GetEndLineNumber() - s_firstLineNumber);
+	return (size_t)(pList->entryCount - getDiscardedEntryCount(*pList));
+}
+
+uint64_t OutputIndex::GetLevelLineNumber(int maxLogLevel, size_t index)
+{
+	HP_ASSERT(index < GetLevelLineCount(maxLogLevel));
+	const LevelList* pList = getLevelList(maxLogLevel);
+	if (!pList)
+		return s_firstLineNumber + index;
+
+	// Last run starting at or before the entry
+	const uint64_t entryIndex = getDiscardedEntryCount(*pList) + index;
+	auto it = std::upper_bound(pList->runs.cbegin(), pList->runs.cend(), entryIndex,
+		[](uint64_t entry, const LevelRun& run) { return entry < run.firstEntryIndex; });
+	HP_ASSERT(it != pList->runs.cbegin());
+	--it;
+	return it->firstLineNumber + (entryIndex - it->firstEntryIndex);
+}
+
+void OutputIndex::GetLevelLineRuns(int maxLogLevel, std::vector<LineRun>& lineRuns)
+{
+	lineRuns.clear();
+	const LevelList* pList = getLevelList(maxLogLevel);
+	if (!pList)
+	{
+		if (s_firstLineNumber < GetEndLineNumber())
+			lineRuns.push_back({ s_firstLineNumber, GetEndLineNumber() });
+		return;
+	}
+
+	lineRuns.reserve(pList->runs.size());
+	for (size_t runIndex = 0; runIndex < pList->runs.size(); runIndex++)
+	{
+		const LevelRun& run = pList->runs[runIndex];
+		const uint64_t firstLineNumber = Max(run.firstLineNumber, s_firstLineNumber);
+		const uint64_t endLineNumber = run.firstLineNumber + getRunLineCount(*pList, runIndex);
+		if (firstLineNumber < endLineNumber)
+			lineRuns.push_back({ firstLineNumber, endLineNumber });
+	}
+}
+
+uint64_t OutputIndex::GetIndexedEndPosition()
+{
+	return s_indexedPosition;
+}
+
+OutputBuffer::Range OutputIndex::GetLineText(uint64_t lineNumber, std::string& scratch)
+{
+	const Line line = GetLine(lineNumber);
+	return OutputBuffer::GetText(line.beginPosition, line.beginPosition + line.length, scratch);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "HoffGui/OutputBuffer.h"
+
+#include "Core/Helpers.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+//
+// Index of the complete lines in OutputBuffer, maintained incrementally: each line is scanned once, when
+// Update first sees it, and forgotten when the buffer discards it.
+//
+// Line numbers count from the first line since startup, so remain valid as older lines are discarded.
+// The current incomplete line (no LF yet) is not indexed.
+//
+// Covers the whole buffer, spilled or in memory, so is compact: about 4 bytes per line. Attributes (level,
+// source, time) are looked up from the buffer at the start of each line. For level filtering there is also a
+// list of the lines at or below each level, as runs of consecutive lines, so filtered lines can be found in
+// O(log n) by index.
+//
+class OutputIndex
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(OutputIndex);
+
+	struct Line
+	{
+		uint64_t beginPosition; // OutputBuffer position
+		uint64_t length;        // excluding the EOL
+	};
+
+	static void Shutdown();
+
+	// Call once per frame, after anything appended to OutputBuffer in the frame. Returns true if lines were added
+	// or removed.
+	static bool Update();
+
+	// Lines [GetFirstLineNumber(), GetEndLineNumber()) are indexed
+	static uint64_t GetFirstLineNumber();
+	static uint64_t GetEndLineNumber();
+
+	static Line GetLine(uint64_t lineNumber);
+	static OutputBuffer::Attributes GetLineAttributes(uint64_t lineNumber);
+
+	// Lines at or below maxLogLevel, i.e. more important. LOG_LEVEL_NONE lines are always included.
+	// For LOG_LEVEL_MAX, every line.
+	static size_t GetLevelLineCount(int maxLogLevel);
+	static uint64_t GetLevelLineNumber(int maxLogLevel, size_t index);
+
+	// As above, as runs of consecutive lines, for visiting many lines without a lookup for each
+	struct LineRun
+	{
+		uint64_t firstLineNumber;
+		uint64_t endLineNumber;
+	};
+	static void GetLevelLineRuns(int maxLogLevel, std::vector<LineRun>& lineRuns);
+
+	// Position after the last complete line i.e. the start of the incomplete line, if any
+	static uint64_t GetIndexedEndPosition();
+
+	// Text of the line excluding the EOL, copied into scratch only if it spans buffer segments
+	static OutputBuffer::Range GetLineText(uint64_t lineNumber, std::string& scratch);
+};
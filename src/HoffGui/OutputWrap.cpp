@@ -0,0 +1,137 @@
+#include "OutputWrap.h"
+
+#include "HoffGui/OutputIndex.h"
+
+#include "Core/hp_assert.h"
+
+#include "ImGuiWrap/ImGuiWrap.h"
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+static ImFont* s_pFont;
+static float s_fontSize;
+static float s_wrapWidth;
+static float s_maxAdvanceX; // widest glyph at s_fontSize, so lines shorter than s_wrapWidth / s_maxAdvanceX can't wrap
+
+// Row count per line from s_firstLineNumber, or 0 if not measured yet
+static std::deque<uint32_t> s_rowCounts;
+static uint64_t s_firstLineNumber;
+
+// Offsets from the line's begin position of its second and later rows, for lines with more than one row
+static std::map<uint64_t, std::vector<uint32_t>> s_rowBeginOffsets;
+
+static void clear()
+{
+	s_rowCounts.clear();
+	s_rowBeginOffsets.clear();
+}
+
+static float getMaxAdvanceX(const ImFont* pFont)
+{
+	float maxAdvanceX = pFont->FallbackAdvanceX;
+	for (const float advanceX : pFont->IndexAdvanceX)
+		maxAdvanceX = Max(maxAdvanceX, advanceX);
+	return maxAdvanceX;
+}
+
+static unsigned int measureLine(uint64_t lineNumber)
+{
+	const OutputIndex::Line line = OutputIndex::GetLine(lineNumber);
+	if ((float)line.length * s_maxAdvanceX <= s_wrapWidth)
+		return 1; // too short to wrap. n.b. Glyphs are at least a byte each.
+
+	std::string scratch;
+	const OutputBuffer::Range range = OutputIndex::GetLineText(lineNumber, scratch);
+	const float scale = s_fontSize / s_pFont->FontSize;
+
+	// Same breaks as ImGui's wrapped text: at the last word that fits (or character, if a word doesn't fit),
+	// skipping blanks at the start of the next row
+	std::vector<uint32_t> rowBeginOffsets;
+	const char* p = range.pBegin;
+	while (true)
+	{
+		p = s_pFont->CalcWordWrapPositionA(scale, p, range.pEnd, s_wrapWidth);
+		while (p < range.pEnd && (*p == ' ' || *p == '\t'))
+			p++;
+		if (p >= range.pEnd)
+			break;
+		rowBeginOffsets.push_back((uint32_t)(p - range.pBegin));
+	}
+
+	const unsigned int rowCount = (unsigned int)rowBeginOffsets.size() + 1;
+	if (rowCount > 1)
+		s_rowBeginOffsets[lineNumber] = std::move(rowBeginOffsets);
+	return rowCount;
+}
+
+void OutputWrap::Shutdown()
+{
+	clear();
+	s_rowCounts.shrink_to_fit();
+	s_pFont = nullptr;
+}
+
+bool OutputWrap::SetLayout(ImFont* pFont, float fontSize, float wrapWidth)
+{
+	HP_ASSERT(pFont != nullptr);
+	wrapWidth = Max(wrapWidth, 1.0f);
+	if (pFont == s_pFont && fontSize == s_fontSize && wrapWidth == s_wrapWidth)
+		return false;
+
+	s_pFont = pFont;
+	s_fontSize = fontSize;
+	s_wrapWidth = wrapWidth;
+	s_maxAdvanceX = getMaxAdvanceX(pFont) * fontSize / pFont->FontSize;
+	clear();
+	return true;
+}
+
+void OutputWrap::Update()
+{
+	const uint64_t firstLineNumber = OutputIndex::GetFirstLineNumber();
+	if (firstLineNumber <= s_firstLineNumber)
+		return;
+
+	const uint64_t discardCount = firstLineNumber - s_firstLineNumber;
+	if (discardCount >= s_rowCounts.size())
+		s_rowCounts.clear();
+	else
+		s_rowCounts.erase(s_rowCounts.begin(), s_rowCounts.begin() + (ptrdiff_t)discardCount);
+	s_rowBeginOffsets.erase(s_rowBeginOffsets.begin(), s_rowBeginOffsets.lower_bound(firstLineNumber));
+	s_firstLineNumber = firstLineNumber;
+}
+
+unsigned int OutputWrap::GetRowCount(uint64_t lineNumber)
+{
+	HP_ASSERT(s_pFont != nullptr);
+	HP_ASSERT(lineNumber >= s_firstLineNumber && lineNumber < OutputIndex::GetEndLineNumber());
+
+	const size_t lineIndex = (size_t)(lineNumber - s_firstLineNumber);
+	if (lineIndex >= s_rowCounts.size())
+		s_rowCounts.resize(lineIndex + 1, 0);
+	uint32_t& rowCount = s_rowCounts[lineIndex];
+	if (rowCount == 0)
+		rowCount = measureLine(lineNumber);
+	return rowCount;
+}
+
+void OutputWrap::GetRowPositions(uint64_t lineNumber, unsigned int rowIndex, uint64_t& beginPosition, uint64_t& endPosition)
+{
+	const unsigned int rowCount = GetRowCount(lineNumber);
+	HP_ASSERT(rowIndex < rowCount);
+
+	const OutputIndex::Line line = OutputIndex::GetLine(lineNumber);
+	beginPosition = line.beginPosition;
+	endPosition = line.beginPosition + line.length;
+	if (rowCount == 1)
+		return;
+
+	const std::vector<uint32_t>& rowBeginOffsets = s_rowBeginOffsets.at(lineNumber);
+	if (rowIndex > 0)
+		beginPosition = line.beginPosition + rowBeginOffsets[rowIndex - 1];
+	if (rowIndex + 1 < rowCount)
+		endPosition = line.beginPosition + rowBeginOffsets[rowIndex];
+}
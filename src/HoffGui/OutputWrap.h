@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Core/Helpers.h"
+
+#include <stdint.h>
+
+struct ImFont;
+
+//
+// Word wrap layout of the Output window's lines: how many rows each line wraps to, and where each row begins.
+// Each line is measured once, when first needed, and the result kept until the font, its size (e.g. zoom) or
+// the wrap width changes. Most lines are too short to wrap, which is detected from their length without
+// measuring; only the break positions of lines that do wrap are stored.
+//
+class OutputWrap
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(OutputWrap);
+
+	static void Shutdown();
+
+	// Call each frame before the functions below. Returns true (and forgets every line's layout) if the
+	// layout has changed.
+	static bool SetLayout(ImFont* pFont, float fontSize, float wrapWidth);
+
+	// Call once per frame, after OutputIndex::Update, to forget discarded lines
+	static void Update();
+
+	// OutputIndex line
+	static unsigned int GetRowCount(uint64_t lineNumber);
+
+	// OutputBuffer positions of [beginPosition, endPosition) of the row, which may include blanks at the end
+	static void GetRowPositions(uint64_t lineNumber, unsigned int rowIndex, uint64_t& beginPosition, uint64_t& endPosition);
+};
@@ -1,71 +1,374 @@
 #include "ModWindow.h"
 
-#include "Mod/ModFile.h"
+#include "Mod/ModDocument.h"
+#include "Mod/ModDocuments.h"
+#include "Mod/ModFileReader.h"
+#include "Mod/ModLoader.h"
+#include "Mod/ModSaver.h"
+#include "Mod/ModScanner.h"
+#include "Mod/ModWatcher.h"
+
+#include "HoffGui/RecentFiles.h"
 
 #include "Core/Log.h"
 #include "Core/FileSystem.h"
 #include "Core/StringHelpers.h"
+#include "Core/hp_assert.h"
 
 #include "ImGuiWrap/ImGuiWrap.h"
 
+#include <limits.h> // INT_MAX
+
+#include <algorithm> // std::lower_bound
+#include <vector>
+
 static bool s_visible = false;
-static char s_windowName[256];
+static ModDocumentHandle s_focusHandle = kInvalidModDocumentHandle;
+static ImGuiID s_dockId = 0; // where MOD windows were last docked, for new document windows
+
+static const unsigned int kBytesPerRow = 16;
+
+// Rows changed by another program are highlighted after reloading, fading out over this long
+static const float kChangeHighlightSeconds = 3.0f;
 
 void ModWindow::Init()
 {
-	SafeStrcpy(s_windowName, sizeof(s_windowName), kWindowName);
 }
 
 void ModWindow::Shutdown()
 {
-	
+	ModLoader::Shutdown();
+	ModSaver::Shutdown();
+	ModScanner::Shutdown();
+	ModWatcher::Shutdown();
+	s_focusHandle = kInvalidModDocumentHandle;
+	s_dockId = 0;
+}
+
+static bool isRowChanged(const std::vector<FileWriter::Range>& changedRanges, uint64_t rowOffset, unsigned int rowSizeBytes)
+{
+	// First range ending after the row starts
+	const std::vector<FileWriter::Range>::const_iterator it = std::upper_bound(changedRanges.begin(), changedRanges.end(), rowOffset,
+		[](uint64_t offset, const FileWriter::Range& range) { return offset < range.offset + range.sizeBytes; });
+	return it != changedRanges.end() && it->offset < rowOffset + rowSizeBytes;
 }
 
-static void showContents()
+// Hex dump of the visible rows only, read through GetRange, so that large modules cost no more per frame than small
+// ones, and windowed modules only page in what is shown
+static void showContents(ModDocumentHandle handle, ModDocument& document)
 {
-	if (!ModFile::IsLoaded())
+	const uint64_t dataSizeBytes = document.GetDataSizeBytes();
+
+	float secondsSinceReload = 0.0f;
+	const std::vector<FileWriter::Range>* pChangedRanges = ModWatcher::GetLastChangedRanges(handle, secondsSinceReload);
+	if (secondsSinceReload >= kChangeHighlightSeconds)
+		pChangedRanges = nullptr;
+	const ImU32 highlightColor = ImGui::GetColorU32(ImGuiCol_TextSelectedBg, 1.0f - secondsSinceReload / kChangeHighlightSeconds);
+
+	// #TODO: The clipper counts rows in an int, so only the first 32 GB of larger files can be shown
+	const uint64_t rowCount = Min((dataSizeBytes + kBytesPerRow - 1) / kBytesPerRow, (uint64_t)INT_MAX);
+	ImGuiListClipper clipper;
+	clipper.Begin((int)rowCount);
+	while (clipper.Step())
+	{
+		const uint64_t firstRowOffset = (uint64_t)clipper.DisplayStart * kBytesPerRow;
+		const ModBufferView rows = document.GetRange(firstRowOffset, (size_t)(clipper.DisplayEnd - clipper.DisplayStart) * kBytesPerRow);
+		if (!rows.IsValid())
+		{
+			ImGui::Text("Failed to read %s", document.GetPath());
+			return;
+		}
+
+		for (int rowIndex = clipper.DisplayStart; rowIndex < clipper.DisplayEnd; rowIndex++)
+		{
+			static const char kHexDigits[] = "0123456789ABCDEF";
+			char row[kBytesPerRow * 3];
+			const uint64_t rowOffset = (uint64_t)rowIndex * kBytesPerRow;
+			const size_t rowOffsetInRange = (size_t)(rowOffset - firstRowOffset);
+			const unsigned int rowSizeBytes = (unsigned int)Min((size_t)kBytesPerRow, rows.GetSizeBytes() - Min(rowOffsetInRange, rows.GetSizeBytes()));
+			if (rowSizeBytes == 0)
+				break; // a windowed file truncated since it was opened reads short, until reopened
+			for (unsigned int i = 0; i < rowSizeBytes; i++)
+			{
+				const uint8_t byte = rows.GetData()[rowOffsetInRange + i];
+				row[i * 3 + 0] = kHexDigits[byte >> 4];
+				row[i * 3 + 1] = kHexDigits[byte & 0xf];
+				row[i * 3 + 2] = ' ';
+			}
+			if (pChangedRanges && isRowChanged(*pChangedRanges, rowOffset, rowSizeBytes))
+			{
+				const ImVec2 position = ImGui::GetCursorScreenPos();
+				const ImVec2 size = ImGui::CalcTextSize(row, row + rowSizeBytes * 3 - 1);
+				ImGui::GetWindowDrawList()->AddRectFilled(position, ImVec2(position.x + size.x, position.y + size.y), highlightColor);
+			}
+			ImGui::TextUnformatted(row, row + rowSizeBytes * 3 - 1);
+		}
+	}
+}
+
+static void rememberDockId()
+{
+	const ImGuiID dockId = ImGui::GetWindowDockID();
+	if (dockId != 0)
+		s_dockId = dockId;
+}
+
+static void showPlaceholderWindow()
+{
+	if (ImGui::Begin(ModWindow::kWindowName, &s_visible))
 		ImGui::Text("No file loaded");
+	rememberDockId();
+	ImGui::End();
+}
+
+static void showLoadingWindow()
+{
+	char filename[256];
+	FileSystem::FilenameWithExtensionFromPath(ModLoader::GetPath(), filename, sizeof(filename));
+	char windowName[sizeof(filename) + 32];
+	SafeSnprintf(windowName, sizeof(windowName), "%s (loading)###MODLOADING", filename);
 
-	const uint8_t* pData = ModFile::GetData();
-	const unsigned int dataSizeBytes = ModFile::GetDataSizeBytes();
-	unsigned int i = 0;
-	while (i < dataSizeBytes)
+	if (s_dockId != 0)
+		ImGui::SetNextWindowDockID(s_dockId, ImGuiCond_FirstUseEver);
+
+	bool open = true;
+	if (ImGui::Begin(windowName, &open))
 	{
-		ImGui::Text("%02X", pData[i]);
-		i++;
-		if (i & 0xf)
-			ImGui::SameLine();
+		ImGui::TextUnformatted(ModLoader::GetPath());
+		char overlay[64];
+		SafeSnprintf(overlay, sizeof(overlay), "%.1f / %.1f MB", (double)ModLoader::GetBytesRead() / (1024.0 * 1024.0), (double)ModLoader::GetSizeBytes() / (1024.0 * 1024.0));
+		ImGui::ProgressBar(ModLoader::GetProgress(), VEC2_96_PPI(300.0f, 0.0f), overlay);
+		if (ImGui::Button("Cancel"))
+			open = false;
 	}
+	rememberDockId();
+	ImGui::End();
+
+	if (!open)
+		ModLoader::Cancel();
 }
 
-void ModWindow::Update()
+// Lists the files in a zip archive, to choose one to load
+static void showArchiveWindow()
 {
-	if (!s_visible)
-		return;
+	char filename[256];
+	FileSystem::FilenameWithExtensionFromPath(ModLoader::GetArchivePath(), filename, sizeof(filename));
+	char windowName[sizeof(filename) + 32];
+	SafeSnprintf(windowName, sizeof(windowName), "%s###MODARCHIVE", filename);
 
-	if (!ImGui::Begin(s_windowName, &s_visible))
+	if (s_dockId != 0)
+		ImGui::SetNextWindowDockID(s_dockId, ImGuiCond_FirstUseEver);
+
+	bool open = true;
+	const char* chosenName = nullptr;
+	if (ImGui::Begin(windowName, &open))
 	{
-		ImGui::End();
-		return;
+		ImGui::TextUnformatted("Choose a file to open:");
+		for (const ModFileReader::ArchiveMember& member : ModLoader::GetArchiveMembers())
+		{
+			char label[kMaxPath + 32];
+			SafeSnprintf(label, sizeof(label), "%s (%llu bytes)", member.name, (unsigned long long)member.sizeBytes);
+			if (ImGui::Selectable(label))
+				chosenName = member.name;
+		}
 	}
+	rememberDockId();
+	ImGui::End();
 
-	showContents();
+	if (chosenName)
+	{
+		char path[kMaxPath];
+		ModFileReader::MakeMemberPath(path, sizeof(path), ModLoader::GetArchivePath(), chosenName);
+		ModWindow::Open(path); // clears the list
+	}
+	else if (!open)
+		ModLoader::ClearArchiveMembers();
+}
 
+// Progress of a scan for embedded modules, then the modules found, to extract
+static void showScanWindow()
+{
+	const ModDocument* pScannedDocument = ModDocuments::Get(ModScanner::GetDocumentHandle());
+	char filename[256];
+	if (pScannedDocument && pScannedDocument->GetPath()[0])
+		FileSystem::FilenameWithExtensionFromPath(pScannedDocument->GetPath(), filename, sizeof(filename));
+	else
+		SafeStrcpy(filename, sizeof(filename), pScannedDocument ? "Untitled" : "closed file");
+	char windowName[sizeof(filename) + 32];
+	SafeSnprintf(windowName, sizeof(windowName), "Modules in %s###MODSCAN", filename);
+
+	if (s_dockId != 0)
+		ImGui::SetNextWindowDockID(s_dockId, ImGuiCond_FirstUseEver);
+
+	bool open = true;
+	const ModScanner::Hit* pChosenHit = nullptr;
+	if (ImGui::Begin(windowName, &open))
+	{
+		if (ModScanner::IsRunning())
+		{
+			ImGui::ProgressBar(ModScanner::GetProgress(), VEC2_96_PPI(300.0f, 0.0f));
+			if (ImGui::Button("Cancel"))
+				open = false;
+		}
+		else if (ModScanner::GetHits().empty())
+			ImGui::TextUnformatted("No modules found");
+		else
+		{
+			ImGui::Text("%u module(s) found. Choose one to open a copy of it:", (unsigned int)ModScanner::GetHits().size());
+			for (const ModScanner::Hit& hit : ModScanner::GetHits())
+			{
+				char label[128];
+				SafeSnprintf(label, sizeof(label), "0x%08llx  %s %2uch  %s (%llu bytes%s)###0x%llx", (unsigned long long)hit.offset, hit.signature, hit.channelCount,
+					hit.title[0] ? hit.title : "Untitled", (unsigned long long)hit.sizeBytes, hit.truncated ? ", truncated" : "", (unsigned long long)hit.offset);
+				if (ImGui::Selectable(label))
+					pChosenHit = &hit;
+			}
+		}
+	}
+	rememberDockId();
 	ImGui::End();
+
+	if (pChosenHit)
+	{
+		const ModDocumentHandle extractedHandle = ModScanner::Extract(*pChosenHit);
+		if (extractedHandle != kInvalidModDocumentHandle)
+			ModWindow::Focus(extractedHandle);
+	}
+	else if (!open)
+	{
+		ModScanner::Cancel();
+		ModScanner::ClearHits();
+	}
 }
 
-void ModWindow::SetFilePath(const char* path)
+static void showDocumentTooltip(ModDocument& document)
 {
-	if (path && path[0])
+	ImGui::BeginTooltip();
+	ImGui::TextUnformatted(document.GetPath()[0] ? document.GetPath() : "Untitled");
+	ImGui::Text("%llu bytes", (unsigned long long)document.GetDataSizeBytes());
+	if (document.IsWindowed())
+		ImGui::TextUnformatted("Too large to load, so read from file as shown");
+
+	// Hashes only the blocks edited since last shown
+	ContentHash::Hash128 hash;
+	if (document.GetContentHash(hash))
 	{
-		char filename[256];
-		FileSystem::FilenameWithExtensionFromPath(path, filename, sizeof(filename));
-		SafeSnprintf(s_windowName, sizeof(s_windowName), "%s###MOD", filename);
+		char hashString[ContentHash::kHexStringSize];
+		ContentHash::ToHexString(hash, hashString, sizeof(hashString));
+		ImGui::Text("Content hash: %s", hashString);
 	}
 	else
+		ImGui::TextUnformatted("Content hash: unavailable");
+	ImGui::EndTooltip();
+}
+
+// Returns false if the window was closed
+static bool showDocumentWindow(ModDocumentHandle handle)
+{
+	ModDocument* pDocument = ModDocuments::Get(handle);
+	HP_ASSERT(pDocument);
+
+	char filename[256];
+	const char* path = pDocument->GetPath();
+	if (path[0])
+		FileSystem::FilenameWithExtensionFromPath(path, filename, sizeof(filename));
+	else
+		SafeStrcpy(filename, sizeof(filename), "Untitled");
+	char windowName[sizeof(filename) + 32];
+	SafeSnprintf(windowName, sizeof(windowName), "%s%s%s%s###MOD%u", filename, pDocument->IsModified() ? "*" : "", pDocument->IsReadOnly() ? " (read-only)" : "", ModSaver::IsSaving(handle) ? " (saving)" : "", handle);
+
+	if (s_dockId != 0)
+		ImGui::SetNextWindowDockID(s_dockId, ImGuiCond_FirstUseEver);
+	if (handle == s_focusHandle)
+	{
+		ImGui::SetNextWindowFocus();
+		s_focusHandle = kInvalidModDocumentHandle;
+	}
+
+	bool open = true;
+	const bool expanded = ImGui::Begin(windowName, &open);
+
+	// The title bar, or the tab when docked
+	if (ImGui::IsItemHovered(ImGuiHoveredFlags_ForTooltip))
+		showDocumentTooltip(*pDocument);
+
+	if (expanded)
+	{
+		if (ImGui::IsWindowFocused(ImGuiFocusedFlags_RootAndChildWindows))
+			ModDocuments::SetActive(handle);
+
+		// Only documents that are shown are used, so hidden tabs can be evicted
+		showContents(handle, *pDocument);
+	}
+	rememberDockId();
+	ImGui::End();
+
+	return open;
+}
+
+void ModWindow::Update()
+{
+	ModSaver::Update();
+	ModScanner::Update();
+	ModWatcher::Update();
+
+	const ModDocumentHandle loadedHandle = ModLoader::Update();
+	if (loadedHandle != kInvalidModDocumentHandle)
+	{
+		Focus(loadedHandle);
+		RecentFiles::Add(ModDocuments::Get(loadedHandle)->GetPath());
+	}
+
+	if (!s_visible)
+		return;
+
+	if (ModLoader::IsRunning())
+		showLoadingWindow();
+	const bool showingArchive = !ModLoader::GetArchiveMembers().empty();
+	if (showingArchive)
+		showArchiveWindow();
+	if (ModScanner::GetDocumentHandle() != kInvalidModDocumentHandle)
+		showScanWindow();
+
+	const unsigned int documentCount = ModDocuments::GetCount();
+	if (documentCount == 0)
+	{
+		if (!ModLoader::IsRunning() && !showingArchive)
+			showPlaceholderWindow();
+		return;
+	}
+
+	std::vector<ModDocumentHandle> closedHandles;
+	for (unsigned int documentIndex = 0; documentIndex < documentCount; documentIndex++)
 	{
-		SafeStrcpy(s_windowName, sizeof(s_windowName), kWindowName);
+		const ModDocumentHandle handle = ModDocuments::GetHandle(documentIndex);
+		if (!showDocumentWindow(handle))
+			closedHandles.push_back(handle);
 	}
+	for (ModDocumentHandle handle : closedHandles)
+		ModDocuments::Close(handle);
+}
+
+void ModWindow::Open(const char* path)
+{
+	ModLoader::ClearArchiveMembers();
+
+	const ModDocumentHandle handle = ModDocuments::Find(path);
+	if (handle != kInvalidModDocumentHandle)
+	{
+		ModDocuments::SetActive(handle);
+		Focus(handle);
+		return;
+	}
+
+	ModLoader::Start(path);
+	s_visible = true;
+}
+
+void ModWindow::Focus(ModDocumentHandle handle)
+{
+	s_focusHandle = handle;
+	s_visible = true;
 }
 
 bool ModWindow::IsVisible()
@@ -80,5 +383,5 @@ void ModWindow::SetVisible(bool visible)
 
 const char* ModWindow::GetWindowName()
 {
-	return s_windowName;
+	return kWindowName;
 }
@@ -1,7 +1,14 @@
 #pragma once
 
+#include "Mod/ModDocuments.h" // ModDocumentHandle
+
 #include "Core/Helpers.h"
 
+//
+// One window per open document (see ModDocuments), docked together, or a placeholder window when none are open.
+// A module being loaded (see ModLoader) gets a window showing progress, replaced by the document's when complete.
+// A scan for embedded modules (see ModScanner) gets a window listing those found.
+//
 class ModWindow
 {
 public:
@@ -10,16 +17,22 @@ public:
 
 	// So can replace visible section but keep hash the same. 
 	// n.b For "label###id" the "###" is included in the hash(!) but only "label" gets displayed. See ImHashStr comment.
+	// The placeholder window's name. Document windows are "filename###MOD<handle>".
 	static constexpr char kWindowName[] = "MOD###MOD";
 
 	static void Init();
 	static void Shutdown();
 
-	// Call once per frame
+	// Call once per frame, whether visible or not
 	static void Update();
 
-	static void SetFilePath(const char* path);
+	// Loads on a worker thread, superseding any load in progress. Focuses the document if it's already open.
+	static void Open(const char* path);
+
+	// Brings the document's window to the front next frame
+	static void Focus(ModDocumentHandle handle);
 
+	// All MOD windows
 	static bool IsVisible();
 	static void SetVisible(bool visible);
 
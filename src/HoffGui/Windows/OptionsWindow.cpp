@@ -1,8 +1,12 @@
 #include "OptionsWindow.h"
 
 #include "HoffGui/Dialogues/FileDialogue.h"
+#include "HoffGui/OutputBuffer.h"
 #include "HoffGui/Options.h"
+#include "Mod/ModDocuments.h"
 
+#include "Core/ToolCache.h"
+#include "Core/WorkerPool.h"
 #include "Core/StringHelpers.h"
 #include "Core/Log.h"
 
@@ -14,10 +18,14 @@ static bool s_focus;
 enum class OptionsView
 {
 	Resources,
+	Documents,
 	Fonts,
 	Logging,
+	OutputHistory,
+	ToolCache,
+	WorkerPool,
 
-	Max = Logging
+	Max = WorkerPool
 };
 
 static OptionsView s_optionsView = OptionsView::Resources;
@@ -67,6 +75,8 @@ void showFontsOptions()
 		ImGui::EndDisabled();
 	ImGui::SameLine();
 	ImGui::Checkbox("Use default font", &viewOptions.outputWindow.useDefaultFont);
+	ImGui::Checkbox("Show timestamps in output window", &viewOptions.outputWindow.showTimestamps);
+	ImGui::Checkbox("Word wrap in output window", &viewOptions.outputWindow.wordWrap);
 }
 
 void showLoggingOptions()
@@ -77,6 +87,161 @@ void showLoggingOptions()
 	if (ImGui::Combo("Log level", &logLevel, "None\0Error\0Warn\0Info\0Debug\0Trace\0"))
 		SetLogLevel(logLevel + LOG_LEVEL_MIN);
 	ImGui::PopItemWidth();
+#if LOG_COMPILE_LEVEL < LOG_LEVEL_MAX
+	ImGui::SameLine();
+	ImGui::HelpMarker("Messages above this level are compiled out of this build");
+#endif
+
+	// Debug and trace messages per subsystem
+	ImGui::Text("Debug and trace channels:");
+	uint32_t channelMask = GetLogChannelMask();
+	for (unsigned int channelIndex = 0; channelIndex < ENUM_COUNT(LogChannel); channelIndex++)
+	{
+		if (channelIndex > 0)
+			ImGui::SameLine();
+		ImGui::CheckboxFlags(GetLogChannelName((LogChannel)channelIndex), &channelMask, LOG_CHANNEL_BIT(channelIndex));
+	}
+	if (channelMask != GetLogChannelMask())
+		SetLogChannelMask(channelMask);
+}
+
+void showOutputHistoryOptions()
+{
+	OutputBuffer::Options& options = g_options.outputBuffer;
+
+	// Applied as new output arrives
+	ImGui::PushItemWidth(DIM_96_PPI(100.0f));
+	int memoryBudgetMB = (int)options.memoryBudgetMB;
+	if (ImGui::InputInt("Memory budget (MB)", &memoryBudgetMB, /*step*/8, /*step_fast*/64, ImGuiInputTextFlags_EnterReturnsTrue))
+		options.memoryBudgetMB = (unsigned int)Max(memoryBudgetMB, 2);
+	ImGui::PopItemWidth();
+	ImGui::SameLine();
+	ImGui::HelpMarker("Output window history kept in memory. Older output is moved to a temporary file, or discarded.");
+
+	ImGui::Checkbox("Spill older output to disk", &options.spillToDisk);
+	if (!options.spillToDisk)
+		ImGui::BeginDisabled();
+	ImGui::PushItemWidth(DIM_96_PPI(100.0f));
+	int maxSpillSizeMB = (int)options.maxSpillSizeMB;
+	if (ImGui::InputInt("Maximum spill size (MB)", &maxSpillSizeMB, /*step*/256, /*step_fast*/4096, ImGuiInputTextFlags_EnterReturnsTrue))
+		options.maxSpillSizeMB = (unsigned int)Max(maxSpillSizeMB, 0);
+	ImGui::PopItemWidth();
+	if (!options.spillToDisk)
+		ImGui::EndDisabled();
+
+	ImGui::Spacing();
+	const OutputBuffer::Stats stats = OutputBuffer::GetStats();
+	ImGui::Text("In memory: %.1f MB  On disk: %.1f MB", (double)stats.memorySizeBytes / (1024.0 * 1024.0), (double)stats.spilledSizeBytes / (1024.0 * 1024.0));
+	ImGui::Text("Discarded: %.1f MB", (double)stats.discardedBytes / (1024.0 * 1024.0));
+	if (stats.spillFailed)
+		ImGui::TextDisabled("Spilling failed, so older output is discarded (see log)");
+}
+
+void showToolCacheOptions()
+{
+	ToolCache::Options& options = g_options.toolCache;
+
+	ImGui::Checkbox("Enable tool cache", &options.enabled);
+	ImGui::SameLine();
+	ImGui::HelpMarker("Reuse the results of previous tool runs with identical tool binary, arguments and input files");
+
+	ImGui::PushItemWidth(DIM_96_PPI(100.0f));
+	int maxSizeMB = (int)options.maxSizeMB;
+	if (ImGui::InputInt("Maximum size (MB)", &maxSizeMB, /*step*/64, /*step_fast*/1024, ImGuiInputTextFlags_EnterReturnsTrue))
+	{
+		options.maxSizeMB = (unsigned int)Max(maxSizeMB, 1);
+		ToolCache::Trim();
+	}
+	ImGui::PopItemWidth();
+
+	ImGui::Spacing();
+	const ToolCache::Stats& stats = ToolCache::GetStats();
+	const unsigned int lookups = stats.hits + stats.misses;
+	ImGui::Text("Entries: %u (%.1f MB)", stats.entryCount, (double)stats.sizeBytes / (1024.0 * 1024.0));
+	ImGui::Text("Hits: %u  Misses: %u  Hit rate: %.0f%%", stats.hits, stats.misses, lookups ? 100.0 * stats.hits / lookups : 0.0);
+	ImGui::Text("Evictions: %u", stats.evictions);
+	ImGui::TextDisabled("%s", ToolCache::GetDirectory());
+
+	if (ImGui::Button("Reset counters"))
+		ToolCache::ResetHitMissCounters();
+	ImGui::SameLine();
+	if (ImGui::Button("Clear cache"))
+		ToolCache::Clear();
+}
+
+void showWorkerPoolOptions()
+{
+	WorkerPool::Options& options = g_options.workerPool;
+
+	ImGui::Checkbox("Enable worker pool", &options.enabled);
+	ImGui::SameLine();
+	ImGui::HelpMarker("Keep tool processes running between jobs, so that process creation and tool startup are paid once per worker rather than once per job");
+
+	ImGui::PushItemWidth(DIM_96_PPI(100.0f));
+	int workerCount = (int)options.workerCount;
+	if (ImGui::InputInt("Worker processes", &workerCount))
+		options.workerCount = (unsigned int)Clamp(workerCount, 1, (int)WorkerPool::kMaxWorkerCount);
+	ImGui::PopItemWidth();
+
+	// Worker executable
+	{
+		ImGui::Text("Worker executable:");
+		ImGui::HelpMarker("Launched with --worker. Default is the stand-in worker next to hoffgui.");
+
+		static char kDefaultString[] = "<stand-in worker>";
+		if (options.workerPath[0])
+			ImGui::InputText("##WorkerPathInputText", options.workerPath, sizeof(options.workerPath), ImGuiInputTextFlags_ReadOnly);
+		else
+			ImGui::InputText("##WorkerPathInputText", kDefaultString, sizeof(kDefaultString), ImGuiInputTextFlags_ReadOnly);
+
+		ImGui::SameLine();
+		if (ImGui::Button("...##SelectWorkerPath"))
+			FileDialogue::OpenFileDialogue("Worker executable", options.workerPath, sizeof(options.workerPath)); // blocking call
+		ImGui::SameLine();
+		if (ImGui::Button("Default##DefaultWorkerPath"))
+			options.workerPath[0] = '\0';
+	}
+
+	if (ImGui::Button("Apply"))
+		WorkerPool::Restart();
+
+	ImGui::Spacing();
+	const WorkerPool::Stats& stats = WorkerPool::GetStats();
+	ImGui::Text("Status: %s", WorkerPool::IsRunning() ? "running" : "stopped");
+	ImGui::Text("Workers: %u (%u busy)  Queued jobs: %u", WorkerPool::GetWorkerCount(), WorkerPool::GetBusyWorkerCount(), WorkerPool::GetQueuedJobCount());
+	ImGui::Text("Jobs: %u submitted  %u completed  %u failed", stats.jobsSubmitted, stats.jobsCompleted, stats.jobsFailed);
+	ImGui::Text("Worker respawns: %u", stats.workerRespawns);
+}
+
+static void showDocumentsOptions()
+{
+	ModDocuments::Options& options = g_options.modDocuments;
+
+	// Applied at the end of the frame
+	ImGui::PushItemWidth(DIM_96_PPI(100.0f));
+	int memoryBudgetMB = (int)options.memoryBudgetMB;
+	if (ImGui::InputInt("Memory budget (MB)", &memoryBudgetMB, /*step*/16, /*step_fast*/256, ImGuiInputTextFlags_EnterReturnsTrue))
+		options.memoryBudgetMB = (unsigned int)Max(memoryBudgetMB, 0);
+	ImGui::PopItemWidth();
+	ImGui::SameLine();
+	ImGui::HelpMarker("Open modules kept in memory. Beyond this, modules that haven't been shown recently are dropped from memory and reloaded from file when next shown. Modules with unsaved changes are always kept.");
+
+	ImGui::PushItemWidth(DIM_96_PPI(100.0f));
+	int windowedThresholdMB = (int)options.windowedThresholdMB;
+	if (ImGui::InputInt("Open windowed from (MB)", &windowedThresholdMB, /*step*/64, /*step_fast*/1024, ImGuiInputTextFlags_EnterReturnsTrue))
+		options.windowedThresholdMB = (unsigned int)Max(windowedThresholdMB, 1);
+	ImGui::PopItemWidth();
+	ImGui::SameLine();
+	ImGui::HelpMarker("Uncompressed files this large are never loaded into memory. Only the parts shown or scanned are read from file. Such files can't be edited.");
+
+	ImGui::Checkbox("Reload modules changed by other programs", &options.reloadChangedFiles);
+	ImGui::SameLine();
+	ImGui::HelpMarker("e.g. when the hoff tool rewrites an open module. Modules with unsaved changes are not reloaded.");
+
+	ImGui::Spacing();
+	const ModDocuments::Stats stats = ModDocuments::GetStats();
+	ImGui::Text("Open: %u  In memory: %u (%.1f MB)", stats.documentCount, stats.residentCount, (double)stats.residentSizeBytes / (1024.0 * 1024.0));
+	ImGui::Text("Evictions: %u", stats.evictionCount);
 }
 
 static void clickableLeafNodeSelector(const char* label, OptionsView view)
@@ -95,8 +260,12 @@ typedef void (*OptionsFunc)(void);
 static const OptionsFunc kOptionsFuncs[] =
 {
 	showResourceOptions,
+	showDocumentsOptions,
 	showFontsOptions,
 	showLoggingOptions,
+	showOutputHistoryOptions,
+	showToolCacheOptions,
+	showWorkerPoolOptions,
 };
 static_assert(COUNTOF_ARRAY(kOptionsFuncs) == ENUM_COUNT(OptionsView));
 
@@ -123,8 +292,12 @@ void OptionsWindow::Update()
 
 	// #TODO: Could macro this up
 	clickableLeafNodeSelector("Resources", OptionsView::Resources);
+	clickableLeafNodeSelector("Documents", OptionsView::Documents);
 	clickableLeafNodeSelector("Fonts", OptionsView::Fonts);
 	clickableLeafNodeSelector("Logging", OptionsView::Logging);
+	clickableLeafNodeSelector("Output History", OptionsView::OutputHistory);
+	clickableLeafNodeSelector("Tool Cache", OptionsView::ToolCache);
+	clickableLeafNodeSelector("Worker Pool", OptionsView::WorkerPool);
 
 	ImGui::EndChild();
 
@@ -1,31 +1,63 @@
 #include "OutputWindow.h"
 
+#include "HoffGui/Dialogues/FileDialogue.h"
+#include "HoffGui/AnsiDecoder.h"
+#include "HoffGui/OutputBuffer.h"
+#include "HoffGui/OutputExport.h"
+#include "HoffGui/OutputFilter.h"
+#include "HoffGui/OutputIndex.h"
+#include "HoffGui/OutputWrap.h"
+
+#include "Core/ProcessStats.h"
+#include "Core/FileSystem.h" // kMaxPath
 #include "Core/StringHelpers.h"
 #include "Core/hp_assert.h"
 #include "Core/Log.h"
 
 #include "ImGuiWrap/ImGuiWrap.h"
 
-#include <string.h> // memcpy
-#include <stdlib.h> // malloc, free
+#include <limits.h> // INT_MAX
+#include <string.h> // strlen
+#include <time.h> // localtime
 
-#define DEBUG_RING_BUFFER 0
+#include <algorithm> // std::upper_bound
+#include <deque>
+#include <string>
 
-// Ring buffer
-static const unsigned int kOutputBufferSizeBytes = 16 * 1024 * 1024;
-
-static char s_outputBuffer[kOutputBufferSizeBytes];
-static unsigned int s_startIndex; // read pos
-static unsigned int s_endIndex;   // write pos
-static unsigned int s_bytesWritten; // required to know if buffer is empty or full
+#define DEBUG_OUTPUT_BUFFER 0
 
 static bool s_visible = true;
 static bool s_focus;
 static bool s_autoScroll = true;
 static bool s_scrollToBottom = false;
+static uint64_t s_lastTotalBytesAppended;
+
+static char s_filterPattern[256];
+static bool s_filterMatchCase;
+static bool s_filterUseRegex;
+static int s_maxLogLevel = LOG_LEVEL_MAX;
+
+static const char* kLogLevelFilterNames[] = { "Errors", "Warnings", "Info", "Debug", "All levels" }; // LOG_LEVEL_ERROR to LOG_LEVEL_TRACE
+
+static const ImVec4 kErrorTextColor = ImVec4(1.0f, 0.4f, 0.4f, 1.0f);
+static const ImVec4 kWarningTextColor = ImVec4(1.0f, 0.8f, 0.3f, 1.0f);
+static const ImVec4 kChildStderrTextColor = ImVec4(1.0f, 0.65f, 0.45f, 1.0f);
 
 static OutputWindow::Options* s_pOptions;
 
+// Word wrap: the cumulative row count of each shown line, so that the clipper's rows map to lines by binary
+// search. Extended as lines are appended, and rebuilt (from OutputWrap's cached row counts) when the shown lines
+// change otherwise, e.g. the filter.
+struct ShownRowEnd
+{
+	uint64_t lineNumber;
+	uint64_t rowEnd; // rows up to and including this line's, counting from s_shownRowsBase
+};
+static std::deque<ShownRowEnd> s_shownRowEnds;
+static uint64_t s_shownRowsBase;
+static bool s_shownRowsValid;
+static bool s_wasRefiltering;
+
 void OutputWindow::Init(Options* pOptions)
 {
 	HP_ASSERT(pOptions != nullptr);
@@ -34,133 +66,307 @@ void OutputWindow::Init(Options* pOptions)
 
 void OutputWindow::Shutdown()
 {
+	OutputBuffer::SpliceStaged(); // frees anything still staged
+	OutputExport::Shutdown();
+	OutputFilter::Shutdown();
+	OutputWrap::Shutdown();
+	OutputIndex::Shutdown();
+	s_shownRowEnds.clear();
 	s_pOptions = nullptr;
 }
 
-void OutputWindow::Clear()
+static void updateFilterBar()
 {
-	s_startIndex = 0;
-	s_endIndex = 0;
-	s_bytesWritten = 0;
+	bool changed = false;
+	ImGui::SetNextItemWidth(DIM_FONT_UNITS(20));
+	changed |= ImGui::InputTextWithHint("##FilterInputText", "Filter", s_filterPattern, sizeof(s_filterPattern));
+	ImGui::SameLine();
+	changed |= ImGui::Checkbox("Match case", &s_filterMatchCase);
+	ImGui::SameLine();
+	changed |= ImGui::Checkbox("Regex", &s_filterUseRegex);
+
+	ImGui::SameLine();
+	int levelFilterIndex = s_maxLogLevel - LOG_LEVEL_ERROR;
+	ImGui::SetNextItemWidth(DIM_FONT_UNITS(7));
+	if (ImGui::Combo("##LevelFilterCombo", &levelFilterIndex, kLogLevelFilterNames, COUNTOF_ARRAY(kLogLevelFilterNames)))
+	{
+		s_maxLogLevel = LOG_LEVEL_ERROR + levelFilterIndex;
+		changed = true;
+	}
+
+	if (changed)
+	{
+		OutputFilter::SetFilter(s_filterPattern, s_filterMatchCase, s_filterUseRegex, s_maxLogLevel);
+		s_shownRowsValid = false;
+	}
 
-	// no need to zero the buffer memory
+	ImGui::SameLine();
+	if (OutputFilter::GetError()[0] != '\0')
+		ImGui::TextColored(kErrorTextColor, "%s", OutputFilter::GetError());
+	else if (OutputFilter::IsRefiltering())
+		ImGui::TextDisabled("Filtering...");
+	else if (OutputFilter::IsActive())
+		ImGui::TextDisabled("%zu matching lines", OutputFilter::GetMatchCount());
+
+	if (OutputExport::IsRunning())
+	{
+		ImGui::SameLine();
+		ImGui::TextDisabled("Saving... %.0f%%", OutputExport::GetProgress() * 100.0f);
+		ImGui::SameLine();
+		if (ImGui::SmallButton("Cancel##CancelSaveOutput"))
+			OutputExport::Cancel();
+	}
 }
 
-static char getPrevChar(unsigned int index)
+static void saveOutput(OutputExport::Format format)
 {
-	unsigned int prevIndex = index > 0 ? index - 1 : kOutputBufferSizeBytes - 1;
-	return s_outputBuffer[prevIndex];
+	char path[kMaxPath] = {};
+	const char* textFilters[] = { "Text Files (.txt)", "*.txt" };
+	const char* tsvFilters[] = { "TSV Files (.tsv)", "*.tsv" };
+	const char** filters = format == OutputExport::Format::Tsv ? tsvFilters : textFilters;
+
+	// This call blocks until user selects a file or cancels
+	FileDialogue::SaveFileDialogue("Save output", path, sizeof(path), COUNTOF_ARRAY(textFilters), filters);
+	if (path[0] != '\0')
+		OutputExport::Start(path, format, OutputIndex::GetIndexedEndPosition());
 }
 
-//
-// Increments the start index by a line (past next EOL or until it catches up with the end index)
-// to make room for more writes
-//
-static void advanceStartIndex()
+static bool isLogLevelVisible(int logLevel)
 {
-	bool reachedEOL = false;
-	do
-	{
-		// Increment and wrap
-		s_startIndex++;
-		if (s_startIndex == kOutputBufferSizeBytes)
-			s_startIndex = 0;
-
-		char c = s_outputBuffer[s_startIndex];
-		bool isEolChar = (c == '\r' || c == '\n');
-		if (isEolChar)
-			reachedEOL = true;
-		else if (reachedEOL && !isEolChar)
-			return; //  passed EOL
-
-	} while (s_startIndex != s_endIndex);
+	return logLevel <= s_maxLogLevel || logLevel == LOG_LEVEL_NONE;
 }
 
-static void appendChar(const char c)
+// Lines shown, after filtering
+static size_t getShownLineCount()
 {
-	HP_ASSERT(s_endIndex <= kOutputBufferSizeBytes);
-	if (s_endIndex == kOutputBufferSizeBytes)
-		s_endIndex = 0; // wrap
+	return OutputFilter::IsActive() ? OutputFilter::GetMatchCount() : OutputIndex::GetLevelLineCount(s_maxLogLevel);
+}
 
-	if (s_endIndex == s_startIndex && s_bytesWritten > 0) // buffer full?
-		advanceStartIndex();
+static uint64_t getShownLineNumber(size_t index)
+{
+	return OutputFilter::IsActive() ? OutputFilter::GetMatchLineNumber(index) : OutputIndex::GetLevelLineNumber(s_maxLogLevel, index);
+}
 
-	// Append the character
-	HP_ASSERT(s_endIndex < kOutputBufferSizeBytes);
-	s_outputBuffer[s_endIndex++] = c;
-	s_bytesWritten++;
+static bool pushTextColor(const OutputBuffer::Attributes& attributes)
+{
+	if (attributes.textColor != AnsiDecoder::kDefaultTextColor)
+		ImGui::PushStyleColor(ImGuiCol_Text, ImGui::ColorConvertU32ToFloat4(IM_COL32((attributes.textColor >> 16) & 0xff, (attributes.textColor >> 8) & 0xff, attributes.textColor & 0xff, 0xff)));
+	else if (attributes.logLevel == LOG_LEVEL_ERROR)
+		ImGui::PushStyleColor(ImGuiCol_Text, kErrorTextColor);
+	else if (attributes.logLevel == LOG_LEVEL_WARN)
+		ImGui::PushStyleColor(ImGuiCol_Text, kWarningTextColor);
+	else if (attributes.logLevel > LOG_LEVEL_INFO)
+		ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetStyleColorVec4(ImGuiCol_TextDisabled));
+	else if (attributes.source == OutputBuffer::Source::ChildStderr)
+		ImGui::PushStyleColor(ImGuiCol_Text, kChildStderrTextColor);
+	else
+		return false;
+	return true;
 }
 
-void OutputWindow::AppendString(const char* str, size_t len)
+static void showTimestamp(const OutputBuffer::Attributes& attributes)
 {
-	// Copy to Output buffer character by character
-	// To support console style "progress bars", if a CR (\r 0xd) is found that is not followed by a LF (\n 0xa),
-	// then back up to start of line. IRA uses this for percentages I think.
-	for (size_t charIndex = 0; charIndex < len; charIndex++)
-	{
-		char c = str[charIndex];
-		HP_ASSERT(c != 0);
-		if (c == '\r') // CR?
-		{
-			bool isFinalChar = (charIndex == len - 1);
-			if (isFinalChar || (str[charIndex + 1] != '\n'))
-			{
-				// Carriage Return back to start of current line, accounting for ring buffer wrapping
-				while (s_endIndex != s_startIndex && getPrevChar(s_endIndex) != '\n')
-				{
-					s_endIndex = s_endIndex > 0 ? s_endIndex - 1 : kOutputBufferSizeBytes - 1;
-					s_bytesWritten--;
-				}
-				continue; // nothing to append
-			}
-		}
+	const uint64_t timeMs = OutputBuffer::GetStartTime() + attributes.timeMs;
+	const time_t time = (time_t)(timeMs / 1000);
+	struct tm localTime = {};
+#ifdef _MSC_VER
+	localtime_s(&localTime, &time);
+#else
+	localtime_r(&time, &localTime);
+#endif
+	ImGui::TextDisabled("%02d:%02d:%02d.%03u", localTime.tm_hour, localTime.tm_min, localTime.tm_sec, (unsigned int)(timeMs % 1000));
+	ImGui::SameLine();
+}
+
+// Text with the colour of each span of attributes, as decoded from escape sequences when appended
+static void showSpans(uint64_t beginPosition, uint64_t endPosition, std::string& scratch)
+{
+	// Beyond this many colour changes in a line, the rest of the line is one colour
+	static const unsigned int kMaxSpans = 32;
 
-		appendChar(c);
+	OutputBuffer::Span spans[kMaxSpans];
+	const unsigned int spanCount = OutputBuffer::GetSpans(beginPosition, endPosition, spans, kMaxSpans);
+	if (spanCount == 0)
+		ImGui::TextUnformatted("");
+
+	for (unsigned int spanIndex = 0; spanIndex < spanCount; spanIndex++)
+	{
+		if (spanIndex > 0)
+			ImGui::SameLine(0.0f, 0.0f);
+
+		const OutputBuffer::Span& span = spans[spanIndex];
+		const bool pushedColor = pushTextColor(span.attributes);
+		const OutputBuffer::Range range = OutputBuffer::GetText(span.beginPosition, span.endPosition, scratch);
+		ImGui::TextUnformatted(range.pBegin, range.pEnd);
+		if (pushedColor)
+			ImGui::PopStyleColor();
 	}
+}
+
+static void showLine(uint64_t lineNumber, std::string& scratch)
+{
+	if (s_pOptions->showTimestamps)
+		showTimestamp(OutputIndex::GetLineAttributes(lineNumber));
 
-	if (s_autoScroll)
-		s_scrollToBottom = true;
+	const OutputIndex::Line line = OutputIndex::GetLine(lineNumber);
+	showSpans(line.beginPosition, line.beginPosition + line.length, scratch);
 }
 
-void OutputWindow::Printf(const char* format, ...)
+// The text after the last complete line e.g. a progress percentage, which isn't indexed
+static void showIncompleteLine(std::string& scratch)
 {
-	HP_ASSERT(format != nullptr);
+	const uint64_t beginPosition = OutputIndex::GetIndexedEndPosition();
+	const uint64_t endPosition = OutputBuffer::GetEndPosition();
+	if (beginPosition >= endPosition)
+		return;
+
+	const OutputBuffer::Attributes attributes = OutputBuffer::GetAttributes(beginPosition);
+	if (!isLogLevelVisible(attributes.logLevel))
+		return;
 
-	va_list argList;
-	va_start(argList, format);
-	Vfprintf(format, argList);
-	va_end(argList);
+	if (s_pOptions->showTimestamps)
+		showTimestamp(attributes);
+	showSpans(beginPosition, endPosition, scratch);
 }
 
-void OutputWindow::Vfprintf(const char* format, va_list argList)
+static void updateShownRowEnds()
 {
-	va_list argcopy; 
-	va_copy(argcopy, argList);
-	int ret = _vscprintf(format, argcopy) + 1; // + 1 to null terminate (_vscprintf return value doesn't include null-terminator)
-	va_end(argcopy);
-	if (ret == -1)
+	if (!s_shownRowsValid)
 	{
-		LOG_ERROR("_vscprintf failed with code %d\n", ret);
-		return;
+		s_shownRowEnds.clear();
+		s_shownRowsBase = 0;
+		s_shownRowsValid = true;
 	}
 
-	size_t bufferSize = (size_t)ret;
+	// Forget discarded lines
+	const uint64_t firstLineNumber = OutputIndex::GetFirstLineNumber();
+	while (!s_shownRowEnds.empty() && s_shownRowEnds.front().lineNumber < firstLineNumber)
+	{
+		s_shownRowsBase = s_shownRowEnds.front().rowEnd;
+		s_shownRowEnds.pop_front();
+	}
 
-	char* buffer = (char*)malloc(bufferSize);
+	const size_t lineCount = getShownLineCount();
+	if (s_shownRowEnds.size() > lineCount || (!s_shownRowEnds.empty() && s_shownRowEnds.front().lineNumber != getShownLineNumber(0)))
+	{
+		s_shownRowEnds.clear(); // not just appended to
+		s_shownRowsBase = 0;
+	}
+
+	for (size_t index = s_shownRowEnds.size(); index < lineCount; index++)
+	{
+		const uint64_t lineNumber = getShownLineNumber(index);
+		const uint64_t rowEnd = (s_shownRowEnds.empty() ? s_shownRowsBase : s_shownRowEnds.back().rowEnd) + OutputWrap::GetRowCount(lineNumber);
+		s_shownRowEnds.push_back({ lineNumber, rowEnd });
+	}
+}
 
-	// Populate the buffer with the contents of the format string.
-	va_copy(argcopy, argList);
-	vsnprintf(buffer, bufferSize, format, argcopy);
-	va_end(argcopy);
+// Index of the shown line containing row
+static size_t findShownRowLine(uint64_t row)
+{
+	const uint64_t rowEnd = s_shownRowsBase + row;
+	auto it = std::upper_bound(s_shownRowEnds.cbegin(), s_shownRowEnds.cend(), rowEnd,
+		[](uint64_t end, const ShownRowEnd& shownRowEnd) { return end < shownRowEnd.rowEnd; });
+	return (size_t)(it - s_shownRowEnds.cbegin());
+}
+
+static void showWrappedRow(uint64_t lineNumber, unsigned int rowIndex, float timestampWidth, std::string& scratch)
+{
+	if (s_pOptions->showTimestamps)
+	{
+		if (rowIndex == 0)
+			showTimestamp(OutputIndex::GetLineAttributes(lineNumber));
+		else
+			ImGui::SetCursorPosX(ImGui::GetCursorPosX() + timestampWidth);
+	}
 
-	HP_ASSERT(bufferSize > 0 && (strlen(buffer) == bufferSize - 1));
-	AppendString(buffer, bufferSize - 1);
+	uint64_t beginPosition = 0;
+	uint64_t endPosition = 0;
+	OutputWrap::GetRowPositions(lineNumber, rowIndex, beginPosition, endPosition);
+	showSpans(beginPosition, endPosition, scratch);
+}
+
+// As showLines, with each row of the wrapped lines as an item for the clipper. Lines are only measured once,
+// so this costs no more per frame than not wrapping.
+static void showWrappedLines(std::string& scratch)
+{
+	const float timestampWidth = s_pOptions->showTimestamps ? ImGui::CalcTextSize("00:00:00.000").x + ImGui::GetStyle().ItemSpacing.x : 0.0f;
+	const float wrapWidth = ImGui::GetContentRegionAvail().x - timestampWidth;
+	if (OutputWrap::SetLayout(ImGui::GetFont(), ImGui::GetFontSize(), wrapWidth))
+		s_shownRowsValid = false;
+	updateShownRowEnds();
+
+	const uint64_t rowCount = s_shownRowEnds.empty() ? 0 : s_shownRowEnds.back().rowEnd - s_shownRowsBase;
+	ImGuiListClipper clipper;
+	clipper.Begin((int)Min(rowCount, (uint64_t)INT_MAX));
+	while (clipper.Step())
+	{
+		uint64_t row = (uint64_t)clipper.DisplayStart;
+		for (size_t index = findShownRowLine(row); index < s_shownRowEnds.size() && row < (uint64_t)clipper.DisplayEnd; index++)
+		{
+			const uint64_t lineNumber = s_shownRowEnds[index].lineNumber;
+			const uint64_t lineRowBegin = (index > 0 ? s_shownRowEnds[index - 1].rowEnd : s_shownRowsBase) - s_shownRowsBase;
+			const unsigned int lineRowCount = (unsigned int)(s_shownRowEnds[index].rowEnd - s_shownRowsBase - lineRowBegin);
+			for (unsigned int rowIndex = (unsigned int)(row - lineRowBegin); rowIndex < lineRowCount && row < (uint64_t)clipper.DisplayEnd; rowIndex++, row++)
+				showWrappedRow(lineNumber, rowIndex, timestampWidth, scratch);
+		}
+	}
+}
+
+// Only the visible lines are drawn, so hundreds of thousands are no problem.
+// When copying, everything is drawn so that it is all logged to the clipboard, unwrapped.
+static void showLines(bool showAll)
+{
+	std::string scratch;
+	const size_t lineCount = getShownLineCount();
+	if (s_pOptions->wordWrap && !showAll)
+		showWrappedLines(scratch);
+	else if (showAll)
+	{
+		for (size_t index = 0; index < lineCount; index++)
+			showLine(getShownLineNumber(index), scratch);
+	}
+	else
+	{
+		ImGuiListClipper clipper;
+		clipper.Begin((int)Min(lineCount, (size_t)INT_MAX));
+		while (clipper.Step())
+		{
+			for (int index = clipper.DisplayStart; index < clipper.DisplayEnd; index++)
+				showLine(getShownLineNumber((size_t)index), scratch);
+		}
+	}
 
-	free(buffer);
+	// Not wrapped, as it may be changing every frame e.g. a progress percentage
+	if (!OutputFilter::IsActive())
+		showIncompleteLine(scratch);
 }
 
 void OutputWindow::Update()
 {
+	// Output logged by other threads since last frame
+	OutputBuffer::SpliceStaged();
+
+	// Index and filter new lines even if not visible, so there is no delay when shown
+	const bool linesChanged = OutputIndex::Update();
+	OutputFilter::Update(linesChanged);
+	OutputWrap::Update();
+	OutputExport::Update();
+
+	// The matches are replaced when a re-filter finishes
+	if (s_wasRefiltering && !OutputFilter::IsRefiltering())
+		s_shownRowsValid = false;
+	s_wasRefiltering = OutputFilter::IsRefiltering();
+
+	// New output since last frame?
+	const uint64_t totalBytesAppended = OutputBuffer::GetTotalBytesAppended();
+	if (totalBytesAppended != s_lastTotalBytesAppended)
+	{
+		s_lastTotalBytesAppended = totalBytesAppended;
+		if (s_autoScroll)
+			s_scrollToBottom = true;
+	}
+
 	if (!s_visible)
 		return;
 
@@ -176,8 +382,8 @@ void OutputWindow::Update()
 		return;
 	}
 
-#if DEBUG_RING_BUFFER
-	ImGui::Text("Size: %u  Start: %u  End: %u  Written: %u\n", kOutputBufferSizeBytes, s_startIndex, s_endIndex, s_bytesWritten);
+#if DEBUG_OUTPUT_BUFFER
+	ImGui::Text("Total appended: %llu\n", (unsigned long long)OutputBuffer::GetTotalBytesAppended());
 
 	if (ImGui::Button("Append number"))
 	{
@@ -185,7 +391,7 @@ void OutputWindow::Update()
 		char text[64];
 		SafeSnprintf(text, sizeof(text), "%03u\n", s_i);
 		size_t len = strlen(text);
-		AppendString(text, len);
+		OutputBuffer::AppendString(text, len);
 		s_i++;
 	}
 	ImGui::SameLine();
@@ -193,46 +399,64 @@ void OutputWindow::Update()
 	{
 		const char* text = "ABC\r";
 		size_t len = strlen(text);
-		AppendString(text, len);
+		OutputBuffer::AppendString(text, len);
 	}
 #endif
 
+	updateFilterBar();
+
+	// Separate child window so the filter bar doesn't scroll
+	ImGui::BeginChild("OutputTextChild", ImVec2(0, 0), ImGuiChildFlags_None, ImGuiWindowFlags_HorizontalScrollbar);
+
 	bool copyToClipboard = false;
+	bool exportProcessStats = false;
+	bool saveText = false;
+	bool saveTsv = false;
 	if (ImGui::BeginPopupContextWindow())
 	{
 		if (ImGui::Selectable("Clear"))
-			Clear();
+			OutputBuffer::Clear();
 		if (ImGui::Selectable("Copy"))
 			copyToClipboard = true;
+		const ImGuiSelectableFlags saveFlags = OutputExport::IsRunning() ? ImGuiSelectableFlags_Disabled : 0;
+		if (ImGui::Selectable("Save output as...", /*selected*/false, saveFlags))
+			saveText = true;
+		if (ImGui::Selectable("Save output with timestamps and levels (TSV)...", /*selected*/false, saveFlags))
+			saveTsv = true;
 		ImGui::Checkbox("Auto-scroll", &s_autoScroll);
+		ImGui::Checkbox("Show timestamps", &s_pOptions->showTimestamps);
+		ImGui::Checkbox("Word wrap", &s_pOptions->wordWrap);
 		if (ImGui::Selectable("Scroll to bottom"))
 			s_scrollToBottom = true;
+		ImGui::Separator();
+		if (ImGui::Selectable("Export process stats (CSV)...", /*selected*/false, ProcessStats::GetJobCount() > 0 ? 0 : ImGuiSelectableFlags_Disabled))
+			exportProcessStats = true;
 		ImGui::EndPopup();
 	}
 
 	if (copyToClipboard)
 		ImGui::LogToClipboard();
 
+	if (saveText || saveTsv)
+		saveOutput(saveTsv ? OutputExport::Format::Tsv : OutputExport::Format::Text);
+
+	if (exportProcessStats)
+	{
+		char path[kMaxPath] = {};
+		const char* filters[] = { "CSV Files (.csv)", "*.csv" };
+
+		// This call blocks until user selects a file or cancels
+		FileDialogue::SaveFileDialogue("Export process stats", path, sizeof(path), COUNTOF_ARRAY(filters), filters);
+		if (path[0] != '\0')
+			ProcessStats::ExportCsv(path);
+	}
+
 	const bool useDefaultFont = s_pOptions->useDefaultFont;
 	if (!useDefaultFont)
 		ImGui::PushFont(Fonts::GetFont(s_pOptions->fontType));
 
-	// Depending on the state of the ring buffer, there will be 0, 1 or 2 ranges to display
-	if (s_bytesWritten == 0)
-	{
-		// nothing to display
-	}
-	else if (s_startIndex < s_endIndex)
-		ImGui::TextUnformatted(s_outputBuffer + s_startIndex, s_outputBuffer + s_endIndex);
-	else // s_startIndex >= s_endIndex
-	{
-		// #TODO: ImGui inserts a little bit of vertical space between the two blocks, but really a minor concern
-		// If a line wraps round the end of the buffer it is broken in two, but this is really a minor concern.
-		// Could increase buffer size, and memcpy(s_outputBuffer + kOutputBufferSizeBytes, s_endIndex) to display
-		// or better still do it during appending to hide the cost, but don't think it's worth it.
-		ImGui::TextUnformatted(s_outputBuffer + s_startIndex, s_outputBuffer + kOutputBufferSizeBytes);
-		ImGui::TextUnformatted(s_outputBuffer, s_outputBuffer + s_endIndex);
-	}
+	// Line by line, so each can be coloured by its attributes without parsing the text
+	showLines(/*showAll*/copyToClipboard);
 
 	if (!useDefaultFont)
 		ImGui::PopFont();
@@ -246,6 +470,7 @@ void OutputWindow::Update()
 		ImGui::SetScrollHereY(1.0f);
 	}
 
+	ImGui::EndChild();
 	ImGui::End();
 }
 
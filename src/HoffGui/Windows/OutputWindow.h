@@ -4,8 +4,6 @@
 
 #include "Core/Helpers.h"
 
-#include <stdarg.h> // va_list
-
 class OutputWindow
 {
 public:
@@ -17,16 +15,13 @@ public:
 	{
 		bool useDefaultFont = true;
 		FontType fontType = FontType::ProggyClean13;
+		bool showTimestamps = false;
+		bool wordWrap = false;
 	};
 
 	static void Init(Options* pOptions);
 	static void Shutdown();
 
-	static void Clear();
-	static void AppendString(const char* str, size_t len);
-	static void Printf(const char* format, ...);
-	static void Vfprintf(const char* format, va_list argList);
-
 	// Call once per frame
 	static void Update();
 
@@ -69,7 +69,7 @@ static ImFont* addFontFromFileTTF(const char* fontsPath, const char* filename, f
 		return nullptr;
 	}
 
-	LOG_TRACE("Loaded font: %s size %.2f\n", fontPath, fontSizePixels);
+	LOG_CHANNEL_TRACE(Fonts, "Loaded font: %s size %.2f\n", fontPath, fontSizePixels);
 	return pFont;
 }
 
@@ -219,7 +219,7 @@ static bool addScalableFonts(const char* fontsPath, float zoomFactor)
 	for (unsigned int dpiScaleIndex = 0; dpiScaleIndex < s_dpiScaleCount; dpiScaleIndex++)
 	{
 		const float dpiScale = s_dpiScales[dpiScaleIndex];
-		LOG_TRACE("Creating font for DPI scale: %.2f (%.0f%%)\n", dpiScale, 100.0f * dpiScale);
+		LOG_CHANNEL_TRACE(Fonts, "Creating font for DPI scale: %.2f (%.0f%%)\n", dpiScale, 100.0f * dpiScale);
 
 		float fontSizePixels = ImFloor((float)kProggyVectorFontSize * dpiScale); // round down to nearest integer (ImGui advice)
 
@@ -125,7 +125,7 @@ static void updateDpiScale()
 		ImFontAtlas* pFontAtlas = ImGui::GetIO().Fonts;
 		if (pFontAtlas->Build())
 		{
-			LOG_TRACE("Rebuilt font atlas\n");
+			LOG_CHANNEL_TRACE(Fonts, "Rebuilt font atlas\n");
 
 			// REUPLOAD FONT TEXTURE TO GPU
 			ImGui_ImplOpenGL3_DestroyFontsTexture();
@@ -192,7 +192,7 @@ void ImGuiWrap::IncreaseZoom()
 	if (s_zoomFactorIndex < IM_ARRAYSIZE(kZoomFactors) - 1)
 	{
 		s_zoomFactorIndex++;
-		LOG_TRACE("Increased UI zoom to %.2f\n", kZoomFactors[s_zoomFactorIndex]);
+		LOG_CHANNEL_TRACE(UI, "Increased UI zoom to %.2f\n", kZoomFactors[s_zoomFactorIndex]);
 	}
 }
 
@@ -206,7 +206,7 @@ void ImGuiWrap::DecreaseZoom()
 	if (s_zoomFactorIndex > 0)
 	{
 		s_zoomFactorIndex--;
-		LOG_TRACE("Decreased UI zoom to %.2f\n", kZoomFactors[s_zoomFactorIndex]);
+		LOG_CHANNEL_TRACE(UI, "Decreased UI zoom to %.2f\n", kZoomFactors[s_zoomFactorIndex]);
 	}
 }
 
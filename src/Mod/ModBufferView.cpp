@@ -0,0 +1,57 @@
+#include "ModBufferView.h"
+
+#include "Core/Helpers.h"
+
+ModBufferView::ModBufferView(std::shared_ptr<const std::vector<uint8_t>> pBuffer)
+{
+	if (pBuffer)
+	{
+		m_pData = pBuffer->data();
+		m_sizeBytes = pBuffer->size();
+		m_pOwner = std::move(pBuffer);
+	}
+}
+
+ModBufferView::ModBufferView(std::shared_ptr<const void> pOwner, const uint8_t* pData, size_t sizeBytes)
+	: m_pOwner(std::move(pOwner))
+	, m_pData(pData)
+	, m_sizeBytes(sizeBytes)
+{
+}
+
+ModBufferView ModBufferView::GetSubview(size_t offset, size_t sizeBytes) const
+{
+	ModBufferView subview;
+	subview.m_pOwner = m_pOwner;
+	offset = Min(offset, m_sizeBytes);
+	subview.m_pData = m_pData + offset;
+	subview.m_sizeBytes = Min(sizeBytes, m_sizeBytes - offset);
+	return subview;
+}
+
+bool ModBufferView::IsValid() const
+{
+	return m_pOwner != nullptr;
+}
+
+const uint8_t* ModBufferView::GetData() const
+{
+	return m_pData;
+}
+
+size_t ModBufferView::GetSizeBytes() const
+{
+	return m_sizeBytes;
+}
+
+bool ModBufferView::IsSameAs(const ModBufferView& other) const
+{
+	return m_pOwner == other.m_pOwner && m_pData == other.m_pData && m_sizeBytes == other.m_sizeBytes;
+}
+
+void ModBufferView::Reset()
+{
+	m_pOwner.reset();
+	m_pData = nullptr;
+	m_sizeBytes = 0;
+}
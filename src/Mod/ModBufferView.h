@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+//
+// An immutable, reference-counted view of a document's data (see ModDocument::GetView), or a range of it.
+//
+// Views share the document's buffer rather than copying it. The buffer never changes while shared: the document
+// copies it before its next edit, and replaces it when reloaded or evicted, leaving views of the old one intact. So a
+// view can be read on any thread for as long as it is held, and the buffer is freed when the last view and the
+// document have both let go of it.
+//
+// A view of a windowed document (see ModDocument::GetRange) holds a memory mapped window of the file instead, which
+// is unmapped when the last view of it is released. It reads the file as it is now, so can change if another program
+// writes the file.
+//
+class ModBufferView
+{
+public:
+	ModBufferView() = default;
+	explicit ModBufferView(std::shared_ptr<const std::vector<uint8_t>> pBuffer);
+	// pOwner keeps [pData, pData + sizeBytes) alive
+	ModBufferView(std::shared_ptr<const void> pOwner, const uint8_t* pData, size_t sizeBytes);
+
+	// A view of part of this one, sharing the same buffer. Clamped to this view.
+	ModBufferView GetSubview(size_t offset, size_t sizeBytes) const;
+
+	// False for a default-constructed view, or one of evicted data that couldn't be reloaded
+	bool IsValid() const;
+
+	const uint8_t* GetData() const;
+	size_t GetSizeBytes() const;
+
+	const uint8_t* begin() const { return m_pData; }
+	const uint8_t* end() const { return m_pData + m_sizeBytes; }
+
+	// Views of the same bytes of the same buffer, so necessarily identical without comparing them
+	bool IsSameAs(const ModBufferView& other) const;
+
+	// Releases this view's reference
+	void Reset();
+
+private:
+	std::shared_ptr<const void> m_pOwner;
+	const uint8_t* m_pData = nullptr;
+	size_t m_sizeBytes = 0;
+};
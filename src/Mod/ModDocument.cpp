@@ -0,0 +1,617 @@
+#include "ModDocument.h"
+
+#include "ModFileReader.h"
+
+#include "Core/StringHelpers.h"
+#include "Core/hp_assert.h"
+#include "Core/Log.h"
+
+#include <string.h> // memcpy, strcmp
+
+#include <algorithm> // std::lower_bound
+
+// Ranges closer than this are merged, as rewriting a few unchanged bytes costs less than another write call
+static const uint64_t kDirtyRangeMergeGapBytes = 4096;
+
+// Beyond this, scattered edits are saved by rewriting the whole file
+static const size_t kMaxDirtyRangeCount = 256;
+
+// An edit rehashes at least this much. Combining the block hashes costs 16 bytes of hashing per block.
+static const size_t kHashBlockSizeBytes = 64 * 1024;
+
+// Windowed documents read the file this much at a time, aligned to it
+static const uint64_t kWindowSizeBytes = 1024 * 1024;
+
+// Windows kept for reuse, beyond those still held by views
+static const size_t kMaxCachedWindows = 8;
+
+static uint64_t s_useCount = 0;
+
+// Shorter than requested if the file has been truncated since it was opened
+struct ModDocument::Window
+{
+	uint64_t offset = 0;
+	std::vector<uint8_t> data;
+};
+
+bool ModDocument::readFile(const char* path)
+{
+	// Before reading, so that a change made while reading shows as a different stamp
+	stampFile();
+
+	std::shared_ptr<std::vector<uint8_t>> pData = std::make_shared<std::vector<uint8_t>>();
+	if (!ModFileReader::Read(path, *pData))
+		return false;
+
+	m_dataSizeBytes = pData->size();
+	m_pData = std::move(pData);
+	m_resident = true;
+	m_reloadFailed = false;
+
+	// The file may have changed since the data was evicted
+	resizeBlockHashes();
+	markBlockHashesStale(0, m_dataSizeBytes);
+	return true;
+}
+
+// Fails for paths of archive members, which are read-only so never saved in place
+void ModDocument::stampFile()
+{
+	m_hasFileStamp = m_path[0] != '\0' && FileWatcher::GetStamp(m_path, m_fileStamp);
+}
+
+// Copies the data first if a view shares it e.g. a save snapshot
+std::vector<uint8_t>& ModDocument::getWritableData()
+{
+	HP_ASSERT(m_pData);
+	if (m_pData.use_count() > 1)
+	{
+		LOG_CHANNEL_TRACE(ModFile, "Copying data shared with %ld view(s): %s\n", m_pData.use_count() - 1, m_path);
+		m_pData = std::make_shared<std::vector<uint8_t>>(*m_pData);
+	}
+	return *m_pData;
+}
+
+void ModDocument::addDirtyRange(uint64_t offset, size_t sizeBytes)
+{
+	if (m_rewriteNeeded)
+		return;
+
+	uint64_t begin = offset;
+	uint64_t end = offset + sizeBytes;
+
+	// Merge with any ranges that overlap or are within the gap
+	const std::vector<FileWriter::Range>::iterator first = std::lower_bound(m_dirtyRanges.begin(), m_dirtyRanges.end(), begin,
+		[](const FileWriter::Range& range, uint64_t position) { return range.offset + range.sizeBytes + kDirtyRangeMergeGapBytes < position; });
+	std::vector<FileWriter::Range>::iterator last = first;
+	while (last != m_dirtyRanges.end() && last->offset <= end + kDirtyRangeMergeGapBytes)
+	{
+		begin = Min(begin, last->offset);
+		end = Max(end, last->offset + last->sizeBytes);
+		++last;
+	}
+
+	const FileWriter::Range mergedRange = { begin, (size_t)(end - begin) };
+	if (first == last)
+		m_dirtyRanges.insert(first, mergedRange);
+	else
+	{
+		*first = mergedRange;
+		m_dirtyRanges.erase(first + 1, last);
+	}
+
+	if (m_dirtyRanges.size() > kMaxDirtyRangeCount)
+	{
+		m_rewriteNeeded = true;
+		m_dirtyRanges.clear();
+	}
+}
+
+void ModDocument::markSaved()
+{
+	m_modified = false;
+	m_rewriteNeeded = false;
+	m_dirtyRanges.clear();
+}
+
+// One per block of m_dataSizeBytes. New blocks are stale; the caller marks any block whose size changed.
+void ModDocument::resizeBlockHashes()
+{
+	const size_t blockCount = (m_dataSizeBytes + kHashBlockSizeBytes - 1) / kHashBlockSizeBytes;
+	if (m_blockHashes.size() == blockCount)
+		return;
+	m_blockHashes.resize(blockCount);
+	m_staleBlockHashes.resize(blockCount, true);
+	m_contentHashStale = true;
+}
+
+// Views of the windows keep them after this
+void ModDocument::closeWindowed()
+{
+	m_windows.clear();
+	m_pWindowedFile.reset();
+}
+
+void ModDocument::markBlockHashesStale(uint64_t offset, uint64_t sizeBytes)
+{
+	if (sizeBytes == 0)
+		return;
+	const size_t firstBlockIndex = (size_t)(offset / kHashBlockSizeBytes);
+	const size_t endBlockIndex = Min((size_t)((offset + sizeBytes - 1) / kHashBlockSizeBytes + 1), m_staleBlockHashes.size());
+	for (size_t blockIndex = firstBlockIndex; blockIndex < endBlockIndex; blockIndex++)
+		m_staleBlockHashes[blockIndex] = true;
+	m_contentHashStale = true;
+}
+
+void ModDocument::New()
+{
+	closeWindowed();
+	m_dataSizeBytes = 16;
+	m_pData = std::make_shared<std::vector<uint8_t>>(m_dataSizeBytes);
+	for (unsigned int i = 0; i < m_dataSizeBytes; i++)
+	{
+		(*m_pData)[i] = (uint8_t)i;
+	}
+
+	m_path[0] = '\0';
+	m_hasFileStamp = false;
+	m_resident = true;
+	m_modified = true;
+	m_readOnly = false;
+	m_rewriteNeeded = true;
+	m_dirtyRanges.clear();
+	m_lastUse = ++s_useCount;
+	resizeBlockHashes();
+	markBlockHashesStale(0, m_dataSizeBytes);
+}
+
+void ModDocument::Open(const char* path, std::vector<uint8_t>&& data, bool readOnly, BlockHashes&& blockHashes,
+	const FileWatcher::Stamp* pFileStamp)
+{
+	HP_ASSERT(path && path[0]);
+
+	closeWindowed();
+	m_dataSizeBytes = data.size();
+	m_pData = std::make_shared<std::vector<uint8_t>>(std::move(data));
+	SafeStrcpy(m_path, sizeof(m_path), path);
+	m_hasFileStamp = pFileStamp != nullptr;
+	m_fileStamp = pFileStamp ? *pFileStamp : FileWatcher::Stamp();
+	m_resident = true;
+	m_readOnly = readOnly;
+	m_reloadFailed = false;
+	m_lastUse = ++s_useCount;
+	markSaved();
+
+	m_blockHashes = std::move(blockHashes);
+	m_staleBlockHashes.assign(m_blockHashes.size(), false);
+	m_contentHashStale = true; // combined on first use
+	if (m_blockHashes.size() != (m_dataSizeBytes + kHashBlockSizeBytes - 1) / kHashBlockSizeBytes)
+	{
+		m_blockHashes.clear();
+		m_staleBlockHashes.clear();
+		resizeBlockHashes();
+	}
+}
+
+bool ModDocument::OpenWindowed(const char* path)
+{
+	HP_ASSERT(path && path[0]);
+
+	std::shared_ptr<MappedFile> pFile = std::make_shared<MappedFile>();
+	uint64_t sizeBytes = 0;
+	if (!pFile->OpenReadOnly(path, sizeBytes))
+	{
+		LOG_ERROR("Failed to open file: %s\n", path);
+		return false;
+	}
+
+	closeWindowed();
+	m_pWindowedFile = std::move(pFile);
+	m_dataSizeBytes = sizeBytes;
+	m_pData.reset();
+	SafeStrcpy(m_path, sizeof(m_path), path);
+	stampFile();
+	m_resident = false;
+	m_readOnly = true;
+	m_reloadFailed = false;
+	m_lastUse = ++s_useCount;
+	markSaved();
+
+	// #TODO: Hash windowed documents on a worker, a window at a time
+	m_blockHashes.clear();
+	m_staleBlockHashes.clear();
+	m_contentHashStale = true;
+	LOG_CHANNEL_DEBUG(ModFile, "Opened windowed, %llu bytes: %s\n", (unsigned long long)sizeBytes, path);
+	return true;
+}
+
+bool ModDocument::ReopenWindowed()
+{
+	HP_ASSERT(IsWindowed());
+
+	std::shared_ptr<MappedFile> pFile = std::make_shared<MappedFile>();
+	uint64_t sizeBytes = 0;
+	if (!pFile->OpenReadOnly(m_path, sizeBytes))
+	{
+		LOG_ERROR("Failed to reopen file: %s\n", m_path);
+		return false;
+	}
+
+	// The cached windows are of the old contents, and the file may have been replaced by another
+	closeWindowed();
+	m_pWindowedFile = std::move(pFile);
+	m_dataSizeBytes = sizeBytes;
+	stampFile();
+	m_lastUse = ++s_useCount;
+	LOG_CHANNEL_DEBUG(ModFile, "Reopened windowed, %llu bytes: %s\n", (unsigned long long)sizeBytes, m_path);
+	return true;
+}
+
+void ModDocument::Reload(std::vector<uint8_t>&& data, const std::vector<FileWriter::Range>& changedRanges, const FileWatcher::Stamp& stamp)
+{
+	HP_ASSERT(m_path[0] != '\0');
+	HP_ASSERT(!m_modified);
+	HP_ASSERT(!IsWindowed());
+
+	m_dataSizeBytes = data.size();
+	m_pData = std::make_shared<std::vector<uint8_t>>(std::move(data));
+	m_resident = true;
+	m_reloadFailed = false;
+	m_lastUse = ++s_useCount;
+	m_fileStamp = stamp;
+	m_hasFileStamp = true;
+
+	resizeBlockHashes();
+	for (const FileWriter::Range& range : changedRanges)
+		markBlockHashesStale(range.offset, range.sizeBytes);
+}
+
+bool ModDocument::Save()
+{
+	HP_ASSERT(m_path[0] != '\0');
+	if (!m_modified)
+		return true;
+	return SaveAs(m_path);
+}
+
+bool ModDocument::SaveAs(const char* path)
+{
+	SaveSnapshot snapshot;
+	if (!BeginSave(path, snapshot))
+		return false;
+	const bool succeeded = WriteSnapshot(snapshot);
+	EndSave(snapshot, succeeded);
+	return succeeded;
+}
+
+bool ModDocument::BeginSave(const char* path, SaveSnapshot& snapshot)
+{
+	HP_ASSERT(path && path[0]);
+
+	if (IsWindowed())
+	{
+		// #TODO: Save as by streaming a copy of the file through windows
+		LOG_ERROR("Can't save, as the file is too large to load: %s\n", m_path);
+		return false;
+	}
+	if (m_readOnly && strcmp(path, m_path) == 0)
+	{
+		LOG_ERROR("Can't save in place, as the file was decompressed when opened. Use Save as: %s\n", path);
+		return false;
+	}
+	if (!GetData() && m_dataSizeBytes > 0)
+		return false;
+
+	SafeStrcpy(snapshot.path, sizeof(snapshot.path), path);
+	snapshot.data = GetResidentView();
+	snapshot.dirtyRanges = std::move(m_dirtyRanges);
+	snapshot.rewriteNeeded = m_rewriteNeeded;
+	snapshot.rewrite = m_rewriteNeeded || strcmp(path, m_path) != 0;
+	snapshot.fileStamp = m_fileStamp;
+	snapshot.hasFileStamp = m_hasFileStamp;
+
+	// Edits from here on are relative to the snapshot
+	m_dirtyRanges.clear();
+	m_rewriteNeeded = false;
+	return true;
+}
+
+bool ModDocument::WriteSnapshot(SaveSnapshot& snapshot)
+{
+	HP_ASSERT(snapshot.data.IsValid());
+	const ModBufferView& data = snapshot.data;
+
+	bool saved = false;
+	if (!snapshot.rewrite)
+	{
+		// Another program may have rewritten the file at the same size, and our ranges would be mixed with its data
+		FileWatcher::Stamp stamp;
+		if (!snapshot.hasFileStamp || !FileWatcher::GetStamp(snapshot.path, stamp) || stamp != snapshot.fileStamp)
+			LOG_CHANNEL_DEBUG(ModFile, "File changed since last loaded or saved, rewriting: %s\n", snapshot.path);
+		else if (FileWriter::WriteRanges(snapshot.path, data.GetSizeBytes(), data.GetData(), snapshot.dirtyRanges.data(), snapshot.dirtyRanges.size()))
+		{
+			LOG_CHANNEL_TRACE(ModFile, "Saved %u range(s) in place: %s\n", (unsigned int)snapshot.dirtyRanges.size(), snapshot.path);
+			saved = true;
+		}
+		else
+			LOG_CHANNEL_DEBUG(ModFile, "Saving in place failed, rewriting: %s\n", snapshot.path);
+	}
+
+	if (!saved)
+	{
+		LOG_CHANNEL_TRACE(ModFile, "Writing file: %s\n", snapshot.path);
+		if (!FileWriter::WriteAtomic(snapshot.path, data.GetData(), data.GetSizeBytes()))
+			return false;
+	}
+	snapshot.hasSavedStamp = FileWatcher::GetStamp(snapshot.path, snapshot.savedStamp);
+	return true;
+}
+
+void ModDocument::EndSave(const SaveSnapshot& snapshot, bool succeeded)
+{
+	if (!succeeded)
+	{
+		// The file is as it was, so the snapshot's changes are still unsaved
+		if (snapshot.rewriteNeeded)
+		{
+			m_rewriteNeeded = true;
+			m_dirtyRanges.clear();
+		}
+		for (const FileWriter::Range& range : snapshot.dirtyRanges)
+			addDirtyRange(range.offset, range.sizeBytes);
+		return;
+	}
+
+	if (strcmp(snapshot.path, m_path) != 0)
+	{
+		SafeStrcpy(m_path, sizeof(m_path), snapshot.path);
+		m_readOnly = false;
+	}
+	m_fileStamp = snapshot.savedStamp;
+	m_hasFileStamp = snapshot.hasSavedStamp;
+	m_modified = m_rewriteNeeded || !m_dirtyRanges.empty();
+	m_saveCount++;
+}
+
+bool ModDocument::Write(uint64_t offset, const void* pData, size_t sizeBytes)
+{
+	HP_ASSERT(offset + sizeBytes <= m_dataSizeBytes);
+	if (sizeBytes == 0)
+		return true;
+
+	if (IsWindowed() || !GetData())
+		return false;
+	memcpy(getWritableData().data() + offset, pData, sizeBytes);
+	addDirtyRange(offset, sizeBytes);
+	markBlockHashesStale(offset, sizeBytes);
+	m_modified = true;
+	return true;
+}
+
+bool ModDocument::Resize(uint64_t sizeBytes)
+{
+	if (sizeBytes == m_dataSizeBytes)
+		return true;
+
+	if (IsWindowed() || (!GetData() && m_dataSizeBytes > 0))
+		return false;
+	if (sizeBytes > SIZE_MAX)
+	{
+		LOG_ERROR("Can't resize to %llu bytes: %s\n", (unsigned long long)sizeBytes, m_path);
+		return false;
+	}
+	const uint64_t oldSizeBytes = m_dataSizeBytes;
+	getWritableData().resize((size_t)sizeBytes);
+	m_dataSizeBytes = sizeBytes;
+	resizeBlockHashes();
+	markBlockHashesStale(Min(oldSizeBytes, sizeBytes), Max(oldSizeBytes, sizeBytes) - Min(oldSizeBytes, sizeBytes));
+	m_rewriteNeeded = true;
+	m_dirtyRanges.clear();
+	m_modified = true;
+	return true;
+}
+
+unsigned int ModDocument::GetDirtyRangeCount() const
+{
+	return (unsigned int)m_dirtyRanges.size();
+}
+
+const char* ModDocument::GetPath() const
+{
+	return m_path;
+}
+
+bool ModDocument::IsModified() const
+{
+	return m_modified;
+}
+
+bool ModDocument::IsReadOnly() const
+{
+	return m_readOnly;
+}
+
+bool ModDocument::IsWindowed() const
+{
+	return m_pWindowedFile != nullptr;
+}
+
+unsigned int ModDocument::GetSaveCount() const
+{
+	return m_saveCount;
+}
+
+const uint8_t* ModDocument::GetData()
+{
+	m_lastUse = ++s_useCount;
+
+	if (IsWindowed())
+		return nullptr;
+	if (!m_resident)
+	{
+		HP_ASSERT(m_path[0] != '\0');
+		if (m_reloadFailed)
+			return nullptr;
+		if (!readFile(m_path))
+		{
+			LOG_ERROR("Failed to reload file: %s\n", m_path);
+			m_pData.reset();
+			m_reloadFailed = true;
+			return nullptr;
+		}
+		LOG_CHANNEL_DEBUG(ModFile, "Reloaded evicted file: %s\n", m_path);
+	}
+	return m_pData->data();
+}
+
+ModBufferView ModDocument::GetView()
+{
+	if (IsWindowed() || (!GetData() && m_dataSizeBytes > 0))
+		return ModBufferView();
+	return GetResidentView();
+}
+
+ModBufferView ModDocument::GetRange(uint64_t offset, size_t sizeBytes)
+{
+	offset = Min(offset, m_dataSizeBytes);
+	sizeBytes = (size_t)Min((uint64_t)sizeBytes, m_dataSizeBytes - offset);
+
+	if (!IsWindowed())
+		return GetView().GetSubview((size_t)offset, sizeBytes);
+
+	m_lastUse = ++s_useCount;
+	if (sizeBytes == 0)
+		return ModBufferView(std::make_shared<Window>(), nullptr, 0);
+
+	// Reuse a cached window containing the range, moving it to the back as the most recently used
+	for (size_t windowIndex = m_windows.size(); windowIndex-- > 0;)
+	{
+		const std::shared_ptr<const Window> pWindow = m_windows[windowIndex];
+		if (offset >= pWindow->offset && offset + sizeBytes <= pWindow->offset + pWindow->data.size())
+		{
+			m_windows.erase(m_windows.begin() + windowIndex);
+			m_windows.push_back(pWindow);
+			return ModBufferView(pWindow, pWindow->data.data() + (offset - pWindow->offset), sizeBytes);
+		}
+	}
+
+	// A range crossing a window boundary gets a window of its own, extended to the next boundary. Read rather than
+	// mapped, so that if another program truncates the file, reading it gives less data rather than SIGBUS.
+	std::shared_ptr<Window> pWindow = std::make_shared<Window>();
+	pWindow->offset = offset - offset % kWindowSizeBytes;
+	const uint64_t windowEnd = Min(Max(pWindow->offset + kWindowSizeBytes, offset + sizeBytes), m_dataSizeBytes);
+	pWindow->data.resize((size_t)(windowEnd - pWindow->offset));
+	size_t bytesRead = 0;
+	if (!m_pWindowedFile->Read(pWindow->offset, pWindow->data.data(), pWindow->data.size(), bytesRead))
+	{
+		LOG_ERROR("Failed to read %llu bytes at %llu: %s\n", (unsigned long long)pWindow->data.size(), (unsigned long long)pWindow->offset, m_path);
+		return ModBufferView();
+	}
+	if (bytesRead < pWindow->data.size())
+	{
+		LOG_CHANNEL_DEBUG(ModFile, "Read %llu of %llu bytes at %llu, as the file has been truncated: %s\n", (unsigned long long)bytesRead,
+			(unsigned long long)pWindow->data.size(), (unsigned long long)pWindow->offset, m_path);
+		pWindow->data.resize(bytesRead);
+	}
+	LOG_CHANNEL_TRACE(ModFile, "Read %llu bytes at %llu: %s\n", (unsigned long long)bytesRead, (unsigned long long)pWindow->offset, m_path);
+
+	if (m_windows.size() >= kMaxCachedWindows)
+		m_windows.erase(m_windows.begin());
+	m_windows.push_back(pWindow);
+	const size_t offsetInWindow = (size_t)Min(offset - pWindow->offset, (uint64_t)pWindow->data.size());
+	const uint8_t* pData = pWindow->data.data() + offsetInWindow;
+	sizeBytes = Min(sizeBytes, pWindow->data.size() - offsetInWindow);
+	return ModBufferView(std::move(pWindow), pData, sizeBytes);
+}
+
+std::shared_ptr<const MappedFile> ModDocument::GetWindowedFile() const
+{
+	return m_pWindowedFile;
+}
+
+ModBufferView ModDocument::GetResidentView() const
+{
+	return ModBufferView(m_pData);
+}
+
+bool ModDocument::GetContentHash(ContentHash::Hash128& hash)
+{
+	if (IsWindowed())
+		return false;
+	if (m_contentHashStale)
+	{
+		const uint8_t* pData = GetData();
+		if (!pData && m_dataSizeBytes > 0)
+			return false;
+
+		unsigned int rehashedCount = 0;
+		for (size_t blockIndex = 0; blockIndex < m_blockHashes.size(); blockIndex++)
+		{
+			if (!m_staleBlockHashes[blockIndex])
+				continue;
+			const size_t offset = blockIndex * kHashBlockSizeBytes;
+			m_blockHashes[blockIndex] = ContentHash::Hash(pData + offset, Min(kHashBlockSizeBytes, (size_t)m_dataSizeBytes - offset));
+			m_staleBlockHashes[blockIndex] = false;
+			rehashedCount++;
+		}
+		m_contentHash = ContentHash::Hash(m_blockHashes.data(), m_blockHashes.size() * sizeof(ContentHash::Hash128));
+		m_contentHashStale = false;
+		LOG_CHANNEL_TRACE(ModFile, "Rehashed %u of %u block(s): %s\n", rehashedCount, (unsigned int)m_blockHashes.size(), m_path);
+	}
+	hash = m_contentHash;
+	return true;
+}
+
+void ModDocument::HashBlocks(const uint8_t* pData, size_t sizeBytes, BlockHashes& blockHashes)
+{
+	blockHashes.resize((sizeBytes + kHashBlockSizeBytes - 1) / kHashBlockSizeBytes);
+	for (size_t blockIndex = 0; blockIndex < blockHashes.size(); blockIndex++)
+	{
+		const size_t offset = blockIndex * kHashBlockSizeBytes;
+		blockHashes[blockIndex] = ContentHash::Hash(pData + offset, Min(kHashBlockSizeBytes, sizeBytes - offset));
+	}
+}
+
+ContentHash::Hash128 ModDocument::HashData(const uint8_t* pData, size_t sizeBytes)
+{
+	BlockHashes blockHashes;
+	HashBlocks(pData, sizeBytes, blockHashes);
+	return ContentHash::Hash(blockHashes.data(), blockHashes.size() * sizeof(ContentHash::Hash128));
+}
+
+uint64_t ModDocument::GetDataSizeBytes() const
+{
+	return m_dataSizeBytes;
+}
+
+bool ModDocument::IsResident() const
+{
+	return m_resident;
+}
+
+bool ModDocument::CanEvict() const
+{
+	return m_resident && !m_modified && m_path[0] != '\0';
+}
+
+void ModDocument::Evict()
+{
+	HP_ASSERT(CanEvict());
+	m_pData.reset();
+	m_resident = false;
+}
+
+size_t ModDocument::GetMemorySizeBytes() const
+{
+	return m_pData ? m_pData->capacity() : 0; // windows are backed by the file
+}
+
+uint64_t ModDocument::GetLastUse() const
+{
+	return m_lastUse;
+}
+
+uint64_t ModDocument::GetUseCount()
+{
+	return s_useCount;
+}
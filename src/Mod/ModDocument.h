@@ -0,0 +1,186 @@
+#pragma once
+
+#include "Core/FileSystem.h" // kMaxPath
+#include "Core/FileWatcher.h"
+#include "Core/FileWriter.h"
+#include "Core/Helpers.h"
+#include "Core/MappedFile.h"
+
+#include "Mod/ModBufferView.h"
+
+#include "Utils/ContentHash.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+//
+// One open module. Documents are owned by ModDocuments and referred to by handle.
+//
+// The data of a document that has a file and no unsaved changes can be evicted to save memory, and is reloaded from
+// the file the next time GetData is called.
+//
+// Edits are tracked as dirty byte ranges. While the size is unchanged, Save overwrites just those ranges of the file
+// in place; otherwise, and whenever that fails, the whole file is rewritten atomically (see FileWriter). Saving in place
+// also needs the file to be as it was last loaded or saved, so that another program's changes aren't mixed with ours.
+//
+// A save can run on a worker thread (see ModSaver) from a snapshot that shares the data. The document copies the
+// data before its next edit if the snapshot is still alive, so the snapshot itself costs nothing.
+//
+// The content hash is a hash of the hashes of fixed-size blocks of the data, so that an edit only rehashes the blocks
+// it touched. Block hashes are computed on the loading thread, or on first use.
+//
+// Files too large to read into memory are opened windowed: the data is never read into the heap whole, and is read
+// through GetRange, which reads and caches windows of the file around the ranges asked for. Windows are copies rather
+// than memory mapped, so that another program truncating the file shortens reads instead of crashing (SIGBUS).
+// Windowed documents are read-only.
+//
+class ModDocument
+{
+public:
+	ModDocument() = default;
+	NON_COPYABLE_CLASS(ModDocument);
+
+	// A document with placeholder data and no file
+	void New();
+	typedef std::vector<ContentHash::Hash128> BlockHashes;
+
+	// Takes data already read from path, see ModLoader. A read-only document can only be saved to another path
+	// e.g. one decompressed from an archive. blockHashes from HashBlocks, or empty to hash on first use. pFileStamp is
+	// the file's, taken before data was read, or null if it has none e.g. an archive member.
+	void Open(const char* path, std::vector<uint8_t>&& data, bool readOnly = false, BlockHashes&& blockHashes = BlockHashes(),
+		const FileWatcher::Stamp* pFileStamp = nullptr);
+
+	// Returns false if the file can't be opened or mapped. Errors are logged.
+	bool OpenWindowed(const char* path);
+
+	// Reopens a windowed document's file after it was changed by another program, taking its new size, and drops the
+	// cached windows. Views of the old windows keep the old contents.
+	bool ReopenWindowed();
+
+	// Replaces the data with the file's new contents after it was changed by another program. Not if modified.
+	// Only the blocks in changedRanges are rehashed. stamp is the file's, taken before data was read.
+	void Reload(std::vector<uint8_t>&& data, const std::vector<FileWriter::Range>& changedRanges, const FileWatcher::Stamp& stamp);
+
+	// The unsaved changes taken by BeginSave
+	struct SaveSnapshot
+	{
+		char path[kMaxPath] = {};
+		ModBufferView data;
+		std::vector<FileWriter::Range> dirtyRanges;
+		bool rewriteNeeded = false; // the document's, restored if the save fails
+		bool rewrite = false; // rewriteNeeded, or saving to another path
+		FileWatcher::Stamp fileStamp; // the file as last loaded or saved, checked before saving in place
+		bool hasFileStamp = false;
+		FileWatcher::Stamp savedStamp; // set by WriteSnapshot
+		bool hasSavedStamp = false;
+	};
+
+	// Does nothing if there are no unsaved changes. Blocks; see ModSaver.
+	bool Save();
+	bool SaveAs(const char* path);
+
+	// Save in three steps, so that WriteSnapshot can run on another thread. Edits made in between are unsaved
+	// changes afterwards. BeginSave returns false if evicted data can't be reloaded, or if a read-only document is
+	// saved to its own path, or if windowed.
+	bool BeginSave(const char* path, SaveSnapshot& snapshot);
+	static bool WriteSnapshot(SaveSnapshot& snapshot);
+	void EndSave(const SaveSnapshot& snapshot, bool succeeded);
+
+	// Return false if evicted data can't be reloaded, or if windowed
+	bool Write(uint64_t offset, const void* pData, size_t sizeBytes);
+	bool Resize(uint64_t sizeBytes);
+
+	// For stats. 0 when the next save rewrites the whole file.
+	unsigned int GetDirtyRangeCount() const;
+
+	// Empty if the document has never been saved
+	const char* GetPath() const;
+
+	// Unsaved changes, including a new document that hasn't been saved yet
+	bool IsModified() const;
+
+	// Until saved to another path
+	bool IsReadOnly() const;
+
+	bool IsWindowed() const;
+
+	// Increases each time the document is saved
+	unsigned int GetSaveCount() const;
+
+	// Reloads the data if it was evicted. Returns nullptr if it can't be reloaded (e.g. the file has been deleted).
+	// Marks the document as used, for eviction. Only valid until the document next changes, so not for other threads.
+	// nullptr if windowed: use GetRange.
+	const uint8_t* GetData();
+	uint64_t GetDataSizeBytes() const;
+
+	// [offset, offset + sizeBytes), clamped to the data. Works whether windowed or not, reloading evicted data like
+	// GetData. Returns an invalid view if the data can't be reloaded or read. If windowed, the range is read into
+	// memory, and is shorter than asked for if the file has been truncated since it was opened.
+	ModBufferView GetRange(uint64_t offset, size_t sizeBytes);
+
+	// For reading a windowed document on other threads a range at a time, with MappedFile::Read. Keeps the file open
+	// after the document is closed or reopened. nullptr if not windowed.
+	std::shared_ptr<const MappedFile> GetWindowedFile() const;
+
+	// For reading on other threads, see ModBufferView. Doesn't copy. GetView reloads the data if it was evicted, like
+	// GetData, and returns an invalid view if it can't. GetResidentView returns an invalid view if evicted. Both return
+	// an invalid view if windowed.
+	ModBufferView GetView();
+	ModBufferView GetResidentView() const;
+
+	// Identical data has the same hash, whether in a document or not (see HashData), so it can be used as a cache key.
+	// Rehashes blocks edited since the last call. Returns false if evicted data can't be reloaded, or if windowed.
+	bool GetContentHash(ContentHash::Hash128& hash);
+
+	// Can be called on any thread
+	static void HashBlocks(const uint8_t* pData, size_t sizeBytes, BlockHashes& blockHashes);
+	static ContentHash::Hash128 HashData(const uint8_t* pData, size_t sizeBytes);
+
+	bool IsResident() const;
+	bool CanEvict() const;
+	void Evict();
+
+	// Memory used by the document's data, cached or not
+	size_t GetMemorySizeBytes() const;
+
+	// Increases each time any document's data is used, so that the least recently used can be found
+	uint64_t GetLastUse() const;
+	static uint64_t GetUseCount();
+
+private:
+	bool readFile(const char* path);
+	void stampFile();
+	std::vector<uint8_t>& getWritableData();
+	void addDirtyRange(uint64_t offset, size_t sizeBytes);
+	void markSaved();
+	void resizeBlockHashes();
+	void markBlockHashesStale(uint64_t offset, uint64_t sizeBytes);
+	void closeWindowed();
+
+	char m_path[kMaxPath] = {};
+	std::shared_ptr<std::vector<uint8_t>> m_pData; // shared with any views, including saves in progress
+	uint64_t m_dataSizeBytes = 0; // kept when evicted
+	bool m_resident = false;
+	bool m_modified = false;
+	bool m_readOnly = false;
+	bool m_reloadFailed = false; // logged once
+	bool m_rewriteNeeded = false; // the size has changed, or the data has never been saved to m_path
+	std::vector<FileWriter::Range> m_dirtyRanges; // sorted and disjoint
+	unsigned int m_saveCount = 0;
+	FileWatcher::Stamp m_fileStamp; // of m_path as last loaded or saved
+	bool m_hasFileStamp = false;
+	uint64_t m_lastUse = 0;
+
+	// Kept when evicted, and marked stale when the data is reloaded from the file
+	BlockHashes m_blockHashes;
+	std::vector<bool> m_staleBlockHashes;
+	bool m_contentHashStale = true; // any block hash is stale
+	ContentHash::Hash128 m_contentHash;
+
+	// Windowed. Windows are shared with views of them, so freed when the last user drops them.
+	struct Window;
+	std::shared_ptr<MappedFile> m_pWindowedFile; // shared with readers on other threads, see GetWindowedFile
+	std::vector<std::shared_ptr<const Window>> m_windows; // the most recently used last
+};
@@ -0,0 +1,218 @@
+#include "ModDocuments.h"
+
+#include "ModDocument.h"
+
+#include "Core/hp_assert.h"
+#include "Core/Log.h"
+
+#include <string.h> // strcmp
+
+#include <algorithm> // std::sort
+#include <memory>
+#include <vector>
+
+struct DocumentEntry
+{
+	ModDocumentHandle handle;
+	std::unique_ptr<ModDocument> pDocument;
+};
+
+static const ModDocuments::Options* s_pOptions;
+static std::vector<DocumentEntry> s_documents; // in the order opened; there are rarely more than a few dozen
+static ModDocumentHandle s_nextHandle = kInvalidModDocumentHandle + 1;
+static ModDocumentHandle s_activeHandle = kInvalidModDocumentHandle;
+static uint64_t s_frameStartUseCount = 0; // documents used since this are in use this frame
+static unsigned int s_evictionCount = 0;
+
+static DocumentEntry* findEntry(ModDocumentHandle handle)
+{
+	for (DocumentEntry& entry : s_documents)
+	{
+		if (entry.handle == handle)
+			return &entry;
+	}
+	return nullptr;
+}
+
+static ModDocumentHandle addDocument(std::unique_ptr<ModDocument> pDocument)
+{
+	const ModDocumentHandle handle = s_nextHandle++;
+	s_documents.push_back({ handle, std::move(pDocument) });
+	s_activeHandle = handle;
+	return handle;
+}
+
+static void evictOverBudget()
+{
+	HP_ASSERT(s_pOptions);
+	const size_t budgetBytes = (size_t)s_pOptions->memoryBudgetMB * 1024 * 1024;
+
+	size_t residentSizeBytes = 0;
+	std::vector<ModDocument*> candidates;
+	for (DocumentEntry& entry : s_documents)
+	{
+		ModDocument& document = *entry.pDocument;
+		residentSizeBytes += document.GetMemorySizeBytes();
+		if (document.CanEvict() && document.GetLastUse() <= s_frameStartUseCount && entry.handle != s_activeHandle)
+			candidates.push_back(&document);
+	}
+	if (residentSizeBytes <= budgetBytes)
+		return;
+
+	// Least recently used first
+	std::sort(candidates.begin(), candidates.end(),
+		[](const ModDocument* pLhs, const ModDocument* pRhs) { return pLhs->GetLastUse() < pRhs->GetLastUse(); });
+	for (ModDocument* pDocument : candidates)
+	{
+		if (residentSizeBytes <= budgetBytes)
+			break;
+		residentSizeBytes -= pDocument->GetMemorySizeBytes();
+		LOG_CHANNEL_DEBUG(ModFile, "Evicting %s\n", pDocument->GetPath());
+		pDocument->Evict();
+		s_evictionCount++;
+	}
+}
+
+void ModDocuments::Init(const Options* pOptions)
+{
+	HP_ASSERT(pOptions);
+	s_pOptions = pOptions;
+}
+
+const ModDocuments::Options& ModDocuments::GetOptions()
+{
+	HP_ASSERT(s_pOptions);
+	return *s_pOptions;
+}
+
+void ModDocuments::Shutdown()
+{
+	s_documents.clear();
+	s_documents.shrink_to_fit();
+	s_activeHandle = kInvalidModDocumentHandle;
+	s_pOptions = nullptr;
+}
+
+void ModDocuments::Update()
+{
+	evictOverBudget();
+	s_frameStartUseCount = ModDocument::GetUseCount();
+}
+
+ModDocumentHandle ModDocuments::New()
+{
+	std::unique_ptr<ModDocument> pDocument = std::make_unique<ModDocument>();
+	pDocument->New();
+	return addDocument(std::move(pDocument));
+}
+
+ModDocumentHandle ModDocuments::Add(const char* path, std::vector<uint8_t>&& data, bool readOnly, std::vector<ContentHash::Hash128>&& blockHashes,
+	const FileWatcher::Stamp* pFileStamp)
+{
+	HP_ASSERT(path && path[0]);
+
+	// Opened again while it was loading
+	const ModDocumentHandle existingHandle = Find(path);
+	if (existingHandle != kInvalidModDocumentHandle)
+	{
+		s_activeHandle = existingHandle;
+		return existingHandle;
+	}
+
+	std::unique_ptr<ModDocument> pDocument = std::make_unique<ModDocument>();
+	pDocument->Open(path, std::move(data), readOnly, std::move(blockHashes), pFileStamp);
+	return addDocument(std::move(pDocument));
+}
+
+ModDocumentHandle ModDocuments::AddWindowed(const char* path)
+{
+	HP_ASSERT(path && path[0]);
+
+	const ModDocumentHandle existingHandle = Find(path);
+	if (existingHandle != kInvalidModDocumentHandle)
+	{
+		s_activeHandle = existingHandle;
+		return existingHandle;
+	}
+
+	std::unique_ptr<ModDocument> pDocument = std::make_unique<ModDocument>();
+	if (!pDocument->OpenWindowed(path))
+		return kInvalidModDocumentHandle;
+	return addDocument(std::move(pDocument));
+}
+
+void ModDocuments::Close(ModDocumentHandle handle)
+{
+	for (size_t index = 0; index < s_documents.size(); index++)
+	{
+		if (s_documents[index].handle != handle)
+			continue;
+
+		s_documents.erase(s_documents.begin() + (ptrdiff_t)index);
+		if (s_activeHandle == handle)
+		{
+			// The next document along, or the last
+			if (index < s_documents.size())
+				s_activeHandle = s_documents[index].handle;
+			else
+				s_activeHandle = s_documents.empty() ? kInvalidModDocumentHandle : s_documents.back().handle;
+		}
+		return;
+	}
+}
+
+unsigned int ModDocuments::GetCount()
+{
+	return (unsigned int)s_documents.size();
+}
+
+ModDocumentHandle ModDocuments::GetHandle(unsigned int index)
+{
+	HP_ASSERT(index < s_documents.size());
+	return s_documents[index].handle;
+}
+
+ModDocument* ModDocuments::Get(ModDocumentHandle handle)
+{
+	DocumentEntry* pEntry = findEntry(handle);
+	return pEntry ? pEntry->pDocument.get() : nullptr;
+}
+
+ModDocumentHandle ModDocuments::Find(const char* path)
+{
+	HP_ASSERT(path);
+	for (const DocumentEntry& entry : s_documents)
+	{
+		// #TODO: Compare canonical paths
+		if (strcmp(entry.pDocument->GetPath(), path) == 0)
+			return entry.handle;
+	}
+	return kInvalidModDocumentHandle;
+}
+
+ModDocumentHandle ModDocuments::GetActive()
+{
+	return s_activeHandle;
+}
+
+void ModDocuments::SetActive(ModDocumentHandle handle)
+{
+	HP_ASSERT(handle == kInvalidModDocumentHandle || findEntry(handle));
+	s_activeHandle = handle;
+}
+
+ModDocuments::Stats ModDocuments::GetStats()
+{
+	Stats stats;
+	stats.documentCount = (unsigned int)s_documents.size();
+	for (const DocumentEntry& entry : s_documents)
+	{
+		if (entry.pDocument->IsResident())
+		{
+			stats.residentCount++;
+			stats.residentSizeBytes += entry.pDocument->GetMemorySizeBytes();
+		}
+	}
+	stats.evictionCount = s_evictionCount;
+	return stats;
+}
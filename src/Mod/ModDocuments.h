@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Core/FileWatcher.h"
+#include "Core/Helpers.h"
+
+#include "Utils/ContentHash.h"
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+
+#include <vector>
+
+class ModDocument;
+
+// Identifies an open document. Handles aren't reused, so a handle to a closed document is simply invalid.
+typedef uint32_t ModDocumentHandle;
+static const ModDocumentHandle kInvalidModDocumentHandle = 0;
+
+//
+// Open modules, each shown in its own ModWindow.
+//
+// The data of documents that haven't been used recently is evicted when the total exceeds the memory budget, least
+// recently used first, and reloaded from file when next needed (see ModDocument). Documents used this frame and
+// documents with unsaved changes are never evicted.
+//
+class ModDocuments
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(ModDocuments);
+
+	struct Options
+	{
+		unsigned int memoryBudgetMB = 256;
+		bool reloadChangedFiles = true; // see ModWatcher
+		unsigned int windowedThresholdMB = 1024; // uncompressed files at least this large are opened windowed
+	};
+
+	struct Stats
+	{
+		unsigned int documentCount = 0;
+		unsigned int residentCount = 0;
+		size_t residentSizeBytes = 0;
+		unsigned int evictionCount = 0;
+	};
+
+	static void Init(const Options* pOptions);
+	static const Options& GetOptions();
+	static void Shutdown();
+
+	// Evicts documents' data while over the memory budget. Call once per frame, after the windows.
+	static void Update();
+
+	static ModDocumentHandle New();
+
+	// Takes data already read from path, see ModLoader and ModDocument::Open
+	static ModDocumentHandle Add(const char* path, std::vector<uint8_t>&& data, bool readOnly = false,
+		std::vector<ContentHash::Hash128>&& blockHashes = std::vector<ContentHash::Hash128>(),
+		const FileWatcher::Stamp* pFileStamp = nullptr);
+
+	// See ModDocument::OpenWindowed. Returns kInvalidModDocumentHandle on failure.
+	static ModDocumentHandle AddWindowed(const char* path);
+
+	// #TODO: Confirm closing documents with unsaved changes
+	static void Close(ModDocumentHandle handle);
+
+	// Documents in the order they were opened
+	static unsigned int GetCount();
+	static ModDocumentHandle GetHandle(unsigned int index);
+
+	// nullptr if the document has been closed
+	static ModDocument* Get(ModDocumentHandle handle);
+
+	static ModDocumentHandle Find(const char* path);
+
+	// The document that File menu commands apply to, usually the most recently focused
+	static ModDocumentHandle GetActive();
+	static void SetActive(ModDocumentHandle handle);
+
+	static Stats GetStats();
+};
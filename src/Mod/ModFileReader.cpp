@@ -0,0 +1,647 @@
+#include "ModFileReader.h"
+
+#include "Core/StringHelpers.h"
+#include "Core/hp_assert.h"
+#include "Core/Log.h"
+
+#include <lzma.h>
+#include <zlib.h>
+
+#include <stdio.h>
+#include <string.h> // memcmp, memcpy, strchr, strcmp
+
+// Cancellation is checked between reads, so this also bounds how long a cancelled read keeps going
+static const size_t kReadSizeBytes = 1024 * 1024;
+
+// Decompressed data grows by at least this much when the stored size is missing or wrong
+static const size_t kMinGrowSizeBytes = 1024 * 1024;
+
+// What a std::vector can hold. Larger raw files are opened windowed, see ModDocument::OpenWindowed.
+static const uint64_t kMaxDataSizeBytes = SIZE_MAX;
+
+// Deflate can't compress by more than this, so a larger stored size is corrupt and isn't allocated up front
+static const uint64_t kMaxDeflateRatio = 1032;
+
+static const uint8_t kGzipMagic[] = { 0x1f, 0x8b };
+static const uint8_t kXzMagic[] = { 0xfd, '7', 'z', 'X', 'Z', 0x00 };
+static const uint8_t kZipMagic[] = { 'P', 'K', 3, 4 };
+static const uint8_t kEmptyZipMagic[] = { 'P', 'K', 5, 6 };
+static const size_t kMagicSizeBytes = sizeof(kXzMagic); // the longest
+
+static const uint32_t kZipLocalHeaderSignature = 0x04034b50;
+static const uint32_t kZipCentralHeaderSignature = 0x02014b50;
+static const uint32_t kZipEndOfCentralDirectorySignature = 0x06054b50;
+static const size_t kZipLocalHeaderSizeBytes = 30;
+static const size_t kZipCentralHeaderSizeBytes = 46;
+static const size_t kZipEndOfCentralDirectorySizeBytes = 22;
+static const size_t kZipMaxCommentSizeBytes = 0xffff;
+static const uint16_t kZipMethodStored = 0;
+static const uint16_t kZipMethodDeflated = 8;
+
+struct ReadContext
+{
+	const char* path = nullptr; // for messages
+	FILE* pFile = nullptr;
+	uint64_t fileSizeBytes = 0;
+	ModFileReader::Progress* pProgress = nullptr;
+	uint64_t inputBytesRead = 0; // for progress
+	std::vector<uint8_t> inputBuffer;
+};
+
+static uint16_t readLE16(const uint8_t* p)
+{
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t readLE32(const uint8_t* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool isCancelled(const ReadContext& context)
+{
+	return context.pProgress && context.pProgress->cancel.load(std::memory_order_relaxed);
+}
+
+// 64-bit fseek(SEEK_SET) and ftell, as long is 32 bits on Windows
+static bool seekFile(FILE* pFile, uint64_t offset)
+{
+#ifdef _MSC_VER
+	return _fseeki64(pFile, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(pFile, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static bool tellFile(FILE* pFile, uint64_t& offset)
+{
+#ifdef _MSC_VER
+	const __int64 position = _ftelli64(pFile);
+#else
+	const off_t position = ftello(pFile);
+#endif
+	if (position < 0)
+		return false;
+	offset = (uint64_t)position;
+	return true;
+}
+
+static bool readAt(ReadContext& context, uint64_t offset, void* pBuffer, size_t sizeBytes)
+{
+	return seekFile(context.pFile, offset) && fread(pBuffer, 1, sizeBytes, context.pFile) == sizeBytes;
+}
+
+// Reads the next chunk of compressed input, up to remainingBytes, into the input buffer. Returns 0 at the end.
+static size_t readInput(ReadContext& context, uint64_t remainingBytes)
+{
+	if (context.inputBuffer.empty())
+		context.inputBuffer.resize(kReadSizeBytes);
+	const size_t bytesRead = fread(context.inputBuffer.data(), 1, (size_t)Min((uint64_t)kReadSizeBytes, remainingBytes), context.pFile);
+	context.inputBytesRead += bytesRead;
+	if (context.pProgress)
+		context.pProgress->bytesRead.store(context.inputBytesRead, std::memory_order_relaxed);
+	return bytesRead;
+}
+
+// Makes room for more output after outputSizeBytes
+static bool growOutput(const ReadContext& context, std::vector<uint8_t>& data, size_t outputSizeBytes)
+{
+	if (outputSizeBytes < data.size())
+		return true;
+	if (data.size() >= kMaxDataSizeBytes)
+	{
+		LOG_ERROR("File too large when decompressed: %s\n", context.path);
+		return false;
+	}
+	data.resize((size_t)Min((uint64_t)Max(data.size() * 2, data.size() + kMinGrowSizeBytes), kMaxDataSizeBytes));
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+
+static bool readRaw(ReadContext& context, uint64_t sizeBytes, std::vector<uint8_t>& data, size_t& outputSizeBytes)
+{
+	if (sizeBytes > kMaxDataSizeBytes)
+	{
+		LOG_ERROR("File too large: %s\n", context.path);
+		return false;
+	}
+
+	data.resize((size_t)sizeBytes);
+	outputSizeBytes = 0;
+	while (outputSizeBytes < data.size())
+	{
+		if (isCancelled(context))
+			return false;
+
+		const size_t readSizeBytes = Min(kReadSizeBytes, data.size() - outputSizeBytes);
+		const size_t numElementsRead = fread(data.data() + outputSizeBytes, 1, readSizeBytes, context.pFile);
+		outputSizeBytes += numElementsRead;
+		context.inputBytesRead += numElementsRead;
+		if (context.pProgress)
+			context.pProgress->bytesRead.store(context.inputBytesRead, std::memory_order_relaxed);
+		if (numElementsRead != readSizeBytes)
+		{
+			LOG_ERROR("File read failed: %s\n", context.path);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Inflates inputSizeBytes of the file from the current position. windowBits selects the format, see inflateInit2.
+static bool inflateInput(ReadContext& context, uint64_t inputSizeBytes, int windowBits, std::vector<uint8_t>& data, size_t& outputSizeBytes)
+{
+	z_stream stream = {};
+	if (inflateInit2(&stream, windowBits) != Z_OK)
+		return false;
+
+	uint64_t remainingInputBytes = inputSizeBytes;
+	int result = Z_OK;
+	bool ok = true;
+	for (;;)
+	{
+		if (stream.avail_in == 0)
+		{
+			if (remainingInputBytes == 0)
+				break;
+			if (isCancelled(context))
+			{
+				ok = false;
+				break;
+			}
+			const size_t bytesRead = readInput(context, remainingInputBytes);
+			if (bytesRead == 0)
+			{
+				LOG_ERROR("File read failed: %s\n", context.path);
+				ok = false;
+				break;
+			}
+			remainingInputBytes -= bytesRead;
+			stream.next_in = context.inputBuffer.data();
+			stream.avail_in = (uInt)bytesRead;
+		}
+
+		if (!growOutput(context, data, outputSizeBytes))
+		{
+			ok = false;
+			break;
+		}
+		const size_t availableSizeBytes = Min(data.size() - outputSizeBytes, (size_t)UINT32_MAX);
+		stream.next_out = data.data() + outputSizeBytes;
+		stream.avail_out = (uInt)availableSizeBytes;
+		result = inflate(&stream, Z_NO_FLUSH);
+		outputSizeBytes += availableSizeBytes - stream.avail_out;
+
+		if (result == Z_STREAM_END)
+		{
+			// A gzip file can hold several members one after another, but a raw deflate stream (zip) is one
+			if (windowBits < 0 || (stream.avail_in == 0 && remainingInputBytes == 0))
+				break;
+			if (inflateReset(&stream) != Z_OK)
+			{
+				ok = false;
+				break;
+			}
+		}
+		else if (result != Z_OK && result != Z_BUF_ERROR)
+		{
+			LOG_ERROR("Decompression failed (%s): %s\n", stream.msg ? stream.msg : "zlib error", context.path);
+			ok = false;
+			break;
+		}
+	}
+	inflateEnd(&stream);
+
+	if (ok && result != Z_STREAM_END)
+	{
+		LOG_ERROR("Compressed data is truncated: %s\n", context.path);
+		return false;
+	}
+	return ok;
+}
+
+static bool readGzip(ReadContext& context, std::vector<uint8_t>& data, size_t& outputSizeBytes)
+{
+	// The uncompressed size modulo 2^32 is stored at the end. Just a hint: there may be several members.
+	uint8_t sizeBytes[4];
+	if (context.fileSizeBytes >= sizeof(sizeBytes) && readAt(context, context.fileSizeBytes - sizeof(sizeBytes), sizeBytes, sizeof(sizeBytes)))
+		data.resize((size_t)Min((uint64_t)readLE32(sizeBytes), context.fileSizeBytes * kMaxDeflateRatio));
+	if (!seekFile(context.pFile, 0))
+		return false;
+
+	outputSizeBytes = 0;
+	return inflateInput(context, context.fileSizeBytes, MAX_WBITS + 16, data, outputSizeBytes);
+}
+
+// From the index at the end of the last stream. 0 if unknown.
+static uint64_t getXzUncompressedSize(ReadContext& context)
+{
+	if (context.fileSizeBytes < LZMA_STREAM_HEADER_SIZE * 2)
+		return 0;
+
+	// The stream footer gives the size of the index, which is just before it
+	uint8_t footer[LZMA_STREAM_HEADER_SIZE];
+	lzma_stream_flags streamFlags;
+	if (!readAt(context, context.fileSizeBytes - sizeof(footer), footer, sizeof(footer)) || lzma_stream_footer_decode(&streamFlags, footer) != LZMA_OK)
+		return 0;
+	if (streamFlags.backward_size > context.fileSizeBytes - LZMA_STREAM_HEADER_SIZE * 2)
+		return 0;
+
+	std::vector<uint8_t> indexBytes((size_t)streamFlags.backward_size);
+	if (!readAt(context, context.fileSizeBytes - sizeof(footer) - indexBytes.size(), indexBytes.data(), indexBytes.size()))
+		return 0;
+	lzma_index* pIndex = nullptr;
+	uint64_t memoryLimit = UINT64_MAX;
+	size_t position = 0;
+	if (lzma_index_buffer_decode(&pIndex, &memoryLimit, nullptr, indexBytes.data(), &position, indexBytes.size()) != LZMA_OK)
+		return 0;
+	const uint64_t sizeBytes = lzma_index_uncompressed_size(pIndex);
+	lzma_index_end(pIndex, nullptr);
+	return sizeBytes;
+}
+
+static bool readXz(ReadContext& context, std::vector<uint8_t>& data, size_t& outputSizeBytes)
+{
+	data.resize((size_t)Min(getXzUncompressedSize(context), kMaxDataSizeBytes));
+	if (!seekFile(context.pFile, 0))
+		return false;
+
+	lzma_stream stream = LZMA_STREAM_INIT;
+	if (lzma_stream_decoder(&stream, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK)
+		return false;
+
+	outputSizeBytes = 0;
+	uint64_t remainingInputBytes = context.fileSizeBytes;
+	lzma_action action = LZMA_RUN;
+	bool ok = true;
+	for (;;)
+	{
+		if (stream.avail_in == 0 && action == LZMA_RUN)
+		{
+			if (isCancelled(context))
+			{
+				ok = false;
+				break;
+			}
+			const size_t bytesRead = readInput(context, remainingInputBytes);
+			remainingInputBytes -= bytesRead;
+			stream.next_in = context.inputBuffer.data();
+			stream.avail_in = bytesRead;
+			if (remainingInputBytes == 0)
+				action = LZMA_FINISH; // required to end concatenated streams
+		}
+
+		if (!growOutput(context, data, outputSizeBytes))
+		{
+			ok = false;
+			break;
+		}
+		const size_t availableSizeBytes = data.size() - outputSizeBytes;
+		stream.next_out = data.data() + outputSizeBytes;
+		stream.avail_out = availableSizeBytes;
+		const lzma_ret result = lzma_code(&stream, action);
+		outputSizeBytes += availableSizeBytes - stream.avail_out;
+
+		if (result == LZMA_STREAM_END)
+			break;
+		if (result != LZMA_OK)
+		{
+			LOG_ERROR("Decompression failed (xz error %d): %s\n", (int)result, context.path);
+			ok = false;
+			break;
+		}
+	}
+	lzma_end(&stream);
+	return ok;
+}
+
+// Returns false, without logging an error, if there is no central directory
+static bool readZipCentralDirectory(ReadContext& context, std::vector<ModFileReader::ArchiveMember>& members)
+{
+	// The end of central directory record is at the end, before a comment of up to 64 KB
+	const size_t tailSizeBytes = (size_t)Min(context.fileSizeBytes, (uint64_t)(kZipEndOfCentralDirectorySizeBytes + kZipMaxCommentSizeBytes));
+	if (tailSizeBytes < kZipEndOfCentralDirectorySizeBytes)
+		return false;
+	std::vector<uint8_t> tail(tailSizeBytes);
+	if (!readAt(context, context.fileSizeBytes - tailSizeBytes, tail.data(), tailSizeBytes))
+		return false;
+
+	const uint8_t* pEnd = nullptr;
+	for (size_t offset = tailSizeBytes - kZipEndOfCentralDirectorySizeBytes + 1; offset-- > 0;)
+	{
+		if (readLE32(&tail[offset]) == kZipEndOfCentralDirectorySignature)
+		{
+			pEnd = &tail[offset];
+			break;
+		}
+	}
+	if (!pEnd)
+		return false;
+
+	const unsigned int entryCount = readLE16(pEnd + 10);
+	const uint32_t directorySizeBytes = readLE32(pEnd + 12);
+	const uint32_t directoryOffset = readLE32(pEnd + 16);
+	if (entryCount == 0xffff || directoryOffset == 0xffffffff)
+	{
+		// #TODO: Zip64
+		LOG_ERROR("Zip64 archives are not supported: %s\n", context.path);
+		return false;
+	}
+	if ((uint64_t)directoryOffset + directorySizeBytes > context.fileSizeBytes)
+	{
+		LOG_ERROR("Corrupt zip archive: %s\n", context.path);
+		return false;
+	}
+
+	std::vector<uint8_t> directory(directorySizeBytes);
+	if (!readAt(context, directoryOffset, directory.data(), directory.size()))
+		return false;
+
+	members.clear();
+	size_t offset = 0;
+	for (unsigned int entryIndex = 0; entryIndex < entryCount; entryIndex++)
+	{
+		const uint8_t* pEntry = directory.data() + offset;
+		if (offset + kZipCentralHeaderSizeBytes > directory.size() || readLE32(pEntry) != kZipCentralHeaderSignature)
+		{
+			LOG_ERROR("Corrupt zip archive: %s\n", context.path);
+			return false;
+		}
+		const size_t nameLength = readLE16(pEntry + 28);
+		const size_t entrySizeBytes = kZipCentralHeaderSizeBytes + nameLength + readLE16(pEntry + 30) + readLE16(pEntry + 32);
+		if (offset + entrySizeBytes > directory.size())
+		{
+			LOG_ERROR("Corrupt zip archive: %s\n", context.path);
+			return false;
+		}
+		offset += entrySizeBytes;
+
+		const char* pName = (const char*)pEntry + kZipCentralHeaderSizeBytes;
+		if (nameLength == 0 || pName[nameLength - 1] == '/')
+			continue; // directory
+
+		ModFileReader::ArchiveMember member;
+		if (nameLength >= sizeof(member.name))
+		{
+			LOG_WARN("Skipped zip archive member with a name too long: %s\n", context.path);
+			continue;
+		}
+		SafeStrncpy(member.name, sizeof(member.name), pName, nameLength);
+		member.method = readLE16(pEntry + 10);
+		member.crc32 = readLE32(pEntry + 16);
+		member.compressedSizeBytes = readLE32(pEntry + 20);
+		member.sizeBytes = readLE32(pEntry + 24);
+		member.localHeaderOffset = readLE32(pEntry + 42);
+		members.push_back(member);
+	}
+	return true;
+}
+
+// memberName nullptr for the archive's only member
+static bool readZip(ReadContext& context, const char* memberName, std::vector<uint8_t>& data, size_t& outputSizeBytes)
+{
+	std::vector<ModFileReader::ArchiveMember> members;
+	if (!readZipCentralDirectory(context, members))
+	{
+		LOG_ERROR("Failed to read zip archive: %s\n", context.path);
+		return false;
+	}
+
+	const ModFileReader::ArchiveMember* pMember = nullptr;
+	if (!memberName)
+	{
+		if (members.size() != 1)
+		{
+			LOG_ERROR("Zip archive holds %u files, so one must be chosen: %s\n", (unsigned int)members.size(), context.path);
+			return false;
+		}
+		pMember = &members[0];
+	}
+	for (const ModFileReader::ArchiveMember& member : members)
+	{
+		if (memberName && strcmp(member.name, memberName) == 0)
+			pMember = &member;
+	}
+	if (!pMember)
+	{
+		LOG_ERROR("File not found in zip archive: %s\n", context.path);
+		return false;
+	}
+	if (pMember->method != kZipMethodStored && pMember->method != kZipMethodDeflated)
+	{
+		LOG_ERROR("Unsupported zip compression method %u: %s\n", pMember->method, context.path);
+		return false;
+	}
+
+	// The local header's name and extra field lengths can differ from the central directory's
+	uint8_t localHeader[kZipLocalHeaderSizeBytes];
+	if (!readAt(context, pMember->localHeaderOffset, localHeader, sizeof(localHeader)) || readLE32(localHeader) != kZipLocalHeaderSignature)
+	{
+		LOG_ERROR("Corrupt zip archive: %s\n", context.path);
+		return false;
+	}
+	const uint64_t dataOffset = pMember->localHeaderOffset + kZipLocalHeaderSizeBytes + readLE16(localHeader + 26) + readLE16(localHeader + 28);
+	if (dataOffset + pMember->compressedSizeBytes > context.fileSizeBytes || !seekFile(context.pFile, dataOffset))
+	{
+		LOG_ERROR("Corrupt zip archive: %s\n", context.path);
+		return false;
+	}
+
+	if (context.pProgress)
+		context.pProgress->sizeBytes.store(pMember->compressedSizeBytes, std::memory_order_relaxed);
+	bool ok;
+	if (pMember->method == kZipMethodStored)
+		ok = readRaw(context, pMember->compressedSizeBytes, data, outputSizeBytes);
+	else
+	{
+		data.resize((size_t)Min(Min(pMember->sizeBytes, pMember->compressedSizeBytes * kMaxDeflateRatio), kMaxDataSizeBytes));
+		outputSizeBytes = 0;
+		ok = inflateInput(context, pMember->compressedSizeBytes, -MAX_WBITS, data, outputSizeBytes);
+	}
+	if (!ok)
+		return false;
+
+	if (crc32_z(0, data.data(), outputSizeBytes) != pMember->crc32)
+	{
+		LOG_ERROR("Zip archive member failed its CRC check: %s\n", context.path);
+		return false;
+	}
+	return true;
+}
+
+static ModFileReader::Format sniffFormat(const uint8_t* pHeader, size_t headerSizeBytes)
+{
+	if (headerSizeBytes >= sizeof(kGzipMagic) && memcmp(pHeader, kGzipMagic, sizeof(kGzipMagic)) == 0)
+		return ModFileReader::Format::Gzip;
+	if (headerSizeBytes >= sizeof(kXzMagic) && memcmp(pHeader, kXzMagic, sizeof(kXzMagic)) == 0)
+		return ModFileReader::Format::Xz;
+	if (headerSizeBytes >= sizeof(kZipMagic) && (memcmp(pHeader, kZipMagic, sizeof(kZipMagic)) == 0 || memcmp(pHeader, kEmptyZipMagic, sizeof(kEmptyZipMagic)) == 0))
+		return ModFileReader::Format::Zip;
+	return ModFileReader::Format::Raw;
+}
+
+static bool isZipArchive(const char* filePath)
+{
+	FILE* pFile = fopen(filePath, "rb");
+	if (!pFile)
+		return false;
+
+	uint8_t header[kMagicSizeBytes];
+	const size_t headerSizeBytes = fread(header, 1, sizeof(header), pFile);
+	fclose(pFile);
+	return sniffFormat(header, headerSizeBytes) == ModFileReader::Format::Zip;
+}
+
+// '|' is legal in POSIX filenames, so a separator only starts a member name if the path before it is a zip archive
+// and the whole path isn't a file of its own. Null if path isn't a member path.
+static const char* findMemberSeparator(const char* path)
+{
+	const char* pSeparator = strchr(path, ModFileReader::kMemberSeparator);
+	if (!pSeparator)
+		return nullptr;
+
+	FILE* pFile = fopen(path, "rb");
+	if (pFile)
+	{
+		fclose(pFile);
+		return nullptr;
+	}
+
+	char filePath[kMaxPath];
+	for (; pSeparator; pSeparator = strchr(pSeparator + 1, ModFileReader::kMemberSeparator))
+	{
+		const size_t filePathLength = (size_t)(pSeparator - path);
+		if (filePathLength >= sizeof(filePath))
+			break;
+		memcpy(filePath, path, filePathLength);
+		filePath[filePathLength] = '\0';
+		if (isZipArchive(filePath))
+			return pSeparator;
+	}
+	return nullptr;
+}
+
+// Opens the file and identifies its format
+static bool openFile(const char* filePath, ReadContext& context, ModFileReader::Format& format)
+{
+	context.pFile = fopen(filePath, "rb");
+	if (!context.pFile)
+		return false;
+
+	if (fseek(context.pFile, 0, SEEK_END) != 0 || !tellFile(context.pFile, context.fileSizeBytes))
+		return false;
+
+	uint8_t header[kMagicSizeBytes];
+	seekFile(context.pFile, 0);
+	const size_t headerSizeBytes = fread(header, 1, sizeof(header), context.pFile);
+	seekFile(context.pFile, 0);
+	format = sniffFormat(header, headerSizeBytes);
+	return true;
+}
+
+//------------------------------------------------------------------------------------------------
+
+bool ModFileReader::Read(const char* path, std::vector<uint8_t>& data, Progress* pProgress, Format* pFormat)
+{
+	HP_ASSERT(path && path[0]);
+
+	const char* pSeparator = findMemberSeparator(path);
+	const char* memberName = pSeparator ? pSeparator + 1 : nullptr;
+	char filePath[kMaxPath];
+	SafeStrncpy(filePath, sizeof(filePath), path, pSeparator ? (size_t)(pSeparator - path) : strlen(path));
+
+	ReadContext context;
+	context.path = path;
+	context.pProgress = pProgress;
+	Format format = Format::Raw;
+	if (!openFile(filePath, context, format))
+	{
+		LOG_ERROR("Failed to open file for read: %s\n", filePath);
+		if (context.pFile)
+			fclose(context.pFile);
+		return false;
+	}
+	LOG_CHANNEL_TRACE(ModFile, "Opened file: %s\n", filePath);
+	if (pProgress)
+		pProgress->sizeBytes.store(context.fileSizeBytes, std::memory_order_relaxed);
+
+	size_t outputSizeBytes = 0;
+	bool ok = false;
+	if (memberName && format != Format::Zip)
+		LOG_ERROR("Not a zip archive: %s\n", filePath);
+	else
+	{
+		switch (format)
+		{
+		case Format::Raw: ok = readRaw(context, context.fileSizeBytes, data, outputSizeBytes); break;
+		case Format::Gzip: ok = readGzip(context, data, outputSizeBytes); break;
+		case Format::Xz: ok = readXz(context, data, outputSizeBytes); break;
+		case Format::Zip: ok = readZip(context, memberName, data, outputSizeBytes); break;
+		}
+	}
+	fclose(context.pFile);
+	context.pFile = nullptr;
+
+	if (!ok)
+	{
+		data.clear();
+		data.shrink_to_fit();
+		return false;
+	}
+
+	// Allocated from the stored size, or grown
+	if (data.size() != outputSizeBytes || data.capacity() != outputSizeBytes)
+	{
+		data.resize(outputSizeBytes);
+		data.shrink_to_fit();
+	}
+	if (format != Format::Raw)
+		LOG_CHANNEL_DEBUG(ModFile, "Decompressed %llu bytes to %llu: %s\n", (unsigned long long)context.inputBytesRead, (unsigned long long)outputSizeBytes, path);
+	if (pFormat)
+		*pFormat = format;
+	return true;
+}
+
+bool ModFileReader::GetFormat(const char* path, Format& format, uint64_t& fileSizeBytes)
+{
+	HP_ASSERT(path && path[0]);
+
+	ReadContext context;
+	context.path = path;
+	const bool ok = openFile(path, context, format);
+	if (context.pFile)
+		fclose(context.pFile);
+	fileSizeBytes = context.fileSizeBytes;
+	return ok;
+}
+
+bool ModFileReader::ListArchiveMembers(const char* path, std::vector<ArchiveMember>& members)
+{
+	HP_ASSERT(path && path[0]);
+
+	ReadContext context;
+	context.path = path;
+	Format format = Format::Raw;
+	const bool ok = openFile(path, context, format) && format == Format::Zip && readZipCentralDirectory(context, members);
+	if (context.pFile)
+		fclose(context.pFile);
+	return ok;
+}
+
+bool ModFileReader::IsMemberPath(const char* path)
+{
+	return findMemberSeparator(path) != nullptr;
+}
+
+void ModFileReader::MakeMemberPath(char* path, size_t pathSize, const char* archivePath, const char* memberName)
+{
+	SafeSnprintf(path, pathSize, "%s%c%s", archivePath, kMemberSeparator, memberName);
+}
+
+void ModFileReader::GetFilePath(const char* path, char* filePath, size_t filePathSize)
+{
+	const char* pSeparator = findMemberSeparator(path);
+	const size_t filePathLength = pSeparator ? (size_t)(pSeparator - path) : strlen(path);
+	SafeStrncpy(filePath, filePathSize, path, filePathLength);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Core/FileSystem.h" // kMaxPath
+#include "Core/Helpers.h"
+
+#include <stdint.h>
+
+#include <atomic>
+#include <vector>
+
+//
+// Reads a module file into memory. Used on the UI thread and on worker threads.
+//
+// Compressed files are recognised by their contents rather than their extension. gzip and xz files are decompressed
+// as they are read, straight into the data, which is allocated up front from the size stored in the file where
+// there is one. Members of zip archives (stored or deflated) are referred to by "<archive path>|<member name>".
+//
+class ModFileReader
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(ModFileReader);
+
+	static constexpr char kMemberSeparator = '|';
+
+	enum class Format
+	{
+		Raw,
+		Gzip,
+		Xz,
+		Zip,
+	};
+
+	// For reads on worker threads
+	struct Progress
+	{
+		std::atomic<uint64_t> sizeBytes { 0 }; // of the file, or the compressed member. 0 until opened.
+		std::atomic<uint64_t> bytesRead { 0 };
+		std::atomic<bool> cancel { false }; // set by the caller
+	};
+
+	struct ArchiveMember
+	{
+		char name[kMaxPath] = {};
+		uint64_t sizeBytes = 0; // uncompressed
+		uint64_t compressedSizeBytes = 0;
+		uint32_t crc32 = 0;
+		uint16_t method = 0;
+		uint64_t localHeaderOffset = 0;
+	};
+
+	// Replaces data with the file's contents, decompressed. A zip archive's own path reads its only member.
+	// Returns false on failure or if cancelled. Errors are logged.
+	static bool Read(const char* path, std::vector<uint8_t>& data, Progress* pProgress = nullptr, Format* pFormat = nullptr);
+
+	// Identifies the format of a file (not a member path) from its first bytes. Returns false if it can't be opened.
+	static bool GetFormat(const char* path, Format& format, uint64_t& fileSizeBytes);
+
+	// Lists a zip archive's files from its central directory, without reading them. Returns false, without logging
+	// an error, if the file isn't a zip archive.
+	static bool ListArchiveMembers(const char* path, std::vector<ArchiveMember>& members);
+
+	// Only if the path before a separator is an existing zip archive, as '|' is legal in POSIX filenames. A path that
+	// is a file of its own is never a member path. Opens files to check, so not for every frame.
+	static bool IsMemberPath(const char* path);
+	static void MakeMemberPath(char* path, size_t pathSize, const char* archivePath, const char* memberName);
+
+	// The file that contains path's data e.g. the archive of a member path
+	static void GetFilePath(const char* path, char* filePath, size_t filePathSize);
+};
@@ -0,0 +1,201 @@
+#include "ModLoader.h"
+
+#include "ModDocument.h"
+#include "ModFileReader.h"
+
+#include "Core/FileSystem.h" // kMaxPath
+#include "Core/FileWatcher.h"
+#include "Core/StringHelpers.h"
+#include "Core/hp_assert.h"
+#include "Core/Log.h"
+
+#include <algorithm> // std::remove_if
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+struct LoadJob
+{
+	char path[kMaxPath] = {};
+	std::thread thread;
+	uint64_t windowedThresholdBytes = 0;
+
+	ModFileReader::Progress progress;
+	std::atomic<bool> done { false };
+
+	// Written by the worker thread before done
+	bool ok = false;
+	std::vector<uint8_t> data;
+	ModDocument::BlockHashes blockHashes;
+	ModFileReader::Format format = ModFileReader::Format::Raw;
+	FileWatcher::Stamp fileStamp;
+	bool hasFileStamp = false; // not for archive members
+	bool windowed = false; // instead of data, when too large to load
+	std::vector<ModFileReader::ArchiveMember> archiveMembers; // instead of data, when one must be chosen
+};
+
+static std::unique_ptr<LoadJob> s_pLoadJob;
+static std::vector<std::unique_ptr<LoadJob>> s_cancelledJobs; // freed by Update once their workers finish
+
+static char s_archivePath[kMaxPath] = {};
+static std::vector<ModFileReader::ArchiveMember> s_archiveMembers;
+
+//------------------------------------------------------------------------------------------------
+
+static void loadThreadFunc(LoadJob* pJob)
+{
+	// Only the central directory is read, which is at the end, so this is quick even for large archives
+	if (!ModFileReader::IsMemberPath(pJob->path) && ModFileReader::ListArchiveMembers(pJob->path, pJob->archiveMembers) && pJob->archiveMembers.size() > 1)
+	{
+		pJob->ok = true;
+		pJob->done.store(true, std::memory_order_release);
+		return;
+	}
+	pJob->archiveMembers.clear();
+
+	// Compressed files can only be read start to end, so are always loaded
+	uint64_t fileSizeBytes = 0;
+	if (!ModFileReader::IsMemberPath(pJob->path) && ModFileReader::GetFormat(pJob->path, pJob->format, fileSizeBytes)
+		&& pJob->format == ModFileReader::Format::Raw && fileSizeBytes >= pJob->windowedThresholdBytes)
+	{
+		pJob->windowed = true;
+		pJob->ok = true;
+		pJob->done.store(true, std::memory_order_release);
+		return;
+	}
+
+	// Before reading, so that a change made while reading shows as a different stamp
+	pJob->hasFileStamp = !ModFileReader::IsMemberPath(pJob->path) && FileWatcher::GetStamp(pJob->path, pJob->fileStamp);
+	pJob->ok = ModFileReader::Read(pJob->path, pJob->data, &pJob->progress, &pJob->format);
+	if (pJob->ok)
+		ModDocument::HashBlocks(pJob->data.data(), pJob->data.size(), pJob->blockHashes); // here rather than on the UI thread
+	pJob->done.store(true, std::memory_order_release);
+}
+
+static void freeFinishedCancelledJobs()
+{
+	s_cancelledJobs.erase(std::remove_if(s_cancelledJobs.begin(), s_cancelledJobs.end(),
+		[](std::unique_ptr<LoadJob>& pJob)
+		{
+			if (!pJob->done.load(std::memory_order_acquire))
+				return false;
+			pJob->thread.join();
+			return true;
+		}),
+		s_cancelledJobs.end());
+}
+
+//------------------------------------------------------------------------------------------------
+
+void ModLoader::Shutdown()
+{
+	Cancel();
+	for (std::unique_ptr<LoadJob>& pJob : s_cancelledJobs)
+		pJob->thread.join();
+	s_cancelledJobs.clear();
+	s_cancelledJobs.shrink_to_fit();
+	ClearArchiveMembers();
+}
+
+void ModLoader::Start(const char* path)
+{
+	HP_ASSERT(path && path[0]);
+	Cancel();
+
+	s_pLoadJob = std::make_unique<LoadJob>();
+	LoadJob& job = *s_pLoadJob;
+	SafeStrcpy(job.path, sizeof(job.path), path);
+	job.windowedThresholdBytes = (uint64_t)ModDocuments::GetOptions().windowedThresholdMB * 1024 * 1024;
+	job.thread = std::thread(loadThreadFunc, s_pLoadJob.get());
+	LOG_CHANNEL_TRACE(ModFile, "Loading file: %s\n", path);
+}
+
+void ModLoader::Cancel()
+{
+	if (!s_pLoadJob)
+		return;
+
+	LOG_INFO("Cancelled loading %s\n", s_pLoadJob->path);
+	s_pLoadJob->progress.cancel.store(true, std::memory_order_relaxed);
+	s_cancelledJobs.push_back(std::move(s_pLoadJob));
+}
+
+ModDocumentHandle ModLoader::Update()
+{
+	freeFinishedCancelledJobs();
+
+	if (!s_pLoadJob || !s_pLoadJob->done.load(std::memory_order_acquire))
+		return kInvalidModDocumentHandle;
+
+	std::unique_ptr<LoadJob> pJob = std::move(s_pLoadJob);
+	pJob->thread.join();
+	if (!pJob->ok)
+	{
+		LOG_ERROR("Failed to load file: %s\n", pJob->path);
+		return kInvalidModDocumentHandle;
+	}
+
+	if (!pJob->archiveMembers.empty())
+	{
+		LOG_INFO("Zip archive holds %u files: %s\n", (unsigned int)pJob->archiveMembers.size(), pJob->path);
+		SafeStrcpy(s_archivePath, sizeof(s_archivePath), pJob->path);
+		s_archiveMembers = std::move(pJob->archiveMembers);
+		return kInvalidModDocumentHandle;
+	}
+
+	if (pJob->windowed)
+	{
+		LOG_INFO("Opened file windowed, as it is too large to load: %s\n", pJob->path);
+		return ModDocuments::AddWindowed(pJob->path);
+	}
+
+	LOG_INFO("Loaded file: %s\n", pJob->path);
+	return ModDocuments::Add(pJob->path, std::move(pJob->data), /*readOnly*/pJob->format != ModFileReader::Format::Raw, std::move(pJob->blockHashes),
+		pJob->hasFileStamp ? &pJob->fileStamp : nullptr);
+}
+
+bool ModLoader::IsRunning()
+{
+	return s_pLoadJob != nullptr;
+}
+
+const char* ModLoader::GetPath()
+{
+	return s_pLoadJob ? s_pLoadJob->path : "";
+}
+
+uint64_t ModLoader::GetBytesRead()
+{
+	return s_pLoadJob ? s_pLoadJob->progress.bytesRead.load(std::memory_order_relaxed) : 0;
+}
+
+uint64_t ModLoader::GetSizeBytes()
+{
+	return s_pLoadJob ? s_pLoadJob->progress.sizeBytes.load(std::memory_order_relaxed) : 0;
+}
+
+float ModLoader::GetProgress()
+{
+	const uint64_t sizeBytes = GetSizeBytes();
+	if (sizeBytes == 0)
+		return 0.0f;
+	return (float)((double)GetBytesRead() / (double)sizeBytes);
+}
+
+const char* ModLoader::GetArchivePath()
+{
+	return s_archivePath;
+}
+
+const std::vector<ModFileReader::ArchiveMember>& ModLoader::GetArchiveMembers()
+{
+	return s_archiveMembers;
+}
+
+void ModLoader::ClearArchiveMembers()
+{
+	s_archivePath[0] = '\0';
+	s_archiveMembers.clear();
+	s_archiveMembers.shrink_to_fit();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Core/Helpers.h"
+
+#include "Mod/ModDocuments.h" // ModDocumentHandle
+#include "Mod/ModFileReader.h"
+
+#include <stdint.h>
+
+#include <vector>
+
+//
+// Reads a module on a worker thread, so that opening one from a slow network mount or a large dump doesn't freeze
+// the UI. The document is added to ModDocuments when the read completes.
+//
+// One load runs at a time. Starting another cancels it; a cancelled worker stops at its next read and its buffer is
+// freed by Update once it has finished, so the UI never waits for it.
+//
+// Compressed files are decompressed as they are read (see ModFileReader), and opened read-only. Loading a zip archive
+// of several files lists them instead, so that one can be chosen and loaded by its member path.
+//
+class ModLoader
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(ModLoader);
+
+	// Waits for any workers to finish
+	static void Shutdown();
+
+	// Supersedes any load in progress
+	static void Start(const char* path);
+	static void Cancel();
+
+	// Call once per frame. Returns the handle of the document added this frame, if any, and logs failures.
+	static ModDocumentHandle Update();
+
+	static bool IsRunning();
+
+	// Of the load in progress
+	static const char* GetPath();
+	static uint64_t GetBytesRead();
+	static uint64_t GetSizeBytes(); // of the compressed data, if compressed. 0 until the file has been opened.
+
+	// 0 to 1
+	static float GetProgress();
+
+	// Of the last zip archive loaded that holds several files, until cleared. Empty if none.
+	static const char* GetArchivePath();
+	static const std::vector<ModFileReader::ArchiveMember>& GetArchiveMembers();
+	static void ClearArchiveMembers();
+};
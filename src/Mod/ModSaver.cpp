@@ -0,0 +1,194 @@
+#include "ModSaver.h"
+
+#include "ModDocument.h"
+
+#include "Core/FileSystem.h" // kMaxPath
+#include "Core/StringHelpers.h"
+#include "Core/hp_assert.h"
+#include "Core/Log.h"
+
+#include <string.h> // strcmp
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+struct DeferredSave
+{
+	char path[kMaxPath] = {}; // empty for the document's own path
+	ModSaver::CompletionCallback pCallback = nullptr;
+	void* pUserData = nullptr;
+};
+
+struct SaveJob
+{
+	ModDocumentHandle handle = kInvalidModDocumentHandle;
+	ModDocument::SaveSnapshot snapshot;
+	ModSaver::CompletionCallback pCallback = nullptr;
+	void* pUserData = nullptr;
+
+	std::thread thread;
+	std::atomic<bool> done { false };
+	bool ok = false; // written by the worker thread before done
+
+	// Requested while this was saving, started in order when it finishes
+	std::vector<DeferredSave> deferredSaves;
+};
+
+static std::vector<std::unique_ptr<SaveJob>> s_jobs; // at most one per document
+
+//------------------------------------------------------------------------------------------------
+
+static void saveThreadFunc(SaveJob* pJob)
+{
+	pJob->ok = ModDocument::WriteSnapshot(pJob->snapshot);
+	pJob->done.store(true, std::memory_order_release);
+}
+
+static SaveJob* findJob(ModDocumentHandle handle)
+{
+	for (std::unique_ptr<SaveJob>& pJob : s_jobs)
+	{
+		if (pJob->handle == handle)
+			return pJob.get();
+	}
+	return nullptr;
+}
+
+static void startSave(ModDocumentHandle handle, const char* path, ModSaver::CompletionCallback pCallback, void* pUserData)
+{
+	ModDocument* pDocument = ModDocuments::Get(handle);
+	if (!pDocument)
+		return; // closed
+
+	if (!path || !path[0])
+		path = pDocument->GetPath();
+	HP_ASSERT(path[0] != '\0');
+
+	if (!pDocument->IsModified() && strcmp(path, pDocument->GetPath()) == 0)
+	{
+		LOG_INFO("No changes to save: %s\n", path);
+		return;
+	}
+
+	std::unique_ptr<SaveJob> pJob = std::make_unique<SaveJob>();
+	if (!pDocument->BeginSave(path, pJob->snapshot))
+	{
+		LOG_ERROR("Failed to save file: %s\n", path);
+		return;
+	}
+	pJob->handle = handle;
+	pJob->pCallback = pCallback;
+	pJob->pUserData = pUserData;
+	pJob->thread = std::thread(saveThreadFunc, pJob.get());
+	s_jobs.push_back(std::move(pJob));
+}
+
+// Starts any deferred save, so may add to s_jobs
+static void finishJob(std::unique_ptr<SaveJob> pJob)
+{
+	pJob->thread.join();
+
+	ModDocument* pDocument = ModDocuments::Get(pJob->handle); // nullptr if closed while saving
+	if (pDocument)
+		pDocument->EndSave(pJob->snapshot, pJob->ok);
+
+	const char* path = pJob->snapshot.path;
+	if (pJob->ok)
+	{
+		LOG_INFO("File saved: %s\n", path);
+		if (pJob->pCallback)
+			pJob->pCallback(pJob->handle, path, pJob->pUserData);
+	}
+	else
+		LOG_ERROR("Failed to save file: %s\n", path);
+
+	// The first that starts a save takes the rest. Others may have nothing to save e.g. if closed.
+	for (size_t saveIndex = 0; saveIndex < pJob->deferredSaves.size(); saveIndex++)
+	{
+		const DeferredSave& deferredSave = pJob->deferredSaves[saveIndex];
+		startSave(pJob->handle, deferredSave.path, deferredSave.pCallback, deferredSave.pUserData);
+		SaveJob* pNextJob = findJob(pJob->handle);
+		if (pNextJob)
+		{
+			pNextJob->deferredSaves.assign(pJob->deferredSaves.begin() + (ptrdiff_t)saveIndex + 1, pJob->deferredSaves.end());
+			break;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------------------------
+
+void ModSaver::Shutdown()
+{
+	// Oldest first, as finishing one can start a deferred save
+	while (!s_jobs.empty())
+	{
+		std::unique_ptr<SaveJob> pJob = std::move(s_jobs.front());
+		s_jobs.erase(s_jobs.begin());
+		finishJob(std::move(pJob));
+	}
+	s_jobs.shrink_to_fit();
+}
+
+void ModSaver::Save(ModDocumentHandle handle, const char* path, CompletionCallback pCallback, void* pUserData)
+{
+	SaveJob* pJob = findJob(handle);
+	if (!pJob)
+	{
+		startSave(handle, path, pCallback, pUserData);
+		return;
+	}
+
+	LOG_CHANNEL_DEBUG(ModFile, "Save deferred until the save in progress finishes: %s\n", pJob->snapshot.path);
+	if (!path)
+		path = "";
+
+	// One save to the same path covers both, unless each has its own callback
+	for (DeferredSave& deferredSave : pJob->deferredSaves)
+	{
+		if (strcmp(deferredSave.path, path) != 0)
+			continue;
+		if (!pCallback || (pCallback == deferredSave.pCallback && pUserData == deferredSave.pUserData))
+			return;
+		if (!deferredSave.pCallback)
+		{
+			deferredSave.pCallback = pCallback;
+			deferredSave.pUserData = pUserData;
+			return;
+		}
+	}
+
+	DeferredSave deferredSave;
+	SafeStrcpy(deferredSave.path, sizeof(deferredSave.path), path);
+	deferredSave.pCallback = pCallback;
+	deferredSave.pUserData = pUserData;
+	pJob->deferredSaves.push_back(deferredSave);
+}
+
+void ModSaver::Update()
+{
+	for (size_t jobIndex = 0; jobIndex < s_jobs.size();)
+	{
+		if (!s_jobs[jobIndex]->done.load(std::memory_order_acquire))
+		{
+			jobIndex++;
+			continue;
+		}
+
+		std::unique_ptr<SaveJob> pJob = std::move(s_jobs[jobIndex]);
+		s_jobs.erase(s_jobs.begin() + (ptrdiff_t)jobIndex);
+		finishJob(std::move(pJob));
+	}
+}
+
+bool ModSaver::IsSaving(ModDocumentHandle handle)
+{
+	return findJob(handle) != nullptr;
+}
+
+unsigned int ModSaver::GetSavingCount()
+{
+	return (unsigned int)s_jobs.size();
+}
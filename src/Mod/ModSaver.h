@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Core/Helpers.h"
+
+#include "Mod/ModDocuments.h" // ModDocumentHandle
+
+//
+// Saves documents on worker threads from snapshots (see ModDocument::BeginSave), so that saving to slow media
+// never stalls the UI and editing can continue straight away. Results are logged, so appear in the Output window.
+//
+// A save requested while the same document is already saving is deferred until that finishes. Deferred requests to
+// the same path coalesce into one save of the latest changes; requests to different paths are saved in turn, in the
+// order requested.
+//
+class ModSaver
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(ModSaver);
+
+	// Called from Update on success
+	typedef void (*CompletionCallback)(ModDocumentHandle handle, const char* path, void* pUserData);
+
+	// Waits for saves in progress, including deferred ones
+	static void Shutdown();
+
+	// path nullptr to save to the document's own path
+	static void Save(ModDocumentHandle handle, const char* path = nullptr, CompletionCallback pCallback = nullptr, void* pUserData = nullptr);
+
+	// Call once per frame
+	static void Update();
+
+	static bool IsSaving(ModDocumentHandle handle);
+	static unsigned int GetSavingCount();
+};
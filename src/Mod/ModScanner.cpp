@@ -0,0 +1,447 @@
+#include "ModScanner.h"
+
+#include "ModBufferView.h"
+#include "ModDocument.h"
+
+#include "Core/MappedFile.h"
+#include "Core/StringHelpers.h"
+#include "Core/hp_assert.h"
+#include "Core/Log.h"
+
+#include <string.h> // memcmp, memcpy
+
+#include <algorithm> // std::sort, std::remove_if
+#include <atomic>
+#include <bit> // std::countr_zero
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MOD_SCANNER_SSE2 1
+#include <emmintrin.h>
+#else
+// #TODO: NEON
+#define MOD_SCANNER_SSE2 0
+#endif
+
+// ProTracker header layout
+static const size_t kTitleSizeBytes = 20;
+static const unsigned int kSampleCount = 31;
+static const size_t kSampleHeaderSizeBytes = 30;
+static const size_t kSongLengthOffset = 950;
+static const size_t kOrderListOffset = 952;
+static const unsigned int kOrderCount = 128;
+static const size_t kSignatureOffset = 1080;
+static const size_t kHeaderSizeBytes = 1084;
+static const unsigned int kRowsPerPattern = 64;
+static const size_t kCellSizeBytes = 4;
+
+static const unsigned int kMaxChannelCount = 32;
+static const uint8_t kMaxFinetune = 0x0f;
+static const uint8_t kMaxVolume = 64;
+
+// Small enough to share out evenly between threads, large enough that claiming one costs nothing
+static const size_t kChunkSizeBytes = 8 * 1024 * 1024;
+
+struct ScanJob
+{
+	ModDocumentHandle handle = kInvalidModDocumentHandle;
+	ModBufferView data; // keeps the data alive, and unchanged, while the workers read it
+	const uint8_t* pData = nullptr;
+	std::shared_ptr<const MappedFile> pFile; // instead of pData if windowed, read a chunk at a time by each worker
+	uint64_t sizeBytes = 0;
+	size_t chunkCount = 0;
+
+	std::vector<std::thread> threads;
+	std::vector<std::vector<ModScanner::Hit>> threadHits; // one per thread, so the workers never contend
+
+	std::atomic<size_t> nextChunkIndex { 0 };
+	std::atomic<uint64_t> bytesScanned { 0 };
+	std::atomic<bool> cancel { false };
+	std::atomic<unsigned int> runningCount { 0 };
+	std::atomic<bool> done { false };
+	std::chrono::steady_clock::time_point startTime;
+};
+
+static std::unique_ptr<ScanJob> s_pScanJob;
+static std::vector<std::unique_ptr<ScanJob>> s_cancelledJobs; // freed by Update once their workers finish
+
+static ModDocumentHandle s_scannedHandle = kInvalidModDocumentHandle;
+static std::vector<ModScanner::Hit> s_hits;
+
+//------------------------------------------------------------------------------------------------
+
+static inline unsigned int read16BigEndian(const uint8_t* p)
+{
+	return ((unsigned int)p[0] << 8) | p[1];
+}
+
+static inline bool isDigit(uint8_t c)
+{
+	return c >= '0' && c <= '9';
+}
+
+// Returns the channel count, or 0 if not a signature
+static unsigned int matchSignature(const uint8_t* p)
+{
+	if (memcmp(p, "M.K.", 4) == 0 || memcmp(p, "M!K!", 4) == 0 || memcmp(p, "FLT4", 4) == 0)
+		return 4;
+	if (isDigit(p[0]) && p[0] != '0' && memcmp(p + 1, "CHN", 3) == 0)
+		return p[0] - '0';
+	if (isDigit(p[0]) && isDigit(p[1]) && p[2] == 'C' && p[3] == 'H')
+	{
+		const unsigned int channelCount = (p[0] - '0') * 10u + (p[1] - '0');
+		return channelCount >= 10 && channelCount <= kMaxChannelCount ? channelCount : 0;
+	}
+	return 0;
+}
+
+// The sample table and order list must be plausible, so that random data and other formats are rejected. pData is
+// at baseOffset in data of totalSizeBytes, for the hit's offset and size.
+static bool validateModule(const uint8_t* pData, size_t sizeBytes, size_t signatureOffset, uint64_t baseOffset, uint64_t totalSizeBytes,
+	unsigned int channelCount, ModScanner::Hit& hit)
+{
+	HP_ASSERT(signatureOffset >= kSignatureOffset && signatureOffset + 4 <= sizeBytes);
+	const size_t offset = signatureOffset - kSignatureOffset;
+	const uint8_t* pModule = pData + offset;
+
+	uint64_t sampleDataSizeBytes = 0;
+	unsigned int sampleCount = 0;
+	for (unsigned int sampleIndex = 0; sampleIndex < kSampleCount; sampleIndex++)
+	{
+		const uint8_t* pSample = pModule + kTitleSizeBytes + sampleIndex * kSampleHeaderSizeBytes;
+		const unsigned int lengthWords = read16BigEndian(pSample + 22);
+		const uint8_t finetune = pSample[24];
+		const uint8_t volume = pSample[25];
+		const unsigned int repeatStartWords = read16BigEndian(pSample + 26);
+		const unsigned int repeatLengthWords = read16BigEndian(pSample + 28);
+		if (finetune > kMaxFinetune || volume > kMaxVolume)
+			return false;
+		if (lengthWords == 0)
+			continue;
+
+		// Some trackers save the loop start in bytes rather than words
+		if (repeatLengthWords > 1 && repeatStartWords + repeatLengthWords > lengthWords && repeatStartWords / 2 + repeatLengthWords > lengthWords)
+			return false;
+		sampleDataSizeBytes += lengthWords * 2ull;
+		sampleCount++;
+	}
+	if (sampleCount == 0)
+		return false; // e.g. a signature in zeroed memory
+
+	const unsigned int songLength = pModule[kSongLengthOffset];
+	if (songLength == 0 || songLength > kOrderCount)
+		return false;
+
+	// Players load every pattern the order list names, including beyond the song length
+	unsigned int highestPattern = 0;
+	for (unsigned int orderIndex = 0; orderIndex < kOrderCount; orderIndex++)
+	{
+		const unsigned int pattern = pModule[kOrderListOffset + orderIndex];
+		if (pattern >= kOrderCount)
+			return false;
+		highestPattern = Max(highestPattern, pattern);
+	}
+
+	const uint64_t patternSizeBytes = (uint64_t)kRowsPerPattern * channelCount * kCellSizeBytes;
+	const uint64_t moduleSizeBytes = kHeaderSizeBytes + (highestPattern + 1) * patternSizeBytes + sampleDataSizeBytes;
+	const uint64_t availableSizeBytes = totalSizeBytes - (baseOffset + offset);
+
+	hit.offset = baseOffset + offset;
+	hit.truncated = moduleSizeBytes > availableSizeBytes;
+	hit.sizeBytes = Min(moduleSizeBytes, availableSizeBytes);
+	memcpy(hit.signature, pData + signatureOffset, 4);
+	hit.signature[4] = '\0';
+	size_t titleLength = 0;
+	while (titleLength < kTitleSizeBytes && pModule[titleLength] != '\0')
+	{
+		const uint8_t c = pModule[titleLength];
+		hit.title[titleLength++] = (c >= 0x20 && c < 0x7f) ? (char)c : '?';
+	}
+	hit.title[titleLength] = '\0';
+	hit.channelCount = channelCount;
+	hit.patternCount = highestPattern + 1;
+	hit.sampleCount = sampleCount;
+	return true;
+}
+
+static void checkCandidate(const uint8_t* pData, size_t sizeBytes, size_t signatureOffset, uint64_t baseOffset, uint64_t totalSizeBytes,
+	std::vector<ModScanner::Hit>& hits)
+{
+	const unsigned int channelCount = matchSignature(pData + signatureOffset);
+	if (channelCount == 0)
+		return;
+	ModScanner::Hit hit;
+	if (validateModule(pData, sizeBytes, signatureOffset, baseOffset, totalSizeBytes, channelCount, hit))
+		hits.push_back(hit);
+}
+
+// See ScanRange. pData is at baseOffset in data of totalSizeBytes e.g. a chunk read from a windowed document.
+static void scanBuffer(const uint8_t* pData, size_t sizeBytes, size_t beginOffset, size_t endOffset, uint64_t baseOffset, uint64_t totalSizeBytes,
+	std::vector<ModScanner::Hit>& hits)
+{
+	// A signature is preceded by the rest of the header, and is 4 bytes
+	if (sizeBytes < kHeaderSizeBytes)
+		return;
+	beginOffset = Max(beginOffset, kSignatureOffset);
+	endOffset = Min(endOffset, sizeBytes - 3);
+	size_t offset = beginOffset;
+
+#if MOD_SCANNER_SSE2
+	// Bytes 2 and 3 of the signatures are "K.", "K!", "T4", "HN" or "CH". Comparing them at 16 offsets at once leaves
+	// few enough candidates to check in full one at a time. Reads up to 3 bytes past the 16th offset.
+	const __m128i k = _mm_set1_epi8('K');
+	const __m128i t = _mm_set1_epi8('T');
+	const __m128i h = _mm_set1_epi8('H');
+	const __m128i c = _mm_set1_epi8('C');
+	const __m128i period = _mm_set1_epi8('.');
+	const __m128i exclamation = _mm_set1_epi8('!');
+	const __m128i four = _mm_set1_epi8('4');
+	const __m128i n = _mm_set1_epi8('N');
+	for (; offset + 16 <= endOffset; offset += 16)
+	{
+		const __m128i third = _mm_loadu_si128((const __m128i*)(pData + offset + 2));
+		const __m128i fourth = _mm_loadu_si128((const __m128i*)(pData + offset + 3));
+		const __m128i kMatches = _mm_and_si128(_mm_cmpeq_epi8(third, k), _mm_or_si128(_mm_cmpeq_epi8(fourth, period), _mm_cmpeq_epi8(fourth, exclamation)));
+		const __m128i tMatches = _mm_and_si128(_mm_cmpeq_epi8(third, t), _mm_cmpeq_epi8(fourth, four));
+		const __m128i hMatches = _mm_and_si128(_mm_cmpeq_epi8(third, h), _mm_cmpeq_epi8(fourth, n));
+		const __m128i cMatches = _mm_and_si128(_mm_cmpeq_epi8(third, c), _mm_cmpeq_epi8(fourth, h));
+		unsigned int candidateMask = (unsigned int)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(kMatches, tMatches), _mm_or_si128(hMatches, cMatches)));
+		while (candidateMask != 0)
+		{
+			checkCandidate(pData, sizeBytes, offset + (size_t)std::countr_zero(candidateMask), baseOffset, totalSizeBytes, hits);
+			candidateMask &= candidateMask - 1;
+		}
+	}
+#endif
+
+	for (; offset < endOffset; offset++)
+	{
+		const uint8_t third = pData[offset + 2];
+		if (third == 'K' || third == 'T' || third == 'H' || third == 'C')
+			checkCandidate(pData, sizeBytes, offset, baseOffset, totalSizeBytes, hits);
+	}
+}
+
+//------------------------------------------------------------------------------------------------
+
+static void scanThreadFunc(ScanJob* pJob, unsigned int threadIndex)
+{
+	std::vector<ModScanner::Hit>& hits = pJob->threadHits[threadIndex];
+	std::vector<uint8_t> chunk; // windowed
+	while (!pJob->cancel.load(std::memory_order_relaxed))
+	{
+		const size_t chunkIndex = pJob->nextChunkIndex.fetch_add(1, std::memory_order_relaxed);
+		if (chunkIndex >= pJob->chunkCount)
+			break;
+		const uint64_t beginOffset = (uint64_t)chunkIndex * kChunkSizeBytes;
+		const uint64_t endOffset = Min(beginOffset + kChunkSizeBytes, pJob->sizeBytes);
+		if (pJob->pData)
+			ModScanner::ScanRange(pJob->pData, (size_t)pJob->sizeBytes, (size_t)beginOffset, (size_t)endOffset, hits);
+		else
+		{
+			// With the header before the chunk and the rest of the signature after it. Less if the file has been
+			// truncated since it was opened.
+			const uint64_t readOffset = beginOffset - Min(beginOffset, (uint64_t)kSignatureOffset);
+			const uint64_t readEndOffset = Min(endOffset + 3, pJob->sizeBytes);
+			chunk.resize((size_t)(readEndOffset - readOffset));
+			size_t bytesRead = 0;
+			if (pJob->pFile->Read(readOffset, chunk.data(), chunk.size(), bytesRead))
+				scanBuffer(chunk.data(), bytesRead, (size_t)(beginOffset - readOffset), (size_t)(endOffset - readOffset), readOffset, pJob->sizeBytes, hits);
+		}
+		pJob->bytesScanned.fetch_add(endOffset - beginOffset, std::memory_order_relaxed);
+	}
+
+	// The last worker out
+	if (pJob->runningCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		pJob->done.store(true, std::memory_order_release);
+}
+
+static void startThreads(ScanJob& job, unsigned int threadCount)
+{
+	job.chunkCount = (job.sizeBytes + kChunkSizeBytes - 1) / kChunkSizeBytes;
+	if (threadCount == 0)
+		threadCount = Max(std::thread::hardware_concurrency(), 1u);
+	threadCount = (unsigned int)Max(Min((size_t)threadCount, job.chunkCount), (size_t)1);
+
+	job.startTime = std::chrono::steady_clock::now();
+	job.threadHits.resize(threadCount);
+	job.runningCount.store(threadCount, std::memory_order_relaxed);
+	for (unsigned int threadIndex = 0; threadIndex < threadCount; threadIndex++)
+		job.threads.emplace_back(scanThreadFunc, &job, threadIndex);
+}
+
+static void joinThreads(ScanJob& job)
+{
+	for (std::thread& thread : job.threads)
+		thread.join();
+	job.threads.clear();
+}
+
+static void mergeHits(ScanJob& job, std::vector<ModScanner::Hit>& hits)
+{
+	hits.clear();
+	for (const std::vector<ModScanner::Hit>& threadHits : job.threadHits)
+		hits.insert(hits.end(), threadHits.begin(), threadHits.end());
+	std::sort(hits.begin(), hits.end(), [](const ModScanner::Hit& a, const ModScanner::Hit& b) { return a.offset < b.offset; });
+}
+
+static void freeFinishedCancelledJobs()
+{
+	s_cancelledJobs.erase(std::remove_if(s_cancelledJobs.begin(), s_cancelledJobs.end(),
+		[](std::unique_ptr<ScanJob>& pJob)
+		{
+			if (!pJob->done.load(std::memory_order_acquire))
+				return false;
+			joinThreads(*pJob);
+			return true;
+		}),
+		s_cancelledJobs.end());
+}
+
+//------------------------------------------------------------------------------------------------
+
+void ModScanner::Shutdown()
+{
+	Cancel();
+	for (std::unique_ptr<ScanJob>& pJob : s_cancelledJobs)
+		joinThreads(*pJob);
+	s_cancelledJobs.clear();
+	s_cancelledJobs.shrink_to_fit();
+	ClearHits();
+}
+
+bool ModScanner::Start(ModDocumentHandle handle)
+{
+	Cancel();
+	ClearHits();
+
+	ModDocument* pDocument = ModDocuments::Get(handle);
+	HP_ASSERT(pDocument);
+
+	std::unique_ptr<ScanJob> pJob = std::make_unique<ScanJob>();
+	if (pDocument->IsWindowed())
+	{
+		pJob->pFile = pDocument->GetWindowedFile();
+		pJob->sizeBytes = pDocument->GetDataSizeBytes();
+	}
+	else
+	{
+		pJob->data = pDocument->GetView();
+		if (!pJob->data.IsValid())
+		{
+			LOG_ERROR("Failed to scan, as the data couldn't be read: %s\n", pDocument->GetPath());
+			return false;
+		}
+		pJob->pData = pJob->data.GetData();
+		pJob->sizeBytes = pJob->data.GetSizeBytes();
+	}
+	pJob->handle = handle;
+
+	s_scannedHandle = handle;
+	s_pScanJob = std::move(pJob);
+	startThreads(*s_pScanJob, /*threadCount*/0);
+	LOG_CHANNEL_DEBUG(ModFile, "Scanning for modules on %u thread(s): %s\n", (unsigned int)s_pScanJob->threads.size(), pDocument->GetPath());
+	return true;
+}
+
+void ModScanner::Cancel()
+{
+	if (!s_pScanJob)
+		return;
+
+	LOG_INFO("Cancelled scanning for modules\n");
+	s_pScanJob->cancel.store(true, std::memory_order_relaxed);
+	s_cancelledJobs.push_back(std::move(s_pScanJob));
+	s_scannedHandle = kInvalidModDocumentHandle;
+}
+
+void ModScanner::Update()
+{
+	freeFinishedCancelledJobs();
+
+	if (!s_pScanJob || !s_pScanJob->done.load(std::memory_order_acquire))
+		return;
+
+	std::unique_ptr<ScanJob> pJob = std::move(s_pScanJob);
+	joinThreads(*pJob);
+	mergeHits(*pJob, s_hits);
+
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - pJob->startTime).count();
+	const ModDocument* pDocument = ModDocuments::Get(pJob->handle);
+	LOG_INFO("Found %u module(s) in %s: %.1f MB scanned in %.3fs\n", (unsigned int)s_hits.size(), pDocument ? pDocument->GetPath() : "a closed file",
+		(double)pJob->sizeBytes / (1024.0 * 1024.0), seconds);
+}
+
+bool ModScanner::IsRunning()
+{
+	return s_pScanJob != nullptr;
+}
+
+float ModScanner::GetProgress()
+{
+	if (!s_pScanJob || s_pScanJob->sizeBytes == 0)
+		return 0.0f;
+	return (float)((double)s_pScanJob->bytesScanned.load(std::memory_order_relaxed) / (double)s_pScanJob->sizeBytes);
+}
+
+ModDocumentHandle ModScanner::GetDocumentHandle()
+{
+	return s_scannedHandle;
+}
+
+const std::vector<ModScanner::Hit>& ModScanner::GetHits()
+{
+	return s_hits;
+}
+
+void ModScanner::ClearHits()
+{
+	if (!s_pScanJob)
+		s_scannedHandle = kInvalidModDocumentHandle;
+	s_hits.clear();
+	s_hits.shrink_to_fit();
+}
+
+ModDocumentHandle ModScanner::Extract(const Hit& hit)
+{
+	ModDocument* pDocument = ModDocuments::Get(s_scannedHandle);
+	if (!pDocument)
+	{
+		LOG_ERROR("Can't extract the module, as the scanned file has been closed\n");
+		return kInvalidModDocumentHandle;
+	}
+
+	const ModBufferView module = pDocument->GetRange(hit.offset, (size_t)hit.sizeBytes);
+	if (!module.IsValid() || module.GetSizeBytes() != hit.sizeBytes)
+	{
+		LOG_ERROR("Failed to extract the module at 0x%llx: %s\n", (unsigned long long)hit.offset, pDocument->GetPath());
+		return kInvalidModDocumentHandle;
+	}
+
+	const ModDocumentHandle extractedHandle = ModDocuments::New();
+	ModDocument* pExtracted = ModDocuments::Get(extractedHandle);
+	HP_ASSERT(pExtracted);
+	pExtracted->Resize(module.GetSizeBytes());
+	pExtracted->Write(0, module.GetData(), module.GetSizeBytes());
+	LOG_INFO("Extracted %s%s (%llu bytes) from 0x%llx: %s\n", hit.title[0] ? hit.title : "untitled module", hit.truncated ? ", truncated," : "",
+		(unsigned long long)hit.sizeBytes, (unsigned long long)hit.offset, pDocument->GetPath());
+	return extractedHandle;
+}
+
+void ModScanner::Scan(const uint8_t* pData, size_t sizeBytes, unsigned int threadCount, std::vector<Hit>& hits)
+{
+	ScanJob job;
+	job.pData = pData;
+	job.sizeBytes = sizeBytes;
+	startThreads(job, threadCount);
+	joinThreads(job);
+	mergeHits(job, hits);
+}
+
+void ModScanner::ScanRange(const uint8_t* pData, size_t sizeBytes, size_t beginOffset, size_t endOffset, std::vector<Hit>& hits)
+{
+	scanBuffer(pData, sizeBytes, beginOffset, endOffset, 0, sizeBytes, hits);
+}
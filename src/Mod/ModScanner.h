@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Core/Helpers.h"
+
+#include "Mod/ModDocuments.h" // ModDocumentHandle
+
+#include <stddef.h> // size_t
+#include <stdint.h>
+
+#include <vector>
+
+//
+// Finds ProTracker modules embedded in other files e.g. Amiga disk images, memory dumps and game executables, so that
+// they can be extracted.
+//
+// A module is recognised by its signature, 1080 bytes into its header: "M.K.", "M!K!", "FLT4", "<n>CHN" or "<nn>CH".
+// The data is searched for every signature at once, 16 positions at a time with SSE2, and each candidate is then
+// checked for a plausible sample table and order list, which random data practically never has.
+//
+// Scans run on worker threads, one per core, each taking the next chunk of the document in turn. The document is
+// read through a view (see ModDocument::GetView), so scanning doesn't stop it being edited or closed. A windowed
+// document is read from its file a chunk at a time by each worker (see ModDocument::GetWindowedFile), rather than
+// into memory whole.
+//
+class ModScanner
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(ModScanner);
+
+	struct Hit
+	{
+		uint64_t offset = 0; // of the module in the scanned data
+		uint64_t sizeBytes = 0; // up to the end of the scanned data, if truncated
+		bool truncated = false; // the file ends before the module's sample data does
+		char signature[5] = {};
+		char title[21] = {}; // unprintable characters replaced
+		unsigned int channelCount = 0;
+		unsigned int patternCount = 0;
+		unsigned int sampleCount = 0; // non-empty samples
+	};
+
+	// Waits for any workers to finish
+	static void Shutdown();
+
+	// Scans the document on worker threads, superseding any scan in progress. Returns false if its data can't be read.
+	static bool Start(ModDocumentHandle handle);
+	static void Cancel();
+
+	// Call once per frame. Collects the hits of a finished scan.
+	static void Update();
+
+	static bool IsRunning();
+
+	// 0 to 1
+	static float GetProgress();
+
+	// The document being scanned, or last scanned until cleared. kInvalidModDocumentHandle if none.
+	static ModDocumentHandle GetDocumentHandle();
+
+	// Of the last scan, in order of offset, until cleared
+	static const std::vector<Hit>& GetHits();
+	static void ClearHits();
+
+	// Copies the module into a new untitled document, to be saved. Returns kInvalidModDocumentHandle if the scanned
+	// document has been closed or can't be read.
+	static ModDocumentHandle Extract(const Hit& hit);
+
+	// Blocking, on threadCount threads (0 for one per core). Hits are in order of offset.
+	static void Scan(const uint8_t* pData, size_t sizeBytes, unsigned int threadCount, std::vector<Hit>& hits);
+
+	// Finds modules whose signatures start in [beginOffset, endOffset). Reads before and after the range as needed,
+	// but never outside [pData, pData + sizeBytes).
+	static void ScanRange(const uint8_t* pData, size_t sizeBytes, size_t beginOffset, size_t endOffset, std::vector<Hit>& hits);
+};
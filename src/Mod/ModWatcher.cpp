@@ -0,0 +1,342 @@
+#include "ModWatcher.h"
+
+#include "ModDocument.h"
+#include "ModFileReader.h"
+#include "ModSaver.h"
+#include "ModScanner.h"
+
+#include "Core/FileSystem.h" // kMaxPath
+#include "Core/FileWatcher.h"
+#include "Core/StringHelpers.h"
+#include "Core/hp_assert.h"
+#include "Core/Log.h"
+
+#include <string.h> // memcmp, strcmp
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Tools often write a file in several steps, so wait for this long without notifications before reloading
+static const std::chrono::milliseconds kDebounceTime(250);
+
+// Data is compared in blocks, and only blocks that differ are searched for the changed bytes
+static const size_t kCompareBlockSizeBytes = 4096;
+
+// Changed bytes closer than this are reported as one range, which is about one row of a hex view
+static const size_t kChangedRangeMergeGapBytes = 16;
+
+struct ReloadJob
+{
+	char path[kMaxPath] = {};
+	ModBufferView oldData;
+	FileWatcher::Stamp stamp; // taken before reading
+
+	std::thread thread;
+	ModFileReader::Progress progress; // for cancelling
+	std::atomic<bool> done { false };
+
+	// Written by the worker thread before done
+	bool ok = false;
+	std::vector<uint8_t> newData;
+	std::vector<FileWriter::Range> changedRanges;
+};
+
+struct WatchedDocument
+{
+	ModDocumentHandle handle = kInvalidModDocumentHandle;
+	char path[kMaxPath] = {};
+	char filePath[kMaxPath] = {}; // the archive, for a member of a zip archive
+	unsigned int watchId = 0;
+	unsigned int saveCount = 0;
+	FileWatcher::Stamp stamp; // of the file as the document last loaded or saved it
+
+	bool changed = false; // notified, waiting for the debounce time
+	std::chrono::steady_clock::time_point changeTime;
+
+	std::unique_ptr<ReloadJob> pReloadJob;
+
+	std::vector<FileWriter::Range> lastChangedRanges;
+	std::chrono::steady_clock::time_point lastReloadTime;
+};
+
+static std::vector<std::unique_ptr<WatchedDocument>> s_watchedDocuments; // pointers are passed to FileWatcher
+static std::vector<std::unique_ptr<ReloadJob>> s_cancelledJobs; // freed by Update once their workers finish
+
+//------------------------------------------------------------------------------------------------
+
+static void addChangedRange(std::vector<FileWriter::Range>& ranges, uint64_t offset, size_t sizeBytes)
+{
+	if (!ranges.empty())
+	{
+		FileWriter::Range& lastRange = ranges.back();
+		if (lastRange.offset + lastRange.sizeBytes + kChangedRangeMergeGapBytes >= offset)
+		{
+			lastRange.sizeBytes = (size_t)(offset + sizeBytes - lastRange.offset);
+			return;
+		}
+	}
+	ranges.push_back({ offset, sizeBytes });
+}
+
+static void findChangedRanges(const ModBufferView& oldData, const std::vector<uint8_t>& newData, std::vector<FileWriter::Range>& ranges)
+{
+	const uint8_t* pOld = oldData.GetData();
+	const uint8_t* pNew = newData.data();
+	const size_t commonSizeBytes = Min(oldData.GetSizeBytes(), newData.size());
+	for (size_t blockOffset = 0; blockOffset < commonSizeBytes; blockOffset += kCompareBlockSizeBytes)
+	{
+		const size_t blockEnd = Min(blockOffset + kCompareBlockSizeBytes, commonSizeBytes);
+		if (memcmp(pOld + blockOffset, pNew + blockOffset, blockEnd - blockOffset) == 0)
+			continue;
+
+		size_t first = blockOffset;
+		while (pOld[first] == pNew[first])
+			first++;
+		size_t end = blockEnd;
+		while (pOld[end - 1] == pNew[end - 1])
+			end--;
+		addChangedRange(ranges, first, end - first);
+	}
+
+	// Appended, or removed from the end
+	const size_t maxSizeBytes = Max(oldData.GetSizeBytes(), newData.size());
+	if (maxSizeBytes > commonSizeBytes)
+		addChangedRange(ranges, commonSizeBytes, maxSizeBytes - commonSizeBytes);
+}
+
+static void reloadThreadFunc(ReloadJob* pJob)
+{
+	pJob->ok = ModFileReader::Read(pJob->path, pJob->newData, &pJob->progress);
+	if (pJob->ok)
+		findChangedRanges(pJob->oldData, pJob->newData, pJob->changedRanges);
+	pJob->done.store(true, std::memory_order_release);
+}
+
+static void cancelReload(WatchedDocument& watchedDocument)
+{
+	if (!watchedDocument.pReloadJob)
+		return;
+	watchedDocument.pReloadJob->progress.cancel.store(true, std::memory_order_relaxed);
+	s_cancelledJobs.push_back(std::move(watchedDocument.pReloadJob));
+}
+
+static void freeFinishedCancelledJobs()
+{
+	for (size_t jobIndex = 0; jobIndex < s_cancelledJobs.size();)
+	{
+		if (!s_cancelledJobs[jobIndex]->done.load(std::memory_order_acquire))
+		{
+			jobIndex++;
+			continue;
+		}
+		s_cancelledJobs[jobIndex]->thread.join();
+		s_cancelledJobs.erase(s_cancelledJobs.begin() + (ptrdiff_t)jobIndex);
+	}
+}
+
+static void onFileChanged(unsigned int watchId, void* pUserData)
+{
+	HP_UNUSED(watchId);
+	WatchedDocument& watchedDocument = *(WatchedDocument*)pUserData;
+	watchedDocument.changed = true;
+	watchedDocument.changeTime = std::chrono::steady_clock::now();
+}
+
+static void unwatch(WatchedDocument& watchedDocument)
+{
+	cancelReload(watchedDocument);
+	if (watchedDocument.watchId != 0)
+	{
+		FileWatcher::Unwatch(watchedDocument.watchId);
+		watchedDocument.watchId = 0;
+	}
+}
+
+static void watch(WatchedDocument& watchedDocument, const ModDocument& document)
+{
+	SafeStrcpy(watchedDocument.path, sizeof(watchedDocument.path), document.GetPath());
+	ModFileReader::GetFilePath(watchedDocument.path, watchedDocument.filePath, sizeof(watchedDocument.filePath));
+	watchedDocument.watchId = FileWatcher::Watch(watchedDocument.filePath, onFileChanged, &watchedDocument);
+	watchedDocument.saveCount = document.GetSaveCount();
+	watchedDocument.stamp = FileWatcher::Stamp();
+	FileWatcher::GetStamp(watchedDocument.filePath, watchedDocument.stamp);
+	watchedDocument.changed = false;
+}
+
+static WatchedDocument* findWatchedDocument(ModDocumentHandle handle)
+{
+	for (std::unique_ptr<WatchedDocument>& pWatchedDocument : s_watchedDocuments)
+	{
+		if (pWatchedDocument->handle == handle)
+			return pWatchedDocument.get();
+	}
+	return nullptr;
+}
+
+// Watches documents with files, and stops watching closed documents
+static void syncWithDocuments(bool enabled)
+{
+	for (size_t watchIndex = 0; watchIndex < s_watchedDocuments.size();)
+	{
+		WatchedDocument& watchedDocument = *s_watchedDocuments[watchIndex];
+		if (enabled && ModDocuments::Get(watchedDocument.handle))
+		{
+			watchIndex++;
+			continue;
+		}
+		unwatch(watchedDocument);
+		s_watchedDocuments.erase(s_watchedDocuments.begin() + (ptrdiff_t)watchIndex);
+	}
+	if (!enabled)
+		return;
+
+	const unsigned int documentCount = ModDocuments::GetCount();
+	for (unsigned int documentIndex = 0; documentIndex < documentCount; documentIndex++)
+	{
+		const ModDocumentHandle handle = ModDocuments::GetHandle(documentIndex);
+		const ModDocument& document = *ModDocuments::Get(handle);
+		if (document.GetPath()[0] == '\0')
+			continue; // new, never saved
+
+		WatchedDocument* pWatchedDocument = findWatchedDocument(handle);
+		if (!pWatchedDocument)
+		{
+			s_watchedDocuments.push_back(std::make_unique<WatchedDocument>());
+			pWatchedDocument = s_watchedDocuments.back().get();
+			pWatchedDocument->handle = handle;
+			watch(*pWatchedDocument, document);
+		}
+		else if (strcmp(pWatchedDocument->path, document.GetPath()) != 0)
+		{
+			// Saved as another file
+			unwatch(*pWatchedDocument);
+			watch(*pWatchedDocument, document);
+		}
+		else if (pWatchedDocument->saveCount != document.GetSaveCount())
+		{
+			// Saved, so the file is as the document last had it
+			pWatchedDocument->saveCount = document.GetSaveCount();
+			FileWatcher::GetStamp(pWatchedDocument->filePath, pWatchedDocument->stamp);
+		}
+	}
+}
+
+static void startReloadIfChanged(WatchedDocument& watchedDocument, ModDocument& document)
+{
+	watchedDocument.changed = false;
+
+	FileWatcher::Stamp stamp;
+	if (!FileWatcher::GetStamp(watchedDocument.filePath, stamp) || stamp == watchedDocument.stamp)
+		return; // deleted, or not changed e.g. the document's own save
+
+	if (document.IsWindowed())
+	{
+		// A scan would mix hits from the old and new contents
+		if (ModScanner::IsRunning() && ModScanner::GetDocumentHandle() == watchedDocument.handle)
+			ModScanner::Cancel();
+		if (document.ReopenWindowed())
+			LOG_INFO("Reopened %s, which was changed by another program\n", watchedDocument.path);
+		watchedDocument.stamp = stamp;
+		return;
+	}
+	if (document.IsModified())
+	{
+		LOG_WARN("%s was changed by another program, but has unsaved changes, so was not reloaded\n", watchedDocument.path);
+		watchedDocument.stamp = stamp;
+		return;
+	}
+	if (!document.IsResident())
+	{
+		// Evicted documents are reloaded from the file when next used anyway
+		watchedDocument.stamp = stamp;
+		return;
+	}
+
+	std::unique_ptr<ReloadJob> pJob = std::make_unique<ReloadJob>();
+	SafeStrcpy(pJob->path, sizeof(pJob->path), watchedDocument.path);
+	pJob->oldData = document.GetResidentView();
+	pJob->stamp = stamp;
+	pJob->thread = std::thread(reloadThreadFunc, pJob.get());
+	watchedDocument.pReloadJob = std::move(pJob);
+	LOG_CHANNEL_DEBUG(ModFile, "Reloading changed file: %s\n", watchedDocument.path);
+}
+
+static void finishReload(WatchedDocument& watchedDocument, ModDocument& document)
+{
+	std::unique_ptr<ReloadJob> pJob = std::move(watchedDocument.pReloadJob);
+	pJob->thread.join();
+	if (!pJob->ok)
+		return; // logged. Retried on the next notification.
+
+	watchedDocument.stamp = pJob->stamp;
+	if (!document.IsResident())
+		return; // evicted meanwhile, so reloads the new file when next used
+	if (document.IsModified() || !document.GetResidentView().IsSameAs(pJob->oldData))
+	{
+		LOG_WARN("%s was changed by another program while being edited, so was not reloaded\n", watchedDocument.path);
+		return;
+	}
+
+	// Even if rewritten with the same contents, so that the document has the new stamp to save in place against
+	if (!pJob->changedRanges.empty())
+	{
+		uint64_t changedSizeBytes = 0;
+		for (const FileWriter::Range& range : pJob->changedRanges)
+			changedSizeBytes += range.sizeBytes;
+		LOG_INFO("Reloaded %s, which was changed by another program: %llu bytes in %u range(s)\n", watchedDocument.path,
+			(unsigned long long)changedSizeBytes, (unsigned int)pJob->changedRanges.size());
+	}
+
+	pJob->oldData.Reset();
+	document.Reload(std::move(pJob->newData), pJob->changedRanges, pJob->stamp);
+	watchedDocument.lastChangedRanges = std::move(pJob->changedRanges);
+	watchedDocument.lastReloadTime = std::chrono::steady_clock::now();
+}
+
+//------------------------------------------------------------------------------------------------
+
+void ModWatcher::Shutdown()
+{
+	for (std::unique_ptr<WatchedDocument>& pWatchedDocument : s_watchedDocuments)
+		unwatch(*pWatchedDocument);
+	s_watchedDocuments.clear();
+	s_watchedDocuments.shrink_to_fit();
+
+	for (std::unique_ptr<ReloadJob>& pJob : s_cancelledJobs)
+		pJob->thread.join();
+	s_cancelledJobs.clear();
+	s_cancelledJobs.shrink_to_fit();
+}
+
+void ModWatcher::Update()
+{
+	freeFinishedCancelledJobs();
+	syncWithDocuments(ModDocuments::GetOptions().reloadChangedFiles);
+
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	for (std::unique_ptr<WatchedDocument>& pWatchedDocument : s_watchedDocuments)
+	{
+		WatchedDocument& watchedDocument = *pWatchedDocument;
+		ModDocument& document = *ModDocuments::Get(watchedDocument.handle);
+
+		if (watchedDocument.pReloadJob && watchedDocument.pReloadJob->done.load(std::memory_order_acquire))
+			finishReload(watchedDocument, document);
+
+		// While saving, the file is expected to change, and is stamped once saved
+		if (watchedDocument.changed && now - watchedDocument.changeTime >= kDebounceTime && !watchedDocument.pReloadJob && !ModSaver::IsSaving(watchedDocument.handle))
+			startReloadIfChanged(watchedDocument, document);
+	}
+}
+
+const std::vector<FileWriter::Range>* ModWatcher::GetLastChangedRanges(ModDocumentHandle handle, float& secondsSinceReload)
+{
+	const WatchedDocument* pWatchedDocument = findWatchedDocument(handle);
+	if (!pWatchedDocument || pWatchedDocument->lastChangedRanges.empty())
+		return nullptr;
+
+	secondsSinceReload = std::chrono::duration<float>(std::chrono::steady_clock::now() - pWatchedDocument->lastReloadTime).count();
+	return &pWatchedDocument->lastChangedRanges;
+}
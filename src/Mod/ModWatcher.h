@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Core/FileWriter.h" // FileWriter::Range
+#include "Core/Helpers.h"
+
+#include "Mod/ModDocuments.h" // ModDocumentHandle
+
+#include <vector>
+
+//
+// Reloads open documents when other programs, such as the hoff tool, change their files (see FileWatcher).
+//
+// Notifications are debounced, so a burst of writes causes one reload. The file is read on a worker thread and
+// compared with the document's data there. Only a file whose contents actually changed replaces the data, and the
+// changed byte ranges are kept so that views can show them. A document with unsaved changes is never reloaded;
+// a warning is logged instead. The document's own saves are recognised and ignored.
+//
+class ModWatcher
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(ModWatcher);
+
+	static void Shutdown();
+
+	// Call once per frame, after ModSaver::Update. Watches and unwatches documents as they are opened, saved
+	// elsewhere and closed.
+	static void Update();
+
+	// The byte ranges that changed in the document's most recent reload, or nullptr if it hasn't been reloaded
+	static const std::vector<FileWriter::Range>* GetLastChangedRanges(ModDocumentHandle handle, float& secondsSinceReload);
+};
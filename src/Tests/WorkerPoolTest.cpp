@@ -0,0 +1,180 @@
+//
+// Checks that WorkerPool completes every job, rather than WaitAll or Stop hanging or dropping jobs, when workers
+// die. Runs the pool against hoffgui_standin_worker, using its --die and --die-after job args.
+//
+// Usage: hoffgui_worker_pool_test [--worker path] [--show-log]
+//
+// Exits with EXIT_SUCCESS if every check passes. POSIX only, as is the worker pool.
+//
+
+#include "Core/WorkerPool.h"
+
+#include "Core/Log.h"
+#include "Core/hp_assert.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#ifdef _MSC_VER
+static const char* kStandInWorkerFilename = "hoffgui_standin_worker.exe";
+#else
+static const char* kStandInWorkerFilename = "hoffgui_standin_worker";
+#endif
+
+static const unsigned int kWorkerCount = 2;
+
+struct JobResults
+{
+	unsigned int succeededCount = 0;
+	unsigned int failedCount = 0;
+	unsigned int resubmittedJobId = 0; // see stopCallback
+};
+
+static void countCallback(unsigned int jobId, unsigned int exitCode, const char* output, size_t outputSizeBytes, void* pUserData)
+{
+	HP_UNUSED(jobId);
+	HP_UNUSED(output);
+	HP_UNUSED(outputSizeBytes);
+	JobResults& results = *(JobResults*)pUserData;
+	if (exitCode == EXIT_SUCCESS)
+		results.succeededCount++;
+	else
+		results.failedCount++;
+}
+
+// Submits a follow-up job, as a caller chaining jobs would
+static void stopCallback(unsigned int jobId, unsigned int exitCode, const char* output, size_t outputSizeBytes, void* pUserData)
+{
+	countCallback(jobId, exitCode, output, outputSizeBytes, pUserData);
+	const char* argv[] = { "standin", nullptr };
+	((JobResults*)pUserData)->resubmittedJobId = WorkerPool::Submit(argv, countCallback, pUserData);
+}
+
+static bool check(bool passed, const char* name, const JobResults& results)
+{
+	printf("%-28s %s (%u succeeded, %u failed)\n", name, passed ? "passed" : "FAILED", results.succeededCount, results.failedCount);
+	return passed;
+}
+
+// A worker that responds and then exits still delivers its response
+static bool testDieAfterResponse(const char* workerPath)
+{
+	JobResults results;
+	if (!WorkerPool::Start(workerPath, kWorkerCount))
+		return check(false, "die after response", results);
+
+	const char* dieAfterArgv[] = { "standin", "--die-after", nullptr };
+	WorkerPool::Submit(dieAfterArgv, countCallback, &results);
+	WorkerPool::WaitAll();
+	WorkerPool::Stop();
+
+	return check(results.succeededCount == 1 && results.failedCount == 0, "die after response", results);
+}
+
+// Jobs that crash fresh workers fail, but don't drain the pool: the jobs behind them still run
+static bool testPoisonJobs(const char* workerPath)
+{
+	JobResults poisonResults;
+	JobResults results;
+	if (!WorkerPool::Start(workerPath, kWorkerCount))
+		return check(false, "poison jobs", results);
+
+	const unsigned int respawnsBefore = WorkerPool::GetStats().workerRespawns;
+	const char* dieArgv[] = { "standin", "--die", nullptr };
+	const char* argv[] = { "standin", nullptr };
+	for (unsigned int jobIndex = 0; jobIndex < kWorkerCount * 2; jobIndex++)
+		WorkerPool::Submit(dieArgv, countCallback, &poisonResults);
+	for (unsigned int jobIndex = 0; jobIndex < kWorkerCount * 2; jobIndex++)
+		WorkerPool::Submit(argv, countCallback, &results);
+	WorkerPool::WaitAll();
+	const bool respawned = WorkerPool::GetStats().workerRespawns > respawnsBefore && WorkerPool::GetWorkerCount() > 0;
+	WorkerPool::Stop();
+
+	check(poisonResults.succeededCount == 0 && poisonResults.failedCount == kWorkerCount * 2, "poison jobs", poisonResults);
+	return check(respawned && results.succeededCount == kWorkerCount * 2 && results.failedCount == 0, "jobs after poison jobs", results)
+		&& poisonResults.failedCount == kWorkerCount * 2;
+}
+
+// Workers that always die are respawned a limited number of times, then queued jobs fail rather than WaitAll hanging
+static bool testBrokenWorker(const char* workerPath)
+{
+	static const unsigned int kJobCount = 50;
+
+	JobResults results;
+	const char* workerArgs[] = { "--die", nullptr };
+	if (!WorkerPool::Start(workerPath, kWorkerCount, workerArgs))
+		return check(false, "broken worker", results);
+
+	const char* argv[] = { "standin", nullptr };
+	for (unsigned int jobIndex = 0; jobIndex < kJobCount; jobIndex++)
+		WorkerPool::Submit(argv, countCallback, &results);
+	WorkerPool::WaitAll();
+	WorkerPool::Stop();
+
+	return check(results.succeededCount == 0 && results.failedCount == kJobCount, "broken worker", results);
+}
+
+// Jobs submitted by completion callbacks while Stop waits for in-flight jobs are rejected, and queued jobs fail
+static bool testStop(const char* workerPath)
+{
+	JobResults results;
+	if (!WorkerPool::Start(workerPath, kWorkerCount))
+		return check(false, "stop", results);
+
+	const char* sleepArgv[] = { "standin", "--sleep-ms", "50", nullptr };
+	for (unsigned int jobIndex = 0; jobIndex < kWorkerCount; jobIndex++)
+		WorkerPool::Submit(sleepArgv, stopCallback, &results);
+	WorkerPool::Update(); // dispatch
+	const char* argv[] = { "standin", nullptr };
+	WorkerPool::Submit(argv, countCallback, &results);
+	results.resubmittedJobId = 1;
+	WorkerPool::Stop();
+
+	return check(results.succeededCount == kWorkerCount && results.failedCount == 1 && results.resubmittedJobId == 0
+		&& WorkerPool::GetQueuedJobCount() == 0, "stop", results);
+}
+
+int main(int argc, char* argv[])
+{
+	std::string workerPath;
+	bool showLog = false;
+
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		if (strcmp(argv[argIndex], "--worker") == 0 && argIndex + 1 < argc)
+			workerPath = argv[++argIndex];
+		else if (strcmp(argv[argIndex], "--show-log") == 0)
+			showLog = true;
+		else
+		{
+			printf("Usage: hoffgui_worker_pool_test [--worker path] [--show-log]\n");
+			return EXIT_FAILURE;
+		}
+	}
+
+	// Default to the stand-in worker next to this executable
+	if (workerPath.empty())
+	{
+		workerPath = argv[0];
+		const size_t slashPos = workerPath.find_last_of("/\\");
+		workerPath.resize(slashPos == std::string::npos ? 0 : slashPos + 1);
+		if (workerPath.empty())
+			workerPath = "./";
+		workerPath += kStandInWorkerFilename;
+	}
+
+	// Every failed job is logged as an error
+	if (!showLog)
+		SetLogLevel(LOG_LEVEL_NONE);
+
+	bool passed = testDieAfterResponse(workerPath.c_str());
+	passed = testPoisonJobs(workerPath.c_str()) && passed;
+	passed = testBrokenWorker(workerPath.c_str()) && passed;
+	passed = testStop(workerPath.c_str()) && passed;
+
+	printf("%s\n", passed ? "All passed" : "FAILED");
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
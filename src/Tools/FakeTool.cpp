@@ -0,0 +1,211 @@
+//
+// Fake external tool for the process pipeline benchmark. Emits a configurable volume and pattern of
+// stdout/stderr output at a configurable rate.
+//
+// Usage: hoffgui_fake_tool [options]
+//   --bytes N              total bytes to write (default 1 MB)
+//   --line-length N        line length including the newline (default 80)
+//   --stream S             stdout, stderr or both (alternate lines) (default stdout)
+//   --progress-every N     after every N lines write a "\r" progress update, like IRA's percentages (default 0 = off)
+//   --rate-kbps N          limit the output rate to N KB/s (default 0 = unlimited)
+//   --chunk-bytes N        bytes per write (default 4096)
+//   --timestamp-every N    start every Nth line with "@T<20 digit ns>", the steady clock time at which the line is
+//                          written, so the reader can measure latency (default 0 = off)
+//   --pattern P            text, percent (lines full of printf conversion specifiers) or ansi (ANSI colour escape
+//                          sequences every few words) (default text)
+//   --exit-code N          (default 0)
+//
+// n.b. Timestamps assume std::chrono::steady_clock is system wide, which is true for CLOCK_MONOTONIC on
+// Linux/macOS and QueryPerformanceCounter on Windows.
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Options
+{
+	uint64_t totalBytes = 1024 * 1024;
+	unsigned int lineLength = 80;
+	bool useStdout = true;
+	bool useStderr = false;
+	unsigned int progressEvery = 0;
+	unsigned int rateKBps = 0;
+	unsigned int chunkBytes = 4096;
+	unsigned int timestampEvery = 0;
+	const char* pattern = "text";
+	int exitCode = EXIT_SUCCESS;
+};
+
+static bool parseArgs(int argc, char* argv[], Options& options)
+{
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		const char* arg = argv[argIndex];
+		if (argIndex + 1 >= argc)
+		{
+			fprintf(stderr, "fake tool: missing value for %s\n", arg);
+			return false;
+		}
+		const char* value = argv[++argIndex];
+
+		if (strcmp(arg, "--bytes") == 0)
+			options.totalBytes = strtoull(value, nullptr, 10);
+		else if (strcmp(arg, "--line-length") == 0)
+			options.lineLength = (unsigned int)strtoul(value, nullptr, 10);
+		else if (strcmp(arg, "--stream") == 0)
+		{
+			options.useStdout = strcmp(value, "stderr") != 0;
+			options.useStderr = strcmp(value, "stdout") != 0;
+		}
+		else if (strcmp(arg, "--progress-every") == 0)
+			options.progressEvery = (unsigned int)strtoul(value, nullptr, 10);
+		else if (strcmp(arg, "--rate-kbps") == 0)
+			options.rateKBps = (unsigned int)strtoul(value, nullptr, 10);
+		else if (strcmp(arg, "--chunk-bytes") == 0)
+			options.chunkBytes = (unsigned int)strtoul(value, nullptr, 10);
+		else if (strcmp(arg, "--timestamp-every") == 0)
+			options.timestampEvery = (unsigned int)strtoul(value, nullptr, 10);
+		else if (strcmp(arg, "--pattern") == 0)
+			options.pattern = value;
+		else if (strcmp(arg, "--exit-code") == 0)
+			options.exitCode = atoi(value);
+		else
+		{
+			fprintf(stderr, "fake tool: unknown option %s\n", arg);
+			return false;
+		}
+	}
+
+	if (options.lineLength < 2)
+		options.lineLength = 2;
+	if (options.chunkBytes == 0)
+		options.chunkBytes = 1;
+	return true;
+}
+
+static uint64_t nowNanoseconds()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const char kTimestampPrefix[] = "@T";
+static const unsigned int kTimestampDigits = 20;
+
+struct Stream
+{
+	FILE* pFile;
+	std::string pending;
+	std::vector<size_t> timestampOffsets; // of the digits in pending, filled in at write time
+};
+
+static void flushStream(Stream& stream)
+{
+	if (stream.pending.empty())
+		return;
+
+	if (!stream.timestampOffsets.empty())
+	{
+		char digits[kTimestampDigits + 1];
+		snprintf(digits, sizeof(digits), "%020llu", (unsigned long long)nowNanoseconds());
+		for (size_t offset : stream.timestampOffsets)
+			memcpy(&stream.pending[offset], digits, kTimestampDigits);
+		stream.timestampOffsets.clear();
+	}
+
+	fwrite(stream.pending.data(), 1, stream.pending.size(), stream.pFile);
+	fflush(stream.pFile);
+	stream.pending.clear();
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!parseArgs(argc, argv, options))
+		return EXIT_FAILURE;
+
+	// Buffered explicitly below so that chunk sizes are under our control
+	setvbuf(stdout, nullptr, _IONBF, 0);
+	setvbuf(stderr, nullptr, _IONBF, 0);
+
+	Stream streams[2] = { { stdout, {}, {} }, { stderr, {}, {} } };
+
+	static const char kTextFill[] = "abcdefghijklmnopqrstuvwxyz0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ ";
+	static const char kPercentFill[] = "%s %d %n %% 100% %x %p ";
+	static const char kAnsiFill[] = "\x1b[32mgreen\x1b[0m plain \x1b[1;31mbold red\x1b[0m \x1b[38;5;208m256\x1b[39m ";
+	const char* fill = kTextFill;
+	if (strcmp(options.pattern, "percent") == 0)
+		fill = kPercentFill;
+	else if (strcmp(options.pattern, "ansi") == 0)
+		fill = kAnsiFill;
+	const size_t fillLength = strlen(fill);
+
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	uint64_t bytesWritten = 0;
+	uint64_t lineIndex = 0;
+	std::string line;
+	while (bytesWritten < options.totalBytes)
+	{
+		const bool toStderr = options.useStderr && (!options.useStdout || (lineIndex & 1));
+		Stream& stream = streams[toStderr ? 1 : 0];
+
+		// Build the line
+		line.clear();
+		size_t timestampOffset = std::string::npos;
+		if (options.timestampEvery && (lineIndex % options.timestampEvery) == 0)
+		{
+			line += kTimestampPrefix;
+			timestampOffset = line.size();
+			line.append(kTimestampDigits, '0');
+			line += ' ';
+		}
+		char prefix[32];
+		snprintf(prefix, sizeof(prefix), "line %08llu ", (unsigned long long)lineIndex);
+		line += prefix;
+		while (line.size() < options.lineLength - 1)
+			line += fill[line.size() % fillLength];
+		line.resize(options.lineLength - 1);
+		line += '\n';
+
+		if (options.progressEvery && lineIndex > 0 && (lineIndex % options.progressEvery) == 0)
+		{
+			char progress[32];
+			snprintf(progress, sizeof(progress), "progress: %3u%%\r", (unsigned int)(bytesWritten * 100 / options.totalBytes));
+			line.insert(0, progress);
+			if (timestampOffset != std::string::npos)
+				timestampOffset += strlen(progress);
+		}
+
+		if (timestampOffset != std::string::npos && timestampOffset + kTimestampDigits < line.size())
+			stream.timestampOffsets.push_back(stream.pending.size() + timestampOffset);
+		stream.pending += line;
+		bytesWritten += line.size();
+		lineIndex++;
+
+		if (stream.pending.size() >= options.chunkBytes)
+			flushStream(stream);
+
+		// Throttle
+		if (options.rateKBps)
+		{
+			const double targetSeconds = (double)bytesWritten / (options.rateKBps * 1024.0);
+			const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+			if (targetSeconds > elapsedSeconds)
+			{
+				flushStream(streams[0]);
+				flushStream(streams[1]);
+				std::this_thread::sleep_for(std::chrono::duration<double>(targetSeconds - elapsedSeconds));
+			}
+		}
+	}
+
+	flushStream(streams[0]);
+	flushStream(streams[1]);
+	return options.exitCode;
+}
@@ -0,0 +1,179 @@
+//
+// Stand-in for an external tool, used to exercise WorkerPool and to measure job throughput without the real tool.
+//
+// Usage:
+//   hoffgui_standin_worker [--startup-ms N] --worker [job args...]   serve WorkerProtocol requests on stdin/stdout until stdin is closed
+//   hoffgui_standin_worker [--startup-ms N] [job args...]            run a single job and exit with its exit code
+//
+// --startup-ms simulates the fixed startup cost of a real tool (loading, initialisation) which a worker pays once.
+//
+// Job args:
+//   --sleep-ms N        simulate N milliseconds of work
+//   --output-bytes N    write N bytes of text output
+//   --exit-code N       exit code of the job
+//   --die               worker mode: exit without responding, as if the worker crashed
+//   --die-after         worker mode: respond, then exit
+// Any other argument is echoed to the output.
+//
+// Deliberately does not depend on SDL or any other hoffgui code other than the header-only protocol.
+//
+
+#include "Core/WorkerProtocol.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <fcntl.h> // _O_BINARY
+#include <io.h> // _setmode
+#endif
+
+static void sleepMilliseconds(unsigned long ms)
+{
+	if (ms > 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+enum class WorkerExit
+{
+	None,
+	BeforeResponse,
+	AfterResponse,
+};
+
+// Returns exit code. args[0] is the tool name.
+static unsigned int runJob(const std::vector<std::string>& args, std::string& output, WorkerExit& workerExit)
+{
+	workerExit = WorkerExit::None;
+	unsigned int exitCode = EXIT_SUCCESS;
+	unsigned long sleepMs = 0;
+	unsigned long outputBytes = 0;
+
+	for (size_t argIndex = 1; argIndex < args.size(); argIndex++)
+	{
+		const std::string& arg = args[argIndex];
+		const bool hasValue = argIndex + 1 < args.size();
+		if (arg == "--sleep-ms" && hasValue)
+			sleepMs = strtoul(args[++argIndex].c_str(), nullptr, 10);
+		else if (arg == "--output-bytes" && hasValue)
+			outputBytes = strtoul(args[++argIndex].c_str(), nullptr, 10);
+		else if (arg == "--exit-code" && hasValue)
+			exitCode = (unsigned int)strtoul(args[++argIndex].c_str(), nullptr, 10);
+		else if (arg == "--die")
+			workerExit = WorkerExit::BeforeResponse;
+		else if (arg == "--die-after")
+			workerExit = WorkerExit::AfterResponse;
+		else
+		{
+			output += arg;
+			output += '\n';
+		}
+	}
+
+	sleepMilliseconds(sleepMs);
+
+	// Lines of printable text, similar to disassembler output
+	static const char kLine[] = "standin: 0123456789abcdefghijklmnopqrstuvwxyz\n";
+	while (outputBytes > 0)
+	{
+		const size_t chunkSize = outputBytes < sizeof(kLine) - 1 ? outputBytes : sizeof(kLine) - 1;
+		output.append(kLine, chunkSize);
+		outputBytes -= chunkSize;
+	}
+
+	return exitCode;
+}
+
+static bool readExactly(void* pBuffer, size_t sizeBytes)
+{
+	return fread(pBuffer, 1, sizeBytes, stdin) == sizeBytes;
+}
+
+static int serveRequests(const std::vector<std::string>& workerArgs)
+{
+	std::vector<uint8_t> payload;
+	std::vector<std::string> args;
+	std::vector<uint8_t> response;
+	std::string output;
+
+	for (;;)
+	{
+		uint8_t header[WorkerProtocol::kFrameHeaderSizeBytes];
+		if (!readExactly(header, sizeof(header)))
+			return EXIT_SUCCESS; // stdin closed; normal shutdown
+
+		const uint32_t payloadSizeBytes = WorkerProtocol::ReadUint32(header);
+		if (payloadSizeBytes > WorkerProtocol::kMaxPayloadSizeBytes)
+		{
+			fprintf(stderr, "standin worker: corrupt request header\n");
+			return EXIT_FAILURE;
+		}
+
+		payload.resize(payloadSizeBytes);
+		if (!readExactly(payload.data(), payloadSizeBytes))
+		{
+			fprintf(stderr, "standin worker: truncated request\n");
+			return EXIT_FAILURE;
+		}
+
+		if (!WorkerProtocol::DecodeRequest(payload.data(), payload.size(), args) || args.empty())
+		{
+			fprintf(stderr, "standin worker: malformed request\n");
+			return EXIT_FAILURE;
+		}
+
+		// Worker args apply to every job, ahead of the job's own args
+		args.insert(args.begin() + 1, workerArgs.begin(), workerArgs.end());
+
+		output.clear();
+		WorkerExit workerExit = WorkerExit::None;
+		const unsigned int exitCode = runJob(args, output, workerExit);
+		if (workerExit == WorkerExit::BeforeResponse)
+			return EXIT_FAILURE;
+
+		response.clear();
+		WorkerProtocol::EncodeResponse(exitCode, output.data(), output.size(), response);
+		if (fwrite(response.data(), 1, response.size(), stdout) != response.size() || fflush(stdout) != 0)
+			return EXIT_FAILURE; // parent has gone away
+		if (workerExit == WorkerExit::AfterResponse)
+			return EXIT_SUCCESS;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	bool workerMode = false;
+	std::vector<std::string> args;
+	args.push_back(argv[0]);
+	for (int argIndex = 1; argIndex < argc; argIndex++)
+	{
+		if (strcmp(argv[argIndex], "--startup-ms") == 0 && argIndex + 1 < argc)
+			sleepMilliseconds(strtoul(argv[++argIndex], nullptr, 10));
+		else if (strcmp(argv[argIndex], "--worker") == 0)
+			workerMode = true;
+		else
+			args.push_back(argv[argIndex]);
+	}
+
+	if (workerMode)
+	{
+#ifdef _MSC_VER
+		_setmode(_fileno(stdin), _O_BINARY);
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+		args.erase(args.begin());
+		return serveRequests(args);
+	}
+
+	std::string output;
+	WorkerExit workerExit = WorkerExit::None; // only meaningful to a worker
+	const unsigned int exitCode = runJob(args, output, workerExit);
+	fwrite(output.data(), 1, output.size(), stdout);
+	return (int)exitCode;
+}
@@ -0,0 +1,202 @@
+#include "ContentHash.h"
+
+#include "Core/StringHelpers.h"
+#include "Core/hp_assert.h"
+
+#include <string.h> // memcpy
+
+#include <array>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONTENT_HASH_SSE2 1
+#include <emmintrin.h>
+#else
+// #TODO: NEON. The scalar lanes are independent, so compilers vectorise them reasonably anyway.
+#define CONTENT_HASH_SSE2 0
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h> // _umul128
+#endif
+
+static const size_t kLaneCount = 8;
+static const size_t kStripeSizeBytes = kLaneCount * sizeof(uint64_t);
+static const size_t kStripesPerBlock = 16;
+static const size_t kBlockSizeBytes = kStripeSizeBytes * kStripesPerBlock;
+
+static const uint64_t kPrime32_1 = 0x9E3779B1ull;
+static const uint64_t kPrime64_1 = 0x9E3779B185EBCA87ull;
+static const uint64_t kPrime64_2 = 0xC2B2AE3D27D4EB4Full;
+static const uint64_t kAvalancheMultiplier = 0x165667919E3779F9ull;
+
+// Stripe s of each block uses keys [s, s + kLaneCount), so the same data at different positions hashes differently.
+// The block scramble uses the last kLaneCount keys.
+static const size_t kScrambleKeyIndex = kStripesPerBlock;
+static const size_t kKeyCount = kScrambleKeyIndex + kLaneCount;
+
+// splitmix64, from an arbitrary seed
+static constexpr std::array<uint64_t, kKeyCount> makeKeys()
+{
+	std::array<uint64_t, kKeyCount> keys = {};
+	uint64_t state = 0x243F6A8885A308D3ull;
+	for (uint64_t& key : keys)
+	{
+		state += 0x9E3779B97F4A7C15ull;
+		uint64_t z = state;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		key = z ^ (z >> 31);
+	}
+	return keys;
+}
+
+static constexpr std::array<uint64_t, kKeyCount> kKeys = makeKeys();
+
+static inline uint64_t read64(const uint8_t* p)
+{
+	uint64_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+// The high and low halves of the 128-bit product, xor'd
+static inline uint64_t multiplyFold64(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+	const unsigned __int128 product = (unsigned __int128)a * b;
+	return (uint64_t)product ^ (uint64_t)(product >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	uint64_t high;
+	const uint64_t low = _umul128(a, b, &high);
+	return low ^ high;
+#else
+	const uint64_t aLow = a & 0xffffffff, aHigh = a >> 32;
+	const uint64_t bLow = b & 0xffffffff, bHigh = b >> 32;
+	const uint64_t lowLow = aLow * bLow;
+	const uint64_t highLow = aHigh * bLow;
+	const uint64_t lowHigh = aLow * bHigh;
+	const uint64_t highHigh = aHigh * bHigh;
+	const uint64_t cross = (lowLow >> 32) + (highLow & 0xffffffff) + lowHigh;
+	const uint64_t low = (cross << 32) | (lowLow & 0xffffffff);
+	const uint64_t high = (highLow >> 32) + (cross >> 32) + highHigh;
+	return low ^ high;
+#endif
+}
+
+static inline uint64_t avalanche(uint64_t x)
+{
+	x ^= x >> 37;
+	x *= kAvalancheMultiplier;
+	x ^= x >> 32;
+	return x;
+}
+
+// Each lane adds the product of the 32-bit halves of its keyed data, and the unkeyed data of its neighbour so that
+// no input is lost when a half is zero
+static inline void accumulateStripe(uint64_t* pAccumulators, const uint8_t* pStripe, const uint64_t* pKeys)
+{
+#if CONTENT_HASH_SSE2
+	__m128i* pAccumulatorVectors = (__m128i*)pAccumulators;
+	for (size_t vectorIndex = 0; vectorIndex < kLaneCount / 2; vectorIndex++)
+	{
+		const __m128i data = _mm_loadu_si128((const __m128i*)pStripe + vectorIndex);
+		const __m128i key = _mm_loadu_si128((const __m128i*)pKeys + vectorIndex);
+		const __m128i keyed = _mm_xor_si128(data, key);
+		const __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+		const __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+		pAccumulatorVectors[vectorIndex] = _mm_add_epi64(pAccumulatorVectors[vectorIndex], _mm_add_epi64(product, swapped));
+	}
+#else
+	for (size_t lane = 0; lane < kLaneCount; lane++)
+	{
+		const uint64_t data = read64(pStripe + lane * sizeof(uint64_t));
+		const uint64_t keyed = data ^ pKeys[lane];
+		pAccumulators[lane ^ 1] += data;
+		pAccumulators[lane] += (keyed & 0xffffffff) * (keyed >> 32);
+	}
+#endif
+}
+
+// Mixes the high bits down after each block, as accumulation only carries upwards
+static inline void scrambleAccumulators(uint64_t* pAccumulators)
+{
+	const uint64_t* pKeys = &kKeys[kScrambleKeyIndex];
+#if CONTENT_HASH_SSE2
+	__m128i* pAccumulatorVectors = (__m128i*)pAccumulators;
+	const __m128i prime = _mm_set1_epi32((int)kPrime32_1);
+	for (size_t vectorIndex = 0; vectorIndex < kLaneCount / 2; vectorIndex++)
+	{
+		__m128i accumulator = pAccumulatorVectors[vectorIndex];
+		accumulator = _mm_xor_si128(accumulator, _mm_srli_epi64(accumulator, 47));
+		accumulator = _mm_xor_si128(accumulator, _mm_loadu_si128((const __m128i*)pKeys + vectorIndex));
+		const __m128i productLow = _mm_mul_epu32(accumulator, prime);
+		const __m128i productHigh = _mm_mul_epu32(_mm_srli_epi64(accumulator, 32), prime);
+		pAccumulatorVectors[vectorIndex] = _mm_add_epi64(productLow, _mm_slli_epi64(productHigh, 32));
+	}
+#else
+	for (size_t lane = 0; lane < kLaneCount; lane++)
+	{
+		uint64_t accumulator = pAccumulators[lane];
+		accumulator ^= accumulator >> 47;
+		accumulator ^= pKeys[lane];
+		pAccumulators[lane] = accumulator * kPrime32_1;
+	}
+#endif
+}
+
+static uint64_t mergeAccumulators(const uint64_t* pAccumulators, const uint64_t* pKeys, uint64_t start)
+{
+	uint64_t result = start;
+	for (size_t lane = 0; lane < kLaneCount; lane += 2)
+		result += multiplyFold64(pAccumulators[lane] ^ pKeys[lane], pAccumulators[lane + 1] ^ pKeys[lane + 1]);
+	return avalanche(result);
+}
+
+//------------------------------------------------------------------------------------------------
+
+ContentHash::Hash128 ContentHash::Hash(const void* pData, size_t sizeBytes)
+{
+	HP_ASSERT(pData || sizeBytes == 0);
+	const uint8_t* pBytes = (const uint8_t*)pData;
+
+	alignas(16) uint64_t accumulators[kLaneCount] =
+	{
+		kPrime32_1, kPrime64_1, kPrime64_2, kAvalancheMultiplier,
+		~kPrime32_1, ~kPrime64_1, ~kPrime64_2, ~kAvalancheMultiplier,
+	};
+
+	const size_t blockCount = sizeBytes / kBlockSizeBytes;
+	for (size_t blockIndex = 0; blockIndex < blockCount; blockIndex++)
+	{
+		const uint8_t* pBlock = pBytes + blockIndex * kBlockSizeBytes;
+		for (size_t stripeIndex = 0; stripeIndex < kStripesPerBlock; stripeIndex++)
+			accumulateStripe(accumulators, pBlock + stripeIndex * kStripeSizeBytes, &kKeys[stripeIndex]);
+		scrambleAccumulators(accumulators);
+	}
+
+	// The remainder is a partial block, ending with a partial stripe zero-padded. The size is merged in below,
+	// so padding doesn't collide with data that really ends with zeros.
+	const uint8_t* pRemainder = pBytes + blockCount * kBlockSizeBytes;
+	const size_t remainderSizeBytes = sizeBytes - blockCount * kBlockSizeBytes;
+	const size_t stripeCount = remainderSizeBytes / kStripeSizeBytes;
+	for (size_t stripeIndex = 0; stripeIndex < stripeCount; stripeIndex++)
+		accumulateStripe(accumulators, pRemainder + stripeIndex * kStripeSizeBytes, &kKeys[stripeIndex]);
+	const size_t tailSizeBytes = remainderSizeBytes - stripeCount * kStripeSizeBytes;
+	if (tailSizeBytes > 0)
+	{
+		uint8_t tail[kStripeSizeBytes] = {};
+		memcpy(tail, pRemainder + stripeCount * kStripeSizeBytes, tailSizeBytes);
+		accumulateStripe(accumulators, tail, &kKeys[stripeCount]);
+	}
+
+	Hash128 hash;
+	hash.low = mergeAccumulators(accumulators, &kKeys[0], (uint64_t)sizeBytes * kPrime64_1);
+	hash.high = mergeAccumulators(accumulators, &kKeys[kLaneCount], ~((uint64_t)sizeBytes * kPrime64_2));
+	return hash;
+}
+
+void ContentHash::ToHexString(const Hash128& hash, char* buffer, size_t bufferSize)
+{
+	HP_ASSERT(bufferSize >= kHexStringSize);
+	SafeSnprintf(buffer, bufferSize, "%016llx%016llx", (unsigned long long)hash.high, (unsigned long long)hash.low);
+}
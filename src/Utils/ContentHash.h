@@ -0,0 +1,37 @@
+#pragma once
+
+//
+// Fast non-cryptographic 128-bit content hash
+//
+// Used to tell whether two buffers are identical e.g. cache keys, deduplication and change detection. Several GB/s,
+// so cheap enough to hash whole modules. Not for security, or anything an adversary could choose data to collide:
+// use Sha256 for that.
+//
+// Input is processed in 64-byte stripes by eight 64-bit lanes. The SSE2 path processes two lanes per instruction and
+// gives the same results as the scalar path. Results are for little-endian hosts.
+//
+
+#include "Core/Helpers.h"
+
+#include <stdint.h>
+#include <stddef.h> // size_t
+
+class ContentHash
+{
+public:
+	NON_INSTANTIABLE_STATIC_CLASS(ContentHash);
+
+	static const unsigned int kHexStringSize = 32 + 1; // including null-terminator
+
+	struct Hash128
+	{
+		uint64_t low = 0;
+		uint64_t high = 0;
+
+		bool operator==(const Hash128& other) const { return low == other.low && high == other.high; }
+		bool operator!=(const Hash128& other) const { return !(*this == other); }
+	};
+
+	static Hash128 Hash(const void* pData, size_t sizeBytes);
+	static void ToHexString(const Hash128& hash, char* buffer, size_t bufferSize);
+};
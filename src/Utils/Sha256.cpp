@@ -0,0 +1,215 @@
+#include "Sha256.h"
+
+#include "Core/hp_assert.h"
+
+#include <stdio.h>
+#include <string.h> // memcpy
+
+static const uint32_t kRoundConstants[64] =
+{
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline uint32_t rotateRight(uint32_t x, unsigned int n)
+{
+	return (x >> n) | (x << (32 - n));
+}
+
+Sha256::Sha256()
+{
+	Reset();
+}
+
+void Sha256::Reset()
+{
+	m_state[0] = 0x6a09e667;
+	m_state[1] = 0xbb67ae85;
+	m_state[2] = 0x3c6ef372;
+	m_state[3] = 0xa54ff53a;
+	m_state[4] = 0x510e527f;
+	m_state[5] = 0x9b05688c;
+	m_state[6] = 0x1f83d9ab;
+	m_state[7] = 0x5be0cd19;
+	m_totalSizeBytes = 0;
+	m_blockSizeBytes = 0;
+}
+
+void Sha256::processBlock(const uint8_t* pBlock)
+{
+	uint32_t w[64];
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		// big endian
+		w[i] = ((uint32_t)pBlock[i * 4 + 0] << 24) | ((uint32_t)pBlock[i * 4 + 1] << 16) | ((uint32_t)pBlock[i * 4 + 2] << 8) | (uint32_t)pBlock[i * 4 + 3];
+	}
+	for (unsigned int i = 16; i < 64; i++)
+	{
+		const uint32_t s0 = rotateRight(w[i - 15], 7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >> 3);
+		const uint32_t s1 = rotateRight(w[i - 2], 17) ^ rotateRight(w[i - 2], 19) ^ (w[i - 2] >> 10);
+		w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+	}
+
+	uint32_t a = m_state[0];
+	uint32_t b = m_state[1];
+	uint32_t c = m_state[2];
+	uint32_t d = m_state[3];
+	uint32_t e = m_state[4];
+	uint32_t f = m_state[5];
+	uint32_t g = m_state[6];
+	uint32_t h = m_state[7];
+
+	for (unsigned int i = 0; i < 64; i++)
+	{
+		const uint32_t s1 = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+		const uint32_t ch = (e & f) ^ (~e & g);
+		const uint32_t temp1 = h + s1 + ch + kRoundConstants[i] + w[i];
+		const uint32_t s0 = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+		const uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+		const uint32_t temp2 = s0 + maj;
+
+		h = g;
+		g = f;
+		f = e;
+		e = d + temp1;
+		d = c;
+		c = b;
+		b = a;
+		a = temp1 + temp2;
+	}
+
+	m_state[0] += a;
+	m_state[1] += b;
+	m_state[2] += c;
+	m_state[3] += d;
+	m_state[4] += e;
+	m_state[5] += f;
+	m_state[6] += g;
+	m_state[7] += h;
+}
+
+void Sha256::Update(const void* pData, size_t sizeBytes)
+{
+	HP_ASSERT(pData != nullptr || sizeBytes == 0);
+
+	const uint8_t* pBytes = (const uint8_t*)pData;
+	m_totalSizeBytes += sizeBytes;
+
+	// Top up a partial block first
+	if (m_blockSizeBytes > 0)
+	{
+		size_t copySizeBytes = sizeof(m_block) - m_blockSizeBytes;
+		if (copySizeBytes > sizeBytes)
+			copySizeBytes = sizeBytes;
+		memcpy(m_block + m_blockSizeBytes, pBytes, copySizeBytes);
+		m_blockSizeBytes += (unsigned int)copySizeBytes;
+		pBytes += copySizeBytes;
+		sizeBytes -= copySizeBytes;
+
+		if (m_blockSizeBytes < sizeof(m_block))
+			return;
+
+		processBlock(m_block);
+		m_blockSizeBytes = 0;
+	}
+
+	// Process whole blocks directly from the source data
+	while (sizeBytes >= sizeof(m_block))
+	{
+		processBlock(pBytes);
+		pBytes += sizeof(m_block);
+		sizeBytes -= sizeof(m_block);
+	}
+
+	if (sizeBytes > 0)
+	{
+		memcpy(m_block, pBytes, sizeBytes);
+		m_blockSizeBytes = (unsigned int)sizeBytes;
+	}
+}
+
+Sha256::Digest Sha256::Finish()
+{
+	const uint64_t totalSizeBits = m_totalSizeBytes * 8;
+
+	// Append 1 bit, pad with zeros, then append the 64-bit big endian message length
+	m_block[m_blockSizeBytes++] = 0x80;
+	if (m_blockSizeBytes > 56)
+	{
+		memset(m_block + m_blockSizeBytes, 0, sizeof(m_block) - m_blockSizeBytes);
+		processBlock(m_block);
+		m_blockSizeBytes = 0;
+	}
+	memset(m_block + m_blockSizeBytes, 0, 56 - m_blockSizeBytes);
+	for (unsigned int i = 0; i < 8; i++)
+		m_block[56 + i] = (uint8_t)(totalSizeBits >> (56 - i * 8));
+	processBlock(m_block);
+
+	Digest digest;
+	for (unsigned int i = 0; i < 8; i++)
+	{
+		digest.bytes[i * 4 + 0] = (uint8_t)(m_state[i] >> 24);
+		digest.bytes[i * 4 + 1] = (uint8_t)(m_state[i] >> 16);
+		digest.bytes[i * 4 + 2] = (uint8_t)(m_state[i] >> 8);
+		digest.bytes[i * 4 + 3] = (uint8_t)(m_state[i]);
+	}
+
+	Reset();
+	return digest;
+}
+
+Sha256::Digest Sha256::Hash(const void* pData, size_t sizeBytes)
+{
+	Sha256 sha;
+	sha.Update(pData, sizeBytes);
+	return sha.Finish();
+}
+
+bool Sha256::HashFile(const char* path, Digest& digest)
+{
+	HP_ASSERT(path && path[0]);
+
+	FILE* pFile = fopen(path, "rb");
+	if (!pFile)
+		return false;
+
+	Sha256 sha;
+	uint8_t buffer[64 * 1024];
+	for (;;)
+	{
+		const size_t bytesRead = fread(buffer, 1, sizeof(buffer), pFile);
+		if (bytesRead == 0)
+			break;
+		sha.Update(buffer, bytesRead);
+	}
+
+	const bool error = ferror(pFile) != 0;
+	fclose(pFile);
+	pFile = nullptr;
+
+	if (error)
+		return false;
+
+	digest = sha.Finish();
+	return true;
+}
+
+void Sha256::ToHexString(const Digest& digest, char* buffer, size_t bufferSize)
+{
+	HP_ASSERT(buffer != nullptr);
+	HP_ASSERT(bufferSize >= kHexStringSize);
+
+	static const char kHexDigits[] = "0123456789abcdef";
+	for (unsigned int i = 0; i < kDigestSizeBytes; i++)
+	{
+		buffer[i * 2 + 0] = kHexDigits[digest.bytes[i] >> 4];
+		buffer[i * 2 + 1] = kHexDigits[digest.bytes[i] & 0xf];
+	}
+	buffer[kDigestSizeBytes * 2] = '\0';
+}
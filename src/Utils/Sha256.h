@@ -0,0 +1,42 @@
+#pragma once
+
+//
+// SHA-256 (FIPS 180-4)
+//
+// Used where a strong content hash is required e.g. content-addressed cache keys.
+// Not optimised; typically hashing a handful of small files per child process launch.
+//
+
+#include <stdint.h>
+#include <stddef.h> // size_t
+
+class Sha256
+{
+public:
+	static const unsigned int kDigestSizeBytes = 32;
+	static const unsigned int kHexStringSize = kDigestSizeBytes * 2 + 1; // including null-terminator
+
+	struct Digest
+	{
+		uint8_t bytes[kDigestSizeBytes] = {};
+	};
+
+	Sha256();
+
+	void Reset();
+	void Update(const void* pData, size_t sizeBytes);
+	Digest Finish();
+
+	// Convenience helpers
+	static Digest Hash(const void* pData, size_t sizeBytes);
+	static bool HashFile(const char* path, Digest& digest); // returns false if the file could not be read
+	static void ToHexString(const Digest& digest, char* buffer, size_t bufferSize);
+
+private:
+	void processBlock(const uint8_t* pBlock);
+
+	uint32_t m_state[8];
+	uint64_t m_totalSizeBytes;
+	uint8_t m_block[64];
+	unsigned int m_blockSizeBytes;
+};
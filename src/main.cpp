@@ -59,7 +59,7 @@ static bool windowIniHandler(const char* pSection, const char* key, const char*
 	HP_ASSERT(pUserData != nullptr);
 	WindowInitParams& windowInitParams = *(WindowInitParams*)pUserData;
 
-	LOG_TRACE("Line %u: section=%s %s=%s\n", lineNumber, pSection ? pSection : "<none>", key, value);
+	LOG_CHANNEL_TRACE(Ini, "Line %u: section=%s %s=%s\n", lineNumber, pSection ? pSection : "<none>", key, value);
 
 	if (pSection == nullptr)
 		return false;
@@ -146,7 +146,7 @@ static SDL_Window* createWindow()
 		}
 		else
 		{
-			LOG_TRACE("Options file not found: %s\n", optionsPath);
+			LOG_CHANNEL_TRACE(Ini, "Options file not found: %s\n", optionsPath);
 		}
 	}
 
@@ -214,10 +214,20 @@ int main(int argc, char** argv)
 	SetLogLevel(LOG_LEVEL_DEBUG); // default log level for debug build
 #endif
 
-	LogSystemInfo();
-
 	ParseCommandLine(argc, argv);
 
+	const CommandLineArgs& commandLineArgs = GetCommandLineArgs();
+	if (commandLineArgs.logFilePath)
+	{
+		const uint64_t maxSizeBytes = commandLineArgs.logFileMaxSizeMB > 0 ? (uint64_t)commandLineArgs.logFileMaxSizeMB * 1024 * 1024 : kDefaultLogFileMaxSizeBytes;
+		if (OpenLogFile(commandLineArgs.logFilePath, maxSizeBytes))
+			LOG_INFO("hoffgui V%s%s\n", GetAppVersion(), GetAppVersonSuffix());
+		else
+			LOG_ERROR("Failed to open log file: %s\n", commandLineArgs.logFilePath);
+	}
+
+	LogSystemInfo(); // after the log file is opened, so that it's included
+
 	// Using SDL_INIT_GAMECONTROLLER produces a load of annoying debug output spam
 	Uint32 sdlInitFlags = SDL_INIT_VIDEO | SDL_INIT_TIMER /*| SDL_INIT_GAMECONTROLLER*/;
 	if (SDL_Init(sdlInitFlags) != 0)